@@ -0,0 +1,91 @@
+//==============================================================================
+// ChannelMatrix.h
+// Independent generator settings for every output channel.
+//==============================================================================
+
+#pragma once
+
+#include "GeneratorSwitcher.h"
+#include "SubBlockScheduler.h"
+
+/// ChannelMatrix holds a waveform, frequency and level for each output
+/// channel, plus a GeneratorSwitcher per channel that crossfades its
+/// waveform changes. While multichannel mode is enabled the main component
+/// renders every channel of the sub-block from its own switcher instead of
+/// fanning one generator out to all channels. The switchers share the
+/// read-only wavetables, and their slots sit side by side in the DSP arena,
+/// so the cost grows linearly with the channel count.
+class ChannelMatrix
+{
+public:
+  /// The most output channels the matrix drives.
+  static constexpr int maxChannels = 64;
+
+  /// The settings and audio thread state of one output channel.
+  struct Channel
+  {
+    /// The requested waveform id. Set from any thread.
+    std::atomic<int> waveform {0};
+    /// The channel level, 0 to 1. Set from any thread.
+    std::atomic<float> level {0.5f};
+    /// Renders the channel. Its frequency can be set from any thread.
+    GeneratorSwitcher switcher;
+    /// The waveform being rendered and the level the last sub-block ended
+    /// at. Only accessed on the audio thread.
+    int activeWaveform {0};
+    float currentLevel {0.0f};
+  };
+
+  ChannelMatrix()
+  {
+    for (auto& channel : channels)
+      channel.switcher.setFrequency (440.0);
+  }
+
+  /// Returns the arena space prepare() needs for numChannels channels.
+  static size_t getArenaBytes (int numChannels)
+  {
+    return (size_t) numChannels * GeneratorSwitcher::getArenaBytes (SubBlockScheduler::subBlockSize);
+  }
+
+  /// Prepares the switchers of the first numChannels channels. Every
+  /// channel starts out silent and fades in its waveform. Call from
+  /// prepareToPlay().
+  void prepare (DspArena& arena, int numChannels, double sampleRate, int fadeLength)
+  {
+    numChannels = jlimit (1, maxChannels, numChannels);
+    for (auto chan = 0; chan < numChannels; ++chan) {
+      auto& channel = channels[chan];
+      channel.switcher.setFadeLength (fadeLength);
+      channel.switcher.prepare (arena, SubBlockScheduler::subBlockSize, sampleRate);
+      channel.activeWaveform = 0;
+      channel.currentLevel = 0.0f;
+    }
+    numPrepared = numChannels;
+  }
+
+  /// Forgets the arena memory handed out by prepare(). Call from
+  /// releaseResources() before the arena is released.
+  void release()
+  {
+    for (auto& channel : channels)
+      channel.switcher.release();
+    numPrepared = 0;
+  }
+
+  /// Returns the number of channels prepare() set up.
+  int getNumChannels() const noexcept { return numPrepared.load(); }
+
+  Channel& getChannel (int index) noexcept { return channels[index]; }
+
+  /// Turns multichannel mode on or off. Safe to call from any thread.
+  void setEnabled (bool shouldBeEnabled) { enabled.store (shouldBeEnabled); }
+  bool isEnabled() const noexcept { return enabled.load(); }
+
+private:
+  Channel channels[maxChannels];
+  std::atomic<int> numPrepared {0};
+  std::atomic<bool> enabled {false};
+
+  JUCE_DECLARE_NON_COPYABLE (ChannelMatrix)
+};
@@ -0,0 +1,75 @@
+//==============================================================================
+// ChannelMatrixView.cpp
+// Edits the waveform, frequency and level of every output channel.
+//==============================================================================
+
+#include "ChannelMatrixView.h"
+
+ChannelMatrixView::ChannelMatrixView (ChannelMatrix& matrix, int numChannels, const PopupMenu& waveforms) {
+  addAndMakeVisible (enableButton);
+  enableButton.setToggleState (matrix.isEnabled(), dontSendNotification);
+  enableButton.onClick = [this, &matrix] {
+    matrix.setEnabled (enableButton.getToggleState());
+  };
+
+  numChannels = jlimit (1, ChannelMatrix::maxChannels, numChannels);
+  for (auto chan = 0; chan < numChannels; ++chan)
+    rows.addAndMakeVisible (rowList.add (new Row (matrix.getChannel (chan), chan, waveforms)));
+  viewport.setViewedComponent (&rows, false);
+  viewport.setScrollBarsShown (true, false);
+  addAndMakeVisible (viewport);
+  setSize (600, 400);
+}
+
+void ChannelMatrixView::resized() {
+  auto bounds = getLocalBounds().reduced (8);
+  enableButton.setBounds (bounds.removeFromTop (24));
+  bounds.removeFromTop (8);
+  viewport.setBounds (bounds);
+  auto width = viewport.getMaximumVisibleWidth();
+  rows.setSize (width, rowList.size() * rowHeight);
+  for (auto i = 0; i < rowList.size(); ++i)
+    rowList[i]->setBounds (0, i * rowHeight, width, rowHeight - 4);
+}
+
+ChannelMatrixView::Row::Row (ChannelMatrix::Channel& channel, int index, const PopupMenu& waveforms) {
+  addAndMakeVisible (name);
+  name.setText ("Ch " + String (index + 1), dontSendNotification);
+
+  addAndMakeVisible (waveform);
+  *waveform.getRootMenu() = waveforms;
+  waveform.setTextWhenNothingSelected ("Off");
+  waveform.setSelectedId (channel.waveform.load(), dontSendNotification);
+  waveform.onChange = [this, &channel] {
+    channel.waveform.store (waveform.getSelectedId());
+  };
+
+  addAndMakeVisible (frequency);
+  frequency.setSliderStyle (Slider::LinearHorizontal);
+  frequency.setTextBoxStyle (Slider::TextBoxLeft, false, 90, 22);
+  frequency.setRange (0.0, 5000.0);
+  frequency.setSkewFactorFromMidPoint (500.0);
+  frequency.setTextValueSuffix (" Hz");
+  frequency.setValue (channel.switcher.getFrequency(), dontSendNotification);
+  frequency.onValueChange = [this, &channel] {
+    channel.switcher.setFrequency (frequency.getValue());
+  };
+
+  addAndMakeVisible (level);
+  level.setSliderStyle (Slider::LinearHorizontal);
+  level.setTextBoxStyle (Slider::TextBoxLeft, false, 90, 22);
+  level.setRange (0.0, 1.0);
+  level.setValue (channel.level.load(), dontSendNotification);
+  level.onValueChange = [this, &channel] {
+    channel.level.store ((float) level.getValue());
+  };
+}
+
+void ChannelMatrixView::Row::resized() {
+  auto bounds = getLocalBounds();
+  name.setBounds (bounds.removeFromLeft (48));
+  waveform.setBounds (bounds.removeFromLeft (118));
+  bounds.removeFromLeft (8);
+  frequency.setBounds (bounds.removeFromLeft (bounds.getWidth() / 2));
+  level.setBounds (bounds);
+}
@@ -0,0 +1,45 @@
+//==============================================================================
+// ChannelMatrixView.h
+// Edits the waveform, frequency and level of every output channel.
+//==============================================================================
+
+#pragma once
+
+#include "ChannelMatrix.h"
+
+/// ChannelMatrixView shows a "Multichannel output" toggle above one row per
+/// output channel: a waveform menu, a frequency slider and a level slider.
+/// Every change is written straight to the ChannelMatrix, which the audio
+/// thread reads once per sub-block.
+class ChannelMatrixView : public Component
+{
+public:
+  /// Creates rows for numChannels channels. Each row's menu offers the
+  /// items of waveforms.
+  ChannelMatrixView (ChannelMatrix& matrix, int numChannels, const PopupMenu& waveforms);
+
+  void resized() override;
+
+private:
+  /// The controls of one channel.
+  struct Row : public Component
+  {
+    Row (ChannelMatrix::Channel& channel, int index, const PopupMenu& waveforms);
+    void resized() override;
+
+    Label name;
+    ComboBox waveform;
+    Slider frequency;
+    Slider level;
+  };
+
+  ToggleButton enableButton {"Multichannel output"};
+  Viewport viewport;
+  Component rows;
+  OwnedArray<Row> rowList;
+
+  /// Height of a row, including the gap below it.
+  static constexpr int rowHeight = 28;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChannelMatrixView)
+};
@@ -0,0 +1,45 @@
+//==============================================================================
+// CompactTables.cpp
+// 16 bit copies of the WT_* tables for the compact wavetable kernels.
+//==============================================================================
+
+#include "CompactTables.h"
+
+size_t CompactTables::getArenaBytes() {
+  // each format's copy and its spare
+  return (size_t) 4 * WaveTables::NumShapes * DspArena::bytesFor<uint16> (tableSamples);
+}
+
+void CompactTables::prepare (DspArena& arena, const WaveTableBank& bank) {
+  for (auto shape = 0; shape < WaveTables::NumShapes; ++shape) {
+    for (auto i = 0; i < 2; ++i) {
+      tables[shape][i] = arena.allocate<uint16> (tableSamples);
+      spares[shape][i] = arena.allocate<uint16> (tableSamples);
+    }
+    if (tables[shape][0] == nullptr || tables[shape][1] == nullptr
+        || spares[shape][0] == nullptr || spares[shape][1] == nullptr) {
+      release();
+      return;
+    }
+    encode (shape, bank.getTable (shape), tables[shape]);
+  }
+}
+
+void CompactTables::release() {
+  for (auto shape = 0; shape < WaveTables::NumShapes; ++shape) {
+    for (auto i = 0; i < 2; ++i)
+      tables[shape][i] = spares[shape][i] = nullptr;
+    sources[shape] = nullptr;
+  }
+}
+
+void CompactTables::encode (int shape, const AudioSampleBuffer& table, uint16* const* copies) noexcept {
+  auto numSamples = jmin (table.getNumSamples(), tableSamples);
+  const auto* samples = table.getReadPointer (0);
+  const WaveTables::Format formats[] {WaveTables::Float16, WaveTables::Int16};
+  for (auto i = 0; i < 2; ++i) {
+    WaveTables::encode (samples, numSamples, formats[i], copies[i]);
+    std::fill (copies[i] + numSamples, copies[i] + tableSamples, (uint16) 0);
+  }
+  sources[shape] = samples;
+}
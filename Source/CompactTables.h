@@ -0,0 +1,83 @@
+//==============================================================================
+// CompactTables.h
+// 16 bit copies of the WT_* tables for the compact wavetable kernels.
+//==============================================================================
+
+#pragma once
+
+#include "WaveTableBank.h"
+#include "DspArena.h"
+
+/// CompactTables keeps a copy of every WT_* table in each 16 bit format,
+/// for the CompactWavetable kernels. A float table of tableSize + 1 samples
+/// takes about 2 KB, a compact copy half that, so the oscillators read half
+/// the bytes and twice as many tables and voices stay in the L1 cache
+/// before they start missing.
+///
+/// The copies add to the memory resident rather than replace it: the
+/// bank's float tables remain the masters, read by the harmonic editor,
+/// the granular generator, the cache and the float kernel. getArenaBytes()
+/// is what the copies add. They live in the DSP arena and are encoded by
+/// prepare() from the tables bound at the time. When the bank swaps in a
+/// rebuilt table, update() encodes it into a spare copy of each format and
+/// then publishes the spares, moving the generators over, so no generator
+/// ever reads a copy half encoded. Encoding a table takes a few
+/// microseconds and never allocates.
+class CompactTables
+{
+public:
+  /// Samples in each copy: the table and its guard sample, padded to a
+  /// multiple of eight.
+  static constexpr int tableSamples = (WaveTables::tableSize + 1 + 7) & ~7;
+
+  /// Returns the arena space prepare() needs.
+  static size_t getArenaBytes();
+
+  /// Places the copies in the arena and encodes the tables bank is bound
+  /// to. Call from prepareToPlay(), after the bank's attachReader().
+  void prepare (DspArena& arena, const WaveTableBank& bank);
+
+  /// Forgets the arena memory handed out by prepare(). Call from
+  /// releaseResources() before the arena is released.
+  void release();
+
+  /// Encodes newTable into the spare copies of the shape whose table was
+  /// oldTable and publishes them. For each format rebind (const uint16*
+  /// oldCopy, const uint16* newCopy) is called so the caller can move its
+  /// generators over, after which the old copy becomes the spare. Call from
+  /// the bank's update() rebind on the audio thread.
+  template <typename Rebind>
+  void update (const AudioSampleBuffer& oldTable, const AudioSampleBuffer& newTable, Rebind&& rebind) noexcept
+  {
+    for (auto shape = 0; shape < WaveTables::NumShapes; ++shape) {
+      if (sources[shape] == nullptr || sources[shape] != oldTable.getReadPointer (0))
+        continue;
+      encode (shape, newTable, spares[shape]);
+      for (auto i = 0; i < 2; ++i) {
+        rebind (static_cast<const uint16*> (tables[shape][i]), static_cast<const uint16*> (spares[shape][i]));
+        std::swap (tables[shape][i], spares[shape][i]);
+      }
+    }
+  }
+
+  /// Returns the copy of a shape's table in a 16 bit format, or nullptr
+  /// before prepare().
+  const uint16* getTable (WaveTables::Shape shape, WaveTables::Format format) const noexcept
+  {
+    jassert (format != WaveTables::Float32);
+    return tables[shape][format == WaveTables::Int16 ? 1 : 0];
+  }
+
+private:
+  /// Encodes table into copies, one per format, as the copies of a shape.
+  void encode (int shape, const AudioSampleBuffer& table, uint16* const* copies) noexcept;
+
+  /// The copies the generators read, and the ones the next update()
+  /// encodes into.
+  uint16* tables[WaveTables::NumShapes][2] {};
+  uint16* spares[WaveTables::NumShapes][2] {};
+  /// The samples of the float table each shape's copies were encoded from.
+  const float* sources[WaveTables::NumShapes] {};
+
+  JUCE_DECLARE_NON_COPYABLE (CompactTables)
+};
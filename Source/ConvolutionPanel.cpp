@@ -0,0 +1,57 @@
+//==============================================================================
+// ConvolutionPanel.cpp
+// The controls of the convolution stage.
+//==============================================================================
+
+#include "ConvolutionPanel.h"
+
+ConvolutionPanel::ConvolutionPanel (ConvolutionStage& s)
+: stage (s) {
+  addAndMakeVisible (loadButton);
+  loadButton.onClick = [this] {
+    fileChooser = std::make_unique<FileChooser> ("Impulse response...", File(), "*.wav;*.aif;*.aiff;*.flac");
+    auto flags = FileChooser::openMode | FileChooser::canSelectFiles;
+    fileChooser->launchAsync (flags, [this] (const FileChooser& chooser) {
+      auto file = chooser.getResult();
+      if (file.existsAsFile())
+        stage.load (file);
+    });
+  };
+  addAndMakeVisible (dryButton);
+  dryButton.onClick = [this] { stage.clear(); };
+
+  addAndMakeVisible (mixSlider);
+  mixSlider.setSliderStyle (Slider::LinearHorizontal);
+  mixSlider.setTextBoxStyle (Slider::TextBoxLeft, false, 90, 22);
+  mixSlider.setRange (0.0, 100.0, 1.0);
+  mixSlider.setTextValueSuffix (" % wet");
+  mixSlider.setValue (50.0, dontSendNotification);
+  mixSlider.addListener (this);
+  stage.setMix (0.5f);
+
+  addAndMakeVisible (status);
+  status.setJustificationType (Justification::centredRight);
+  updateStatus();
+}
+
+void ConvolutionPanel::updateStatus() {
+  auto text = stage.getStatus();
+  if (stage.isLoaded())
+    text += ", " + String (stage.getLateBlocks()) + " late blocks";
+  status.setText (text, dontSendNotification);
+}
+
+void ConvolutionPanel::resized() {
+  auto row = getLocalBounds();
+  loadButton.setBounds (row.removeFromLeft (118));
+  row.removeFromLeft (8);
+  dryButton.setBounds (row.removeFromLeft (56));
+  row.removeFromLeft (8);
+  mixSlider.setBounds (row.removeFromLeft (200));
+  status.setBounds (row);
+}
+
+void ConvolutionPanel::sliderValueChanged (Slider* slider) {
+  if (slider == &mixSlider)
+    stage.setMix ((float) slider->getValue() / 100.0f);
+}
@@ -0,0 +1,33 @@
+//==============================================================================
+// ConvolutionPanel.h
+// The controls of the convolution stage.
+//==============================================================================
+
+#pragma once
+
+#include "ConvolutionStage.h"
+
+/// ConvolutionPanel loads an impulse response into a ConvolutionStage,
+/// removes it and sets the wet/dry mix. updateStatus() shows the response
+/// loaded and how many background blocks were late.
+class ConvolutionPanel : public Component, public Slider::Listener
+{
+public:
+  explicit ConvolutionPanel (ConvolutionStage& stage);
+
+  /// Shows the stage's status. Call from a timer.
+  void updateStatus();
+
+  void resized() override;
+  void sliderValueChanged (Slider* slider) override;
+
+private:
+  ConvolutionStage& stage;
+  TextButton loadButton {"Impulse..."};
+  TextButton dryButton {"Dry"};
+  Slider mixSlider;
+  Label status;
+  std::unique_ptr<FileChooser> fileChooser;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConvolutionPanel)
+};
@@ -0,0 +1,582 @@
+//==============================================================================
+// ConvolutionStage.cpp
+// Convolves the output with an impulse response in partitions of growing size.
+//==============================================================================
+
+#include "ConvolutionStage.h"
+#include "SubBlockScheduler.h"
+#include "Tracing.h"
+#include "RealtimeWakeup.h"
+#include "RealtimeChecks.h"
+
+namespace
+{
+  /// The partition sizes: the head's is the sub-block, and each background
+  /// partition starts two of its blocks into the response, where the one
+  /// before ends.
+  constexpr int headBlockSize = SubBlockScheduler::subBlockSize;
+  constexpr int middleBlockSize = 256;
+  constexpr int tailBlockSize = 4096;
+  constexpr int headLength = 2 * middleBlockSize;
+  constexpr int middleEnd = 2 * tailBlockSize;
+  /// A worker that finds no block for this many polls, about a second,
+  /// parks until the audio thread wakes it.
+  constexpr int parkAfterPolls = 1000;
+
+  /// Adds the bin by bin products of the complex spectra a and b to sum.
+  forcedinline void multiplyAdd (float* sumRe, float* sumIm, const float* aRe, const float* aIm,
+                                 const float* bRe, const float* bIm, int numBins) noexcept
+  {
+    for (auto bin = 0; bin < numBins; ++bin) {
+      sumRe[bin] += aRe[bin] * bRe[bin] - aIm[bin] * bIm[bin];
+      sumIm[bin] += aRe[bin] * bIm[bin] + aIm[bin] * bRe[bin];
+    }
+  }
+
+  /// Resamples every channel of source by ratio source samples per output
+  /// sample.
+  AudioSampleBuffer resample (const AudioSampleBuffer& source, double ratio)
+  {
+    // the interpolator reads a few samples ahead of its position
+    AudioSampleBuffer padded (source.getNumChannels(), source.getNumSamples() + 8);
+    padded.clear();
+    auto length = (int) std::ceil (source.getNumSamples() / ratio);
+    AudioSampleBuffer result (source.getNumChannels(), length);
+    for (auto chan = 0; chan < source.getNumChannels(); ++chan) {
+      padded.copyFrom (chan, 0, source, chan, 0, source.getNumSamples());
+      LagrangeInterpolator interpolator;
+      interpolator.process (ratio, padded.getReadPointer (chan), result.getWritePointer (chan), length);
+    }
+    return result;
+  }
+
+  /// A uniformly partitioned overlap-save convolution with the part of an
+  /// impulse response from start to end, in partitions of blockSize samples.
+  /// Each block of input is transformed once, with the block before it,
+  /// into a frequency domain delay line of the last numPartitions input
+  /// spectra, and a block of output is the inverse transform of the sum of
+  /// their products with the partitions' spectra. The spectra are stored
+  /// with their real and imaginary parts in separate arrays, so the
+  /// products vectorize.
+  class Partitions
+  {
+  public:
+    Partitions (const AudioSampleBuffer& ir, int channels, int start, int end, int block)
+    : blockSize (block), numBins (block + 1), numChannels (channels),
+      irChannels (ir.getNumChannels()), fft (roundToInt (std::log2 (2.0 * block)))
+    {
+      auto length = jmax (0, jmin (end, ir.getNumSamples()) - start);
+      numPartitions = (length + blockSize - 1) / blockSize;
+      spectra.assign ((size_t) 2 * (irChannels + numChannels) * numPartitions * numBins, 0.0f);
+      buffer.resize ((size_t) 4 * blockSize);
+      sum.resize ((size_t) 2 * numBins);
+      auto* data = buffer.data();
+      for (auto chan = 0; chan < irChannels; ++chan) {
+        for (auto p = 0; p < numPartitions; ++p) {
+          // a partition occupies the first half of the transform, so its
+          // product with a two block window is free of wrap around in the
+          // second half
+          auto first = start + p * blockSize;
+          auto num = jmin (blockSize, start + length - first);
+          std::fill (buffer.begin(), buffer.end(), 0.0f);
+          std::copy (ir.getReadPointer (chan, first), ir.getReadPointer (chan, first) + num, data);
+          fft.performRealOnlyForwardTransform (data, true);
+          split (getSpectrum (chan, p, false), getSpectrum (chan, p, true));
+        }
+      }
+    }
+
+    bool isEmpty() const noexcept { return numPartitions == 0; }
+    int getBlockSize() const noexcept { return blockSize; }
+
+    /// Convolves the block of channel chan whose window holds the block
+    /// before it and then the block itself, 2 * blockSize samples, and
+    /// writes blockSize samples of output. Call for every channel, then
+    /// advance().
+    void process (int chan, const float* window, float* output) noexcept
+    {
+      auto* data = buffer.data();
+      std::copy (window, window + 2 * blockSize, data);
+      fft.performRealOnlyForwardTransform (data, true);
+      split (getInput (chan, slot, false), getInput (chan, slot, true));
+
+      auto* sumRe = sum.data();
+      auto* sumIm = sumRe + numBins;
+      std::fill (sum.begin(), sum.end(), 0.0f);
+      auto irChan = jmin (chan, irChannels - 1);
+      for (auto p = 0; p < numPartitions; ++p) {
+        // the input p blocks ago meets partition p
+        auto s = slot - p;
+        if (s < 0)
+          s += numPartitions;
+        multiplyAdd (sumRe, sumIm, getInput (chan, s, false), getInput (chan, s, true),
+                     getSpectrum (irChan, p, false), getSpectrum (irChan, p, true), numBins);
+      }
+      for (auto bin = 0; bin < numBins; ++bin) {
+        data[2 * bin] = sumRe[bin];
+        data[2 * bin + 1] = sumIm[bin];
+      }
+      fft.performRealOnlyInverseTransform (data);
+      FloatVectorOperations::copy (output, data + blockSize, blockSize);
+    }
+
+    /// Moves the delay line on to the next block.
+    void advance() noexcept
+    {
+      if (++slot == numPartitions)
+        slot = 0;
+    }
+
+    /// Enters a block of silence into the delay line, in place of a block
+    /// that wasn't convolved.
+    void skip() noexcept
+    {
+      for (auto chan = 0; chan < numChannels; ++chan) {
+        std::fill (getInput (chan, slot, false), getInput (chan, slot, false) + numBins, 0.0f);
+        std::fill (getInput (chan, slot, true), getInput (chan, slot, true) + numBins, 0.0f);
+      }
+      advance();
+    }
+
+  private:
+    /// Returns the real or imaginary part of partition p of channel chan of
+    /// the response.
+    float* getSpectrum (int chan, int p, bool imag) noexcept
+    {
+      return spectra.data() + ((size_t) ((chan * 2 + (imag ? 1 : 0)) * numPartitions + p)) * numBins;
+    }
+
+    /// Returns the real or imaginary part of an input spectrum in the delay
+    /// line of channel chan. They follow the response's spectra.
+    float* getInput (int chan, int s, bool imag) noexcept
+    {
+      return getSpectrum (irChannels + chan, s, imag);
+    }
+
+    /// Copies the transform in buffer into separate real and imaginary
+    /// parts.
+    void split (float* re, float* im) const noexcept
+    {
+      for (auto bin = 0; bin < numBins; ++bin) {
+        re[bin] = buffer[(size_t) 2 * bin];
+        im[bin] = buffer[(size_t) 2 * bin + 1];
+      }
+    }
+
+    const int blockSize;
+    const int numBins;
+    const int numChannels;
+    const int irChannels;
+    int numPartitions {0};
+    /// The delay line entry of the current block.
+    int slot {0};
+    dsp::FFT fft;
+    /// The response's spectra, then the delay lines.
+    std::vector<float> spectra;
+    /// The transform's working space, twice the transform size.
+    std::vector<float> buffer;
+    /// The sum of the products, real parts then imaginary parts.
+    std::vector<float> sum;
+  };
+
+  /// A background partition. The audio thread writes its input into a ring
+  /// of four blocks and reads its output from another; a block's input
+  /// is convolved by the worker, or by the audio thread if the device block
+  /// is larger than the partition, as soon as the block is complete, and
+  /// its output is read two blocks later. The two counters publish the
+  /// blocks written and convolved, each from the only thread that writes
+  /// it. A worker so far behind that the audio thread overwrites a window
+  /// while it is copied leaves that block out, as it does an older one.
+  class Tail : private Thread
+  {
+  public:
+    Tail (const AudioSampleBuffer& ir, int channels, int start, int end, int block, bool runInBackground)
+    : Thread ("Convolution Partition"), partitions (ir, channels, start, end, block),
+      numChannels (channels), blockSize (block), threaded (runInBackground)
+    {
+      input.assign ((size_t) numChannels * ringSize(), 0.0f);
+      output.assign ((size_t) numChannels * ringSize(), 0.0f);
+      window.resize ((size_t) 2 * blockSize * numChannels);
+      if (threaded && ! partitions.isEmpty())
+        startThread (Thread::Priority::high);
+    }
+
+    ~Tail() override
+    {
+      // a parked worker only wakes for the audio thread's wakeup
+      signalThreadShouldExit();
+      wakeup.signal();
+      stopThread (10000);
+    }
+
+    bool isEmpty() const noexcept { return partitions.isEmpty(); }
+
+    /// Adds the output of the numSamples from time on to wet and queues
+    /// their input, for numChannels channels. Returns false if a block's
+    /// output wasn't ready when it was first needed.
+    bool process (const float* const* source, float* const* wet, int channels, int numSamples, int64 time) noexcept
+    {
+      auto position = (int) (time % ringSize());
+      auto block = time / blockSize;
+      auto ready = true;
+      // nothing has reached the output for the first two blocks
+      if (block >= 2) {
+        ready = blocksDone.load (std::memory_order_acquire) >= block - 1;
+        if (ready) {
+          for (auto chan = 0; chan < channels; ++chan)
+            FloatVectorOperations::add (wet[chan], getRing (output, chan) + position, numSamples);
+          RealtimeChecks::checkDenormal (getRing (output, 0)[position + numSamples - 1]);
+        }
+      }
+      for (auto chan = 0; chan < channels; ++chan)
+        FloatVectorOperations::copy (getRing (input, chan) + position, source[chan], numSamples);
+      if ((time + numSamples) % blockSize == 0) {
+        blocksWritten.store ((time + numSamples) / blockSize);
+        // keeps the next block's input behind the count, which the worker
+        // checks after copying its window
+        std::atomic_thread_fence (std::memory_order_release);
+        // a parked worker is woken rather than the block convolved here,
+        // which would put a whole partition's FFTs into one sub-block. A
+        // block it still misses is left out, as any late block is.
+        if (! threaded)
+          convolveNext();
+        else if (parked.load())
+          wakeup.signal();
+      }
+      return ready || position % blockSize != 0;
+    }
+
+  private:
+    /// The worker: convolves blocks as they complete, polling for them.
+    /// While the audio thread feeds nothing, e.g. while the output is
+    /// silent, it parks until the audio thread wakes it.
+    void run() override
+    {
+      ScopedNoDenormals noDenormals;
+      auto idlePolls = 0;
+      while (! threadShouldExit()) {
+        if (convolveNext()) {
+          idlePolls = 0;
+        }
+        else if (++idlePolls < parkAfterPolls) {
+          wait (1);
+        }
+        else {
+          // either the audio thread sees the flag and wakes the worker, or
+          // the worker sees the block the audio thread wrote before it
+          parked.store (true);
+          if (blocksWritten.load() == blocksDone.load (std::memory_order_relaxed))
+            wakeup.wait();
+          parked.store (false);
+          idlePolls = 0;
+        }
+      }
+    }
+
+    /// Convolves the oldest complete block not yet convolved. Returns false
+    /// if there is none.
+    bool convolveNext() noexcept
+    {
+      auto written = blocksWritten.load (std::memory_order_acquire);
+      auto done = blocksDone.load (std::memory_order_relaxed);
+      if (done >= written)
+        return false;
+      Tracing::Scope trace ("convolve partition");
+      // the ring holds the window of a block until the audio thread writes
+      // the block three on, so any older are missed and left silent
+      for (; done < written - 2; ++done)
+        miss (done);
+      for (auto chan = 0; chan < numChannels; ++chan) {
+        auto* data = getWindow (chan);
+        FloatVectorOperations::copy (data, getBlock (input, chan, done - 1), blockSize);
+        FloatVectorOperations::copy (data + blockSize, getBlock (input, chan, done), blockSize);
+      }
+      // if the audio thread got on to block done + 3 during the copy, it
+      // was writing over block done - 1, and the window is torn: the block
+      // is missed as an older one would be
+      std::atomic_thread_fence (std::memory_order_acquire);
+      if (blocksWritten.load (std::memory_order_relaxed) > done + 2) {
+        miss (done);
+      }
+      else {
+        for (auto chan = 0; chan < numChannels; ++chan)
+          partitions.process (chan, getWindow (chan), getBlock (output, chan, done + 2));
+        partitions.advance();
+      }
+      blocksDone.store (done + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// Leaves a block out: silence enters the delay line in its place, and
+    /// its output is silent.
+    void miss (int64 block) noexcept
+    {
+      partitions.skip();
+      for (auto chan = 0; chan < numChannels; ++chan)
+        FloatVectorOperations::clear (getBlock (output, chan, block + 2), blockSize);
+    }
+
+    int ringSize() const noexcept { return 4 * blockSize; }
+
+    /// Returns the window of channel chan: the block before and the block
+    /// convolved, copied out of the input ring.
+    float* getWindow (int chan) noexcept
+    {
+      return window.data() + (size_t) chan * 2 * blockSize;
+    }
+
+    float* getRing (std::vector<float>& ring, int chan) noexcept
+    {
+      return ring.data() + (size_t) chan * ringSize();
+    }
+
+    /// Returns the place of a block in a ring.
+    float* getBlock (std::vector<float>& ring, int chan, int64 block) noexcept
+    {
+      return getRing (ring, chan) + (int) ((block + 4) % 4) * blockSize;
+    }
+
+    Partitions partitions;
+    const int numChannels;
+    const int blockSize;
+    const bool threaded;
+    std::vector<float> input;
+    std::vector<float> output;
+    std::vector<float> window;
+    std::atomic<int64> blocksWritten {0};
+    std::atomic<int64> blocksDone {0};
+    /// Set while the worker is parked, and how the audio thread wakes it.
+    std::atomic<bool> parked {false};
+    RealtimeWakeup wakeup;
+  };
+}
+
+//==============================================================================
+
+/// An impulse response prepared for the device: the head partitions, the
+/// two background partitions and the head's input window and output.
+struct ConvolutionStage::Engine
+{
+  Engine (const AudioSampleBuffer& ir, int channels, int deviceBlockSize)
+  : numChannels (channels), loaded (ir.getNumSamples() > 0),
+    tailSamples (loaded ? ir.getNumSamples() + 2 * tailBlockSize : 0),
+    head (ir, channels, 0, headLength, headBlockSize),
+    middle (ir, channels, headLength, middleEnd, middleBlockSize, deviceBlockSize <= middleBlockSize),
+    tail (ir, channels, middleEnd, std::numeric_limits<int>::max(), tailBlockSize, deviceBlockSize <= tailBlockSize)
+  {
+    window.assign ((size_t) numChannels * 2 * headBlockSize, 0.0f);
+    wet.assign ((size_t) numChannels * headBlockSize, 0.0f);
+  }
+
+  /// Convolves the first channels of a sub-block and mixes the result in.
+  /// Returns the number of background blocks that were late.
+  int process (AudioSampleBuffer& block, float mix) noexcept
+  {
+    if (! loaded)
+      return 0;
+    auto channels = jmin (numChannels, block.getNumChannels());
+    const float* inputs[maxChannels] {};
+    float* outputs[maxChannels] {};
+    for (auto chan = 0; chan < channels; ++chan) {
+      auto* w = window.data() + (size_t) chan * 2 * headBlockSize;
+      FloatVectorOperations::copy (w, w + headBlockSize, headBlockSize);
+      FloatVectorOperations::copy (w + headBlockSize, block.getReadPointer (chan), headBlockSize);
+      inputs[chan] = w + headBlockSize;
+      outputs[chan] = wet.data() + (size_t) chan * headBlockSize;
+      head.process (chan, w, outputs[chan]);
+    }
+    head.advance();
+    auto late = 0;
+    for (auto* t : {&middle, &tail}) {
+      if (! t->isEmpty() && ! t->process (inputs, outputs, channels, headBlockSize, time))
+        ++late;
+    }
+    time += headBlockSize;
+    for (auto chan = 0; chan < channels; ++chan) {
+      auto* data = block.getWritePointer (chan);
+      FloatVectorOperations::multiply (data, 1.0f - mix, headBlockSize);
+      FloatVectorOperations::addWithMultiply (data, outputs[chan], mix, headBlockSize);
+    }
+    return late;
+  }
+
+  const int numChannels;
+  const bool loaded;
+  /// How long the output goes on after the input goes silent: the
+  /// response, and the background blocks in flight.
+  const int tailSamples;
+  Partitions head;
+  Tail middle;
+  Tail tail;
+  std::vector<float> window;
+  std::vector<float> wet;
+  int64 time {0};
+};
+
+//==============================================================================
+
+ConvolutionStage::ConvolutionStage()
+: Thread ("Convolution Builder") {
+  startThread (Thread::Priority::low);
+}
+
+ConvolutionStage::~ConvolutionStage() {
+  stopThread (10000);
+  delete incoming.exchange (nullptr);
+  delete retired.exchange (nullptr);
+  delete engine;
+}
+
+void ConvolutionStage::prepare (double sampleRate, int numChannels, int blockSize) {
+  numChannels = jlimit (1, maxChannels, numChannels);
+  {
+    const ScopedLock sl (lock);
+    if (sampleRate == deviceRate && numChannels == deviceChannels && blockSize == deviceBlockSize)
+      return;
+    deviceRate = sampleRate;
+    deviceChannels = numChannels;
+    deviceBlockSize = blockSize;
+    rebuildRequested = true;
+  }
+  notify();
+}
+
+void ConvolutionStage::load (const File& file) {
+  {
+    const ScopedLock sl (lock);
+    pendingFile = file;
+    clearRequested = false;
+    status = "Reading " + file.getFileName() + "...";
+  }
+  notify();
+}
+
+void ConvolutionStage::clear() {
+  {
+    const ScopedLock sl (lock);
+    pendingFile = File();
+    clearRequested = true;
+    status = "No impulse response";
+  }
+  notify();
+}
+
+String ConvolutionStage::getStatus() const {
+  const ScopedLock sl (lock);
+  return status;
+}
+
+bool ConvolutionStage::isLoaded() const {
+  const ScopedLock sl (lock);
+  return response.getNumSamples() > 0;
+}
+
+void ConvolutionStage::process (AudioSampleBuffer& subBlock) noexcept {
+  jassert (subBlock.getNumSamples() == headBlockSize);
+  if (retired.load() == nullptr) {
+    if (auto* next = incoming.exchange (nullptr)) {
+      retired.store (engine);
+      engine = next;
+    }
+  }
+  if (engine != nullptr && subBlock.getNumSamples() == headBlockSize) {
+    if (auto late = engine->process (subBlock, mix.load()))
+      lateBlocks.fetch_add (late);
+  }
+}
+
+int ConvolutionStage::getTailSamples() const noexcept {
+  return (engine != nullptr) ? engine->tailSamples : 0;
+}
+
+void ConvolutionStage::run() {
+  while (! threadShouldExit()) {
+    File file;
+    bool clearing, rebuilding;
+    {
+      const ScopedLock sl (lock);
+      file = std::exchange (pendingFile, File());
+      clearing = std::exchange (clearRequested, false);
+      rebuilding = std::exchange (rebuildRequested, false);
+    }
+    if (clearing) {
+      const ScopedLock sl (lock);
+      response.setSize (0, 0);
+      rebuilding = true;
+    }
+    if (file != File()) {
+      auto error = read (file);
+      if (error.isEmpty())
+        rebuilding = true;
+      else {
+        const ScopedLock sl (lock);
+        status = error;
+      }
+    }
+    if (rebuilding)
+      build();
+    reclaim();
+    // poll while an engine waits for the audio thread to take it or to
+    // pass the old one back
+    wait (incoming.load() != nullptr || retired.load() != nullptr ? 50 : -1);
+  }
+}
+
+String ConvolutionStage::read (const File& file) {
+  AudioFormatManager formats;
+  formats.registerBasicFormats();
+  std::unique_ptr<AudioFormatReader> reader (formats.createReaderFor (file));
+  if (reader == nullptr)
+    return "Can't read " + file.getFullPathName() + ".";
+  if (reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0 || reader->numChannels == 0)
+    return file.getFileName() + " holds no audio.";
+  if (reader->lengthInSamples > maxSeconds * reader->sampleRate)
+    return file.getFileName() + " is longer than " + String ((int) maxSeconds) + " seconds.";
+  auto numSamples = (int) reader->lengthInSamples;
+  auto numChannels = jmin ((int) reader->numChannels, maxChannels);
+  AudioSampleBuffer audio (numChannels, numSamples);
+  if (! reader->read (&audio, 0, numSamples, 0, true, true))
+    return "Can't read " + file.getFullPathName() + ".";
+  if (audio.getMagnitude (0, numSamples) == 0.0f)
+    return file.getFileName() + " is silent.";
+
+  const ScopedLock sl (lock);
+  response = std::move (audio);
+  responseRate = reader->sampleRate;
+  status = file.getFileName() + ": " + String (numSamples / reader->sampleRate, 2) + " s "
+           + (numChannels > 1 ? "stereo" : "mono");
+  return {};
+}
+
+void ConvolutionStage::build() {
+  AudioSampleBuffer ir;
+  double rate;
+  int channels, blockSize;
+  {
+    const ScopedLock sl (lock);
+    if (deviceRate <= 0.0)
+      return;
+    ir.makeCopyOf (response);
+    rate = responseRate;
+    channels = deviceChannels;
+    blockSize = deviceBlockSize;
+  }
+  if (ir.getNumSamples() > 0) {
+    if (rate != deviceRate)
+      ir = resample (ir, rate / deviceRate);
+    // unit energy in the louder channel, so white noise keeps its level
+    auto energy = 0.0;
+    for (auto chan = 0; chan < ir.getNumChannels(); ++chan) {
+      auto* data = ir.getReadPointer (chan);
+      energy = jmax (energy, std::inner_product (data, data + ir.getNumSamples(), data, 0.0));
+    }
+    ir.applyGain ((float) (1.0 / std::sqrt (energy)));
+  }
+  // an engine the audio thread hasn't taken yet was never played
+  delete incoming.exchange (new Engine (ir, channels, blockSize));
+  lateBlocks.store (0);
+}
+
+void ConvolutionStage::reclaim() {
+  delete retired.exchange (nullptr);
+}
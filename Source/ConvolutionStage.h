@@ -0,0 +1,141 @@
+//==============================================================================
+// ConvolutionStage.h
+// Convolves the output with an impulse response in partitions of growing size.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/// ConvolutionStage convolves the generators' output with an impulse
+/// response of up to maxSeconds, for cabinet and room simulation, and mixes
+/// the result with the dry signal. It adds no latency beyond the sub-block
+/// and keeps the cost on the audio thread small and the same every
+/// sub-block, however long the response.
+///
+/// The response is split into three uniformly partitioned overlap-save
+/// convolutions whose blocks grow with their distance from the start:
+///   * the first 512 samples in 32 sample partitions, convolved on the audio
+///     thread every sub-block,
+///   * the samples up to 8192 in 256 sample partitions,
+///   * the rest in 4096 sample partitions.
+/// The second and third start two of their blocks into the response, so
+/// the output of a block is first needed a whole block after its input is
+/// complete. Each runs on its own worker thread and has that block to
+/// deliver; a block that isn't ready in time is left out and counted in
+/// getLateBlocks(). When the device block is larger than a partition the
+/// partition's convolution can't overlap the audio callback, so it runs on
+/// the audio thread instead.
+///
+/// Responses are read, resampled to the device rate, normalized to unit
+/// energy and transformed on a builder thread. The finished engine, with
+/// its delay lines and workers, is handed to the audio thread through a
+/// pair of atomic pointers, as in PartialSynth, and the builder deletes the
+/// engine it replaces, stopping its workers. The audio thread never
+/// allocates or locks: the workers poll for input. A worker that has had
+/// no input for a second parks, and the audio thread wakes it with the
+/// first block after the pause, through a RealtimeWakeup, as
+/// Thread::notify() would lock.
+///
+/// The first maxChannels output channels are convolved, a mono response
+/// with each of them. Any others stay dry.
+class ConvolutionStage : private Thread
+{
+public:
+  /// Number of channels convolved.
+  static constexpr int maxChannels = 2;
+  /// Longest impulse response, in seconds.
+  static constexpr double maxSeconds = 10.0;
+
+  ConvolutionStage();
+
+  /// Stops the builder and deletes every engine. The audio thread must have
+  /// stopped.
+  ~ConvolutionStage() override;
+
+  /// Sets the rate, channel count and the most samples rendered per device
+  /// callback, and rebuilds the engine for them in the background if they
+  /// changed.
+  /// Call from prepareToPlay().
+  void prepare (double sampleRate, int numChannels, int blockSize);
+
+  //==============================================================================
+  // Message thread
+
+  /// Starts reading an impulse response from an audio file in the
+  /// background. The convolution continues with the previous response until
+  /// the new one is ready.
+  void load (const File& file);
+
+  /// Removes the impulse response, leaving the output dry.
+  void clear();
+
+  /// Returns the state of the last load: the response's name and length,
+  /// or an error.
+  String getStatus() const;
+
+  /// Returns true while a response is loaded.
+  bool isLoaded() const;
+
+  /// Returns the number of blocks of the background partitions that were
+  /// not ready in time, since the last response was loaded.
+  int64 getLateBlocks() const noexcept { return lateBlocks.load(); }
+
+  /// Sets the level of the convolved signal in the output, 0 (dry) to 1
+  /// (wet only). Safe from any thread.
+  void setMix (float wet) { mix.store (jlimit (0.0f, 1.0f, wet)); }
+
+  //==============================================================================
+  // Audio thread
+
+  /// Convolves a sub-block in place. Its length must be
+  /// SubBlockScheduler::subBlockSize.
+  void process (AudioSampleBuffer& subBlock) noexcept;
+
+  /// Returns how long the output goes on after the input goes silent, in
+  /// samples. Once the input has been silent that long the stage holds
+  /// only silence, and process() can be skipped until it isn't: the
+  /// convolution picks up where it stopped.
+  int getTailSamples() const noexcept;
+
+private:
+  struct Engine;
+
+  /// The builder thread: reads responses and builds engines.
+  void run() override;
+
+  /// Reads file into response, or returns an error.
+  String read (const File& file);
+
+  /// Builds an engine for the current response and device and hands it to
+  /// the audio thread.
+  void build();
+
+  /// Deletes the engine the audio thread has passed back, if any.
+  void reclaim();
+
+  /// The engine playing, on the audio thread, and the engines handed over
+  /// and passed back. The audio thread only adopts a new engine while
+  /// nothing waits in retired.
+  Engine* engine {nullptr};
+  std::atomic<Engine*> incoming {nullptr};
+  std::atomic<Engine*> retired {nullptr};
+
+  std::atomic<float> mix {0.5f};
+  std::atomic<int64> lateBlocks {0};
+
+  /// The builder's work and results, guarded by lock: a file to read, the
+  /// response read last at its own rate, and the device to build for.
+  File pendingFile;
+  bool clearRequested {false};
+  bool rebuildRequested {false};
+  AudioSampleBuffer response;
+  double responseRate {0.0};
+  String status {"No impulse response"};
+  double deviceRate {0.0};
+  int deviceChannels {0};
+  int deviceBlockSize {0};
+  CriticalSection lock;
+
+  JUCE_DECLARE_NON_COPYABLE (ConvolutionStage)
+};
@@ -0,0 +1,122 @@
+//==============================================================================
+// DiskRecorder.cpp
+// Records the output stream to disk on a background thread.
+//==============================================================================
+
+#include "DiskRecorder.h"
+
+DiskRecorder::DiskRecorder()
+: Thread ("Disk Recorder") {
+}
+
+DiskRecorder::~DiskRecorder() {
+  stop();
+}
+
+String DiskRecorder::start (const File& file, double sampleRate, int numChannels) {
+  stop();
+  if (sampleRate <= 0.0 || numChannels <= 0)
+    return "The audio device is not running.";
+
+  std::unique_ptr<AudioFormat> format;
+  int bitsPerSample = 32;
+  if (file.hasFileExtension ("w64")) {
+    format = std::make_unique<Wave64AudioFormat>();
+  }
+  else if (file.hasFileExtension ("flac")) {
+    format = std::make_unique<FlacAudioFormat>();
+    bitsPerSample = 24;
+  }
+  else {
+    format = std::make_unique<WavAudioFormat>();
+  }
+
+  file.deleteFile();
+  // a large stream buffer turns the writer's chunks into big sequential writes
+  auto stream = file.createOutputStream (1 << 20);
+  if (stream == nullptr)
+    return "Can't open " + file.getFullPathName() + " for writing.";
+  writer.reset (format->createWriterFor (stream.get(), sampleRate, (unsigned int) numChannels,
+                                         bitsPerSample, {}, 0));
+  if (writer == nullptr)
+    return format->getFormatName() + " can't record " + String (numChannels) + " channels at "
+      + String (sampleRate) + " Hz.";
+  stream.release(); // now owned by the writer
+
+  auto fifoSize = roundToInt (sampleRate * fifoSeconds);
+  fifoBuffer.setSize (numChannels, fifoSize);
+  fifo.setTotalSize (fifoSize);
+  fifo.reset();
+  recordedSamples = 0;
+  droppedSamples = 0;
+  startThread (Thread::Priority::low);
+  recording = true;
+  return {};
+}
+
+void DiskRecorder::stop() {
+  if (! recording.exchange (false) && ! isThreadRunning())
+    return;
+  // once push() is seen outside the FIFO it can't enter it again
+  while (pushing.load())
+    Thread::yield();
+  signalThreadShouldExit();
+  notify();
+  stopThread (10000);
+  writer.reset();
+  fifoBuffer.setSize (0, 0);
+}
+
+void DiskRecorder::push (const AudioSourceChannelInfo& bufferToFill) noexcept {
+  pushing = true;
+  if (recording.load()) {
+    auto num = bufferToFill.numSamples;
+    if (fifo.getFreeSpace() < num) {
+      droppedSamples += num;
+    }
+    else {
+      int start1, size1, start2, size2;
+      fifo.prepareToWrite (num, start1, size1, start2, size2);
+      auto& buffer = *bufferToFill.buffer;
+      for (auto chan = 0; chan < fifoBuffer.getNumChannels(); ++chan) {
+        if (chan < buffer.getNumChannels()) {
+          fifoBuffer.copyFrom (chan, start1, buffer, chan, bufferToFill.startSample, size1);
+          fifoBuffer.copyFrom (chan, start2, buffer, chan, bufferToFill.startSample + size1, size2);
+        }
+        else {
+          fifoBuffer.clear (chan, start1, size1);
+          fifoBuffer.clear (chan, start2, size2);
+        }
+      }
+      fifo.finishedWrite (size1 + size2);
+      recordedSamples += num;
+    }
+  }
+  pushing = false;
+}
+
+bool DiskRecorder::drain() {
+  int start1, size1, start2, size2;
+  fifo.prepareToRead (fifo.getNumReady(), start1, size1, start2, size2);
+  auto ok = true;
+  if (size1 > 0)
+    ok = writer->writeFromAudioSampleBuffer (fifoBuffer, start1, size1);
+  if (ok && size2 > 0)
+    ok = writer->writeFromAudioSampleBuffer (fifoBuffer, start2, size2);
+  fifo.finishedRead (size1 + size2);
+  return ok;
+}
+
+void DiskRecorder::run() {
+  // write in chunks of a tenth of the FIFO, checking every 20 ms
+  auto chunkSize = fifo.getTotalSize() / 10;
+  auto failed = false;
+  while (! threadShouldExit()) {
+    if (fifo.getNumReady() >= chunkSize && ! drain() && ! failed) {
+      Logger::writeToLog ("DiskRecorder: write failed, the recording is incomplete.");
+      failed = true;
+    }
+    wait (20);
+  }
+  drain();
+}
@@ -0,0 +1,72 @@
+//==============================================================================
+// DiskRecorder.h
+// Records the output stream to disk on a background thread.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/// DiskRecorder captures the buffers the audio thread hands to push() and
+/// writes them to a WAV, W64 or FLAC file. The audio thread only copies into
+/// a lock-free FIFO that start() allocates. A low priority writer thread
+/// drains the FIFO in large chunks through a heavily buffered file stream, so
+/// disk latency never reaches the audio callback. If the writer falls behind
+/// and the FIFO fills, the samples that do not fit are dropped and counted
+/// by getDroppedSamples().
+class DiskRecorder : private Thread
+{
+public:
+  DiskRecorder();
+
+  /// Stops any recording in progress.
+  ~DiskRecorder() override;
+
+  /// Opens file and starts recording numChannels at sampleRate. The format
+  /// is chosen from the file extension: .wav and .w64 are written as 32 bit
+  /// float, .flac as 24 bit. Returns an error message, or an empty string on
+  /// success. Call on the message thread.
+  String start (const File& file, double sampleRate, int numChannels);
+
+  /// Stops recording, writes whatever is left in the FIFO and closes the
+  /// file. Call on the message thread.
+  void stop();
+
+  /// Returns true between start() and stop().
+  bool isRecording() const noexcept { return recording.load(); }
+
+  /// Copies the active region of bufferToFill into the FIFO. Called on the
+  /// audio thread, never blocks or allocates.
+  void push (const AudioSourceChannelInfo& bufferToFill) noexcept;
+
+  /// Returns the number of sample frames written to the FIFO so far.
+  int64 getRecordedSamples() const noexcept { return recordedSamples.load(); }
+
+  /// Returns the number of sample frames dropped because the FIFO was full.
+  int64 getDroppedSamples() const noexcept { return droppedSamples.load(); }
+
+  /// Seconds of audio the FIFO can hold before the writer must catch up.
+  static constexpr double fifoSeconds = 2.0;
+
+private:
+  /// The writer thread: wakes up regularly and drains the FIFO to disk.
+  void run() override;
+
+  /// Writes everything currently in the FIFO. Returns false on a disk error.
+  bool drain();
+
+  std::unique_ptr<AudioFormatWriter> writer;
+  AudioSampleBuffer fifoBuffer;
+  AbstractFifo fifo {1};
+
+  /// True while the audio thread may push into the FIFO.
+  std::atomic<bool> recording {false};
+  /// True while the audio thread is inside push(). stop() waits for it to
+  /// clear before it tears down the FIFO.
+  std::atomic<bool> pushing {false};
+
+  std::atomic<int64> recordedSamples {0};
+  std::atomic<int64> droppedSamples {0};
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DiskRecorder)
+};
@@ -0,0 +1,88 @@
+//==============================================================================
+// DspArena.h
+// A contiguous, cache aligned memory region for all DSP state.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/// DspArena is a bump allocator over a single heap block. prepareToPlay()
+/// sizes it once with reserve(), every DSP component then carves its tables,
+/// state and scratch buffers out of it in the order they are used, and
+/// releaseResources() frees it with release(). Nothing is allocated in
+/// between, and related state ends up contiguous in memory.
+///
+/// Every allocation starts on a cache line boundary. Objects created in the
+/// arena never have their destructors run, so they must not own resources.
+class DspArena
+{
+public:
+  /// Size of a cache line. Every allocation is aligned to this.
+  static constexpr size_t alignment = 64;
+
+  /// Returns the arena space needed for count objects of type T. Components
+  /// add these up to tell prepareToPlay() how large the arena must be.
+  template <typename T>
+  static constexpr size_t bytesFor (size_t count) noexcept
+  {
+    return (sizeof (T) * count + alignment - 1) & ~(alignment - 1);
+  }
+
+  /// Frees any existing region and allocates a new one of numBytes.
+  void reserve (size_t numBytes)
+  {
+    release();
+    storage.calloc (numBytes + alignment);
+    auto address = reinterpret_cast<uintptr_t> (storage.get());
+    base = storage.get() + ((alignment - (address & (alignment - 1))) & (alignment - 1));
+    capacity = numBytes;
+  }
+
+  /// Frees the region. Everything allocated from it becomes invalid.
+  void release()
+  {
+    storage.free();
+    base = nullptr;
+    capacity = 0;
+    used = 0;
+  }
+
+  /// Returns uninitialized space for count objects of type T, or nullptr if
+  /// the arena was sized too small.
+  template <typename T>
+  T* allocate (size_t count) noexcept
+  {
+    auto bytes = bytesFor<T> (count);
+    if (used + bytes > capacity) {
+      jassertfalse; // the size passed to reserve() is missing this allocation
+      return nullptr;
+    }
+    auto* block = base + used;
+    used += bytes;
+    return reinterpret_cast<T*> (block);
+  }
+
+  /// Default constructs count objects of type T in the arena.
+  template <typename T>
+  T* create (size_t count = 1)
+  {
+    auto* objects = allocate<T> (count);
+    if (objects != nullptr)
+      for (size_t i = 0; i < count; ++i)
+        new (objects + i) T();
+    return objects;
+  }
+
+  /// Returns the size of the region in bytes.
+  size_t getCapacity() const noexcept { return capacity; }
+
+  /// Returns the number of bytes handed out so far.
+  size_t getBytesUsed() const noexcept { return used; }
+
+private:
+  HeapBlock<char> storage;
+  char* base {nullptr};
+  size_t capacity {0};
+  size_t used {0};
+};
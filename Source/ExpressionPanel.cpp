@@ -0,0 +1,76 @@
+//==============================================================================
+// ExpressionPanel.cpp
+// The controls of the expression generator.
+//==============================================================================
+
+#include "ExpressionPanel.h"
+
+ExpressionPanel::ExpressionPanel (ExpressionSynth& s)
+: synth (s) {
+  addAndMakeVisible (editor);
+  editor.setText (defaultExpression, false);
+  editor.setTextToShowWhenEmpty ("e.g. sin(2*pi*p) * (1 - a*t)", Colours::grey);
+  auto apply = [this] {
+    if (editor.getText() != compiled)
+      setExpression (editor.getText());
+  };
+  editor.onReturnKey = apply;
+  editor.onFocusLost = apply;
+
+  addAndMakeVisible (status);
+  status.setJustificationType (Justification::centredRight);
+
+  addSlider (parameterA, "a");
+  addSlider (parameterB, "b");
+
+  setExpression (defaultExpression);
+}
+
+void ExpressionPanel::addSlider (Slider& slider, const String& name) {
+  addAndMakeVisible (slider);
+  slider.setSliderStyle (Slider::LinearHorizontal);
+  slider.setTextBoxStyle (Slider::TextBoxLeft, false, 90, 22);
+  slider.setRange (0.0, 1.0);
+  slider.setTextValueSuffix (" " + name);
+  slider.setValue (0.5, dontSendNotification);
+  slider.addListener (this);
+}
+
+String ExpressionPanel::setExpression (const String& text) {
+  compiled = text;
+  String error;
+  auto program = ExpressionProgram::compile (text, error);
+  if (program == nullptr) {
+    status.setText (error, dontSendNotification);
+    return error;
+  }
+  auto size = program->getNumInstructions();
+  synth.setProgram (std::move (program));
+  status.setText (String (size) + ((size == 1) ? " instruction" : " instructions"), dontSendNotification);
+  return {};
+}
+
+void ExpressionPanel::updateStatus() {
+  synth.reclaim();
+}
+
+void ExpressionPanel::resized() {
+  auto bounds = getLocalBounds();
+  editor.setBounds (bounds.removeFromTop (24));
+
+  bounds.removeFromTop (4);
+  status.setBounds (bounds.removeFromTop (24));
+
+  bounds.removeFromTop (4);
+  auto row = bounds.removeFromTop (24);
+  parameterA.setBounds (row.removeFromLeft (row.getWidth() / 2));
+  parameterB.setBounds (row);
+}
+
+void ExpressionPanel::sliderValueChanged (Slider* slider) {
+  auto value = (float) slider->getValue();
+  if (slider == &parameterA)
+    synth.setParameter (0, value);
+  else if (slider == &parameterB)
+    synth.setParameter (1, value);
+}
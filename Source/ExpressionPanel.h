@@ -0,0 +1,47 @@
+//==============================================================================
+// ExpressionPanel.h
+// The controls of the expression generator.
+//==============================================================================
+
+#pragma once
+
+#include "ExpressionSynth.h"
+
+/// ExpressionPanel edits the expression an ExpressionSynth plays and sets
+/// its a and b parameters. The text is compiled when return is pressed or
+/// the editor loses focus. A program that compiles replaces the one
+/// playing, and the status shows its size; one that doesn't leaves the
+/// old program playing and shows the error.
+class ExpressionPanel : public Component, public Slider::Listener
+{
+public:
+  /// The expression played until another is entered.
+  static constexpr const char* defaultExpression = "sin(2*pi*p) + 0.3*saw(3*p)";
+
+  /// Compiles the default expression and hands it to the synth.
+  explicit ExpressionPanel (ExpressionSynth& synth);
+
+  /// Compiles text and, if it compiles, hands it to the synth. Returns the
+  /// error, or an empty string.
+  String setExpression (const String& text);
+
+  /// Deletes the programs the synth has replaced. Call from a timer.
+  void updateStatus();
+
+  void resized() override;
+  void sliderValueChanged (Slider* slider) override;
+
+private:
+  /// Sets up a slider with the app's text box style.
+  void addSlider (Slider& slider, const String& name);
+
+  ExpressionSynth& synth;
+  TextEditor editor;
+  Label status;
+  Slider parameterA;
+  Slider parameterB;
+  /// The text last compiled, successfully or not.
+  String compiled;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ExpressionPanel)
+};
@@ -0,0 +1,598 @@
+//==============================================================================
+// ExpressionProgram.cpp
+// Compiles waveform expressions to register bytecode that runs a block at a time.
+//==============================================================================
+
+#include "ExpressionProgram.h"
+
+namespace
+{
+  /// Returns floor (x) in plain arithmetic, so loops of it vectorize where
+  /// loops of std::floor() may not. Floats of 2^23 and above are whole.
+  forcedinline float floorOf (float x) noexcept
+  {
+    auto truncated = (float) (int) jlimit (-8388608.0f, 8388608.0f, x);
+    auto floored = (truncated > x) ? truncated - 1.0f : truncated;
+    return (std::abs (x) < 8388608.0f) ? floored : x;
+  }
+
+  /// Returns the position of x in its cycle, 0 to 1.
+  forcedinline float fracOf (float x) noexcept
+  {
+    return x - floorOf (x);
+  }
+
+  /// Returns sin (x), accurate to about 3e-7 for |x| up to 10 and to the
+  /// rounding of x itself beyond. x is reduced to |r| <= pi / 2 with
+  /// sin (x) = +-sin (r), whose Taylor series is the one PartialSynth uses.
+  forcedinline float sine (float x) noexcept
+  {
+    auto n = floorOf (jlimit (-4.0e6f, 4.0e6f, x * 0.318309886f) + 0.5f);
+    // pi as a float is 8.74e-8 too large
+    auto r = jlimit (-1.57079637f, 1.57079637f, x - n * 3.14159274f + n * 8.74227766e-8f);
+    auto r2 = r * r;
+    auto s = r * (1.0f - r2 / 6.0f * (1.0f - r2 / 20.0f * (1.0f - r2 / 42.0f * (1.0f - r2 / 72.0f * (1.0f - r2 / 110.0f)))));
+    return ((int) n & 1) ? -s : s;
+  }
+
+  /// Applies f to every sample of x.
+  template <typename Function>
+  forcedinline void map (float* dest, const float* x, int numSamples, Function f) noexcept
+  {
+    for (auto i = 0; i < numSamples; ++i)
+      dest[i] = f (x[i]);
+  }
+
+  /// Applies f to every pair of samples of x and y.
+  template <typename Function>
+  forcedinline void map (float* dest, const float* x, const float* y, int numSamples, Function f) noexcept
+  {
+    for (auto i = 0; i < numSamples; ++i)
+      dest[i] = f (x[i], y[i]);
+  }
+
+  /// Limits the nesting of parentheses, arguments and signs, so parsing
+  /// can't overflow the stack. Chains such as p*p*p*p nest without
+  /// recursing; Node::height bounds those.
+  const int maxDepth = 64;
+}
+
+//==============================================================================
+/// A node of the parsed expression.
+struct ExpressionProgram::Node
+{
+  enum Kind { Constant, Variable, Operation };
+
+  bool is (float constant) const noexcept { return kind == Constant && value == constant; }
+
+  Kind kind {Constant};
+  float value {0.0f};
+  Input input {Phase};
+  Op op {Op::fill};
+  /// The operands of an Operation. right is null for one operand.
+  std::unique_ptr<Node> left;
+  std::unique_ptr<Node> right;
+  /// Operations on the longest path down to a constant or variable. The
+  /// compiler and the destructor recurse this deep, so the parser rejects
+  /// trees higher than maxInstructions, which couldn't compile anyway.
+  int height {0};
+};
+
+//==============================================================================
+/// Parses an expression by recursive descent into a tree, folding each
+/// operation on constants as it's built.
+class ExpressionProgram::Parser
+{
+public:
+  Parser (const String& text, String& e)
+  : source (text.toStdString()), error (e) {
+  }
+
+  std::unique_ptr<Node> parse() {
+    if (peek() == 0) {
+      error = "Enter an expression";
+      return nullptr;
+    }
+    auto root = parseSum();
+    if (root != nullptr && peek() != 0)
+      return fail (String ("Unexpected '") + source[position] + "'");
+    return root;
+  }
+
+private:
+  using NodePtr = std::unique_ptr<Node>;
+
+  /// sum := product (('+' | '-') product)*
+  NodePtr parseSum() {
+    auto node = parseProduct();
+    while (node != nullptr) {
+      if (accept ('+'))
+        node = combine (Op::add, std::move (node), parseProduct());
+      else if (accept ('-'))
+        node = combine (Op::sub, std::move (node), parseProduct());
+      else
+        break;
+    }
+    return node;
+  }
+
+  /// product := unary (('*' | '/' | '%') unary)*
+  NodePtr parseProduct() {
+    auto node = parseUnary();
+    while (node != nullptr) {
+      if (accept ('*'))
+        node = combine (Op::mul, std::move (node), parseUnary());
+      else if (accept ('/'))
+        node = combine (Op::div, std::move (node), parseUnary());
+      else if (accept ('%'))
+        node = combine (Op::mod, std::move (node), parseUnary());
+      else
+        break;
+    }
+    return node;
+  }
+
+  /// unary := ('-' | '+') unary | power
+  NodePtr parseUnary() {
+    if (depth >= maxDepth)
+      return fail ("Too deeply nested");
+    ++depth;
+    NodePtr node;
+    if (accept ('-'))
+      node = combine (Op::neg, parseUnary());
+    else if (accept ('+'))
+      node = parseUnary();
+    else
+      node = parsePower();
+    --depth;
+    return node;
+  }
+
+  /// power := primary ('^' unary)?, so a^b^c is a^(b^c) and -a^b is -(a^b)
+  NodePtr parsePower() {
+    auto node = parsePrimary();
+    if (node != nullptr && accept ('^'))
+      node = combine (Op::pow, std::move (node), parseUnary());
+    return node;
+  }
+
+  /// primary := number | name | name '(' arguments ')' | '(' sum ')'
+  NodePtr parsePrimary() {
+    auto c = peek();
+    if (accept ('(')) {
+      auto node = parseSum();
+      if (node != nullptr && ! accept (')'))
+        return fail ("Expected ')'");
+      return node;
+    }
+    if (std::isdigit ((unsigned char) c) || c == '.')
+      return parseNumber();
+    if (std::isalpha ((unsigned char) c))
+      return parseName();
+    if (c == 0)
+      return fail ("Unexpected end");
+    return fail (String ("Unexpected '") + c + "'");
+  }
+
+  NodePtr parseNumber() {
+    auto start = position;
+    auto digits = [this] {
+      while (position < source.size() && std::isdigit ((unsigned char) source[position]))
+        ++position;
+    };
+    digits();
+    if (position < source.size() && source[position] == '.') {
+      ++position;
+      digits();
+    }
+    // an exponent needs a digit; without one the e is left over, so "2e" is
+    // an error rather than 2 times e
+    if (position < source.size() && (source[position] == 'e' || source[position] == 'E')) {
+      auto mark = position++;
+      if (position < source.size() && (source[position] == '+' || source[position] == '-'))
+        ++position;
+      if (position < source.size() && std::isdigit ((unsigned char) source[position]))
+        digits();
+      else
+        position = mark;
+    }
+    auto token = source.substr (start, position - start);
+    if (token == ".")
+      return fail ("Expected a number");
+    return constant ((float) String (token).getDoubleValue());
+  }
+
+  NodePtr parseName() {
+    auto start = position;
+    while (position < source.size() && (std::isalnum ((unsigned char) source[position]) || source[position] == '_'))
+      ++position;
+    auto name = source.substr (start, position - start);
+
+    struct Symbol { const char* name; Input input; };
+    static const Symbol variables[] {
+      {"p", Phase}, {"t", Time}, {"f", Frequency}, {"a", ParameterA}, {"b", ParameterB}
+    };
+    for (auto& v : variables) {
+      if (name == v.name) {
+        auto node = std::make_unique<Node>();
+        node->kind = Node::Variable;
+        node->input = v.input;
+        return node;
+      }
+    }
+    if (name == "pi")
+      return constant (MathConstants<float>::pi);
+    if (name == "e")
+      return constant (MathConstants<float>::euler);
+
+    struct Function { const char* name; Op op; int arity; };
+    static const Function functions[] {
+      {"sin", Op::sin, 1}, {"cos", Op::cos, 1}, {"tan", Op::tan, 1}, {"tanh", Op::tanh, 1},
+      {"exp", Op::exp, 1}, {"log", Op::log, 1}, {"sqrt", Op::sqrt, 1}, {"abs", Op::abs, 1},
+      {"floor", Op::floor, 1}, {"frac", Op::frac, 1}, {"clip", Op::clip, 1},
+      {"saw", Op::saw, 1}, {"sqr", Op::sqr, 1}, {"tri", Op::tri, 1},
+      {"min", Op::min, 2}, {"max", Op::max, 2}, {"pow", Op::pow, 2}, {"pulse", Op::pulse, 2}
+    };
+    for (auto& f : functions) {
+      if (name != f.name)
+        continue;
+      if (! accept ('('))
+        return fail ("Expected '(' after " + String (f.name));
+      auto first = parseSum();
+      if (first == nullptr)
+        return nullptr;
+      NodePtr second;
+      if (f.arity == 2) {
+        if (! accept (','))
+          return fail (String (f.name) + " takes 2 arguments");
+        second = parseSum();
+        if (second == nullptr)
+          return nullptr;
+      }
+      if (! accept (')'))
+        return fail ((f.arity == 1 && peek() == ',') ? String (f.name) + " takes 1 argument" : String ("Expected ')'"));
+      return combine (f.op, std::move (first), std::move (second));
+    }
+    position = start;
+    return fail ("Unknown name '" + String (name) + "'");
+  }
+
+  //==============================================================================
+  static NodePtr constant (float value) {
+    auto node = std::make_unique<Node>();
+    node->value = value;
+    return node;
+  }
+
+  /// Returns op applied to x and, for two operands, y. Folds the operation
+  /// if every operand is constant and drops the ones that change nothing.
+  /// Division by a constant becomes multiplication by its reciprocal, and
+  /// constants are gathered on the right, so chains such as 2*pi*p*3 fold
+  /// to a single multiply. Fails if the result is too high (see
+  /// Node::height).
+  NodePtr combine (Op op, NodePtr x, NodePtr y = nullptr) {
+    if (x == nullptr || (y == nullptr && ! isUnary (op)))
+      return nullptr;
+    if (x->kind == Node::Constant && (y == nullptr || y->kind == Node::Constant))
+      return constant (evaluate (op, x->value, (y != nullptr) ? y->value : 0.0f));
+
+    auto commutative = (op == Op::add || op == Op::mul || op == Op::min || op == Op::max);
+    if (commutative && x->kind == Node::Constant)
+      std::swap (x, y);
+    switch (op) {
+      case Op::add:
+        if (y->is (0.0f))
+          return x;
+        if (y->kind == Node::Constant && x->kind == Node::Operation && x->op == Op::add && x->right->kind == Node::Constant)
+          return combine (Op::add, std::move (x->left), constant (x->right->value + y->value));
+        break;
+      case Op::sub:
+        if (y->is (0.0f))
+          return x;
+        if (x->is (0.0f))
+          return combine (Op::neg, std::move (y));
+        if (y->kind == Node::Constant)
+          return combine (Op::add, std::move (x), constant (-y->value));
+        break;
+      case Op::mul:
+        if (y->is (1.0f))
+          return x;
+        if (y->is (-1.0f))
+          return combine (Op::neg, std::move (x));
+        if (y->kind == Node::Constant && x->kind == Node::Operation && x->op == Op::mul && x->right->kind == Node::Constant)
+          return combine (Op::mul, std::move (x->left), constant (x->right->value * y->value));
+        break;
+      case Op::div:
+        if (y->kind == Node::Constant)
+          return combine (Op::mul, std::move (x), constant (1.0f / y->value));
+        break;
+      case Op::pow:
+        if (y->is (1.0f))
+          return x;
+        break;
+      case Op::neg:
+        if (x->kind == Node::Operation && x->op == Op::neg)
+          return std::move (x->left);
+        break;
+      default:
+        break;
+    }
+    auto node = std::make_unique<Node>();
+    node->kind = Node::Operation;
+    node->op = op;
+    node->left = std::move (x);
+    node->right = std::move (y);
+    node->height = 1 + jmax (node->left->height, (node->right != nullptr) ? node->right->height : 0);
+    if (node->height > maxInstructions)
+      return fail ("Too long, more than " + String (maxInstructions) + " operations");
+    return node;
+  }
+
+  static bool isUnary (Op op) noexcept {
+    return op == Op::neg || op >= Op::sin;
+  }
+
+  //==============================================================================
+  /// Skips spaces and returns the next character, or 0 at the end.
+  char peek() {
+    while (position < source.size() && std::isspace ((unsigned char) source[position]))
+      ++position;
+    return (position < source.size()) ? source[position] : 0;
+  }
+
+  /// Consumes the next character if it is c.
+  bool accept (char c) {
+    if (peek() != c)
+      return false;
+    ++position;
+    return true;
+  }
+
+  /// Sets the error, if there isn't one yet, and returns nullptr.
+  NodePtr fail (const String& message) {
+    if (error.isEmpty())
+      error = message + " at column " + String ((int) position + 1);
+    return nullptr;
+  }
+
+  const std::string source;
+  size_t position {0};
+  int depth {0};
+  String& error;
+};
+
+//==============================================================================
+/// Emits the instructions of a folded tree, computing each operation into a
+/// temporary register and freeing its operands' registers as soon as it has
+/// read them.
+class ExpressionProgram::Compiler
+{
+public:
+  Compiler (ExpressionProgram& p, String& e)
+  : program (p), error (e) {
+  }
+
+  bool compile (const Node& root) {
+    auto result = emit (root);
+    // a constant expression is a register filled with it
+    if (result.isConstant())
+      result.reg = add (Op::fill, allocate(), 0, 0, result.value);
+    program.result = result.reg;
+    return error.isEmpty();
+  }
+
+private:
+  /// A register, or a constant held in the instruction that reads it.
+  struct Operand
+  {
+    bool isConstant() const noexcept { return reg < 0; }
+
+    int reg {-1};
+    float value {0.0f};
+  };
+
+  Operand emit (const Node& node) {
+    if (node.kind == Node::Constant)
+      return {-1, node.value};
+    if (node.kind == Node::Variable) {
+      program.inputsUsed |= 1u << node.input;
+      return {node.input};
+    }
+    if (node.right == nullptr) {
+      auto x = emit (*node.left);
+      return {add (node.op, reuse (x), x.reg, 0, 0.0f)};
+    }
+    // the operand needing more registers first, so its temporaries are
+    // free again before the other operand's are taken
+    Operand x, y;
+    if (getNeed (*node.right) > getNeed (*node.left)) {
+      y = emit (*node.right);
+      x = emit (*node.left);
+    }
+    else {
+      x = emit (*node.left);
+      y = emit (*node.right);
+    }
+    return combine (node.op, x, y);
+  }
+
+  Operand combine (Op op, Operand x, Operand y) {
+    if (! x.isConstant() && ! y.isConstant()) {
+      auto dest = reuse (x, y);
+      return {add (op, dest, x.reg, y.reg, 0.0f)};
+    }
+    if (y.isConstant()) {
+      if (op == Op::pow && y.value == 2.0f)
+        return {add (Op::mul, reuse (x), x.reg, x.reg, 0.0f)};
+      if (auto form = getConstantForm (op, false); form != Op::fill)
+        return {add (form, reuse (x), x.reg, 0, y.value)};
+      y.reg = add (Op::fill, allocate(), 0, 0, y.value);
+      return combine (op, x, y);
+    }
+    if (auto form = getConstantForm (op, true); form != Op::fill)
+      return {add (form, reuse (y), y.reg, 0, x.value)};
+    x.reg = add (Op::fill, allocate(), 0, 0, x.value);
+    return combine (op, x, y);
+  }
+
+  /// Returns the form of a two operand op taking its right, or left,
+  /// operand from the constant, or fill if there is none.
+  static Op getConstantForm (Op op, bool left) noexcept {
+    switch (op) {
+      case Op::add: return Op::addK;
+      case Op::mul: return Op::mulK;
+      case Op::min: return Op::minK;
+      case Op::max: return Op::maxK;
+      case Op::sub: return left ? Op::kSub : Op::subK;
+      case Op::div: return left ? Op::kDiv : Op::fill;
+      case Op::mod: return left ? Op::kMod : Op::modK;
+      case Op::pow: return left ? Op::kPow : Op::powK;
+      case Op::pulse: return left ? Op::fill : Op::pulseK;
+      default: return Op::fill;
+    }
+  }
+
+  /// Returns the temporaries a subtree needs.
+  static int getNeed (const Node& node) noexcept {
+    if (node.kind != Node::Operation)
+      return 0;
+    auto left = getNeed (*node.left);
+    if (node.right == nullptr)
+      return jmax (1, left);
+    auto right = getNeed (*node.right);
+    return jmax (1, (left == right) ? left + 1 : jmax (left, right));
+  }
+
+  static bool isTemporary (int reg) noexcept { return reg >= NumInputs; }
+
+  /// Returns a free temporary.
+  int allocate() {
+    for (auto reg = (int) NumInputs; reg < maxRegisters; ++reg) {
+      if ((used & (1u << reg)) == 0) {
+        used |= 1u << reg;
+        return reg;
+      }
+    }
+    if (error.isEmpty())
+      error = "Too complex, needs more than " + String (maxRegisters - NumInputs) + " registers";
+    return NumInputs;
+  }
+
+  void free (int reg) noexcept {
+    if (isTemporary (reg))
+      used &= ~(1u << reg);
+  }
+
+  /// Returns a register for the result of an operation on x, x's own if it
+  /// is a temporary.
+  int reuse (Operand x) {
+    return isTemporary (x.reg) ? x.reg : allocate();
+  }
+
+  /// Returns a register for the result of an operation on x and y, one of
+  /// theirs if they are temporaries, and frees the other.
+  int reuse (Operand x, Operand y) {
+    if (isTemporary (x.reg)) {
+      if (y.reg != x.reg)
+        free (y.reg);
+      return x.reg;
+    }
+    return reuse (y);
+  }
+
+  /// Appends an instruction and returns its destination.
+  int add (Op op, int dest, int a, int b, float constant) {
+    if ((int) program.code.size() >= maxInstructions) {
+      if (error.isEmpty())
+        error = "Too long, compiles to more than " + String (maxInstructions) + " instructions";
+      return dest;
+    }
+    program.code.push_back ({op, (uint8) dest, (uint8) a, (uint8) b, constant});
+    return dest;
+  }
+
+  ExpressionProgram& program;
+  String& error;
+  /// The registers holding values still to be read, one bit each.
+  uint32 used {0};
+};
+
+//==============================================================================
+std::unique_ptr<ExpressionProgram> ExpressionProgram::compile (const String& text, String& error) {
+  error = {};
+  auto root = Parser (text, error).parse();
+  if (root == nullptr)
+    return nullptr;
+  std::unique_ptr<ExpressionProgram> program (new ExpressionProgram());
+  program->text = text;
+  if (! Compiler (*program, error).compile (*root))
+    return nullptr;
+  return program;
+}
+
+const float* ExpressionProgram::run (float* registers, int stride, int numSamples) const noexcept {
+  for (auto& instruction : code)
+    execute (instruction, registers, stride, numSamples);
+  return registers + (size_t) result * (size_t) stride;
+}
+
+float ExpressionProgram::evaluate (Op op, float x, float y) noexcept {
+  float registers[3] {x, y, 0.0f};
+  execute ({op, 2, 0, 1, 0.0f}, registers, 1, 1);
+  return registers[2];
+}
+
+void ExpressionProgram::execute (const Instruction& instruction, float* registers, int stride, int numSamples) noexcept {
+  auto* d = registers + (size_t) instruction.dest * (size_t) stride;
+  const auto* x = registers + (size_t) instruction.a * (size_t) stride;
+  const auto* y = registers + (size_t) instruction.b * (size_t) stride;
+  const auto k = instruction.constant;
+  const auto n = numSamples;
+  auto mod = [] (float u, float v) { return u - v * floorOf (u / v); };
+  auto pulse = [] (float u, float w) { return (fracOf (u) < w) ? 1.0f : -1.0f; };
+  // exp, log, pow, tan and tanh call the library and stay scalar
+  switch (instruction.op) {
+    case Op::fill:   FloatVectorOperations::fill (d, k, n); break;
+    case Op::add:    map (d, x, y, n, [] (float u, float v) { return u + v; }); break;
+    case Op::addK:   map (d, x, n, [k] (float u) { return u + k; }); break;
+    case Op::sub:    map (d, x, y, n, [] (float u, float v) { return u - v; }); break;
+    case Op::subK:   map (d, x, n, [k] (float u) { return u - k; }); break;
+    case Op::kSub:   map (d, x, n, [k] (float u) { return k - u; }); break;
+    case Op::mul:    map (d, x, y, n, [] (float u, float v) { return u * v; }); break;
+    case Op::mulK:   map (d, x, n, [k] (float u) { return u * k; }); break;
+    case Op::div:    map (d, x, y, n, [] (float u, float v) { return u / v; }); break;
+    case Op::kDiv:   map (d, x, n, [k] (float u) { return k / u; }); break;
+    case Op::mod:    map (d, x, y, n, mod); break;
+    case Op::modK:   map (d, x, n, [k, mod] (float u) { return mod (u, k); }); break;
+    case Op::kMod:   map (d, x, n, [k, mod] (float u) { return mod (k, u); }); break;
+    case Op::pow:    map (d, x, y, n, [] (float u, float v) { return std::pow (u, v); }); break;
+    case Op::powK:   map (d, x, n, [k] (float u) { return std::pow (u, k); }); break;
+    case Op::kPow:   map (d, x, n, [k] (float u) { return std::pow (k, u); }); break;
+    case Op::min:    map (d, x, y, n, [] (float u, float v) { return jmin (u, v); }); break;
+    case Op::minK:   map (d, x, n, [k] (float u) { return jmin (u, k); }); break;
+    case Op::max:    map (d, x, y, n, [] (float u, float v) { return jmax (u, v); }); break;
+    case Op::maxK:   map (d, x, n, [k] (float u) { return jmax (u, k); }); break;
+    case Op::pulse:  map (d, x, y, n, pulse); break;
+    case Op::pulseK: map (d, x, n, [k, pulse] (float u) { return pulse (u, k); }); break;
+    case Op::neg:    map (d, x, n, [] (float u) { return -u; }); break;
+    case Op::sin:    map (d, x, n, [] (float u) { return sine (u); }); break;
+    case Op::cos:    map (d, x, n, [] (float u) { return sine (u + MathConstants<float>::halfPi); }); break;
+    case Op::tan:    map (d, x, n, [] (float u) { return std::tan (u); }); break;
+    case Op::tanh:   map (d, x, n, [] (float u) { return std::tanh (u); }); break;
+    case Op::exp:    map (d, x, n, [] (float u) { return std::exp (u); }); break;
+    case Op::log:    map (d, x, n, [] (float u) { return std::log (u); }); break;
+    case Op::sqrt:   map (d, x, n, [] (float u) { return std::sqrt (u); }); break;
+    case Op::abs:    map (d, x, n, [] (float u) { return std::abs (u); }); break;
+    case Op::floor:  map (d, x, n, [] (float u) { return floorOf (u); }); break;
+    case Op::frac:   map (d, x, n, [] (float u) { return fracOf (u); }); break;
+    case Op::clip:   map (d, x, n, [] (float u) { return jlimit (-1.0f, 1.0f, u); }); break;
+    case Op::saw:    map (d, x, n, [] (float u) { return 2.0f * fracOf (u) - 1.0f; }); break;
+    case Op::sqr:    map (d, x, n, [] (float u) { return (fracOf (u) > 0.5f) ? 1.0f : -1.0f; }); break;
+    case Op::tri:
+      map (d, x, n, [] (float u) {
+        auto f = fracOf (u);
+        return (f <= 0.5f) ? 4.0f * f - 1.0f : 3.0f - 4.0f * f;
+      });
+      break;
+  }
+}
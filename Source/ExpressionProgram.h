@@ -0,0 +1,101 @@
+//==============================================================================
+// ExpressionProgram.h
+// Compiles waveform expressions to register bytecode that runs a block at a time.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/// ExpressionProgram is a waveform typed in as a formula, such as
+/// `sin(2*pi*p) + 0.3*saw(3*p)`. The formula can use:
+///   * the variables p (the phase, 0 to 1 over a period), t (seconds since
+///     the waveform started, back to 0 after the whole number of periods of f
+///     nearest a minute), f (the frequency in
+///     Hz) and a and b (the two parameter sliders, 0 to 1), and the
+///     constants pi and e,
+///   * + - * / % (floored modulo) and ^ (power), with the usual precedence,
+///   * sin, cos, tan, tanh, exp, log, sqrt, abs, floor, frac and clip (to
+///     -1..1) of one argument, and min, max, pow and pulse of two.
+/// saw, sqr and tri take a phase in cycles and match the LF_* shapes, and
+/// pulse (x, w) is 1 for the first w of each cycle and -1 after. Nothing is
+/// band limited, so these alias as the LF_* shapes do.
+///
+/// compile() parses the text and folds every part that doesn't depend on a
+/// variable into a constant, then allocates registers and emits one
+/// instruction per remaining operation. A register holds a whole block of
+/// samples, and run() executes each instruction across the block before
+/// going on to the next, so the dispatch costs once per block rather than
+/// per sample and every instruction is a loop the compiler vectorizes.
+/// Constant operands are stored in the instruction, not in a register.
+///
+/// Programs are immutable once compiled, so one can be shared by any number
+/// of voices.
+class ExpressionProgram
+{
+public:
+  /// The variables, held in the first registers.
+  enum Input { Phase, Time, Frequency, ParameterA, ParameterB, NumInputs };
+
+  /// Registers, the inputs included.
+  static constexpr int maxRegisters = 16;
+  /// Longest program, in instructions.
+  static constexpr int maxInstructions = 256;
+
+  /// Compiles text, or returns nullptr and sets error.
+  static std::unique_ptr<ExpressionProgram> compile (const String& text, String& error);
+
+  /// Returns the text the program was compiled from.
+  const String& getText() const noexcept { return text; }
+
+  /// Returns the number of instructions.
+  int getNumInstructions() const noexcept { return (int) code.size(); }
+
+  /// Returns true if the program reads an input. The caller needn't fill
+  /// the others.
+  bool uses (Input input) const noexcept { return (inputsUsed & (1u << input)) != 0; }
+
+  /// Runs the program on numSamples samples. registers holds maxRegisters
+  /// rows of stride samples, the inputs filled in. Returns the row holding
+  /// the result.
+  const float* run (float* registers, int stride, int numSamples) const noexcept;
+
+private:
+  struct Node;
+  class Parser;
+  class Compiler;
+
+  /// The operations. The K forms take their second operand, and the KX
+  /// forms their first, from the instruction's constant.
+  enum class Op : uint8
+  {
+    fill, add, addK, sub, subK, kSub, mul, mulK, div, kDiv, mod, modK, kMod,
+    pow, powK, kPow, min, minK, max, maxK, pulse, pulseK, neg,
+    sin, cos, tan, tanh, exp, log, sqrt, abs, floor, frac, clip, saw, sqr, tri
+  };
+
+  struct Instruction
+  {
+    Op op;
+    uint8 dest;
+    uint8 a;
+    uint8 b;
+    float constant;
+  };
+
+  ExpressionProgram() = default;
+
+  /// Runs one instruction on numSamples samples.
+  static void execute (const Instruction& instruction, float* registers, int stride, int numSamples) noexcept;
+
+  /// Returns op applied to x and y, computed exactly as the instruction
+  /// would be, so folding never changes the result.
+  static float evaluate (Op op, float x, float y) noexcept;
+
+  String text;
+  std::vector<Instruction> code;
+  int result {0};
+  uint32 inputsUsed {0};
+
+  JUCE_DECLARE_NON_COPYABLE (ExpressionProgram)
+};
@@ -0,0 +1,133 @@
+//==============================================================================
+// ExpressionSynth.cpp
+// Plays a waveform typed in as an expression.
+//==============================================================================
+
+#include "ExpressionSynth.h"
+
+ExpressionSynth::~ExpressionSynth() {
+  delete incoming.exchange (nullptr);
+  delete retired.exchange (nullptr);
+  delete playing;
+}
+
+size_t ExpressionSynth::getArenaBytes() {
+  return DspArena::bytesFor<float> ((size_t) ExpressionProgram::maxRegisters * blockSize);
+}
+
+void ExpressionSynth::prepare (DspArena& arena) {
+  registers = arena.allocate<float> ((size_t) ExpressionProgram::maxRegisters * blockSize);
+}
+
+void ExpressionSynth::release() {
+  registers = nullptr;
+}
+
+void ExpressionSynth::setProgram (std::unique_ptr<ExpressionProgram> newProgram) {
+  reclaim();
+  // a program still waiting was never played
+  delete incoming.exchange (newProgram.release());
+}
+
+void ExpressionSynth::reclaim() {
+  delete retired.exchange (nullptr);
+}
+
+void ExpressionSynth::update() noexcept {
+  if (retired.load() != nullptr)
+    return;
+  if (auto* next = incoming.exchange (nullptr)) {
+    retired.store (playing);
+    playing = next;
+  }
+}
+
+double ExpressionSynth::getTimeWrap (double freq) noexcept {
+  if (! (freq > 0.0))
+    return timePeriod;
+  return jmax (1.0, std::round (timePeriod * freq)) / freq;
+}
+
+void ExpressionSynth::render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain) {
+  auto* synth = state.engines.expression;
+  auto& buffer = *bufferToFill.buffer;
+  if (synth == nullptr || synth->registers == nullptr) {
+    bufferToFill.clearActiveBufferRegion();
+    return;
+  }
+  synth->update();
+  if (synth->playing == nullptr) {
+    bufferToFill.clearActiveBufferRegion();
+    return;
+  }
+  if (buffer.getNumChannels() == 0 || bufferToFill.numSamples <= 0)
+    return;
+  float from[2], to[2];
+  for (auto k = 0; k < 2; ++k) {
+    auto& last = state.expressionParameters[k];
+    to[k] = synth->parameters[k].load();
+    from[k] = (last < 0.0f) ? to[k] : last;
+    last = to[k];
+    RealtimeChecks::checkDenormal (last);
+  }
+  const auto secondsPerSample = (state.srate > 0.0) ? 1.0 / state.srate : 0.0;
+  const auto wrap = getTimeWrap (state.freq);
+  // a frequency change can leave t beyond the new wrap
+  if (state.expressionTime >= wrap)
+    state.expressionTime = std::fmod (state.expressionTime, wrap);
+  auto* first = buffer.getWritePointer (0, bufferToFill.startSample);
+  for (auto done = 0; done < bufferToFill.numSamples; done += blockSize) {
+    auto num = jmin (blockSize, bufferToFill.numSamples - done);
+    synth->fillInputs (state, from, to, done, num, bufferToFill.numSamples, secondsPerSample, wrap);
+    const auto* result = synth->playing->run (synth->registers, blockSize, num);
+    auto* dest = first + done;
+    for (auto i = 0; i < num; ++i) {
+      auto value = result[i];
+      // NaN and +-inf are the only values for which value - value isn't 0
+      dest[i] = (value - value == 0.0f) ? gain * jlimit (-4.0f, 4.0f, value) : 0.0f;
+    }
+    auto next = state.phase + num * state.phaseDelta;
+    state.phase = next - std::floor (next);
+    auto time = state.expressionTime + num * secondsPerSample;
+    state.expressionTime = (time >= wrap) ? time - wrap : time;
+  }
+  for (auto chan = 1; chan < buffer.getNumChannels(); ++chan)
+    FloatVectorOperations::copy (buffer.getWritePointer (chan, bufferToFill.startSample), first, bufferToFill.numSamples);
+}
+
+void ExpressionSynth::fillInputs (const GeneratorState& state, const float* from, const float* to,
+                                  int done, int numSamples, int total,
+                                  double secondsPerSample, double wrap) noexcept {
+  auto& program = *playing;
+  auto input = [this] (ExpressionProgram::Input in) { return registers + (size_t) in * blockSize; };
+  if (program.uses (ExpressionProgram::Phase)) {
+    auto* p = input (ExpressionProgram::Phase);
+    const auto start = state.phase;
+    const auto delta = state.phaseDelta;
+    for (auto i = 0; i < numSamples; ++i) {
+      auto phase = start + i * delta;
+      p[i] = (float) (phase - std::floor (phase));
+    }
+  }
+  if (program.uses (ExpressionProgram::Time)) {
+    auto* t = input (ExpressionProgram::Time);
+    // kept in double, so only the wrapped time is rounded to float
+    const auto start = state.expressionTime;
+    for (auto i = 0; i < numSamples; ++i) {
+      auto time = start + i * secondsPerSample;
+      t[i] = (float) ((time >= wrap) ? time - wrap : time);
+    }
+  }
+  if (program.uses (ExpressionProgram::Frequency))
+    FloatVectorOperations::fill (input (ExpressionProgram::Frequency), (float) state.freq, numSamples);
+  for (auto k = 0; k < 2; ++k) {
+    auto in = (k == 0) ? ExpressionProgram::ParameterA : ExpressionProgram::ParameterB;
+    if (! program.uses (in))
+      continue;
+    auto* r = input (in);
+    auto step = (to[k] - from[k]) / (float) total;
+    auto start = from[k] + step * (float) done;
+    for (auto i = 0; i < numSamples; ++i)
+      r[i] = start + step * (float) i;
+  }
+}
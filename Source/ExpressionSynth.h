@@ -0,0 +1,110 @@
+//==============================================================================
+// ExpressionSynth.h
+// Plays a waveform typed in as an expression.
+//==============================================================================
+
+#pragma once
+
+#include "Generators.h"
+#include "DspArena.h"
+#include "ExpressionProgram.h"
+
+/// ExpressionSynth plays an ExpressionProgram as a generator. It fills the
+/// program's inputs for up to blockSize samples at a time, the phase and
+/// time from the slot's GeneratorState, runs the program over them and
+/// scales the result by the gain. The synth keeps nothing per voice, so
+/// every slot and matrix channel can play the same synth at its own
+/// frequency.
+///
+/// The registers are scratch space in the DSP arena, reused by every
+/// render. A parameter ramps to a new value over each voice's next render,
+/// so moving a slider doesn't zipper. The value a voice ramped to is kept
+/// in its GeneratorState, so every voice ramps the same way. Results that
+/// aren't finite, NaN or +-inf, are silenced and the rest limited to +-4,
+/// so an expression such as 1/p can't blow up the stages after it.
+///
+/// New programs are handed over from the message thread through a pair of
+/// atomic pointers: the audio thread adopts a program at the start of a
+/// block and passes the one it replaces back, to be deleted by the next
+/// setProgram() or reclaim().
+class ExpressionSynth
+{
+public:
+  /// Samples per run of the program: the length of a register.
+  static constexpr int blockSize = 64;
+
+  /// About how many seconds t runs before it starts over from 0. The
+  /// registers are floats, so an ever growing t would lose its resolution,
+  /// 8 ms a step after a day; a minute keeps it below 4 us.
+  static constexpr double timePeriod = 60.0;
+
+  /// Returns the seconds after which t starts over at frequency freq: the
+  /// whole number of periods of freq nearest timePeriod, at least one, so
+  /// an expression such as sin (2 * pi * f * t) carries on across the wrap
+  /// without a click. Returns timePeriod if freq is 0.
+  static double getTimeWrap (double freq) noexcept;
+
+  ExpressionSynth() = default;
+
+  /// Deletes every program. The audio thread must have stopped.
+  ~ExpressionSynth();
+
+  /// Returns the arena space prepare() needs.
+  static size_t getArenaBytes();
+
+  /// Places the registers in the arena. Call from prepareToPlay().
+  void prepare (DspArena& arena);
+
+  /// Forgets the arena memory handed out by prepare(). Call from
+  /// releaseResources() before the arena is released.
+  void release();
+
+  //==============================================================================
+  // Message thread
+
+  /// Hands a new program to the audio thread, which plays it from its next
+  /// block. Also deletes programs the audio thread is done with.
+  void setProgram (std::unique_ptr<ExpressionProgram> newProgram);
+
+  /// Deletes the program the audio thread has passed back. Call regularly,
+  /// e.g. from a timer.
+  void reclaim();
+
+  /// Sets the value of a or b, 0 to 1, from any thread.
+  void setParameter (int index, float value) { parameters[index == 0 ? 0 : 1].store (jlimit (0.0f, 1.0f, value)); }
+
+  //==============================================================================
+  // Audio thread
+
+  /// The generator function. Renders the synth that
+  /// state.engines.expression points to.
+  static void render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain);
+
+private:
+  /// Adopts a program handed over by setProgram(), if any.
+  void update() noexcept;
+
+  /// Fills the registers of the inputs the program reads for numSamples
+  /// samples, done samples into a render of length total that ramps a and
+  /// b from from to to. t steps by secondsPerSample and starts over at wrap.
+  void fillInputs (const GeneratorState& state, const float* from, const float* to,
+                   int done, int numSamples, int total,
+                   double secondsPerSample, double wrap) noexcept;
+
+  /// maxRegisters registers of blockSize samples.
+  float* registers {nullptr};
+
+  /// The program playing.
+  ExpressionProgram* playing {nullptr};
+
+  /// The parameter values set.
+  std::atomic<float> parameters[2] {{0.5f}, {0.5f}};
+
+  /// The program handed over by setProgram(), and the one the audio thread
+  /// has replaced. The audio thread only adopts a new program while nothing
+  /// waits in retired, so it never has more than one to pass back.
+  std::atomic<ExpressionProgram*> incoming {nullptr};
+  std::atomic<ExpressionProgram*> retired {nullptr};
+
+  JUCE_DECLARE_NON_COPYABLE (ExpressionSynth)
+};
@@ -0,0 +1,333 @@
+//==============================================================================
+// GeneratorBenchmark.cpp
+// Measures the quality and cost of every periodic generator.
+//==============================================================================
+
+#include "GeneratorBenchmark.h"
+#include "SubBlockScheduler.h"
+#include "WaveTables.h"
+
+namespace
+{
+  const double sampleRates[] = {44100.0, 48000.0, 96000.0, 192000.0};
+  const double frequencies[] = {55.0, 220.0, 880.0, 3520.0};
+
+  /// Samples rendered to time a generator, and the number of timed renders
+  /// whose median is taken. An untimed render before them warms the caches
+  /// and tables.
+  const int timingSamples = 1 << 15;
+  const int timingRepeats = 7;
+
+  /// Half width in bins of the Blackman-Harris main lobe.
+  const int lobeBins = 4;
+
+  /// Renders numSamples of a candidate into dest, one sub-block at a time,
+  /// exactly as the audio thread does.
+  void renderCandidate (const GeneratorBenchmark::Candidate& candidate, GeneratorState& state,
+                        AudioSampleBuffer& dest, int numSamples)
+  {
+    for (auto start = 0; start < numSamples; start += SubBlockScheduler::subBlockSize) {
+      auto num = jmin (SubBlockScheduler::subBlockSize, numSamples - start);
+      candidate.generator (state, AudioSourceChannelInfo (&dest, start, num), 1.0f);
+    }
+  }
+
+  GeneratorState makeState (const GeneratorBenchmark::Candidate& candidate, double sampleRate, double frequency)
+  {
+    GeneratorState state;
+    if (candidate.wavetable != nullptr)
+      state.setTable (*candidate.wavetable);
+    state.engines.expression = candidate.expression;
+    state.engines.spectral = candidate.spectral;
+    state.compactTable = candidate.compactTable;
+    state.slot = 0;
+    state.setFrequency (frequency, sampleRate);
+    return state;
+  }
+}
+
+GeneratorBenchmark::GeneratorBenchmark() {
+  static_assert ((int) NumShapes == (int) WaveTables::NumShapes, "shapes must match the WT_* tables");
+  for (auto shape = 0; shape < NumShapes; ++shape)
+    WaveTables::createTable (WaveTables::getDefaultSpectrum ((WaveTables::Shape) shape), tables[shape]);
+
+  using namespace Generators;
+  addCandidate ({"Sine",        "Sine", Sine,     &render<Generators::Sine>,   nullptr});
+  addCandidate ({"LF Impulse",  "LF",   Impulse,  &render<LF_Impulse>,         nullptr});
+  addCandidate ({"LF Square",   "LF",   Square,   &render<LF_Square>,          nullptr});
+  addCandidate ({"LF Saw",      "LF",   Sawtooth, &render<LF_Sawtooth>,        nullptr});
+  addCandidate ({"LF Triangle", "LF",   Triangle, &render<LF_Triangle>,        nullptr});
+  addCandidate ({"BL Impulse",  "BL",   Impulse,  &render<BL_Impulse>,         nullptr});
+  addCandidate ({"BL Square",   "BL",   Square,   &render<BL_Square>,          nullptr});
+  addCandidate ({"BL Saw",      "BL",   Sawtooth, &render<BL_Sawtooth>,        nullptr});
+  addCandidate ({"BL Triangle", "BL",   Triangle, &render<BL_Triangle>,        nullptr});
+  addCandidate ({"WT Sine",     "WT",   Sine,     &render<Wavetable>,          &tables[Sine]});
+  addCandidate ({"WT Impulse",  "WT",   Impulse,  &render<Wavetable>,          &tables[Impulse]});
+  addCandidate ({"WT Square",   "WT",   Square,   &render<Wavetable>,          &tables[Square]});
+  addCandidate ({"WT Saw",      "WT",   Sawtooth, &render<Wavetable>,          &tables[Sawtooth]});
+  addCandidate ({"WT Triangle", "WT",   Triangle, &render<Wavetable>,          &tables[Triangle]});
+
+  // the same tables in the 16 bit formats, to measure what the compact
+  // kernels lose against the float ones
+  const char* const shapeNames[] = {"Sine", "Impulse", "Square", "Saw", "Triangle"};
+  for (auto shape = 0; shape < NumShapes; ++shape) {
+    auto numSamples = tables[shape].getNumSamples();
+    for (auto i = 0; i < 2; ++i) {
+      compactTables[i][shape].resize ((size_t) numSamples);
+      WaveTables::encode (tables[shape].getReadPointer (0), numSamples, i == 0 ? WaveTables::Float16 : WaveTables::Int16,
+                          compactTables[i][shape].data());
+    }
+    Candidate half {String ("WT Half ") + shapeNames[shape], "WT Half", (Shape) shape,
+                    &render<CompactWavetable<WaveTables::Float16>>, &tables[shape]};
+    half.compactTable = compactTables[0][shape].data();
+    addCandidate (half);
+    Candidate int16 {String ("WT Int16 ") + shapeNames[shape], "WT Int16", (Shape) shape,
+                     &render<CompactWavetable<WaveTables::Int16>>, &tables[shape]};
+    int16.compactTable = compactTables[1][shape].data();
+    addCandidate (int16);
+  }
+
+  // the sine and saw as expressions, to compare the interpreter with the
+  // kernels above
+  const char* const texts[] = {"sin(2*pi*p)", "saw(p)"};
+  arena.reserve (2 * ExpressionSynth::getArenaBytes() + std::size (spectral) * SpectralSynth::getArenaBytes());
+  for (auto i = 0; i < 2; ++i) {
+    String error;
+    expressions[i].prepare (arena);
+    expressions[i].setProgram (ExpressionProgram::compile (texts[i], error));
+  }
+  addCandidate ({"Expr Sine",   "Expr", Sine,     &ExpressionSynth::render,    nullptr, &expressions[0]});
+  addCandidate ({"Expr Saw",    "Expr", Sawtooth, &ExpressionSynth::render,    nullptr, &expressions[1]});
+
+  // the BL_* harmonics synthesized by inverse FFT, at the default size,
+  // each with an engine of its own
+  for (auto& synth : spectral)
+    synth.prepare (arena);
+  addCandidate ({"FFT Impulse", "FFT",  Impulse,  &SpectralSynth::render<1, 0>, nullptr, nullptr, &spectral[0], nullptr, &render<BL_Impulse>});
+  addCandidate ({"FFT Square",  "FFT",  Square,   &SpectralSynth::render<2, 1>, nullptr, nullptr, &spectral[1], nullptr, &render<BL_Square>});
+  addCandidate ({"FFT Saw",     "FFT",  Sawtooth, &SpectralSynth::render<1, 1>, nullptr, nullptr, &spectral[2], nullptr, &render<BL_Sawtooth>});
+  addCandidate ({"FFT Triangle", "FFT", Triangle, &SpectralSynth::render<2, 2>, nullptr, nullptr, &spectral[3], nullptr, &render<BL_Triangle>});
+}
+
+void GeneratorBenchmark::addCandidate (const Candidate& candidate) {
+  candidates.push_back (candidate);
+}
+
+const char* GeneratorBenchmark::getShapeName (Shape shape) {
+  switch (shape) {
+    case Sine:     return "sine";
+    case Impulse:  return "impulse";
+    case Square:   return "square";
+    case Sawtooth: return "sawtooth";
+    case Triangle: return "triangle";
+    default:       return "";
+  }
+}
+
+double GeneratorBenchmark::getIdealAmplitude (Shape shape, int harmonic) {
+  auto odd = (harmonic % 2) == 1;
+  switch (shape) {
+    case Sine:     return harmonic == 1 ? 1.0 : 0.0;
+    case Impulse:  return 1.0;
+    case Square:   return odd ? 1.0 / harmonic : 0.0;
+    case Sawtooth: return 1.0 / harmonic;
+    case Triangle: return odd ? 1.0 / (harmonic * harmonic) : 0.0;
+    default:       return 0.0;
+  }
+}
+
+void GeneratorBenchmark::run() {
+  results.clear();
+  for (auto sampleRate : sampleRates)
+    for (auto frequency : frequencies)
+      for (auto i = 0; i < (int) candidates.size(); ++i)
+        results.add (measure (i, sampleRate, frequency));
+  markParetoFront();
+}
+
+GeneratorBenchmark::Result GeneratorBenchmark::measure (int index, double sampleRate, double frequency) {
+  auto& candidate = candidates[(size_t) index];
+  Result result {index, sampleRate, frequency, 0.0, 0.0, 0.0, 0.0, 0.0, false};
+
+  // cost, each render from a fresh state
+  {
+    AudioSampleBuffer buffer (1, timingSamples);
+    {
+      auto state = makeState (candidate, sampleRate, frequency);
+      renderCandidate (candidate, state, buffer, timingSamples);
+    }
+    double seconds[timingRepeats];
+    for (auto& s : seconds) {
+      auto state = makeState (candidate, sampleRate, frequency);
+      auto start = Time::getHighResolutionTicks();
+      renderCandidate (candidate, state, buffer, timingSamples);
+      s = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+    }
+    auto* median = seconds + timingRepeats / 2;
+    std::nth_element (seconds, median, seconds + timingRepeats);
+    result.nsPerSample = *median * 1.0e9 / timingSamples;
+  }
+
+  // Spectrum. The FFT is long enough to put at least 10 bins between
+  // harmonics so each harmonic's main lobe can be summed on its own.
+  auto order = jmax (13, (int) std::ceil (std::log2 (10.0 * sampleRate / frequency)));
+  auto size = 1 << order;
+  AudioSampleBuffer buffer (1, size * 2);
+  buffer.clear();
+  auto state = makeState (candidate, sampleRate, frequency);
+  renderCandidate (candidate, state, buffer, size);
+  auto* data = buffer.getWritePointer (0);
+  dsp::WindowingFunction<float>::fillWindowingTables (data + size, (size_t) size,
+                                                     dsp::WindowingFunction<float>::blackmanHarris, false);
+  FloatVectorOperations::multiply (data, data + size, size);
+  dsp::FFT fft (order);
+  fft.performFrequencyOnlyForwardTransform (data);
+
+  auto numBins = size / 2;
+  std::vector<double> power ((size_t) numBins);
+  for (auto k = 0; k < numBins; ++k)
+    power[(size_t) k] = (double) data[k] * (double) data[k];
+
+  auto binsPerHarmonic = frequency * size / sampleRate;
+  // every harmonic below Nyquist
+  auto numHarmonics = (int) std::ceil (sampleRate / 2.0 / frequency) - 1;
+  std::vector<bool> harmonicBin ((size_t) numBins, false);
+  std::vector<double> amplitude ((size_t) numHarmonics + 1, 0.0);
+  for (auto h = 1; h <= numHarmonics; ++h) {
+    auto centre = roundToInt (h * binsPerHarmonic);
+    double sum = 0.0;
+    for (auto k = jmax (1, centre - lobeBins); k <= jmin (numBins - 1, centre + lobeBins); ++k) {
+      sum += power[(size_t) k];
+      harmonicBin[(size_t) k] = true;
+    }
+    amplitude[(size_t) h] = std::sqrt (sum);
+  }
+
+  double inharmonic = 0.0, total = 0.0, logSum = 0.0;
+  for (auto k = lobeBins + 1; k < numBins; ++k) {
+    auto p = power[(size_t) k];
+    total += p;
+    logSum += std::log (p + 1.0e-30);
+    if (! harmonicBin[(size_t) k])
+      inharmonic += p;
+  }
+  auto counted = numBins - lobeBins - 1;
+  result.flatness = total > 0.0 ? std::exp (logSum / counted) / (total / counted) : 0.0;
+
+  auto fundamental = amplitude.size() > 1 ? amplitude[1] : 0.0;
+  double reference = 0.0, error = inharmonic, overtones = 0.0;
+  for (auto h = 1; h <= numHarmonics; ++h) {
+    auto ideal = fundamental * getIdealAmplitude (candidate.shape, h);
+    reference += ideal * ideal;
+    error += square (amplitude[(size_t) h] - ideal);
+    if (h > 1)
+      overtones += square (amplitude[(size_t) h]);
+  }
+  result.snrDb = (error > 0.0 && reference > 0.0) ? jmin (200.0, 10.0 * std::log10 (reference / error)) : 200.0;
+  result.thdPercent = fundamental > 0.0 ? 100.0 * std::sqrt (overtones) / fundamental : 0.0;
+
+  // the difference from the generator approximated, over the same samples
+  if (candidate.reference != nullptr) {
+    AudioSampleBuffer rendered (1, size);
+    auto candidateState = makeState (candidate, sampleRate, frequency);
+    renderCandidate (candidate, candidateState, rendered, size);
+    auto reference = candidate;
+    reference.generator = candidate.reference;
+    AudioSampleBuffer expected (1, size);
+    auto referenceState = makeState (reference, sampleRate, frequency);
+    renderCandidate (reference, referenceState, expected, size);
+    double difference = 0.0, power = 0.0;
+    for (auto i = 0; i < size; ++i) {
+      auto x = (double) expected.getSample (0, i);
+      difference += square ((double) rendered.getSample (0, i) - x);
+      power += x * x;
+    }
+    result.referenceErrorDb = (difference > 0.0 && power > 0.0) ? jmax (-200.0, 10.0 * std::log10 (difference / power)) : -200.0;
+  }
+  return result;
+}
+
+void GeneratorBenchmark::markParetoFront() {
+  // a result is on the front unless another generator of the same shape,
+  // rate and frequency is at least as good and as cheap, and better in one
+  for (auto& a : results) {
+    a.pareto = true;
+    for (auto& b : results) {
+      if (&a == &b || a.sampleRate != b.sampleRate || a.frequency != b.frequency
+          || candidates[(size_t) a.candidate].shape != candidates[(size_t) b.candidate].shape)
+        continue;
+      auto noWorse = b.snrDb >= a.snrDb && b.nsPerSample <= a.nsPerSample;
+      auto better = b.snrDb > a.snrDb || b.nsPerSample < a.nsPerSample;
+      if (noWorse && better) {
+        a.pareto = false;
+        break;
+      }
+    }
+  }
+}
+
+bool GeneratorBenchmark::write (const File& directory) const {
+  if (! directory.createDirectory())
+    return false;
+
+  String csv ("generator,engine,shape,sampleRate,frequency,snrDb,thdPercent,flatness,nsPerSample,referenceErrorDb,pareto\n");
+  for (auto& r : results) {
+    auto& c = candidates[(size_t) r.candidate];
+    csv += c.name + "," + c.engine + "," + getShapeName (c.shape) + ","
+      + String (r.sampleRate, 0) + "," + String (r.frequency, 1) + ","
+      + String (r.snrDb, 2) + "," + String (r.thdPercent, 3) + "," + String (r.flatness, 5) + ","
+      + String (r.nsPerSample, 2) + ","
+      + (c.reference != nullptr ? String (r.referenceErrorDb, 1) : String()) + ","
+      + (r.pareto ? "1" : "0") + "\n";
+  }
+  if (! directory.getChildFile ("quality.csv").replaceWithText (csv))
+    return false;
+
+  // one scatter plot per shape: log cost across, SNR up, a colour per engine
+  const int width = 640, height = 400, margin = 50;
+  const char* colours[] = {"#d62728", "#1f77b4", "#2ca02c", "#7f7f7f", "#9467bd", "#ff7f0e", "#8c564b", "#17becf"};
+  const auto numColours = (int) std::size (colours);
+  for (auto shape = 0; shape < NumShapes; ++shape) {
+    StringArray engines;
+    double minCost = 1.0e9, maxCost = 0.0, maxSnr = 1.0;
+    for (auto& r : results) {
+      auto& c = candidates[(size_t) r.candidate];
+      if (c.shape != shape)
+        continue;
+      if (! engines.contains (c.engine))
+        engines.add (c.engine);
+      minCost = jmin (minCost, r.nsPerSample);
+      maxCost = jmax (maxCost, r.nsPerSample);
+      maxSnr = jmax (maxSnr, r.snrDb);
+    }
+    if (engines.isEmpty())
+      continue;
+    auto lo = std::log10 (jmax (0.01, minCost)) - 0.1, hi = std::log10 (jmax (0.01, maxCost)) + 0.1;
+    auto x = [&] (double cost) { return margin + (std::log10 (jmax (0.01, cost)) - lo) / (hi - lo) * (width - 2 * margin); };
+    auto y = [&] (double snr) { return height - margin - jmax (0.0, snr) / maxSnr * (height - 2 * margin); };
+
+    String svg;
+    svg << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height << "\">\n"
+        << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n"
+        << "<text x=\"" << width / 2 << "\" y=\"20\" text-anchor=\"middle\">" << getShapeName ((Shape) shape) << "</text>\n"
+        << "<text x=\"" << width / 2 << "\" y=\"" << height - 10 << "\" text-anchor=\"middle\">log10 ns/sample</text>\n"
+        << "<text x=\"12\" y=\"" << height / 2 << "\" transform=\"rotate(-90 12 " << height / 2 << ")\" text-anchor=\"middle\">SNR dB (0 - " << String (maxSnr, 0) << ")</text>\n"
+        << "<rect x=\"" << margin << "\" y=\"" << margin << "\" width=\"" << width - 2 * margin << "\" height=\"" << height - 2 * margin << "\" fill=\"none\" stroke=\"black\"/>\n";
+    for (auto& r : results) {
+      auto& c = candidates[(size_t) r.candidate];
+      if (c.shape != shape)
+        continue;
+      auto colour = colours[engines.indexOf (c.engine) % numColours];
+      svg << "<circle cx=\"" << String (x (r.nsPerSample), 1) << "\" cy=\"" << String (y (r.snrDb), 1)
+          << "\" r=\"" << (r.pareto ? 5 : 3) << "\" fill=\"" << colour << "\"><title>" << c.name << " "
+          << String (r.sampleRate, 0) << " Hz, " << String (r.frequency, 0) << " Hz</title></circle>\n";
+    }
+    for (auto i = 0; i < engines.size(); ++i)
+      svg << "<text x=\"" << width - margin - 40 << "\" y=\"" << margin + 16 * (i + 1) << "\" fill=\""
+          << colours[i % numColours] << "\">" << engines[i] << "</text>\n";
+    svg << "</svg>\n";
+    if (! directory.getChildFile ("pareto_" + String (getShapeName ((Shape) shape)) + ".svg").replaceWithText (svg))
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,104 @@
+//==============================================================================
+// GeneratorBenchmark.h
+// Measures the quality and cost of every periodic generator.
+//==============================================================================
+
+#pragma once
+
+#include "Generators.h"
+#include "ExpressionSynth.h"
+#include "SpectralSynth.h"
+
+/// GeneratorBenchmark renders each periodic generator (Sine, LF_*, BL_*,
+/// WT_* in float, half float and int16 tables, FFT_* and expressions of
+/// the sine and saw) across a sweep of sample rates and frequencies. For
+/// each render it measures:
+/// * snrDb: the ratio of an ideal band-limited rendering of the shape to the
+///   error against it. The error is the harmonic amplitude error plus all
+///   inharmonic energy (aliasing and noise), with the ideal scaled to the
+///   measured fundamental.
+/// * thdPercent: total harmonic distortion relative to the fundamental.
+/// * flatness: spectral flatness (geometric / arithmetic mean power).
+/// * nsPerSample: render cost in nanoseconds per sample, the median of
+///   several renders from a fresh state after a warm-up render.
+/// * referenceErrorDb: for a candidate that approximates another
+///   generator, such as FFT_* the BL_* kernels, the power of the sample by
+///   sample difference relative to the other's output.
+/// write() saves the results as a CSV table marking the Pareto optimal
+/// generators, along with one SVG cost/quality plot per shape. Run it with
+/// `WaveLab --benchmark [directory]`.
+class GeneratorBenchmark
+{
+public:
+  /// The ideal waveform a generator approximates.
+  enum Shape { Sine, Impulse, Square, Sawtooth, Triangle, NumShapes };
+
+  /// A generator to measure. Engine groups generators for the plots (e.g.
+  /// "LF", "BL", "WT", "WT Half", "FFT"). The compact WT_* candidates
+  /// read compactTable, an encoding of wavetable. A candidate with a
+  /// reference is compared sample by sample with that generator.
+  struct Candidate
+  {
+    String name;
+    String engine;
+    Shape shape;
+    GeneratorFunction generator;
+    const AudioSampleBuffer* wavetable;
+    ExpressionSynth* expression = nullptr;
+    SpectralSynth* spectral = nullptr;
+    const uint16* compactTable = nullptr;
+    GeneratorFunction reference = nullptr;
+  };
+
+  /// One measurement of one candidate.
+  struct Result
+  {
+    int candidate;
+    double sampleRate;
+    double frequency;
+    double snrDb;
+    double thdPercent;
+    double flatness;
+    double nsPerSample;
+    /// 0 if the candidate has no reference.
+    double referenceErrorDb;
+    bool pareto;
+  };
+
+  /// Creates the benchmark with every built in generator as a candidate.
+  GeneratorBenchmark();
+
+  /// Adds another generator to compare.
+  void addCandidate (const Candidate& candidate);
+
+  /// Measures every candidate at every sample rate and frequency.
+  void run();
+
+  /// Writes quality.csv and pareto_<shape>.svg into directory. Returns
+  /// false if a file can't be written.
+  bool write (const File& directory) const;
+
+  const Array<Result>& getResults() const noexcept { return results; }
+
+  static const char* getShapeName (Shape shape);
+
+  /// Returns the amplitude of harmonic h in the Fourier series of shape,
+  /// relative to the fundamental.
+  static double getIdealAmplitude (Shape shape, int harmonic);
+
+private:
+  Result measure (int candidate, double sampleRate, double frequency);
+  void markParetoFront();
+
+  std::vector<Candidate> candidates;
+  Array<Result> results;
+  /// Tables for the built in WT_* candidates.
+  AudioSampleBuffer tables[NumShapes];
+  /// The tables as half floats and as int16.
+  std::vector<uint16> compactTables[2][NumShapes];
+  /// The expression candidates and the FFT candidates' engines, and the
+  /// arena holding their registers and buffers.
+  DspArena arena;
+  ExpressionSynth expressions[2];
+  SpectralSynth spectral[4];
+};
@@ -0,0 +1,197 @@
+//==============================================================================
+// GeneratorSwitcher.h
+// Crossfades between generators when the waveform changes.
+//==============================================================================
+
+#pragma once
+
+#include "Generators.h"
+#include "DspArena.h"
+
+/// GeneratorSwitcher owns two generator slots, the active one and the one it
+/// is fading away from. A switch renders both slots for fadeLength samples
+/// and ramps the outgoing slot down while the incoming slot ramps up, so a
+/// switch never costs more than two generators and never clicks. The slots
+/// and the fade scratch buffer live in the DSP arena, so switching never
+/// allocates.
+class GeneratorSwitcher
+{
+public:
+  /// Returns the arena space prepare() needs for blocks of up to
+  /// maxBlockSize samples.
+  static size_t getArenaBytes (int maxBlockSize)
+  {
+    return DspArena::bytesFor<Slot> (2) + DspArena::bytesFor<float> ((size_t) jmax (1, maxBlockSize));
+  }
+
+  /// Places both slots and a fade buffer for blocks of up to maxBlockSize
+  /// samples in the arena. Both slots start out silent. Call from
+  /// prepareToPlay().
+  void prepare (DspArena& arena, int maxBlockSize, double sampleRate)
+  {
+    maxBlockSize = jmax (1, maxBlockSize);
+    slots = arena.create<Slot> (2);
+    fadeData = arena.allocate<float> ((size_t) maxBlockSize);
+    if (slots == nullptr || fadeData == nullptr) {
+      release();
+      return;
+    }
+    fadeBuffer.setDataToReferTo (&fadeData, 1, maxBlockSize);
+    srate = sampleRate;
+    active = 0;
+    fadePosition = fadeLength;
+    for (auto i = 0; i < 2; ++i) {
+      slots[i].state.setFrequency (frequency.load(), srate);
+      slots[i].state.slot = i;
+    }
+  }
+
+  /// Forgets the arena memory handed out by prepare(). Call from
+  /// releaseResources() before the arena is released.
+  void release()
+  {
+    slots = nullptr;
+    fadeData = nullptr;
+    fadeBuffer = AudioSampleBuffer();
+  }
+
+  /// Sets the number of samples a switch takes to fade from the outgoing
+  /// generator to the incoming one. Zero switches immediately.
+  void setFadeLength (int numSamples)
+  {
+    fadeLength = jmax (0, numSamples);
+    fadePosition = jmin (fadePosition, fadeLength);
+  }
+
+  /// Sets the frequency of both slots so an outgoing generator keeps its
+  /// pitch while it fades out. Safe to call from any thread, the audio
+  /// thread applies it at the start of the next block.
+  void setFrequency (double freq)
+  {
+    frequency.store (freq);
+  }
+
+  /// Returns the frequency last passed to setFrequency().
+  double getFrequency() const noexcept { return frequency.load(); }
+
+  /// Returns true while a switch is being crossfaded.
+  bool isFading() const noexcept { return fadePosition < fadeLength; }
+
+  /// Returns true if render() would only output silence: no generator is
+  /// selected and no switch is fading.
+  bool isSilent() const noexcept
+  {
+    return slots == nullptr || (! isFading() && slots[active].function == nullptr);
+  }
+
+  /// Starts a switch to a generator reading an optional wavetable, and the
+  /// wavetable's compact copy if the generator reads one, rendering from
+  /// the engine it is written for in engines. Called on the audio thread.
+  /// Returns false if a fade is still running. The caller should retry on a
+  /// later block, which keeps the cost bounded at two generators.
+  bool switchTo (GeneratorFunction function, const AudioSampleBuffer* wavetable,
+                 const uint16* compactTable, const GeneratorEngines& engines)
+  {
+    if (isFading() || slots == nullptr)
+      return false;
+    auto& outgoing = slots[active];
+    auto& incoming = slots[1 - active];
+    incoming.function = function;
+    incoming.state.setFrequency (outgoing.state.freq, srate);
+    if (wavetable != nullptr)
+      incoming.state.setTable (*wavetable);
+    incoming.state.engines = engines;
+    incoming.state.compactTable = compactTable;
+    incoming.state.reset();
+    active = 1 - active;
+    auto silent = (outgoing.function == nullptr && function == nullptr);
+    fadePosition = (silent || fadeBuffer.getNumSamples() == 0) ? fadeLength : 0;
+    return true;
+  }
+
+  /// Moves every slot reading oldTable over to newTable, keeping its place
+  /// in the period. Called on the audio thread when a wavetable is rebuilt.
+  void replaceTable (const AudioSampleBuffer& oldTable, const AudioSampleBuffer& newTable)
+  {
+    if (slots == nullptr)
+      return;
+    for (auto i = 0; i < 2; ++i)
+      if (slots[i].state.table == oldTable.getReadPointer (0))
+        slots[i].state.replaceTable (newTable);
+  }
+
+  /// Moves every slot reading the compact copy oldCopy over to newCopy.
+  /// Called on the audio thread when CompactTables publishes a new copy.
+  void replaceCompactTable (const uint16* oldCopy, const uint16* newCopy)
+  {
+    if (slots == nullptr)
+      return;
+    for (auto i = 0; i < 2; ++i)
+      if (slots[i].state.compactTable == oldCopy)
+        slots[i].state.compactTable = newCopy;
+  }
+
+  /// Renders the active generator into bufferToFill at the given gain,
+  /// mixing in the outgoing generator while a switch is fading.
+  void render (const AudioSourceChannelInfo& bufferToFill, float gain)
+  {
+    if (slots == nullptr) {
+      bufferToFill.clearActiveBufferRegion();
+      return;
+    }
+    auto freq = frequency.load();
+    if (freq != slots[active].state.freq)
+      for (auto i = 0; i < 2; ++i)
+        slots[i].state.setFrequency (freq, srate);
+    auto& buffer = *bufferToFill.buffer;
+    auto& incoming = slots[active];
+    auto& outgoing = slots[1 - active];
+    int done = 0;
+    while (isFading() && done < bufferToFill.numSamples) {
+      auto num = jmin (bufferToFill.numSamples - done, fadeBuffer.getNumSamples(), fadeLength - fadePosition);
+      auto start = bufferToFill.startSample + done;
+      renderSlot (incoming, AudioSourceChannelInfo (&buffer, start, num), gain);
+      renderSlot (outgoing, AudioSourceChannelInfo (&fadeBuffer, 0, num), gain);
+      auto gain0 = (float) fadePosition / (float) fadeLength;
+      auto gain1 = (float) (fadePosition + num) / (float) fadeLength;
+      for (auto chan = 0; chan < buffer.getNumChannels(); ++chan) {
+        buffer.applyGainRamp (chan, start, num, gain0, gain1);
+        buffer.addFromWithRamp (chan, start, fadeBuffer.getReadPointer (0), num, 1.0f - gain0, 1.0f - gain1);
+      }
+      fadePosition += num;
+      done += num;
+    }
+    if (done < bufferToFill.numSamples)
+      renderSlot (incoming, AudioSourceChannelInfo (&buffer, bufferToFill.startSample + done, bufferToFill.numSamples - done), gain);
+  }
+
+private:
+  /// A generator function and the state it renders from.
+  struct Slot
+  {
+    GeneratorFunction function {nullptr};
+    GeneratorState state;
+  };
+
+  static void renderSlot (Slot& slot, const AudioSourceChannelInfo& bufferToFill, float gain)
+  {
+    if (slot.function != nullptr)
+      slot.function (slot.state, bufferToFill, gain);
+    else
+      bufferToFill.clearActiveBufferRegion();
+  }
+
+  /// The two slots, in the arena.
+  Slot* slots {nullptr};
+  /// Index of the incoming (or only) slot.
+  int active {0};
+  /// Holds the outgoing generator's samples during a fade. It refers to
+  /// fadeData in the arena.
+  AudioSampleBuffer fadeBuffer;
+  float* fadeData {nullptr};
+  /// The frequency requested by setFrequency().
+  std::atomic<double> frequency {0.0};
+  double srate {0.0};
+  int fadeLength {512};
+  int fadePosition {512};
+};
@@ -0,0 +1,385 @@
+//==============================================================================
+// Generators.h
+// Stateless generator kernels and the shared block driver that renders them.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "RealtimeChecks.h"
+#include "WaveTables.h"
+
+class GrainCloud;
+class MeasurementSignals;
+class StringBank;
+class PartialSynth;
+class ExpressionSynth;
+class SampleStreamer;
+class SpectralSynth;
+
+/// The engines a generator may render from besides its wavetable, passed
+/// to GeneratorSwitcher::switchTo() as one context. Each generator
+/// function reads only the engine it is written for; the others may be
+/// null.
+struct GeneratorEngines
+{
+  /// The grain pool rendered by the granular generator (see GrainCloud.h).
+  GrainCloud* grains {nullptr};
+  /// The settings and multitone buffer of the measurement signals (see
+  /// MeasurementSignals.h).
+  const MeasurementSignals* signals {nullptr};
+  /// The strings rendered by the Plucked and Resonator generators (see
+  /// StringBank.h).
+  StringBank* strings {nullptr};
+  /// The oscillator bank rendered by the resynthesis generator (see
+  /// PartialSynth.h).
+  PartialSynth* partials {nullptr};
+  /// The program rendered by the expression generator (see
+  /// ExpressionSynth.h).
+  ExpressionSynth* expression {nullptr};
+  /// The voices rendered by the sample generator (see SampleStreamer.h).
+  SampleStreamer* samples {nullptr};
+  /// The overlap-add engine rendered by the FFT_* generators (see
+  /// SpectralSynth.h).
+  SpectralSynth* spectral {nullptr};
+};
+
+/// All of the mutable data a generator needs between audio blocks. The
+/// kernels below hold no state of their own, so everything that must survive
+/// from one block to the next lives here.
+struct GeneratorState
+{
+  /// Updates the frequency dependent members: the phase increment, the number
+  /// of harmonics below nyquist used by the BL_* kernels and the wavetable
+  /// increment used by the WT_* kernels.
+  void setFrequency (double frequency, double sampleRate)
+  {
+    freq = frequency;
+    srate = sampleRate;
+    phaseDelta = (srate > 0.0) ? freq / srate : 0.0;
+    numHarmonics = (freq > 0.0 && srate > 0.0) ? (int) std::ceil (srate / 2.0 / freq) - 1 : 0;
+    tableDelta = (float) (phaseDelta * tableSize);
+  }
+
+  /// Points the WT_* kernel at a wavetable. The table must contain one period
+  /// plus a guard sample equal to the first sample.
+  void setTable (const AudioSampleBuffer& wavetable)
+  {
+    table = wavetable.getReadPointer (0);
+    tableSize = wavetable.getNumSamples() - 1;
+    tableIndex = 0.0f;
+    setFrequency (freq, srate);
+  }
+
+  /// Points the WT_* kernel at a new version of its wavetable without
+  /// restarting the waveform: the read position keeps its place in the
+  /// period.
+  void replaceTable (const AudioSampleBuffer& wavetable)
+  {
+    auto position = (tableSize > 0) ? tableIndex / (float) tableSize : 0.0f;
+    setTable (wavetable);
+    tableIndex = position * (float) tableSize;
+  }
+
+  /// Restarts the waveform from its first sample.
+  void reset()
+  {
+    phase = 0.0;
+    tableIndex = 0.0f;
+    brown = 0.0f;
+    position = 0;
+    expressionTime = 0.0;
+    expressionParameters[0] = expressionParameters[1] = -1.0f;
+    lfsr = 1;
+  }
+
+  double srate {0.0};
+  double freq {0.0};
+  /// Normalized phase [0.0, 1.0) of the next sample to render.
+  double phase {0.0};
+  /// The phase increment per sample, e.g (freq/srate).
+  double phaseDelta {0.0};
+  /// Number of harmonics at or below the nyquist limit.
+  int numHarmonics {0};
+  /// Output of the brown noise low pass filter for the previous sample.
+  float brown {0.0f};
+  /// The wavetable read by the WT_* kernel.
+  const float* table {nullptr};
+  int tableSize {0};
+  float tableIndex {0.0f};
+  float tableDelta {0.0f};
+  /// The same wavetable in a 16 bit format, read by the compact WT_*
+  /// kernels (see CompactTables.h).
+  const uint16* compactTable {nullptr};
+  /// The engine the generator renders from, if any.
+  GeneratorEngines engines;
+  /// The values of the expression's a and b the last render ramped to, or
+  /// -1 before the first, which starts at the values set.
+  float expressionParameters[2] {-1.0f, -1.0f};
+  /// The expression's t at the next sample, in seconds (see
+  /// ExpressionSynth::getTimeWrap()).
+  double expressionTime {0.0};
+  /// The index of the spectral engine's buffers this state renders into
+  /// (see SpectralSynth.h).
+  int slot {0};
+  /// Samples rendered since the measurement signal's current period
+  /// started. The period's settings are latched below when it starts, so
+  /// a settings change never bends a sweep or sequence in progress.
+  int64 position {0};
+  int64 period {0};
+  /// Sweep start frequency in cycles per sample, its growth per sample
+  /// (logarithmic for the exponential sweep, linear otherwise) and length.
+  double sweepStart {0.0};
+  double sweepRate {0.0};
+  int64 sweepLength {0};
+  /// The MLS shift register, never zero, and its feedback taps.
+  uint32 lfsr {1};
+  uint32 mlsTaps {0};
+  Random random;
+};
+
+/// A function that renders one block of a generator into every channel of
+/// bufferToFill at the given gain.
+using GeneratorFunction = void (*) (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain);
+
+namespace Generators
+{
+  const double TwoPi {MathConstants<double>::twoPi};
+
+  /// Returns a random value [-1.0, 1.0]
+  forcedinline float ranSamp (Random& random) noexcept
+  {
+    return random.nextFloat() * 2.0f - 1.0f;
+  }
+
+  /// The change from one filter output to the next is proportional to the
+  /// difference between the previous output and the next input.
+  forcedinline float lowPass (const float value, const float prevout, const float alpha) noexcept
+  {
+    return (value - prevout) * alpha + prevout;
+  }
+
+  /// Returns the sum of values, in eight partial sums the compiler can keep
+  /// in SIMD registers. Used by the banks that run one voice per SIMD lane.
+  forcedinline float getSum (const float* values, int count) noexcept
+  {
+    float partial[8] {};
+    auto i = 0;
+    for (; i + 8 <= count; i += 8)
+      for (auto lane = 0; lane < 8; ++lane)
+        partial[lane] += values[i + lane];
+    auto sum = 0.0f;
+    for (auto lane = 0; lane < 8; ++lane)
+      sum += partial[lane];
+    for (; i < count; ++i)
+      sum += values[i];
+    return sum;
+  }
+
+  //==============================================================================
+  // Kernel bases
+
+  /// CRTP base for kernels whose output depends only on the phase. Each
+  /// sample's phase is computed from the block's starting phase instead of
+  /// being carried from sample to sample, so the loop has no recurrence and
+  /// Kernel::shape() inlines into it. Kernel must provide:
+  ///   static float shape (double phase, const GeneratorState& state);
+  template <typename Kernel>
+  struct PhaseKernel
+  {
+    static forcedinline void render (GeneratorState& state, float* dest, int numSamples, float gain) noexcept
+    {
+      const auto start = state.phase;
+      const auto delta = state.phaseDelta;
+      for (int i = 0; i < numSamples; ++i) {
+        auto p = start + i * delta;
+        p -= std::floor (p);
+        dest[i] = gain * Kernel::shape (p, state);
+      }
+      auto next = start + numSamples * delta;
+      state.phase = next - std::floor (next);
+    }
+  };
+
+  /// CRTP base for kernels that carry state from one sample to the next (noise
+  /// filters, random generators, table readers). Kernel must provide:
+  ///   static float tick (GeneratorState& state);
+  template <typename Kernel>
+  struct SampleKernel
+  {
+    static forcedinline void render (GeneratorState& state, float* dest, int numSamples, float gain) noexcept
+    {
+      for (int i = 0; i < numSamples; ++i)
+        dest[i] = gain * Kernel::tick (state);
+    }
+  };
+
+  //==============================================================================
+  // Noise
+
+  /// Uniformly distributed samples.
+  struct WhiteNoise : SampleKernel<WhiteNoise>
+  {
+    static forcedinline float tick (GeneratorState& s) noexcept { return ranSamp (s.random); }
+  };
+
+  /// Random uniform samples with a probability of freq/srate.
+  struct Dust : SampleKernel<Dust>
+  {
+    static forcedinline float tick (GeneratorState& s) noexcept
+    {
+      return (s.random.nextFloat() < s.phaseDelta) ? ranSamp (s.random) : 0.0f;
+    }
+  };
+
+  /// White noise low pass filtered to roughly -6dB per octave.
+  struct BrownNoise : SampleKernel<BrownNoise>
+  {
+    static forcedinline float tick (GeneratorState& s) noexcept
+    {
+      s.brown = lowPass (ranSamp (s.random), s.brown, 0.025f);
+      return 3.0f * s.brown;
+    }
+  };
+
+  //==============================================================================
+  // Sine and low frequency waves
+
+  struct Sine : PhaseKernel<Sine>
+  {
+    static forcedinline float shape (double p, const GeneratorState&) noexcept
+    {
+      return (float) std::sin (p * TwoPi);
+    }
+  };
+
+  /// Outputs a single sample each time the phase wraps around.
+  struct LF_Impulse : PhaseKernel<LF_Impulse>
+  {
+    static forcedinline float shape (double p, const GeneratorState& s) noexcept
+    {
+      return (p < s.phaseDelta) ? (float) (1.0 - 2.0 * p) : 0.0f;
+    }
+  };
+
+  struct LF_Square : PhaseKernel<LF_Square>
+  {
+    static forcedinline float shape (double p, const GeneratorState&) noexcept
+    {
+      return (p > 0.5) ? 1.0f : -1.0f;
+    }
+  };
+
+  struct LF_Sawtooth : PhaseKernel<LF_Sawtooth>
+  {
+    static forcedinline float shape (double p, const GeneratorState&) noexcept
+    {
+      return (float) (p * 2.0 - 1.0);
+    }
+  };
+
+  struct LF_Triangle : PhaseKernel<LF_Triangle>
+  {
+    static forcedinline float shape (double p, const GeneratorState&) noexcept
+    {
+      return (float) ((p <= 0.5) ? (p * 4.0 - 1.0) : (3.0 - p * 4.0));
+    }
+  };
+
+  //==============================================================================
+  // Band limited waves
+
+  /// Sums sin() over the fundamental and its harmonics up to the nyquist
+  /// limit. Step selects every harmonic (1) or only the odd ones (2) and
+  /// Rolloff the amplitude law: equal (0), 1/h (1) or 1/h**2 (2).
+  template <int Step, int Rolloff>
+  struct BL_Additive : PhaseKernel<BL_Additive<Step, Rolloff>>
+  {
+    static forcedinline float shape (double p, const GeneratorState& s) noexcept
+    {
+      double sum = 0.0;
+      for (int h = 1; h <= s.numHarmonics; h += Step) {
+        auto amp = (Rolloff == 0) ? 1.0 : (Rolloff == 1) ? 1.0 / h : 1.0 / (h * h);
+        sum += std::sin (p * TwoPi * h) * amp;
+      }
+      if (Rolloff == 0 && s.numHarmonics > 0)
+        sum /= s.numHarmonics;
+      return (float) sum;
+    }
+  };
+
+  using BL_Impulse  = BL_Additive<1, 0>;
+  using BL_Square   = BL_Additive<2, 1>;
+  using BL_Sawtooth = BL_Additive<1, 1>;
+  using BL_Triangle = BL_Additive<2, 2>;
+
+  //==============================================================================
+  // Wavetable
+
+  /// Reads the state's wavetable with linear interpolation.
+  struct Wavetable : SampleKernel<Wavetable>
+  {
+    static forcedinline float tick (GeneratorState& s) noexcept
+    {
+      auto index0 = (unsigned int) s.tableIndex;
+      auto frac = s.tableIndex - (float) index0;
+      auto value0 = s.table[index0];
+      auto value1 = s.table[index0 + 1];
+      if ((s.tableIndex += s.tableDelta) > s.tableSize)
+        s.tableIndex -= s.tableSize;
+      return value0 + frac * (value1 - value0);
+    }
+  };
+
+  /// Reads the state's compact wavetable with linear interpolation. The
+  /// indices and fractions of eight samples are stepped first, then both
+  /// neighbours of all eight are decoded at once and interpolated, so the
+  /// decode runs in SIMD registers.
+  template <WaveTables::Format format>
+  struct CompactWavetable
+  {
+    static forcedinline void render (GeneratorState& s, float* dest, int numSamples, float gain) noexcept
+    {
+      if (s.compactTable == nullptr) {
+        FloatVectorOperations::clear (dest, numSamples);
+        return;
+      }
+      uint16 raw0[8] {}, raw1[8] {};
+      float frac[8] {}, value0[8], value1[8];
+      for (auto i = 0; i < numSamples; i += 8) {
+        auto count = jmin (8, numSamples - i);
+        for (auto lane = 0; lane < count; ++lane) {
+          auto index0 = (unsigned int) s.tableIndex;
+          frac[lane] = s.tableIndex - (float) index0;
+          raw0[lane] = s.compactTable[index0];
+          raw1[lane] = s.compactTable[index0 + 1];
+          if ((s.tableIndex += s.tableDelta) > s.tableSize)
+            s.tableIndex -= s.tableSize;
+        }
+        WaveTables::decode8<format> (raw0, value0);
+        WaveTables::decode8<format> (raw1, value1);
+        for (auto lane = 0; lane < count; ++lane)
+          dest[i + lane] = gain * (value0[lane] + frac[lane] * (value1[lane] - value0[lane]));
+      }
+    }
+  };
+
+  //==============================================================================
+  // Block driver
+
+  /// Renders one block of Kernel into the first channel at the given gain and
+  /// fans it out to the remaining channels. Instantiating this template for a
+  /// kernel is all that is needed to add a generator.
+  template <typename Kernel>
+  void render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain)
+  {
+    auto& buffer = *bufferToFill.buffer;
+    if (buffer.getNumChannels() == 0 || bufferToFill.numSamples <= 0)
+      return;
+    auto* first = buffer.getWritePointer (0, bufferToFill.startSample);
+    Kernel::render (state, first, bufferToFill.numSamples, gain);
+    RealtimeChecks::checkDenormal (state.brown);
+    for (auto chan = 1; chan < buffer.getNumChannels(); ++chan)
+      FloatVectorOperations::copy (buffer.getWritePointer (chan, bufferToFill.startSample), first, bufferToFill.numSamples);
+  }
+}
@@ -0,0 +1,172 @@
+//==============================================================================
+// GrainCloud.cpp
+// A granular generator over the wavetables or captured audio.
+//==============================================================================
+
+#include "GrainCloud.h"
+
+size_t GrainCloud::getArenaBytes() {
+  return 5 * DspArena::bytesFor<float> (maxGrains)
+    + DspArena::bytesFor<int> (maxGrains)
+    + DspArena::bytesFor<const float*> (maxGrains)
+    + DspArena::bytesFor<float> ((size_t) NumWindows * (windowSize + 1))
+    + 2 * DspArena::bytesFor<float> (scratchSize);
+}
+
+void GrainCloud::prepare (DspArena& arena, double sampleRate) {
+  readPosition = arena.allocate<float> (maxGrains);
+  readIncrement = arena.allocate<float> (maxGrains);
+  windowPosition = arena.allocate<float> (maxGrains);
+  windowIncrement = arena.allocate<float> (maxGrains);
+  amplitude = arena.allocate<float> (maxGrains);
+  startOffset = arena.allocate<int> (maxGrains);
+  windowTable = arena.allocate<const float*> (maxGrains);
+  windows = arena.allocate<float> ((size_t) NumWindows * (windowSize + 1));
+  sourceScratch = arena.allocate<float> (scratchSize);
+  windowScratch = arena.allocate<float> (scratchSize);
+  if (sourceScratch == nullptr || windowScratch == nullptr) {
+    release();
+    return;
+  }
+  for (auto shape = 0; shape < NumWindows; ++shape) {
+    auto* table = windows + shape * (windowSize + 1);
+    for (auto i = 0; i <= windowSize; ++i) {
+      auto x = (double) i / windowSize;
+      double value = 0.0;
+      switch (shape) {
+        case Hann:     value = 0.5 - 0.5 * std::cos (MathConstants<double>::twoPi * x); break;
+        case Gaussian: value = std::exp (-0.5 * square ((x - 0.5) / 0.15)); break;
+        // flat top with cosine tapers over the outer 20%
+        case Tukey:    value = (x < 0.2 || x > 0.8) ? 0.5 - 0.5 * std::cos (MathConstants<double>::pi * jmin (x, 1.0 - x) / 0.2) : 1.0; break;
+        // short attack, exponential decay
+        case Expodec:  value = (x < 0.02) ? x / 0.02 : std::exp (-5.0 * (x - 0.02)) * (1.0 - x); break;
+        default:       break;
+      }
+      table[i] = (float) value;
+    }
+  }
+  srate = sampleRate;
+  active = 0;
+  numActive = 0;
+  samplesToNextGrain = 0.0;
+}
+
+void GrainCloud::release() {
+  readPosition = readIncrement = windowPosition = windowIncrement = amplitude = nullptr;
+  startOffset = nullptr;
+  windowTable = nullptr;
+  windows = sourceScratch = windowScratch = nullptr;
+  sourceData = nullptr;
+  sourceLength = 0;
+  active = 0;
+  numActive = 0;
+}
+
+void GrainCloud::setSourceTable (const AudioSampleBuffer& table, bool periodic) noexcept {
+  sourceData = table.getReadPointer (0);
+  sourceLength = table.getNumSamples() - 1;
+  sourcePeriodic = periodic;
+}
+
+void GrainCloud::render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain) {
+  auto* cloud = state.engines.grains;
+  auto& buffer = *bufferToFill.buffer;
+  if (cloud == nullptr || cloud->sourceScratch == nullptr) {
+    bufferToFill.clearActiveBufferRegion();
+    return;
+  }
+  if (buffer.getNumChannels() == 0 || bufferToFill.numSamples <= 0)
+    return;
+  auto* first = buffer.getWritePointer (0, bufferToFill.startSample);
+  for (auto done = 0; done < bufferToFill.numSamples; done += scratchSize)
+    cloud->process (state, first + done, jmin (scratchSize, bufferToFill.numSamples - done), gain);
+  for (auto chan = 1; chan < buffer.getNumChannels(); ++chan)
+    FloatVectorOperations::copy (buffer.getWritePointer (chan, bufferToFill.startSample), first, bufferToFill.numSamples);
+}
+
+void GrainCloud::spawn (GeneratorState& state, int offset) noexcept {
+  if (active == maxGrains) {
+    ++droppedGrains;
+    return;
+  }
+  auto length = sourceLength;
+  auto grainSamples = jmax (1.0, grainSize.load() * 0.001 * srate);
+  auto ratio = std::pow (2.0, pitch.load() / 12.0);
+  auto increment = sourcePeriodic ? state.freq * length / srate * ratio : ratio;
+  auto start = position.load() + jitter.load() * (state.random.nextFloat() - 0.5f);
+  start -= std::floor (start);
+  // uncorrelated grains add in power, so scale by the expected overlap
+  auto overlap = density.load() * grainSamples / srate;
+
+  auto i = active++;
+  readPosition[i] = (float) (start * length);
+  readIncrement[i] = (float) increment;
+  windowPosition[i] = 0.0f;
+  windowIncrement[i] = (float) (windowSize / grainSamples);
+  amplitude[i] = (float) (1.0 / std::sqrt (jmax (1.0, overlap)));
+  startOffset[i] = offset;
+  windowTable[i] = windows + window.load() * (windowSize + 1);
+}
+
+void GrainCloud::remove (int i) noexcept {
+  auto last = --active;
+  readPosition[i] = readPosition[last];
+  readIncrement[i] = readIncrement[last];
+  windowPosition[i] = windowPosition[last];
+  windowIncrement[i] = windowIncrement[last];
+  amplitude[i] = amplitude[last];
+  startOffset[i] = startOffset[last];
+  windowTable[i] = windowTable[last];
+}
+
+void GrainCloud::process (GeneratorState& state, float* output, int numSamples, float gain) noexcept {
+  FloatVectorOperations::clear (output, numSamples);
+
+  // schedule the onsets that fall in this pass
+  auto interval = srate / density.load();
+  samplesToNextGrain = jmin (samplesToNextGrain, interval);
+  while (samplesToNextGrain < numSamples) {
+    spawn (state, (int) samplesToNextGrain);
+    samplesToNextGrain += interval;
+  }
+  samplesToNextGrain -= numSamples;
+
+  auto length = (float) sourceLength;
+  for (auto i = 0; i < active;) {
+    auto start = startOffset[i];
+    startOffset[i] = 0;
+    // samples left before the window ends
+    auto remaining = (int) std::ceil ((windowSize - windowPosition[i]) / windowIncrement[i]);
+    auto count = jmin (numSamples - start, remaining);
+    // a grain may not skip a whole cycle of the source per sample
+    auto readable = sourceLength > 0 && readIncrement[i] < length;
+    if (readable && count > 0) {
+      auto read = std::fmod (readPosition[i], length);
+      auto increment = readIncrement[i];
+      auto* window = windowTable[i];
+      auto windowRead = windowPosition[i];
+      auto windowStep = windowIncrement[i];
+      auto level = amplitude[i] * gain;
+      for (auto n = 0; n < count; ++n) {
+        auto index = (int) read;
+        auto frac = read - (float) index;
+        sourceScratch[n] = sourceData[index] + frac * (sourceData[index + 1] - sourceData[index]);
+        windowScratch[n] = window[(int) windowRead] * level;
+        if ((read += increment) >= length)
+          read -= length;
+        windowRead += windowStep;
+      }
+      FloatVectorOperations::addWithMultiply (output + start, sourceScratch, windowScratch, count);
+      readPosition[i] = read;
+      windowPosition[i] = windowRead;
+    }
+    else if (count > 0) {
+      windowPosition[i] += windowIncrement[i] * count;
+    }
+    if (count >= remaining)
+      remove (i);
+    else
+      ++i;
+  }
+  numActive.store (active);
+}
@@ -0,0 +1,133 @@
+//==============================================================================
+// GrainCloud.h
+// A granular generator over the wavetables or captured audio.
+//==============================================================================
+
+#pragma once
+
+#include "Generators.h"
+#include "DspArena.h"
+
+/// GrainCloud spawns short windowed grains from a source buffer, either one
+/// of the WT_* tables or audio captured from the output. New grains start
+/// at the given density, each reading the source at a position jittered
+/// around a base position and transposed by a pitch in semitones. A table
+/// source is read at the generator frequency, so its grains are pitched
+/// like the WT_* waveforms. A captured source plays back at its original
+/// speed.
+///
+/// Grains come from a fixed pool of maxGrains in the DSP arena, stored as
+/// parallel arrays, and their windows are read from precomputed tables.
+/// Each grain is rendered into a scratch buffer and mixed with one vector
+/// multiply-add, so the cost per sample grows linearly with the number of
+/// overlapping grains (density times grain size) and nothing is allocated.
+/// If the pool is full new grains are dropped and counted.
+class GrainCloud
+{
+public:
+  /// The grain envelopes.
+  enum Window { Hann, Gaussian, Tukey, Expodec, NumWindows };
+
+  /// Size of the grain pool.
+  static constexpr int maxGrains = 1024;
+
+  /// Samples per window table, not counting the guard sample.
+  static constexpr int windowSize = 1024;
+
+  /// Returns the arena space prepare() needs.
+  static size_t getArenaBytes();
+
+  /// Places the pool, window tables and scratch buffers in the arena and
+  /// fills the window tables. Call from prepareToPlay().
+  void prepare (DspArena& arena, double sampleRate);
+
+  /// Forgets the arena memory handed out by prepare(). Call from
+  /// releaseResources() before the arena is released.
+  void release();
+
+  //==============================================================================
+  // Parameters, safe to set from any thread. New values apply to grains
+  // spawned after the next block starts.
+
+  /// Grains started per second, 1 to 5000.
+  void setDensity (float grainsPerSecond) { density.store (jlimit (1.0f, 5000.0f, grainsPerSecond)); }
+  /// Length of each grain, 1 to 500 ms.
+  void setGrainSize (float milliseconds) { grainSize.store (jlimit (1.0f, 500.0f, milliseconds)); }
+  /// Base read position as a fraction of the source, 0 to 1.
+  void setPosition (float fraction) { position.store (jlimit (0.0f, 1.0f, fraction)); }
+  /// Random spread of the read position as a fraction of the source, 0 to 1.
+  void setJitter (float fraction) { jitter.store (jlimit (0.0f, 1.0f, fraction)); }
+  /// Transposition, -24 to 24 semitones.
+  void setPitch (float semitones) { pitch.store (jlimit (-24.0f, 24.0f, semitones)); }
+  void setWindow (Window shape) { window.store (jlimit (0, (int) NumWindows - 1, (int) shape)); }
+
+  /// The source buffer the grains read, a WaveTableBank source index.
+  void setSource (int index) { source.store (index); }
+  int getSource() const noexcept { return source.load(); }
+
+  //==============================================================================
+  // Audio thread
+
+  /// Sets the buffer the grains read. It holds the source plus a guard
+  /// sample equal to the first. A periodic source is a single cycle table
+  /// read at the generator frequency. Call before each block.
+  void setSourceTable (const AudioSampleBuffer& table, bool periodic) noexcept;
+
+  /// The generator function. Renders the cloud that state.engines.grains
+  /// points to.
+  static void render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain);
+
+  /// Returns the number of grains sounding.
+  int getActiveGrains() const noexcept { return numActive.load(); }
+
+  /// Returns the number of grains dropped because the pool was full.
+  int64 getDroppedGrains() const noexcept { return droppedGrains.load(); }
+
+private:
+  /// Samples rendered per scratch pass.
+  static constexpr int scratchSize = 64;
+
+  /// Renders numSamples (at most scratchSize) into output.
+  void process (GeneratorState& state, float* output, int numSamples, float gain) noexcept;
+
+  /// Starts a grain offset samples into the current pass.
+  void spawn (GeneratorState& state, int offset) noexcept;
+
+  /// Removes grain i by moving the last active grain into its place.
+  void remove (int i) noexcept;
+
+  // The pool, one array per field and one entry per grain.
+  float* readPosition {nullptr};
+  float* readIncrement {nullptr};
+  float* windowPosition {nullptr};
+  float* windowIncrement {nullptr};
+  float* amplitude {nullptr};
+  int* startOffset {nullptr};
+  const float** windowTable {nullptr};
+  int active {0};
+
+  /// NumWindows tables of windowSize + 1 samples.
+  float* windows {nullptr};
+  /// Per pass source samples and window values.
+  float* sourceScratch {nullptr};
+  float* windowScratch {nullptr};
+
+  const float* sourceData {nullptr};
+  int sourceLength {0};
+  bool sourcePeriodic {true};
+
+  double srate {0.0};
+  /// Samples from the start of the current pass to the next grain onset.
+  double samplesToNextGrain {0.0};
+
+  std::atomic<float> density {50.0f};
+  std::atomic<float> grainSize {50.0f};
+  std::atomic<float> position {0.0f};
+  std::atomic<float> jitter {0.1f};
+  std::atomic<float> pitch {0.0f};
+  std::atomic<int> window {Hann};
+  std::atomic<int> source {0};
+
+  std::atomic<int> numActive {0};
+  std::atomic<int64> droppedGrains {0};
+};
@@ -0,0 +1,101 @@
+//==============================================================================
+// GranularPanel.cpp
+// The controls of the granular generator.
+//==============================================================================
+
+#include "GranularPanel.h"
+#include "WaveTableBank.h"
+
+GranularPanel::GranularPanel (GrainCloud& c)
+: cloud (c) {
+  addAndMakeVisible (sourceMenu);
+  sourceMenu.addItemList ({"WT Sine", "WT Impulse", "WT Square", "WT Saw", "WT Triangle"}, 1);
+  sourceMenu.addSeparator();
+  sourceMenu.addItem ("Captured", WaveTableBank::captureSource + 1);
+  sourceMenu.setSelectedId (cloud.getSource() + 1, dontSendNotification);
+  sourceMenu.addListener (this);
+
+  addAndMakeVisible (windowMenu);
+  windowMenu.addItemList ({"Hann", "Gaussian", "Tukey", "Expodec"}, 1);
+  windowMenu.setSelectedId (GrainCloud::Hann + 1, dontSendNotification);
+  windowMenu.addListener (this);
+
+  addAndMakeVisible (captureButton);
+  captureButton.onClick = [this] {
+    if (onCapture)
+      onCapture();
+  };
+
+  addAndMakeVisible (status);
+  status.setJustificationType (Justification::centredRight);
+
+  addSlider (densitySlider, 1.0, 5000.0, 50.0, " grains/s");
+  densitySlider.setSkewFactorFromMidPoint (200.0);
+  addSlider (sizeSlider, 1.0, 500.0, 50.0, " ms");
+  sizeSlider.setSkewFactorFromMidPoint (50.0);
+  addSlider (pitchSlider, -24.0, 24.0, 0.0, " st");
+  addSlider (positionSlider, 0.0, 1.0, 0.0, " pos");
+  addSlider (jitterSlider, 0.0, 1.0, 0.1, " jitter");
+}
+
+void GranularPanel::addSlider (Slider& slider, double minimum, double maximum, double value, const String& suffix) {
+  addAndMakeVisible (slider);
+  slider.setSliderStyle (Slider::LinearHorizontal);
+  slider.setTextBoxStyle (Slider::TextBoxLeft, false, 90, 22);
+  slider.setRange (minimum, maximum);
+  slider.setTextValueSuffix (suffix);
+  slider.setValue (value, dontSendNotification);
+  slider.addListener (this);
+}
+
+void GranularPanel::updateStatus (int activeGrains, int64 droppedGrains, bool capturing) {
+  auto text = String (activeGrains) + " grains";
+  if (droppedGrains > 0)
+    text += ", " + String (droppedGrains) + " dropped";
+  status.setText (text, dontSendNotification);
+  captureButton.setButtonText (capturing ? "Capturing..." : "Capture 2 s");
+}
+
+void GranularPanel::resized() {
+  auto bounds = getLocalBounds();
+  auto row = bounds.removeFromTop (24);
+  sourceMenu.setBounds (row.removeFromLeft (118));
+  row.removeFromLeft (8);
+  windowMenu.setBounds (row.removeFromLeft (118));
+  row.removeFromLeft (8);
+  captureButton.setBounds (row.removeFromLeft (118));
+  status.setBounds (row);
+
+  bounds.removeFromTop (4);
+  row = bounds.removeFromTop (24);
+  auto third = row.getWidth() / 3;
+  densitySlider.setBounds (row.removeFromLeft (third));
+  sizeSlider.setBounds (row.removeFromLeft (third));
+  pitchSlider.setBounds (row);
+
+  bounds.removeFromTop (4);
+  row = bounds.removeFromTop (24);
+  positionSlider.setBounds (row.removeFromLeft (row.getWidth() / 2));
+  jitterSlider.setBounds (row);
+}
+
+void GranularPanel::sliderValueChanged (Slider* slider) {
+  auto value = (float) slider->getValue();
+  if (slider == &densitySlider)
+    cloud.setDensity (value);
+  else if (slider == &sizeSlider)
+    cloud.setGrainSize (value);
+  else if (slider == &pitchSlider)
+    cloud.setPitch (value);
+  else if (slider == &positionSlider)
+    cloud.setPosition (value);
+  else if (slider == &jitterSlider)
+    cloud.setJitter (value);
+}
+
+void GranularPanel::comboBoxChanged (ComboBox* menu) {
+  if (menu == &sourceMenu)
+    cloud.setSource (sourceMenu.getSelectedId() - 1);
+  else if (menu == &windowMenu)
+    cloud.setWindow ((GrainCloud::Window) (windowMenu.getSelectedId() - 1));
+}
@@ -0,0 +1,46 @@
+//==============================================================================
+// GranularPanel.h
+// The controls of the granular generator.
+//==============================================================================
+
+#pragma once
+
+#include "GrainCloud.h"
+
+/// GranularPanel sets the parameters of a GrainCloud: the source (a WT_*
+/// table or the captured audio), the grain window, density, grain size,
+/// pitch, position and jitter. Its Capture button calls onCapture, and
+/// updateStatus() shows the number of sounding and dropped grains.
+class GranularPanel : public Component, public Slider::Listener, public ComboBox::Listener
+{
+public:
+  explicit GranularPanel (GrainCloud& cloud);
+
+  /// Called when the Capture button is clicked.
+  std::function<void()> onCapture;
+
+  /// Shows the grain counts and whether a capture is in progress. Call
+  /// from a timer.
+  void updateStatus (int activeGrains, int64 droppedGrains, bool capturing);
+
+  void resized() override;
+  void sliderValueChanged (Slider* slider) override;
+  void comboBoxChanged (ComboBox* menu) override;
+
+private:
+  /// Sets up a slider with the app's text box style.
+  void addSlider (Slider& slider, double minimum, double maximum, double value, const String& suffix);
+
+  GrainCloud& cloud;
+  ComboBox sourceMenu;
+  ComboBox windowMenu;
+  TextButton captureButton {"Capture 2 s"};
+  Label status;
+  Slider densitySlider;
+  Slider sizeSlider;
+  Slider pitchSlider;
+  Slider positionSlider;
+  Slider jitterSlider;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GranularPanel)
+};
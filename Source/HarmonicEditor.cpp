@@ -0,0 +1,79 @@
+//==============================================================================
+// HarmonicEditor.cpp
+// Edits the harmonic spectrum of a WT_* wavetable.
+//==============================================================================
+
+#include "HarmonicEditor.h"
+#include "Tracing.h"
+
+HarmonicEditor::HarmonicEditor (WaveTableBank& b)
+: bank (b) {
+  spectrum = bank.getSpectrum (shape);
+}
+
+void HarmonicEditor::setShape (WaveTables::Shape newShape) {
+  shape = newShape;
+  spectrum = bank.getSpectrum (shape);
+  repaint();
+}
+
+Rectangle<float> HarmonicEditor::getAmplitudeArea() const {
+  auto area = getLocalBounds().toFloat();
+  return area.removeFromTop (area.getHeight() * 2.0f / 3.0f);
+}
+
+Rectangle<float> HarmonicEditor::getPhaseArea() const {
+  auto area = getLocalBounds().toFloat();
+  return area.removeFromBottom (area.getHeight() / 3.0f);
+}
+
+void HarmonicEditor::paint (Graphics& g) {
+  Tracing::Scope trace ("HarmonicEditor::paint");
+  g.fillAll (Colours::black);
+  auto colour = isEnabled() ? Colours::lightgreen : Colours::grey;
+  auto width = (float) getWidth() / WaveTables::maxHarmonics;
+  auto amplitudes = getAmplitudeArea();
+  auto phases = getPhaseArea();
+  for (auto h = 0; h < WaveTables::maxHarmonics; ++h) {
+    auto x = h * width;
+    auto decibels = Decibels::gainToDecibels (spectrum.amplitude[h], minDecibels);
+    auto height = jmap (decibels, minDecibels, 0.0f, 0.0f, amplitudes.getHeight());
+    g.setColour (colour);
+    g.fillRect (x + 1.0f, amplitudes.getBottom() - height, width - 2.0f, height);
+    // phase bars grow up or down from the middle of the phase area
+    auto middle = phases.getCentreY();
+    auto offset = spectrum.phase[h] / MathConstants<float>::pi * phases.getHeight() * 0.5f;
+    g.setColour (colour.withAlpha (0.6f));
+    g.fillRect (x + 1.0f, jmin (middle, middle - offset), width - 2.0f, std::abs (offset));
+  }
+  g.setColour (Colours::grey);
+  g.drawHorizontalLine (roundToInt (phases.getY()), 0.0f, (float) getWidth());
+}
+
+void HarmonicEditor::mouseDown (const MouseEvent& event) {
+  editingPhase = getPhaseArea().contains (event.position);
+  edit (event.position);
+}
+
+void HarmonicEditor::mouseDrag (const MouseEvent& event) {
+  edit (event.position);
+}
+
+void HarmonicEditor::edit (Point<float> position) {
+  auto h = (int) (position.x / getWidth() * WaveTables::maxHarmonics);
+  if (h < 0 || h >= WaveTables::maxHarmonics)
+    return;
+  if (editingPhase) {
+    auto area = getPhaseArea();
+    auto y = jlimit (area.getY(), area.getBottom(), position.y);
+    spectrum.phase[h] = jmap (y, area.getBottom(), area.getY(), -MathConstants<float>::pi, MathConstants<float>::pi);
+  }
+  else {
+    auto area = getAmplitudeArea();
+    auto y = jlimit (area.getY(), area.getBottom(), position.y);
+    auto decibels = jmap (y, area.getBottom(), area.getY(), minDecibels, 0.0f);
+    spectrum.amplitude[h] = Decibels::decibelsToGain (decibels, minDecibels);
+  }
+  bank.setHarmonic (shape, h + 1, spectrum.amplitude[h], spectrum.phase[h]);
+  repaint();
+}
@@ -0,0 +1,48 @@
+//==============================================================================
+// HarmonicEditor.h
+// Edits the harmonic spectrum of a WT_* wavetable.
+//==============================================================================
+
+#pragma once
+
+#include "WaveTableBank.h"
+
+/// HarmonicEditor draws one column per harmonic of the selected WT_* shape.
+/// The upper part of each column is its amplitude on a decibel scale from
+/// minDecibels (silent) to 0 dB, the lower part its phase from -pi to pi.
+/// Clicking or dragging across the columns sets the amplitudes or phases
+/// under the mouse, depending on which part the drag started in, and the
+/// bank rebuilds the table in the background.
+class HarmonicEditor : public Component
+{
+public:
+  explicit HarmonicEditor (WaveTableBank& bank);
+
+  /// Shows and edits the spectrum of shape.
+  void setShape (WaveTables::Shape shape);
+
+  /// Amplitudes at or below this are drawn and set as silent.
+  static constexpr float minDecibels = -60.0f;
+
+  void paint (Graphics& g) override;
+  void enablementChanged() override { repaint(); }
+  void mouseDown (const MouseEvent& event) override;
+  void mouseDrag (const MouseEvent& event) override;
+
+private:
+  /// Returns the area of the amplitude (or phase) columns.
+  Rectangle<float> getAmplitudeArea() const;
+  Rectangle<float> getPhaseArea() const;
+
+  /// Sets the harmonic under position from its y coordinate.
+  void edit (Point<float> position);
+
+  WaveTableBank& bank;
+  WaveTables::Shape shape {WaveTables::Sine};
+  /// The shape's spectrum as last edited here.
+  WaveTables::Spectrum spectrum;
+  /// True if the current drag edits phases rather than amplitudes.
+  bool editingPhase {false};
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HarmonicEditor)
+};
@@ -0,0 +1,277 @@
+//==============================================================================
+// LevelMeter.cpp
+// Peak, RMS, true-peak and loudness metering of the output stream.
+//==============================================================================
+
+#include "LevelMeter.h"
+
+namespace
+{
+  /// Returns the sum of the squares of samples. Eight independent partial
+  /// sums give the compiler a reduction it can keep in SIMD registers.
+  double getSumOfSquares (const float* samples, int numSamples) noexcept
+  {
+    float partial[8] {};
+    auto i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+      for (auto lane = 0; lane < 8; ++lane)
+        partial[lane] += samples[i + lane] * samples[i + lane];
+    double sum = 0.0;
+    for (auto lane = 0; lane < 8; ++lane)
+      sum += partial[lane];
+    for (; i < numSamples; ++i)
+      sum += (double) samples[i] * samples[i];
+    return sum;
+  }
+
+  /// Flushes a filter state that has decayed towards the denormal range.
+  forcedinline void flush (double& state) noexcept
+  {
+    if (std::abs (state) < 1.0e-15)
+      state = 0.0;
+  }
+}
+
+LevelMeter::LevelMeter() {
+  // a 48 tap windowed sinc low pass at the original nyquist, split into
+  // four phases that each have unity gain at DC
+  const auto numTaps = 4 * tapsPerPhase;
+  for (auto phase = 0; phase < 4; ++phase) {
+    auto sum = 0.0f;
+    for (auto tap = 0; tap < tapsPerPhase; ++tap) {
+      auto n = tap * 4 + phase;
+      auto x = (n - (numTaps - 1) / 2.0) / 4.0;
+      auto sinc = (x == 0.0) ? 1.0 : std::sin (MathConstants<double>::pi * x) / (MathConstants<double>::pi * x);
+      auto w = 2.0 * MathConstants<double>::pi * (n + 0.5) / numTaps;
+      auto window = 0.35875 - 0.48829 * std::cos (w) + 0.14128 * std::cos (2.0 * w) - 0.01168 * std::cos (3.0 * w);
+      phases[phase][tap] = (float) (sinc * window);
+      sum += phases[phase][tap];
+    }
+    auto gain = 0.0f;
+    for (auto tap = 0; tap < tapsPerPhase; ++tap) {
+      phases[phase][tap] /= sum;
+      gain += std::abs (phases[phase][tap]);
+    }
+    truePeakGain = jmax (truePeakGain, gain);
+  }
+}
+
+void LevelMeter::prepare (double sampleRate) {
+  // the BS.1770 pre-filter (a high shelf) and RLB high pass, derived for
+  // any sample rate from their analog prototypes
+  auto k = std::tan (MathConstants<double>::pi * 1681.974450955533 / sampleRate);
+  auto q = 0.7071752369554196;
+  auto vh = std::pow (10.0, 3.999843853973347 / 20.0);
+  auto vb = std::pow (vh, 0.4996667741545416);
+  auto a0 = 1.0 + k / q + k * k;
+  shelf.b0 = (vh + vb * k / q + k * k) / a0;
+  shelf.b1 = 2.0 * (k * k - vh) / a0;
+  shelf.b2 = (vh - vb * k / q + k * k) / a0;
+  shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+  shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+  k = std::tan (MathConstants<double>::pi * 38.13547087602444 / sampleRate);
+  q = 0.5003270373238773;
+  a0 = 1.0 + k / q + k * k;
+  highPass.b0 = 1.0;
+  highPass.b1 = -2.0;
+  highPass.b2 = 1.0;
+  highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+  highPass.a2 = (1.0 - k / q + k * k) / a0;
+
+  stepLength = jmax (1, roundToInt (sampleRate / 10.0));
+  clear();
+}
+
+void LevelMeter::clear() noexcept {
+  for (auto& channel : channels)
+    channel = Channel();
+  stepPosition = 0;
+  stepPeak = stepTruePeak = 0.0f;
+  stepSquares = stepWeighted = 0.0;
+  ringIndex = numSteps = 0;
+  clearIntegrated();
+  rmsDb.store (minimumDb);
+  momentary.store (minimumDb);
+  shortTerm.store (minimumDb);
+}
+
+void LevelMeter::clearIntegrated() noexcept {
+  std::fill (std::begin (histogramCounts), std::end (histogramCounts), 0u);
+  std::fill (std::begin (histogramEnergy), std::end (histogramEnergy), 0.0);
+  integrated.store (minimumDb);
+  clipped.store (false);
+}
+
+void LevelMeter::process (const AudioSourceChannelInfo& bufferToFill, bool silent) noexcept {
+  if (stepLength == 0)
+    return;
+  if (resetRequested.exchange (false))
+    clearIntegrated();
+  auto& buffer = *bufferToFill.buffer;
+  auto numChannels = jmin (maxChannels, buffer.getNumChannels());
+  if (numChannels == 0)
+    return;
+  stepChannels = numChannels;
+  // a step after the silence starts, what is left in the filters is far
+  // below anything the meter shows
+  if (silence.push (silent, bufferToFill.numSamples, stepLength)) {
+    if (! resting) {
+      for (auto& channel : channels)
+        channel = Channel();
+      resting = true;
+    }
+    for (auto done = 0; done < bufferToFill.numSamples;) {
+      auto num = jmin (bufferToFill.numSamples - done, stepLength - stepPosition);
+      done += num;
+      if ((stepPosition += num) == stepLength)
+        endStep();
+    }
+    return;
+  }
+  resting = false;
+  for (auto done = 0; done < bufferToFill.numSamples;) {
+    auto num = jmin (bufferToFill.numSamples - done, stepLength - stepPosition);
+    for (auto chan = 0; chan < numChannels; ++chan)
+      measure (channels[chan], buffer.getReadPointer (chan, bufferToFill.startSample + done), num);
+    done += num;
+    if ((stepPosition += num) == stepLength)
+      endStep();
+  }
+}
+
+void LevelMeter::measure (Channel& channel, const float* samples, int numSamples) noexcept {
+  auto range = FloatVectorOperations::findMinAndMax (samples, numSamples);
+  stepPeak = jmax (stepPeak, -range.getStart(), range.getEnd());
+  // the interpolated phases sit between the samples, so the samples
+  // themselves count towards the true peak too
+  stepTruePeak = jmax (stepTruePeak, stepPeak);
+  stepTruePeak = jmax (stepTruePeak, getTruePeak (channel, samples, numSamples, stepTruePeak));
+  stepSquares += getSumOfSquares (samples, numSamples);
+
+  // K-weighting, both biquads in one pass
+  auto s0 = channel.shelf[0], s1 = channel.shelf[1];
+  auto h0 = channel.highPass[0], h1 = channel.highPass[1];
+  auto energy = 0.0;
+  for (auto i = 0; i < numSamples; ++i) {
+    auto x = (double) samples[i];
+    auto y = shelf.b0 * x + s0;
+    s0 = shelf.b1 * x - shelf.a1 * y + s1;
+    s1 = shelf.b2 * x - shelf.a2 * y;
+    auto z = highPass.b0 * y + h0;
+    h0 = highPass.b1 * y - highPass.a1 * z + h1;
+    h1 = highPass.b2 * y - highPass.a2 * z;
+    energy += z * z;
+  }
+  stepWeighted += energy;
+  flush (s0);
+  flush (s1);
+  flush (h0);
+  flush (h1);
+  channel.shelf[0] = s0;
+  channel.shelf[1] = s1;
+  channel.highPass[0] = h0;
+  channel.highPass[1] = h1;
+}
+
+float LevelMeter::getTruePeak (Channel& channel, const float* samples, int numSamples, float floor) noexcept {
+  const auto historySize = tapsPerPhase - 1;
+  auto result = floor;
+  std::copy (channel.history, channel.history + historySize, runInput);
+  for (auto done = 0; done < numSamples;) {
+    auto num = jmin (truePeakRun, numSamples - done);
+    FloatVectorOperations::copy (runInput + historySize, samples + done, num);
+    // no interpolated sample can exceed the run's peak times the
+    // interpolator's gain, so steady levels skip the interpolator
+    auto range = FloatVectorOperations::findMinAndMax (runInput, historySize + num);
+    auto bound = jmax (-range.getStart(), range.getEnd()) * truePeakGain;
+    // each phase is a sum over taps of the input run shifted by the tap,
+    // so every tap is one vector multiply-add across the run
+    for (auto phase = 0; phase < 4 && bound > result; ++phase) {
+      FloatVectorOperations::copyWithMultiply (runOutput, runInput + historySize, phases[phase][0], num);
+      for (auto tap = 1; tap < tapsPerPhase; ++tap)
+        FloatVectorOperations::addWithMultiply (runOutput, runInput + historySize - tap, phases[phase][tap], num);
+      auto range = FloatVectorOperations::findMinAndMax (runOutput, num);
+      result = jmax (result, -range.getStart(), range.getEnd());
+    }
+    // the last samples of this run are the history of the next
+    std::copy (runInput + num, runInput + num + historySize, runInput);
+    done += num;
+  }
+  std::copy (runInput, runInput + historySize, channel.history);
+  return result;
+}
+
+void LevelMeter::endStep() noexcept {
+  squares[ringIndex] = stepSquares / ((double) stepLength * stepChannels);
+  weighted[ringIndex] = stepWeighted / stepLength;
+  ringIndex = (ringIndex + 1) % shortTermSteps;
+  numSteps = jmin (numSteps + 1, shortTermSteps);
+
+  auto meanOf = [this] (const double* ring, int steps) {
+    steps = jmin (steps, numSteps);
+    auto sum = 0.0;
+    for (auto i = 1; i <= steps; ++i)
+      sum += ring[(ringIndex - i + shortTermSteps) % shortTermSteps];
+    return sum / steps;
+  };
+  auto block = meanOf (weighted, momentarySteps);
+  rmsDb.store (toDb (meanOf (squares, momentarySteps)));
+  momentary.store (toLoudness (block));
+  shortTerm.store (toLoudness (meanOf (weighted, shortTermSteps)));
+
+  // gate the 400 ms block (the steps overlap it by 75%) into the histogram,
+  // then apply the -70 LUFS absolute and -10 LU relative gates
+  if (numSteps >= momentarySteps) {
+    auto loudness = toLoudness (block);
+    if (loudness > -70.0f) {
+      auto bin = jlimit (0, histogramBins - 1, (int) ((loudness + 70.0f) * 10.0f));
+      ++histogramCounts[bin];
+      histogramEnergy[bin] += block;
+    }
+    auto count = 0.0, energy = 0.0;
+    for (auto bin = 0; bin < histogramBins; ++bin) {
+      count += histogramCounts[bin];
+      energy += histogramEnergy[bin];
+    }
+    if (count > 0.0) {
+      auto gate = toLoudness (energy / count) - 10.0f;
+      auto first = jlimit (0, histogramBins - 1, (int) ((gate + 70.0f) * 10.0f));
+      count = energy = 0.0;
+      for (auto bin = first; bin < histogramBins; ++bin) {
+        count += histogramCounts[bin];
+        energy += histogramEnergy[bin];
+      }
+      integrated.store (count > 0.0 ? toLoudness (energy / count) : minimumDb);
+    }
+  }
+
+  storeMax (peak, stepPeak);
+  storeMax (truePeak, stepTruePeak);
+  if (stepTruePeak >= 1.0f)
+    clipped.store (true);
+  stepPosition = 0;
+  stepPeak = stepTruePeak = 0.0f;
+  stepSquares = stepWeighted = 0.0;
+}
+
+float LevelMeter::takePeakDb() {
+  return Decibels::gainToDecibels (peak.exchange (0.0f), minimumDb);
+}
+
+float LevelMeter::takeTruePeakDb() {
+  return Decibels::gainToDecibels (truePeak.exchange (0.0f), minimumDb);
+}
+
+float LevelMeter::toLoudness (double meanSquare) noexcept {
+  return (meanSquare > 0.0) ? jmax (minimumDb, (float) (-0.691 + 10.0 * std::log10 (meanSquare))) : minimumDb;
+}
+
+float LevelMeter::toDb (double meanSquare) noexcept {
+  return (meanSquare > 0.0) ? jmax (minimumDb, (float) (10.0 * std::log10 (meanSquare))) : minimumDb;
+}
+
+void LevelMeter::storeMax (std::atomic<float>& target, float value) noexcept {
+  auto current = target.load();
+  while (value > current && ! target.compare_exchange_weak (current, value)) {}
+}
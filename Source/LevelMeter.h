@@ -0,0 +1,153 @@
+//==============================================================================
+// LevelMeter.h
+// Peak, RMS, true-peak and loudness metering of the output stream.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "SilenceTracker.h"
+
+/// LevelMeter measures every block the app outputs on the audio thread:
+/// * the sample peak, with a SIMD min/max reduction per channel,
+/// * the true peak, from a 4x oversampled polyphase FIR evaluated as one
+///   SIMD multiply-add per tap over a run of samples. Runs whose peak
+///   can't raise the step's true peak skip the interpolator,
+/// * RMS and BS.1770 loudness over the momentary (400 ms) and short-term
+///   (3 s) windows, and the gated integrated loudness since the last
+///   reset.
+/// Loudness is measured on K-weighted samples in 100 ms steps. The
+/// integrated loudness keeps a histogram of 0.1 LU bins instead of every
+/// 400 ms block, so it runs for any length of time in fixed memory. All
+/// channels have a weight of 1. Results are published through atomics at
+/// the end of every step, and nothing is allocated after prepare().
+///
+/// Blocks the caller knows are silent are measured as usual until the
+/// filters have rung out, one step later. From then on their filter
+/// state is cleared and they only move the steps on, so the meter costs
+/// next to nothing while the output is silent.
+class LevelMeter
+{
+public:
+  /// The most channels measured. Further channels are ignored.
+  static constexpr int maxChannels = 64;
+
+  /// Reported for silence and before there is anything to measure.
+  static constexpr float minimumDb = -100.0f;
+
+  LevelMeter();
+
+  /// Computes the K-weighting filters for sampleRate and clears every
+  /// measurement. Call from prepareToPlay().
+  void prepare (double sampleRate);
+
+  /// Measures a block, which is all zeros if silent is true. Called on the
+  /// audio thread.
+  void process (const AudioSourceChannelInfo& bufferToFill, bool silent = false) noexcept;
+
+  /// Restarts the integrated loudness and clears the clip indicator. Safe
+  /// to call from any thread, the audio thread applies it at its next step.
+  void resetIntegrated() { resetRequested.store (true); }
+
+  //==============================================================================
+  // Results, safe to read from any thread.
+
+  /// Returns the highest sample and true peak in dBFS since the last call.
+  float takePeakDb();
+  float takeTruePeakDb();
+  /// Unweighted RMS over the momentary window, in dBFS.
+  float getRmsDb() const noexcept { return rmsDb.load(); }
+  /// Loudness in LUFS.
+  float getMomentary() const noexcept { return momentary.load(); }
+  float getShortTerm() const noexcept { return shortTerm.load(); }
+  float getIntegrated() const noexcept { return integrated.load(); }
+  /// True if the true peak reached 0 dBTP since the last reset.
+  bool hasClipped() const noexcept { return clipped.load(); }
+
+private:
+  /// Taps per phase of the true-peak interpolator.
+  static constexpr int tapsPerPhase = 12;
+  /// Samples the true-peak interpolator works on at a time.
+  static constexpr int truePeakRun = 256;
+  /// Steps per momentary and short-term window.
+  static constexpr int momentarySteps = 4;
+  static constexpr int shortTermSteps = 30;
+  /// The integrated loudness histogram covers -70 to +5 LUFS.
+  static constexpr int histogramBins = 750;
+
+  /// A direct form II transposed biquad in double precision, so the 38 Hz
+  /// high pass stays exact at high sample rates.
+  struct Biquad
+  {
+    double b0 {1.0}, b1 {0.0}, b2 {0.0}, a1 {0.0}, a2 {0.0};
+  };
+
+  /// The filter and interpolator memory of one channel.
+  struct Channel
+  {
+    double shelf[2] {};
+    double highPass[2] {};
+    float history[tapsPerPhase - 1] {};
+  };
+
+  /// Measures numSamples of one channel into the current step.
+  void measure (Channel& channel, const float* samples, int numSamples) noexcept;
+  /// Returns the larger of floor and the highest interpolated sample.
+  float getTruePeak (Channel& channel, const float* samples, int numSamples, float floor) noexcept;
+  void endStep() noexcept;
+  void clear() noexcept;
+  void clearIntegrated() noexcept;
+
+  static float toLoudness (double meanSquare) noexcept;
+  static float toDb (double meanSquare) noexcept;
+  static void storeMax (std::atomic<float>& target, float value) noexcept;
+
+  /// The interpolator's coefficients, by phase and tap.
+  float phases[4][tapsPerPhase];
+  /// The largest sum of absolute coefficients of a phase, which bounds the
+  /// interpolated samples relative to the input.
+  float truePeakGain {0.0f};
+  Biquad shelf, highPass;
+  Channel channels[maxChannels];
+
+  /// How long the blocks have been silent, and whether the filter state
+  /// has been cleared since.
+  SilenceTracker silence;
+  bool resting {false};
+
+  /// The current step: its length and position in samples, and its peak and
+  /// energy so far.
+  int stepLength {0};
+  int stepPosition {0};
+  int stepChannels {1};
+  float stepPeak {0.0f};
+  float stepTruePeak {0.0f};
+  double stepSquares {0.0};
+  double stepWeighted {0.0};
+
+  /// Mean squares of the last shortTermSteps steps, unweighted and
+  /// K-weighted, in a ring.
+  double squares[shortTermSteps] {};
+  double weighted[shortTermSteps] {};
+  int ringIndex {0};
+  int numSteps {0};
+
+  /// The number and energy of gated 400 ms blocks in each 0.1 LU bin.
+  uint32 histogramCounts[histogramBins] {};
+  double histogramEnergy[histogramBins] {};
+
+  /// Scratch space for the true-peak interpolator.
+  float runInput[tapsPerPhase - 1 + truePeakRun];
+  float runOutput[truePeakRun];
+
+  std::atomic<float> peak {0.0f};
+  std::atomic<float> truePeak {0.0f};
+  std::atomic<float> rmsDb {minimumDb};
+  std::atomic<float> momentary {minimumDb};
+  std::atomic<float> shortTerm {minimumDb};
+  std::atomic<float> integrated {minimumDb};
+  std::atomic<bool> clipped {false};
+  std::atomic<bool> resetRequested {false};
+
+  JUCE_DECLARE_NON_COPYABLE (LevelMeter)
+};
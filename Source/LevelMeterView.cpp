@@ -0,0 +1,65 @@
+//==============================================================================
+// LevelMeterView.cpp
+// Draws the output levels measured by a LevelMeter.
+//==============================================================================
+
+#include "LevelMeterView.h"
+#include "Tracing.h"
+
+namespace
+{
+  /// The width of the level bar.
+  const int barWidth = 80;
+
+  /// How far the true peak tick falls per update.
+  const float holdFallDb = 1.0f;
+
+  String formatLoudness (float lufs)
+  {
+    return (lufs <= LevelMeter::minimumDb) ? String ("-inf") : String (lufs, 1);
+  }
+}
+
+LevelMeterView::LevelMeterView (LevelMeter& m)
+: meter (m) {
+}
+
+void LevelMeterView::update() {
+  peakDb = meter.takePeakDb();
+  rmsDb = meter.getRmsDb();
+  truePeakHoldDb = jmax (meter.takeTruePeakDb(), truePeakHoldDb - holdFallDb);
+  repaint();
+}
+
+void LevelMeterView::paint (Graphics& g) {
+  Tracing::Scope trace ("LevelMeterView::paint");
+  auto bounds = getLocalBounds().toFloat();
+  auto bar = bounds.removeFromLeft ((float) barWidth).reduced (0.0f, 4.0f);
+  auto toX = [&bar] (float decibels) {
+    return jmap (jlimit (minDecibels, 0.0f, decibels), minDecibels, 0.0f, bar.getX(), bar.getRight());
+  };
+  g.setColour (Colours::black);
+  g.fillRect (bar);
+  g.setColour (Colours::lightgreen);
+  g.fillRect (bar.withRight (toX (rmsDb)));
+  g.setColour (Colours::yellow);
+  g.drawVerticalLine (roundToInt (toX (peakDb)), bar.getY(), bar.getBottom());
+  g.setColour (Colours::white);
+  g.fillRect (Rectangle<float> (toX (truePeakHoldDb) - 1.0f, bar.getY(), 2.0f, bar.getHeight()));
+  g.setColour (meter.hasClipped() ? Colours::red : Colours::grey);
+  g.drawRect (bar);
+
+  bounds.removeFromLeft (6.0f);
+  g.setColour (getLookAndFeel().findColour (Label::textColourId));
+  g.setFont (12.0f);
+  g.drawText ("M " + formatLoudness (meter.getMomentary())
+              + "  S " + formatLoudness (meter.getShortTerm())
+              + "  I " + formatLoudness (meter.getIntegrated()) + " LUFS",
+              bounds, Justification::centredLeft, true);
+}
+
+void LevelMeterView::mouseDown (const MouseEvent&) {
+  meter.resetIntegrated();
+  truePeakHoldDb = LevelMeter::minimumDb;
+  repaint();
+}
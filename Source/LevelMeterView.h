@@ -0,0 +1,37 @@
+//==============================================================================
+// LevelMeterView.h
+// Draws the output levels measured by a LevelMeter.
+//==============================================================================
+
+#pragma once
+
+#include "LevelMeter.h"
+
+/// LevelMeterView draws a bar from minDecibels to 0 dBFS filled to the RMS
+/// level, with a line at the sample peak and a held tick at the true peak,
+/// followed by the momentary, short-term and integrated loudness. The bar
+/// turns red once the true peak reaches 0 dBTP. Clicking the view restarts
+/// the integrated loudness and clears the clip indicator.
+class LevelMeterView : public Component
+{
+public:
+  explicit LevelMeterView (LevelMeter& meter);
+
+  /// Reads the latest measurements and repaints. Call from a timer.
+  void update();
+
+  /// The bottom of the level bar.
+  static constexpr float minDecibels = -60.0f;
+
+  void paint (Graphics& g) override;
+  void mouseDown (const MouseEvent& event) override;
+
+private:
+  LevelMeter& meter;
+  float peakDb {LevelMeter::minimumDb};
+  float rmsDb {LevelMeter::minimumDb};
+  /// The true peak tick falls back slowly after a peak.
+  float truePeakHoldDb {LevelMeter::minimumDb};
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeterView)
+};
@@ -0,0 +1,50 @@
+//==============================================================================
+// LimiterPanel.cpp
+// The controls of the output limiter.
+//==============================================================================
+
+#include "LimiterPanel.h"
+
+LimiterPanel::LimiterPanel (OutputLimiter& l)
+: limiter (l) {
+  addAndMakeVisible (clipButton);
+  clipButton.onClick = [this] { limiter.setSoftClip (clipButton.getToggleState()); };
+
+  addAndMakeVisible (ceilingSlider);
+  ceilingSlider.setSliderStyle (Slider::LinearHorizontal);
+  ceilingSlider.setTextBoxStyle (Slider::TextBoxLeft, false, 90, 22);
+  ceilingSlider.setRange (-12.0, 0.0, 0.1);
+  ceilingSlider.setTextValueSuffix (" dBTP");
+  ceilingSlider.setValue (-1.0, dontSendNotification);
+  ceilingSlider.addListener (this);
+  limiter.setCeilingDb (-1.0f);
+
+  addAndMakeVisible (status);
+  status.setJustificationType (Justification::centredRight);
+}
+
+void LimiterPanel::updateStatus (double sampleRate) {
+  auto reduction = limiter.takeGainReductionDb();
+  if (sampleRate <= 0.0) {
+    status.setText ({}, dontSendNotification);
+    return;
+  }
+  auto latency = limiter.getLatencySamples();
+  auto text = "Latency " + String (1000.0 * latency / sampleRate, 1) + " ms (" + String (latency) + ")";
+  if (reduction < -0.05f)
+    text += ", GR " + String (reduction, 1) + " dB";
+  status.setText (text, dontSendNotification);
+}
+
+void LimiterPanel::resized() {
+  auto row = getLocalBounds();
+  clipButton.setBounds (row.removeFromLeft (118));
+  row.removeFromLeft (8 + 56 + 8);
+  ceilingSlider.setBounds (row.removeFromLeft (200));
+  status.setBounds (row);
+}
+
+void LimiterPanel::sliderValueChanged (Slider* slider) {
+  if (slider == &ceilingSlider)
+    limiter.setCeilingDb ((float) slider->getValue());
+}
@@ -0,0 +1,31 @@
+//==============================================================================
+// LimiterPanel.h
+// The controls of the output limiter.
+//==============================================================================
+
+#pragma once
+
+#include "OutputLimiter.h"
+
+/// LimiterPanel sets the ceiling of an OutputLimiter and switches its soft
+/// clipper. updateStatus() shows the latency the limiter adds and its gain
+/// reduction.
+class LimiterPanel : public Component, public Slider::Listener
+{
+public:
+  explicit LimiterPanel (OutputLimiter& limiter);
+
+  /// Shows the latency and gain reduction. Call from a timer.
+  void updateStatus (double sampleRate);
+
+  void resized() override;
+  void sliderValueChanged (Slider* slider) override;
+
+private:
+  OutputLimiter& limiter;
+  ToggleButton clipButton {"Soft clip"};
+  Slider ceilingSlider;
+  Label status;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LimiterPanel)
+};
@@ -3,6 +3,12 @@
 #include "MainApplication.h"
 #include "MainWindow.h"
 #include "MainComponent.h"
+#include "GeneratorBenchmark.h"
+#include "MeasurementSignals.h"
+#include "PartialTracks.h"
+#include "Tracing.h"
+#include "SimulatedAudioDevice.h"
+#include "SoakTest.h"
 
 //==============================================================================
 // MainApplication members
@@ -36,10 +42,117 @@ bool MainApplication::moreThanOneInstanceAllowed() {
 }
 
 void MainApplication::initialise(const String& commandLine) {
-  // initialize the audio device manager
-	String audioError = audioDeviceManager.initialise(0, 2, nullptr, true);
-  // use jassert to ensure audioError is empty
-	jassert(audioError.isEmpty());
+  auto args = StringArray::fromTokens(commandLine, true);
+  // `--trace [file]` records trace events until the app quits, for
+  // chrome://tracing or ui.perfetto.dev.
+  auto traceArg = args.indexOf("--trace");
+  if (traceArg >= 0) {
+    auto file = File::getCurrentWorkingDirectory().getChildFile("trace.json");
+    if (traceArg + 1 < args.size() && !args[traceArg + 1].startsWith("--"))
+      file = File::getCurrentWorkingDirectory().getChildFile(args[traceArg + 1].unquoted());
+    auto error = Tracing::start(file);
+    Logger::writeToLog(error.isEmpty() ? "Tracing to " + file.getFullPathName() : error);
+  }
+  // `--benchmark [directory]` measures the generators and exits without
+  // opening the audio device or a window.
+  auto benchmarkArg = args.indexOf("--benchmark");
+  if (benchmarkArg >= 0) {
+    auto directory = File::getCurrentWorkingDirectory().getChildFile("benchmark");
+    if (benchmarkArg + 1 < args.size())
+      directory = File::getCurrentWorkingDirectory().getChildFile(args[benchmarkArg + 1].unquoted());
+    GeneratorBenchmark benchmark;
+    benchmark.run();
+    auto written = benchmark.write(directory);
+    Logger::writeToLog(written ? "Benchmark results written to " + directory.getFullPathName()
+                               : "Can't write benchmark results to " + directory.getFullPathName());
+    setApplicationReturnValue(written ? 0 : 1);
+    quit();
+    return;
+  }
+  // `--measure <signal> [file] [--rate <hz>]` renders one period of a
+  // measurement signal to a .wav file and exits.
+  auto measureArg = args.indexOf("--measure");
+  if (measureArg >= 0) {
+    auto name = args[measureArg + 1];
+    auto signal = MeasurementSignals::NumSignals;
+    for (auto i = 0; i < MeasurementSignals::NumSignals; ++i)
+      if (name == MeasurementSignals::getName((MeasurementSignals::Signal) i))
+        signal = (MeasurementSignals::Signal) i;
+    auto rateArg = args.indexOf("--rate");
+    auto sampleRate = (rateArg >= 0) ? args[rateArg + 1].getDoubleValue() : 48000.0;
+    auto file = File::getCurrentWorkingDirectory().getChildFile(name + ".wav");
+    if (measureArg + 2 < args.size() && measureArg + 2 != rateArg)
+      file = File::getCurrentWorkingDirectory().getChildFile(args[measureArg + 2].unquoted());
+    String error;
+    if (signal == MeasurementSignals::NumSignals)
+      error = "Unknown signal '" + name + "', use exp-sweep, lin-sweep, mls or multitone.";
+    else
+      error = MeasurementSignals().render(signal, sampleRate, file);
+    Logger::writeToLog(error.isEmpty() ? "Rendered " + file.getFullPathName() : error);
+    setApplicationReturnValue(error.isEmpty() ? 0 : 1);
+    quit();
+    return;
+  }
+  // `--analyze <audio file> [file]` analyzes an audio file into partial
+  // tracks, writes them to a .partials file for the Resynthesis waveform
+  // and exits.
+  auto analyzeArg = args.indexOf("--analyze");
+  if (analyzeArg >= 0) {
+    auto input = File::getCurrentWorkingDirectory().getChildFile(args[analyzeArg + 1].unquoted());
+    auto output = input.withFileExtension(PartialTracks::fileExtension);
+    if (analyzeArg + 2 < args.size())
+      output = File::getCurrentWorkingDirectory().getChildFile(args[analyzeArg + 2].unquoted());
+    String error;
+    if (auto tracks = PartialTracks::analyze(input, error))
+      error = tracks->save(output);
+    Logger::writeToLog(error.isEmpty() ? "Wrote " + output.getFullPathName() : error);
+    setApplicationReturnValue(error.isEmpty() ? 0 : 1);
+    quit();
+    return;
+  }
+  // `--simulate [--rate <hz>] [--block <samples>] [--channels <n>]
+  // [--jitter <fraction>] [--contention <fraction>] [--max-speed]` plays on
+  // a simulated device instead of the sound hardware (see
+  // SimulatedAudioDevice.h). `--soak <seconds>` also does, and runs the app
+  // without a window for that long (see SoakTest.h).
+  auto simulateArg = args.indexOf("--simulate");
+  auto soakArg = args.indexOf("--soak");
+  if (simulateArg >= 0 || soakArg >= 0) {
+    auto getOption = [&args] (const char* name, double fallback) {
+      auto index = args.indexOf(name);
+      return (index >= 0 && index + 1 < args.size()) ? args[index + 1].getDoubleValue() : fallback;
+    };
+    SimulatedAudioDevice::Options options;
+    options.sampleRate = getOption("--rate", options.sampleRate);
+    options.blockSize = (int) getOption("--block", options.blockSize);
+    options.numChannels = (int) getOption("--channels", options.numChannels);
+    options.jitter = getOption("--jitter", options.jitter);
+    options.contention = getOption("--contention", options.contention);
+    options.maxSpeed = args.contains("--max-speed");
+    // added before initialise(), it's the only device type, so nothing
+    // opens the hardware
+    audioDeviceManager.addAudioDeviceType(std::make_unique<SimulatedAudioDeviceType>(options));
+    AudioDeviceManager::AudioDeviceSetup setup;
+    setup.outputDeviceName = SimulatedAudioDeviceType::deviceName;
+    setup.sampleRate = options.sampleRate;
+    setup.bufferSize = options.blockSize;
+    auto audioError = audioDeviceManager.initialise(0, options.numChannels, nullptr, false, {}, &setup);
+    if (audioError.isNotEmpty())
+      Logger::writeToLog(audioError);
+    if (soakArg >= 0) {
+      soakTest = std::make_unique<SoakTest>(getOption("--soak", 60.0), options.seed);
+      return;
+    }
+  }
+  else {
+    // initialize the audio device manager, with the simulated device offered
+    // after the real ones
+    audioDeviceManager.getAvailableDeviceTypes();
+    audioDeviceManager.addAudioDeviceType(std::make_unique<SimulatedAudioDeviceType>());
+    String audioError = audioDeviceManager.initialise(0, 2, nullptr, true);
+    // use jassert to ensure audioError is empty
+    jassert(audioError.isEmpty());
+  }
   // Create the application window.
   mainWindow = std::make_unique<MainWindow>(getApplicationName());
 }
@@ -47,6 +160,9 @@ void MainApplication::initialise(const String& commandLine) {
 void MainApplication::shutdown() {
   // Delete our main window
   mainWindow = nullptr;
+  soakTest = nullptr;
+  // the audio device has stopped, so the trace is complete
+  Tracing::stop();
 }
 
 void MainApplication::systemRequestedQuit() {
@@ -8,6 +8,7 @@
 #include "../JuceLibraryCode/JuceHeader.h"
 
 class MainWindow;
+class SoakTest;
 
 /// A JUCEApplication that generates various types of wave forms and displays
 /// them in a visualizer. NOTE: Member declarations without documentation
@@ -62,4 +63,7 @@ private:
 
   /// Pointer to the main window of the app.
   std::unique_ptr<MainWindow> mainWindow;
+
+  /// The headless soak test run by `--soak`, in place of the window.
+  std::unique_ptr<SoakTest> soakTest;
 };
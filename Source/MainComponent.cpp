@@ -46,11 +46,48 @@ MainComponent::MainComponent()
     waveformMenu.addItem("WT Saw", 16);
     waveformMenu.addItem("WT Triangle", 17);
 
+    waveformMenu.addSeparator();
+
+    waveformMenu.addItem("Granular", 18);
+
+    waveformMenu.addSeparator();
+
+    waveformMenu.addItem("Exp Sweep", 19);
+    waveformMenu.addItem("Lin Sweep", 20);
+    waveformMenu.addItem("MLS", 21);
+    waveformMenu.addItem("Multitone", 22);
+
+    waveformMenu.addSeparator();
+
+    waveformMenu.addItem("Plucked", 23);
+    waveformMenu.addItem("Resonator", 24);
+    waveformMenu.addSeparator();
+
+    waveformMenu.addItem("Resynthesis", 25);
+    waveformMenu.addSeparator();
+
+    waveformMenu.addItem("Expression", 26);
+    waveformMenu.addSeparator();
+
+    waveformMenu.addItem("Sample", 27);
+    waveformMenu.addSeparator();
+
+    waveformMenu.addItem("FFT Impulse", 28);
+    waveformMenu.addItem("FFT Square", 29);
+    waveformMenu.addItem("FFT Saw", 30);
+    waveformMenu.addItem("FFT Triangle", 31);
+
     addAndMakeVisible(playButton);
     playButton.addListener(this);
     drawPlayButton(playButton, true);
     playButton.setEnabled(false);
 
+    addAndMakeVisible(recordButton);
+    recordButton.addListener(this);
+
+    addAndMakeVisible(matrixButton);
+    matrixButton.addListener(this);
+
     addAndMakeVisible(levelLabel);
     levelLabel.setText("Level:", dontSendNotification);
 
@@ -73,10 +110,48 @@ MainComponent::MainComponent()
     freqLabel.attachToComponent(&freqSlider, true);
     freqSlider.setSkewFactorFromMidPoint(500.0);
 
+    addAndMakeVisible(harmonicEditor);
+    harmonicEditor.setEnabled(false);
+
+    addChildComponent(tableFormatMenu);
+    tableFormatMenu.addItem("Float tables", 1 + WaveTables::Float32);
+    tableFormatMenu.addItem("Half tables", 1 + WaveTables::Float16);
+    tableFormatMenu.addItem("Int16 tables", 1 + WaveTables::Int16);
+    tableFormatMenu.setSelectedId(1 + WaveTables::Float32, dontSendNotification);
+    tableFormatMenu.addListener(this);
+    addChildComponent(tableMemory);
+    showTableMemory();
+
+    addChildComponent(granularPanel);
+    granularPanel.onCapture = [this] {
+        if (srate > 0.0) {
+            capture.request(roundToInt(srate * captureSeconds));
+        }
+    };
+
+    addChildComponent(measurementPanel);
+    addChildComponent(stringPanel);
+    addChildComponent(partialPanel);
+    addChildComponent(expressionPanel);
+    addChildComponent(samplePanel);
+    addChildComponent(spectralPanel);
+    addAndMakeVisible(convolutionPanel);
+    addAndMakeVisible(limiterPanel);
+    addAndMakeVisible(ratePanel);
+    ratePanel.onRateChange = [this] (double rate) {
+        fixedRate.store(rate);
+        // restarting the source prepares it at the new rate
+        if (isPlaying()) {
+            audioSourcePlayer.setSource(nullptr);
+            audioSourcePlayer.setSource(this);
+        }
+    };
+
     addAndMakeVisible(audioVisualizer);
+    audioVisualizer.setRepaintRate(activeRepaintRate);
     audioSourcePlayer.setSource(nullptr);
     deviceManager.addAudioCallback(&audioSourcePlayer);
-    startTimer(100);
+    startTimer(activeTimerInterval);
 
     cpuLabel.setText("CPU:", juce::dontSendNotification);
     cpuUsage.setJustificationType(juce::Justification::right);
@@ -84,13 +159,18 @@ MainComponent::MainComponent()
     addAndMakeVisible(cpuUsage);
     
 
-    setVisible(true);
+    memoryUsage.setJustificationType(juce::Justification::right);
+    addAndMakeVisible(memoryUsage);
+
+    addAndMakeVisible(meterView);
 
-    createWaveTables();
+    setVisible(true);
 }
 
 MainComponent::~MainComponent() {
+    recorder.stop();
     audioSourcePlayer.setSource(nullptr);
+    releaseRenderStages();
     deviceManager.removeAudioCallback(&audioSourcePlayer);
     deviceManager.closeAudioDevice();
 }
@@ -100,6 +180,7 @@ MainComponent::~MainComponent() {
 //==============================================================================
 
 void MainComponent::paint (Graphics& g) {
+    Tracing::Scope trace("MainComponent::paint");
     g.fillAll(getLookAndFeel().findColour(ResizableWindow::backgroundColourId));
 }
 
@@ -117,6 +198,11 @@ void MainComponent::resized() {
     twoLines.removeFromLeft(8);
 
     playButton.setBounds(twoLines.removeFromLeft(56));
+    twoLines.removeFromLeft(8);
+    auto buttonArea = twoLines.removeFromLeft(118);
+    recordButton.setBounds(buttonArea.removeFromTop(24));
+    buttonArea.removeFromTop(8);
+    matrixButton.setBounds(buttonArea.removeFromTop(24));
     
 
     auto secArea = twoLines.removeFromRight(300);
@@ -128,12 +214,35 @@ void MainComponent::resized() {
 
     secArea.removeFromRight(8);
     
+    bounds.removeFromTop(8);
+    auto editorArea = bounds.removeFromTop(80);
+    granularPanel.setBounds(editorArea);
+    measurementPanel.setBounds(editorArea);
+    stringPanel.setBounds(editorArea);
+    partialPanel.setBounds(editorArea);
+    expressionPanel.setBounds(editorArea);
+    samplePanel.setBounds(editorArea);
+    spectralPanel.setBounds(editorArea);
+    auto formatArea = editorArea.removeFromRight(118);
+    tableFormatMenu.setBounds(formatArea.removeFromTop(24));
+    formatArea.removeFromTop(8);
+    tableMemory.setBounds(formatArea.removeFromTop(40));
+    editorArea.removeFromRight(8);
+    harmonicEditor.setBounds(editorArea);
+    bounds.removeFromTop(8);
+    convolutionPanel.setBounds(bounds.removeFromTop(24));
+    bounds.removeFromTop(8);
+    limiterPanel.setBounds(bounds.removeFromTop(24));
+    bounds.removeFromTop(8);
+    ratePanel.setBounds(bounds.removeFromTop(24));
     bounds.removeFromTop(8);
     auto cpuArea = bounds.removeFromBottom(20);
     auto cpuLabelArea2 = cpuArea.removeFromRight(200);
     auto cpuUsageArea = cpuLabelArea2.removeFromRight(100);
     cpuLabel.setBounds(cpuLabelArea2);
     cpuUsage.setBounds(cpuUsageArea);
+    memoryUsage.setBounds(cpuArea.removeFromRight(120));
+    meterView.setBounds(cpuArea);
 
     audioVisualizer.setBounds(bounds);
 
@@ -177,6 +286,7 @@ void MainComponent::buttonClicked (Button *button) {
     if (button == &playButton) {
         if (isPlaying()) {
             audioSourcePlayer.setSource(nullptr);
+            releaseRenderStages();
         } else {
             audioSourcePlayer.setSource(this);
         }
@@ -185,25 +295,45 @@ void MainComponent::buttonClicked (Button *button) {
     else if (button == &settingsButton) {
         openAudioSettings();
     }
+    else if (button == &recordButton) {
+        toggleRecording();
+    }
+    else if (button == &matrixButton) {
+        openChannelMatrix();
+    }
 }
 
 void MainComponent::sliderValueChanged (Slider *slider) {
+    Tracing::Scope trace("MainComponent::sliderValueChanged");
     if (slider == &levelSlider) {
-        level = levelSlider.getValue();
+        level = (float) levelSlider.getValue();
     }
     else if (slider == &freqSlider) {
         freq = freqSlider.getValue();
-        phaseDelta = freqSlider.getValue() / srate;
-        for (auto& o : oscillators) {
-            o->setFrequency(freq, srate);
-        }
+        switcher.setFrequency(freq);
     }
 }
 
 void MainComponent::comboBoxChanged (ComboBox *menu) {
     if (menu == &waveformMenu) {
         waveformId = (WaveformId)waveformMenu.getSelectedId();
+        requestedWaveform.store(waveformId);
         playButton.setEnabled(true);
+        if (isWaveTable(waveformId)) {
+            harmonicEditor.setShape((WaveTables::Shape)(waveformId - WT_START));
+        }
+        harmonicEditor.setEnabled(isWaveTable(waveformId));
+        auto panel = getWaveformInfo(waveformId).panel;
+        harmonicEditor.setVisible(panel == WaveformPanel::Harmonics);
+        granularPanel.setVisible(panel == WaveformPanel::Granular);
+        measurementPanel.setVisible(panel == WaveformPanel::Measurement);
+        stringPanel.setVisible(panel == WaveformPanel::Strings);
+        partialPanel.setVisible(panel == WaveformPanel::Partials);
+        expressionPanel.setVisible(panel == WaveformPanel::Expression);
+        samplePanel.setVisible(panel == WaveformPanel::Sample);
+        spectralPanel.setVisible(panel == WaveformPanel::Spectral);
+        tableFormatMenu.setVisible(isWaveTable(waveformId));
+        tableMemory.setVisible(isWaveTable(waveformId));
         /*
         int num = waveformMenu.getSelectedItemIndex();
         std::cout << num << std::endl;
@@ -211,6 +341,25 @@ void MainComponent::comboBoxChanged (ComboBox *menu) {
         */
 
     }
+    else if (menu == &tableFormatMenu) {
+        tableFormat.store(tableFormatMenu.getSelectedId() - 1);
+        showTableMemory();
+    }
+}
+
+void MainComponent::showTableMemory() {
+    auto format = (WaveTables::Format) tableFormat.load();
+    // what the oscillators read, and what stays in memory: the float
+    // masters plus every compact copy, whichever format is chosen
+    auto bytes = WaveTables::NumShapes * WaveTables::getTableBytes(format);
+    auto floatBytes = WaveTables::NumShapes * WaveTables::getTableBytes(WaveTables::Float32);
+    auto residentBytes = floatBytes + CompactTables::getArenaBytes();
+    auto text = juce::String(bytes / 1024.0, 1) + " KB read";
+    if (bytes < floatBytes) {
+        text << " (-" << roundToInt(100.0 * (floatBytes - bytes) / floatBytes) << "%)";
+    }
+    text << "\n" << juce::String(residentBytes / 1024.0, 1) << " KB resident";
+    tableMemory.setText(text, juce::dontSendNotification);
 }
 
 //==============================================================================
@@ -218,8 +367,48 @@ void MainComponent::comboBoxChanged (ComboBox *menu) {
 //==============================================================================
 
 void MainComponent::timerCallback() {
+    Tracing::Scope trace("MainComponent::timerCallback");
     auto cpu = deviceManager.getCpuUsage() * 100;
     cpuUsage.setText(juce::String(cpu, 3) + " %", juce::dontSendNotification);
+    auto kilobytes = dspMemory.load() / 1024.0;
+    memoryUsage.setText("DSP: " + juce::String(kilobytes, 1) + " KB", juce::dontSendNotification);
+    meterView.update();
+    RealtimeChecks::reportViolations();
+    if (auto captured = capture.takeCompleted()) {
+        waveTables.setCapture(std::move(captured));
+    }
+    granularPanel.updateStatus(grains.getActiveGrains(), grains.getDroppedGrains(), capture.isCapturing());
+    measurementPanel.updateStatus(srate);
+    partialPanel.updateStatus();
+    expressionPanel.updateStatus();
+    samplePanel.updateStatus();
+    spectralPanel.updateStatus(srate);
+    convolutionPanel.updateStatus();
+    limiterPanel.updateStatus(deviceRate);
+    ratePanel.updateStatus(srate, deviceRate);
+    if (recorder.isRecording()) {
+        auto text = "Stop " + juce::String(recorder.getRecordedSamples() / deviceRate, 1) + " s";
+        if (auto dropped = recorder.getDroppedSamples()) {
+            text += " (" + juce::String(dropped) + " lost)";
+        }
+        recordButton.setButtonText(text);
+    }
+    updateIdle();
+}
+
+void MainComponent::updateIdle() {
+  // idle once the visualizer has shown a flat line for half a second
+  auto silent = deviceRate > 0.0 && outputSilentSamples.load() > visualizerHistory + deviceRate / 2;
+  auto nowIdle = !isPlaying() || (silent && !recorder.isRecording());
+  if (nowIdle == idle) {
+    return;
+  }
+  idle = nowIdle;
+  startTimer(idle ? idleTimerInterval : activeTimerInterval);
+  audioVisualizer.setRepaintRate(idle ? 0 : activeRepaintRate);
+  if (idle) {
+    audioVisualizer.repaint();
+  }
 }
 
 //==============================================================================
@@ -229,65 +418,334 @@ void MainComponent::timerCallback() {
 void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRate) {
     audioVisualizer.setBufferSize(samplesPerBlockExpected);
     audioVisualizer.setSamplesPerBlock(8);
-    srate = sampleRate;
-    phaseDelta = freq / srate;
-    phase = 0.0;
+    visualizerHistory = samplesPerBlockExpected * 8;
+    deviceRate = sampleRate;
+    auto fixed = fixedRate.load();
+    auto renderRate = (fixed > 0.0) ? fixed : sampleRate;
+    auto* device = deviceManager.getCurrentAudioDevice();
+    auto outputs = (device != nullptr) ? device->getActiveOutputChannels().countNumberOfSetBits() : 1;
+    outputs = jlimit(1, ChannelMatrix::maxChannels, outputs);
+    // the render stages kept by releaseResources() carry on if they were
+    // prepared for this rate and channel count
+    if (!renderPrepared || renderRate != srate || outputs != numOutputs) {
+        releaseRenderStages();
+        srate = renderRate;
+        numOutputs = outputs;
+        prepareRenderStages();
+    }
+    converting = srate != deviceRate;
+    deviceArena.reserve(getDeviceArenaBytes());
+    meter.prepare(deviceRate);
+    limiter.prepare(deviceArena, numOutputs, deviceRate);
+    if (converting) {
+        converter.prepare(deviceArena, numOutputs, srate, deviceRate);
+        outputScheduler.prepare(deviceArena, numOutputs);
+    }
+    else {
+        converter.release();
+        outputScheduler.release();
+    }
+    // while converting the convolution sees a callback's worth of samples
+    // at the render rate, plus the converter's and the output scheduler's
+    // read ahead
+    auto renderBlockSize = converting ? converter.getMaxInputSamples(samplesPerBlockExpected + SubBlockScheduler::subBlockSize)
+                                      : samplesPerBlockExpected;
+    convolution.prepare(srate, numOutputs, renderBlockSize);
+    dspMemory.store(arena.getBytesUsed() + deviceArena.getBytesUsed());
+    Tracing::reserveThread("Audio Callback");
+    audioThreadTraced = false;
 }
 
 void MainComponent::releaseResources() {
+    limiter.release();
+    converter.release();
+    outputScheduler.release();
+    deviceArena.release();
+    // at a fixed render rate nothing rendered depends on the device, so a
+    // device change keeps the render stages, and stopping releases them
+    // (see releaseRenderStages())
+    if (fixedRate.load() <= 0.0) {
+        releaseRenderStages();
+    }
+    dspMemory.store(arena.getBytesUsed());
+}
+
+void MainComponent::prepareRenderStages() {
+    arena.reserve(getArenaBytes());
+    waveTables.attachReader();
+    switcher.setFrequency(freq);
+    switcher.setFadeLength(fadeLength);
+    switcher.prepare(arena, SubBlockScheduler::subBlockSize, srate);
+    grains.prepare(arena, srate);
+    strings.prepare(arena, srate);
+    partials.prepare(arena, srate);
+    expression.prepare(arena);
+    spectral.prepare(arena);
+    compactTables.prepare(arena, waveTables);
+    signals.prepare(srate);
+    matrix.prepare(arena, numOutputs, srate, fadeLength);
+    scheduler.prepare(arena, numOutputs);
+    // the slots start out silent, so the selected waveform fades in
+    activeWaveform = Empty;
+    activeTableFormat = tableFormat.load();
+    renderPrepared = true;
+}
+
+void MainComponent::releaseRenderStages() {
+    if (!renderPrepared) {
+        return;
+    }
+    waveTables.detachReader();
+    switcher.release();
+    grains.release();
+    strings.release();
+    partials.release();
+    expression.release();
+    spectral.release();
+    compactTables.release();
+    matrix.release();
+    capture.reset();
+    scheduler.release();
+    arena.release();
+    renderPrepared = false;
 }
 
 void MainComponent::getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill) {
-  bufferToFill.clearActiveBufferRegion();
-  switch (waveformId) {
-    case WhiteNoise:      whiteNoise(bufferToFill);   break;
-    case DustNoise:       dust(bufferToFill);         break;
-    case BrownNoise:      brownNoise(bufferToFill);   break;
-    case SineWave:        sineWave(bufferToFill);     break;
-    case LF_ImpulseWave:  LF_impulseWave(bufferToFill);  break;
-    case LF_SquareWave:   LF_squareWave(bufferToFill);   break;
-    case LF_SawtoothWave: LF_sawtoothWave(bufferToFill); break;
-    case LF_TriangeWave:  LF_triangleWave(bufferToFill); break;
-    case BL_ImpulseWave:  BL_impulseWave(bufferToFill);  break;
-    case BL_SquareWave:   BL_squareWave(bufferToFill);   break;
-    case BL_SawtoothWave: BL_sawtoothWave(bufferToFill); break;
-    case BL_TriangeWave:  BL_triangleWave(bufferToFill); break;
-    case WT_SineWave:
-    case WT_ImpulseWave:
-    case WT_SquareWave:
-    case WT_SawtoothWave:
-    case WT_TriangleWave:
-      WT_wave(bufferToFill);
-      break;
-    case Empty:
-      break;
+  RealtimeChecks::ScopedAudioThread audioThread;
+  RealtimeChecks::ScopedDenormalGuard denormalGuard;
+  if (!audioThreadTraced) {
+    Tracing::adoptThread();
+    audioThreadTraced = true;
+  }
+  Tracing::Scope trace("MainComponent::getNextAudioBlock");
+  auto render = [this] (const AudioSourceChannelInfo& info) {
+    return scheduler.process(info, [this] (AudioSampleBuffer& subBlock) {
+      return renderSubBlock(subBlock);
+    });
+  };
+  // at a fixed render rate the limiter follows the converter, so the
+  // converter's filter can't ring past the ceiling
+  auto convert = [this, &render] (AudioSampleBuffer& subBlock) {
+    return limitSubBlock(subBlock, converter.process(AudioSourceChannelInfo(subBlock), render));
+  };
+  auto silent = converting ? outputScheduler.process(bufferToFill, convert) : render(bufferToFill);
+  meter.process(bufferToFill, silent);
+  recorder.push(bufferToFill);
+  // once the visualizer's history is all zeros more zeros change nothing
+  auto flat = visualizerSilence.push(silent, bufferToFill.numSamples, visualizerHistory);
+  outputSilentSamples.store(visualizerSilence.getSilentSamples());
+  if (!flat) {
+    Tracing::Scope visualizerTrace("AudioVisualiserComponent::pushBuffer");
+    audioVisualizer.pushBuffer(bufferToFill);
   }
-  audioVisualizer.pushBuffer(bufferToFill);
 }
 
-//==============================================================================
-// Audio Utilities
-//==============================================================================
-
-double MainComponent::phasor() {
-  double p = phase;
-  phase = std::fmod(phase + phaseDelta, 1.0);
-  return p;
+bool MainComponent::renderSubBlock(AudioSampleBuffer& subBlock) {
+  // move the generators onto any wavetables rebuilt since the last sub-block
+  waveTables.update([this] (const AudioSampleBuffer& oldTable, const AudioSampleBuffer& newTable) {
+    compactTables.update(oldTable, newTable, [this] (const uint16* oldCopy, const uint16* newCopy) {
+      switcher.replaceCompactTable(oldCopy, newCopy);
+      for (auto chan = 0; chan < matrix.getNumChannels(); ++chan) {
+        matrix.getChannel(chan).switcher.replaceCompactTable(oldCopy, newCopy);
+      }
+    });
+    switcher.replaceTable(oldTable, newTable);
+    for (auto chan = 0; chan < matrix.getNumChannels(); ++chan) {
+      matrix.getChannel(chan).switcher.replaceTable(oldTable, newTable);
+    }
+  });
+  // a new table format switches every WT_* generator over to it
+  auto format = tableFormat.load();
+  if (format != activeTableFormat) {
+    if (isWaveTable(activeWaveform)) {
+      activeWaveform = Empty;
+    }
+    for (auto chan = 0; chan < matrix.getNumChannels(); ++chan) {
+      auto& channel = matrix.getChannel(chan);
+      if (isWaveTable((WaveformId) channel.activeWaveform)) {
+        channel.activeWaveform = Empty;
+      }
+    }
+    activeTableFormat = format;
+  }
+  auto source = grains.getSource();
+  grains.setSourceTable(waveTables.getTable(source), source != WaveTableBank::captureSource);
+  // while the output is muted the generators are paused rather than
+  // rendered and thrown away
+  auto targetLevel = level.load();
+  auto muted = targetLevel == 0.0f && currentLevel == 0.0f;
+  auto rendered = matrix.isEnabled() ? renderMatrix(subBlock, muted) : renderGenerator(subBlock, muted);
+  auto silent = !rendered || SilenceTracker::isSilent(subBlock);
+  auto numSamples = subBlock.getNumSamples();
+  // each stage is skipped once its input has been silent for longer than
+  // it rings on, and picks up where it stopped when the input returns
+  if (!convolutionSilence.push(silent, numSamples, convolution.getTailSamples())) {
+    Tracing::Scope trace("ConvolutionStage::process");
+    convolution.process(subBlock);
+    silent = silent && SilenceTracker::isSilent(subBlock);
+  }
+  // everything above renders at unity gain, ramp to the new level across
+  // the sub-block
+  if (silent || muted) {
+    if (!silent) {
+      subBlock.clear();
+    }
+    silent = true;
+  }
+  else {
+    subBlock.applyGainRamp(0, numSamples, currentLevel, targetLevel);
+  }
+  currentLevel = targetLevel;
+  if (!converting) {
+    silent = limitSubBlock(subBlock, silent);
+  }
+  capture.push(subBlock);
+  return silent;
 }
 
-float MainComponent::ranSamp() {
-    return random.nextFloat() * 2 - 1;
-
+bool MainComponent::limitSubBlock(AudioSampleBuffer& subBlock, bool silent) {
+  // nothing after the limiter may raise the level
+  if (limiterSilence.push(silent, subBlock.getNumSamples(), limiter.getTailSamples())) {
+    limiter.skip();
+    return silent;
+  }
+  Tracing::Scope trace("OutputLimiter::process");
+  limiter.process(subBlock);
+  return silent && SilenceTracker::isSilent(subBlock);
+}
+
+bool MainComponent::renderGenerator(AudioSampleBuffer& subBlock, bool muted) {
+  auto requested = (WaveformId) requestedWaveform.load();
+  if (requested != activeWaveform) {
+    auto* wavetable = isWaveTable(requested) ? &getWaveTable(requested) : nullptr;
+    auto format = (WaveTables::Format) activeTableFormat;
+    if (switcher.switchTo(getGenerator(requested, format), wavetable, getCompactTable(requested), getEngines(requested))) {
+      activeWaveform = requested;
+    }
+  }
+  if (muted || switcher.isSilent()) {
+    subBlock.clear();
+    return false;
+  }
+  // one generator fanned out to every channel
+  Tracing::Scope trace(getTraceName(activeWaveform));
+  switcher.render(AudioSourceChannelInfo(subBlock), 1.0f);
+  return true;
+}
+
+bool MainComponent::renderMatrix(AudioSampleBuffer& subBlock, bool muted) {
+  auto rendered = false;
+  for (auto chan = 0; chan < subBlock.getNumChannels(); ++chan) {
+    auto& channel = matrix.getChannel(chan);
+    auto requested = (WaveformId) channel.waveform.load();
+    if (!isMatrixWaveform(requested)) {
+      requested = Empty;
+    }
+    if (requested != channel.activeWaveform) {
+      auto* wavetable = isWaveTable(requested) ? &getWaveTable(requested) : nullptr;
+      auto format = (WaveTables::Format) activeTableFormat;
+      if (channel.switcher.switchTo(getGenerator(requested, format), wavetable, getCompactTable(requested),
+                                    getEngines(requested))) {
+        channel.activeWaveform = requested;
+      }
+    }
+    auto targetLevel = channel.level.load();
+    if (muted || channel.switcher.isSilent() || (targetLevel == 0.0f && channel.currentLevel == 0.0f)) {
+      subBlock.clear(chan, 0, subBlock.getNumSamples());
+      channel.currentLevel = targetLevel;
+      continue;
+    }
+    // a single channel view of the sub-block, the channel pointer is
+    // stored in the buffer itself so this doesn't allocate
+    auto* data = subBlock.getWritePointer(chan);
+    AudioSampleBuffer output(&data, 1, subBlock.getNumSamples());
+    Tracing::Scope trace(getTraceName((WaveformId) channel.activeWaveform));
+    channel.switcher.render(AudioSourceChannelInfo(output), 1.0f);
+    output.applyGainRamp(0, output.getNumSamples(), channel.currentLevel, targetLevel);
+    channel.currentLevel = targetLevel;
+    rendered = true;
+  }
+  return rendered;
 }
 
-float MainComponent::ranSamp(const float mul) {
-  return (ranSamp() * mul);
-}
+//==============================================================================
+// Generators
+//==============================================================================
 
-float MainComponent::lowPass(const float value, const float prevout, const float alpha) {
-  return (value - prevout) * alpha + prevout;
+const MainComponent::WaveformInfo& MainComponent::getWaveformInfo(WaveformId id) {
+  using Panel = WaveformPanel;
+  using Engine = WaveformEngine;
+  // One entry per WaveformId, in enum order. All WT_* waveforms share the
+  // wavetable kernel and differ only in the table passed to the switcher.
+  static const WaveformInfo waveforms[] = {
+    {nullptr, "Silence", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::WhiteNoise>, "White", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::BrownNoise>, "Brown", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::Dust>, "Dust", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::Sine>, "Sine", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::LF_Impulse>, "LF Impulse", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::LF_Square>, "LF Square", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::LF_Sawtooth>, "LF Saw", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::LF_Triangle>, "LF Triangle", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::BL_Impulse>, "BL Impulse", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::BL_Square>, "BL Square", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::BL_Sawtooth>, "BL Saw", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::BL_Triangle>, "BL Triangle", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::Wavetable>, "WT Sine", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::Wavetable>, "WT Impulse", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::Wavetable>, "WT Square", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::Wavetable>, "WT Saw", Panel::Harmonics, Engine::None, true},
+    {&Generators::render<Generators::Wavetable>, "WT Triangle", Panel::Harmonics, Engine::None, true},
+    {&GrainCloud::render, "Granular", Panel::Granular, Engine::Grains, false},
+    {&Generators::render<MeasurementSignals::Sweep<true>>, "Exp Sweep", Panel::Measurement, Engine::Signals, true},
+    {&Generators::render<MeasurementSignals::Sweep<false>>, "Lin Sweep", Panel::Measurement, Engine::Signals, true},
+    {&Generators::render<MeasurementSignals::MlsKernel>, "MLS", Panel::Measurement, Engine::Signals, true},
+    {&Generators::render<MeasurementSignals::MultitoneKernel>, "Multitone", Panel::Measurement, Engine::Signals, true},
+    {&StringBank::render<true>, "Plucked", Panel::Strings, Engine::Strings, false},
+    {&StringBank::render<false>, "Resonator", Panel::Strings, Engine::Strings, false},
+    {&PartialSynth::render, "Resynthesis", Panel::Partials, Engine::Partials, false},
+    {&ExpressionSynth::render, "Expression", Panel::Expression, Engine::Expression, true},
+    {&SampleStreamer::render, "Sample", Panel::Sample, Engine::Samples, false},
+    {&SpectralSynth::render<1, 0>, "FFT Impulse", Panel::Spectral, Engine::Spectral, false},
+    {&SpectralSynth::render<2, 1>, "FFT Square", Panel::Spectral, Engine::Spectral, false},
+    {&SpectralSynth::render<1, 1>, "FFT Saw", Panel::Spectral, Engine::Spectral, false},
+    {&SpectralSynth::render<2, 2>, "FFT Triangle", Panel::Spectral, Engine::Spectral, false}
+  };
+  static_assert(sizeof(waveforms) / sizeof(waveforms[0]) == FFT_TriangleWave + 1,
+                "waveform table must have one entry per WaveformId");
+  return waveforms[id];
+}
+
+GeneratorFunction MainComponent::getGenerator(WaveformId id, WaveTables::Format format) {
+  // the compact kernels decode their 16 bit tables as they read them
+  if (isWaveTable(id) && format == WaveTables::Float16) {
+    return &Generators::render<Generators::CompactWavetable<WaveTables::Float16>>;
+  }
+  if (isWaveTable(id) && format == WaveTables::Int16) {
+    return &Generators::render<Generators::CompactWavetable<WaveTables::Int16>>;
+  }
+  return getWaveformInfo(id).generator;
+}
+
+GeneratorEngines MainComponent::getEngines(WaveformId id) {
+  GeneratorEngines engines;
+  switch (getWaveformInfo(id).engine) {
+    case WaveformEngine::None:       break;
+    case WaveformEngine::Grains:     engines.grains = &grains; break;
+    case WaveformEngine::Signals:    engines.signals = &signals; break;
+    case WaveformEngine::Strings:    engines.strings = &strings; break;
+    case WaveformEngine::Partials:   engines.partials = &partials; break;
+    case WaveformEngine::Expression: engines.expression = &expression; break;
+    case WaveformEngine::Samples:    engines.samples = &samples; break;
+    case WaveformEngine::Spectral:   engines.spectral = &spectral; break;
+  }
+  return engines;
 }
 
+//==============================================================================
+// Audio Utilities
+//==============================================================================
+
 bool MainComponent::isPlaying() {
     if (audioSourcePlayer.getCurrentSource() == nullptr) {
         return false;
@@ -296,7 +754,7 @@ bool MainComponent::isPlaying() {
 }
 
 void MainComponent::openAudioSettings() {
-    adsComp = std::make_unique<AudioDeviceSelectorComponent>(deviceManager, 0, 2, 0, 2, false, false, false, false);
+    adsComp = std::make_unique<AudioDeviceSelectorComponent>(deviceManager, 0, 2, 0, ChannelMatrix::maxChannels, false, false, false, false);
     adsComp.get()->setSize(500, 270);
     new_options = std::make_unique<DialogWindow::LaunchOptions>();
     new_options->useNativeTitleBar = true;
@@ -308,376 +766,99 @@ void MainComponent::openAudioSettings() {
     new_options->launchAsync();
 }
 
-void MainComponent::createWaveTables() {
-  createSineTable(sineTable);
-  oscillators.push_back(std::make_unique<WavetableOscillator>(sineTable));
-  createImpulseTable(impulseTable);
-  oscillators.push_back(std::make_unique<WavetableOscillator>(impulseTable));
-  createSquareTable(squareTable);
-  oscillators.push_back(std::make_unique<WavetableOscillator>(squareTable));
-  createSawtoothTable(sawtoothTable);
-  oscillators.push_back(std::make_unique<WavetableOscillator>(sawtoothTable));
-  createTriangleTable(triangleTable);
-  oscillators.push_back(std::make_unique<WavetableOscillator>(triangleTable));
-}
-
-//==============================================================================
-// Noise
-//==============================================================================
-
-// White Noise
-
-void MainComponent::whiteNoise (const AudioSourceChannelInfo& bufferToFill) {
-    // loop over every channel in buffer to fill
-    for (auto chan = 0; chan < bufferToFill.buffer->getNumChannels(); ++chan) {
-        auto channelData = bufferToFill.buffer->getWritePointer(chan, bufferToFill.startSample);
-        for (auto i = 0; i < bufferToFill.numSamples; ++i) {
-            channelData[i] = ranSamp(level);
-        }
-    }
-}
-
-// Dust
-
-void MainComponent::dust (const AudioSourceChannelInfo& bufferToFill) {
-    for (auto chan = 0; chan < bufferToFill.buffer->getNumChannels(); ++chan) {
-        auto channelData = bufferToFill.buffer->getWritePointer(chan, bufferToFill.startSample);
-        for (auto i = 0; i < bufferToFill.numSamples; ++i) {
-            if (i % bufferToFill.numSamples == 0) {
-                channelData[i] = ranSamp(level);
-            }
-        }
-    }
-}
-
-// Brown Noise
-
-void MainComponent::brownNoise (const AudioSourceChannelInfo& bufferToFill) {
-    for (auto chan = 0; chan < bufferToFill.buffer->getNumChannels(); ++chan) {
-        auto channelData = bufferToFill.buffer->getWritePointer(chan, bufferToFill.startSample);
-        float brownNoise = 0.0;
-        for (auto i = 0; i < bufferToFill.numSamples; ++i) {
-            brownNoise = lowPass(ranSamp(), brownNoise, 0.025);
-            channelData[i] = 3.0 * level * brownNoise;
-        }
-    }
-}
-
-//==============================================================================
-// Sine Wave
-//==============================================================================
-
-void MainComponent::sineWave (const AudioSourceChannelInfo& bufferToFill) {
-    auto startingPhase = phase;
-    for (auto chan = 0; chan < bufferToFill.buffer->getNumChannels(); ++chan) {
-        // set the phase for each channel to  startingPhase
-        phase = startingPhase;
-        // get the pointer to the first sample in the buffer
-        auto channelData = bufferToFill.buffer->getWritePointer(chan, bufferToFill.startSample);
-        // iterate samples
-        for (auto i = 0; i < bufferToFill.numSamples; ++i) {
-            // calculate the next sample for the current phase
-            channelData[i] = level * std::sin(phase * TwoPi);
-            // increment phase for the next dample
-            phase += phaseDelta;
-        }
-    }
-}
-
-//==============================================================================
-// Low Frequency Waveforms
-//==============================================================================
-
-/// Impulse wave
-
-void MainComponent::LF_impulseWave (const AudioSourceChannelInfo& bufferToFill) {
-    auto startingPhase = phase;
-    for (auto chan = 0; chan < bufferToFill.buffer->getNumChannels(); ++chan) {
-        phase = startingPhase;
-        double lastPhasor = 0.0;
-        auto channelData = bufferToFill.buffer->getWritePointer(chan, bufferToFill.startSample);
-        for (auto i = 0; i < bufferToFill.numSamples; ++i) {
-            double phasorValue = phasor();
-            if (lastPhasor - phasorValue > 0.9) {
-                channelData[i] = level * (phasorValue * -2 + 1);
-            }
-            lastPhasor = phasorValue;
-        }
-    }
-}
-
-/// Square wave
-
-void MainComponent::LF_squareWave (const AudioSourceChannelInfo& bufferToFill) {
-    auto startingPhase = phase;
-    for (auto chan = 0; chan < bufferToFill.buffer->getNumChannels(); ++chan) {
-        phase = startingPhase;
-        auto channelData = bufferToFill.buffer->getWritePointer(chan, bufferToFill.startSample);
-        for (auto i = 0; i < bufferToFill.numSamples; ++i) {
-            if (level * (phasor() * 2 - 1) > 0) {
-                channelData[i] = level * 1.0;
-            }
-            else {
-                channelData[i] = level * -1.0;
-            }
-            
-        }
+void MainComponent::openChannelMatrix() {
+    auto channels = numOutputs;
+    if (auto* device = deviceManager.getCurrentAudioDevice()) {
+        channels = device->getActiveOutputChannels().countNumberOfSetBits();
     }
-}
-
-/// Sawtooth wave
-
-void MainComponent::LF_sawtoothWave (const AudioSourceChannelInfo& bufferToFill) {
-    auto startingPhase = phase;
-    for (auto chan = 0; chan < bufferToFill.buffer->getNumChannels(); ++chan) {
-        phase = startingPhase;
-        auto channelData = bufferToFill.buffer->getWritePointer(chan, bufferToFill.startSample);
-        for (auto i = 0; i < bufferToFill.numSamples; ++i) {
-            channelData[i] = level * (phasor() * 2 - 1);
+    DialogWindow::LaunchOptions options;
+    options.content.setOwned(new ChannelMatrixView(matrix, channels, getMatrixWaveforms()));
+    options.dialogTitle = "Channel Matrix";
+    options.dialogBackgroundColour = getLookAndFeel().findColour(ResizableWindow::backgroundColourId);
+    options.useNativeTitleBar = true;
+    options.resizable = true;
+    options.launchAsync();
+}
+
+PopupMenu MainComponent::getMatrixWaveforms() {
+    PopupMenu menu;
+    auto separator = false;
+    for (PopupMenu::MenuItemIterator items(*waveformMenu.getRootMenu()); items.next();) {
+        auto& item = items.getItem();
+        if (item.isSeparator) {
+            separator = true;
         }
-    }
-}
-
-/// Triangle wave
-
-void MainComponent::LF_triangleWave (const AudioSourceChannelInfo& bufferToFill) {
-    auto startingPhase = phase;
-    for (auto chan = 0; chan < bufferToFill.buffer->getNumChannels(); ++chan) {
-        phase = startingPhase;
-        auto channelData = bufferToFill.buffer->getWritePointer(chan, bufferToFill.startSample);
-        for (auto i = 0; i < bufferToFill.numSamples; ++i) {
-            double phasorValue = phasor();
-            if (phasorValue <= 0.5) { // first half
-                // phasor goes from 0.0 to 0.5
-                // need -1 to 1
-                channelData[i] = level * (phasorValue * 4 - 1);
-            }
-            else { // second half
-                // 0.5 to 1.0
-                channelData[i] = level * (phasorValue * 4 - 3) * -1;
+        else if (isMatrixWaveform((WaveformId) item.itemID)) {
+            if (separator) {
+                menu.addSeparator();
             }
+            menu.addItem(item.itemID, item.text);
+            separator = false;
         }
     }
-
+    return menu;
 }
 
-//==============================================================================
-// Band Limited Waveforms
-//==============================================================================
-
-/// Impulse (pulse) wave
-
-/// Synthesized by summing sin() over frequency and all its harmonics at equal
-/// amplitude. To make it band limited only include harmonics that are at or
-/// below the nyquist limit.
-void MainComponent::BL_impulseWave (const AudioSourceChannelInfo& bufferToFill) {
-    auto channelData = bufferToFill.buffer->getWritePointer(0, bufferToFill.startSample);
-    double numHarmonics = srate / 2 / freq;
-    double nyquist = srate / 2;
-
-    for (auto i = 0; i < bufferToFill.numSamples; ++i) {
-        // amplitude = level / numHarmonics
-        auto freqLevel = level / numHarmonics;
-        auto phasorValue = phasor();
-        for (auto h = 1; h < numHarmonics; h++) {
-            auto newFreq = phasorValue * TwoPi * h;
-            if (newFreq < nyquist) {
-                channelData[i] += sin(phasorValue * TwoPi * h) * freqLevel;
-            }
+void MainComponent::toggleRecording() {
+    if (recorder.isRecording()) {
+        recorder.stop();
+        if (auto dropped = recorder.getDroppedSamples()) {
+            Logger::writeToLog("Recording overran, " + juce::String(dropped) + " samples were lost.");
         }
+        recordButton.setButtonText("Record...");
+        return;
     }
-
-    memcpy(bufferToFill.buffer->getWritePointer(1, bufferToFill.startSample), bufferToFill.buffer->getWritePointer(0, bufferToFill.startSample), sizeof(float)  * bufferToFill.numSamples);
-}
-
-/// Square wave
-
-/// Synthesized by summing sin() over all ODD harmonics at 1/harmonic amplitude.
-/// To make it band limited only include harmonics that are at or below the
-/// nyquist limit.
-void MainComponent::BL_squareWave (const AudioSourceChannelInfo& bufferToFill) {
-    auto channelData = bufferToFill.buffer->getWritePointer(0, bufferToFill.startSample);
-    double numHarmonics = srate / 2 / freq;
-    double nyquist = srate / 2;
-
-    for (auto i = 0; i < bufferToFill.numSamples; ++i) {
-        // amplitude = level / numHarmonics
-        auto freqLevel = level;
-        auto phasorValue = phasor();
-        for (auto h = 1; h < numHarmonics; h++) {
-            auto newFreq = phasorValue * TwoPi * h;
-            if (h % 2 == 1) {
-                channelData[i] += sin(phasorValue * TwoPi * (h)) * freqLevel * ((float)1/h);
-            }
-        }
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device == nullptr || !isPlaying()) {
+        AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Record",
+                                         "Start playback before recording.");
+        return;
     }
-
-    memcpy(bufferToFill.buffer->getWritePointer(1, bufferToFill.startSample), bufferToFill.buffer->getWritePointer(0, bufferToFill.startSample), sizeof(float) * bufferToFill.numSamples);
-
-}
-
-/// Sawtooth wave
-///
-/// Synthesized by summing sin() over all harmonics at 1/harmonic amplitude. To make
-/// it band limited only include harmonics that are at or below the nyquist limit.
-void MainComponent::BL_sawtoothWave (const AudioSourceChannelInfo& bufferToFill) {
-    auto channelData = bufferToFill.buffer->getWritePointer(0, bufferToFill.startSample);
-    double numHarmonics = srate / 2 / freq;
-    double nyquist = srate / 2;
-
-    for (auto i = 0; i < bufferToFill.numSamples; ++i) {
-        // amplitude = level / numHarmonics
-        auto freqLevel = level;
-        auto phasorValue = phasor();
-        for (auto h = 1; h < numHarmonics; h++) {
-            auto newFreq = phasorValue * TwoPi * h;
-            if (newFreq < nyquist) {
-                auto newData = sin(phasorValue * TwoPi * h) * freqLevel / h;
-                channelData[i] += newData;
-            }
+    auto numChannels = device->getActiveOutputChannels().countNumberOfSetBits();
+    fileChooser = std::make_unique<FileChooser>("Record output to...",
+        File::getSpecialLocation(File::userMusicDirectory).getChildFile("WaveLab.wav"),
+        "*.wav;*.w64;*.flac");
+    auto flags = FileChooser::saveMode | FileChooser::canSelectFiles | FileChooser::warnAboutOverwriting;
+    fileChooser->launchAsync(flags, [this, numChannels] (const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file == File()) {
+            return;
         }
-    }
-
-    memcpy(bufferToFill.buffer->getWritePointer(1, bufferToFill.startSample), bufferToFill.buffer->getWritePointer(0, bufferToFill.startSample), sizeof(float) * bufferToFill.numSamples);
-
-}
-
-/// Triangle wave
-///
-/// Synthesized by summing sin() over all ODD harmonics at 1/harmonic**2 amplitude.
-/// To make it band limited only include harmonics that are at or below the
-/// Nyquist limit.
-void MainComponent::BL_triangleWave (const AudioSourceChannelInfo& bufferToFill) {
-    auto channelData = bufferToFill.buffer->getWritePointer(0, bufferToFill.startSample);
-    double numHarmonics = srate / 2 / freq;
-    double nyquist = srate / 2;
-
-    for (auto i = 0; i < bufferToFill.numSamples; ++i) {
-        // amplitude = level / numHarmonics
-        auto freqLevel = level;
-        auto phasorValue = phasor();
-        for (auto h = 1; h < numHarmonics; h++) {
-            auto newFreq = phasorValue * TwoPi * h;
-            if (newFreq < nyquist && h % 2 == 1) {
-                channelData[i] += sin(phasorValue * TwoPi * (h)) * freqLevel * ((float)1 / (h*h));
-            }
+        auto error = recorder.start(file, deviceRate, numChannels);
+        if (error.isNotEmpty()) {
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Record", error);
+            return;
         }
-    }
-
-    memcpy(bufferToFill.buffer->getWritePointer(1, bufferToFill.startSample), bufferToFill.buffer->getWritePointer(0, bufferToFill.startSample), sizeof(float) * bufferToFill.numSamples);
-
-}
-
-//==============================================================================
-// WaveTable Synthesis
-//==============================================================================
-
-// The audio block loop
-void inline MainComponent::WT_wave(const AudioSourceChannelInfo& bufferToFill) {
-    auto* leftBuffer = bufferToFill.buffer->getWritePointer(0, bufferToFill.startSample);
-    auto* rightBuffer = bufferToFill.buffer->getWritePointer(1, bufferToFill.startSample);
-    bufferToFill.clearActiveBufferRegion();
-    auto oscillatorIndex = waveformId - WT_START;
-    auto* oscil = oscillators[oscillatorIndex].get();
-    // add each oscillator's samples ot the output buffer
-    for (auto sample = 0; sample < bufferToFill.numSamples; ++sample) {
-        auto levelSample = oscil->getNextSample() * level;
-        leftBuffer[sample] += levelSample;
-        rightBuffer[sample] += levelSample;
-    }
-}
-
-// Create a sine wave table
-void MainComponent::createSineTable(AudioSampleBuffer& waveTable) {
-    waveTable.setSize (1, tableSize + 1);
-    waveTable.clear();
-    auto* samples = waveTable.getWritePointer (0);
-    auto phase = 0.0;
-    auto phaseDelta = MathConstants<double>::twoPi / (double) (tableSize - 1);
-    for (auto i = 0; i < tableSize; ++i) {
-        samples[i] += std::sin(phase);
-        phase += phaseDelta;
-    }
-    samples[tableSize] = samples[0];
+        recordButton.setButtonText("Stop");
+    });
 }
 
-// Create an inpulse wave table
-void MainComponent::createImpulseTable(AudioSampleBuffer& waveTable) {
-    waveTable.setSize(1, tableSize + 1);
-    waveTable.clear();
-    auto* samples = waveTable.getWritePointer(0);
-    auto phase = 0.0;
-    auto phaseDelta = MathConstants<double>::twoPi / (double)(tableSize - 1);
-
-    double numHarmonics = 15;
-
-    for (auto i = 0; i < tableSize; ++i) {
-        for (auto h = 1; h < numHarmonics; h++) {
-            samples[i] += std::sin(phase * h) / numHarmonics;
-        }
-        phase += phaseDelta;
-    }
-    samples[tableSize] = samples[0];
-
+size_t MainComponent::getArenaBytes() {
+  // generators only ever render one sub-block at a time
+  return GeneratorSwitcher::getArenaBytes(SubBlockScheduler::subBlockSize)
+    + GrainCloud::getArenaBytes()
+    + StringBank::getArenaBytes(srate)
+    + PartialSynth::getArenaBytes()
+    + ExpressionSynth::getArenaBytes()
+    + SpectralSynth::getArenaBytes()
+    + CompactTables::getArenaBytes()
+    + ChannelMatrix::getArenaBytes(numOutputs)
+    + SubBlockScheduler::getArenaBytes(numOutputs);
 }
 
-// Create a square wave table
-void MainComponent::createSquareTable(AudioSampleBuffer& waveTable) {
-    waveTable.setSize(1, tableSize + 1);
-    waveTable.clear();
-    auto* samples = waveTable.getWritePointer(0);
-    auto phase = 0.0;
-    auto phaseDelta = MathConstants<double>::twoPi / (double)(tableSize - 1);
-
-    double numHarmonics = 15;
-
-    for (auto i = 0; i < tableSize; ++i) {
-        for (auto h = 1; h < numHarmonics; h++) {
-            if (h % 2 == 1) {
-                samples[i] += std::sin(phase * h) / numHarmonics / h;
-            }
-        }
-        phase += phaseDelta;
-    }
-    samples[tableSize] = samples[0];
+size_t MainComponent::getDeviceArenaBytes() {
+  return OutputLimiter::getArenaBytes(numOutputs, deviceRate)
+    + (converting ? RateConverter::getArenaBytes(numOutputs, srate, deviceRate)
+                    + SubBlockScheduler::getArenaBytes(numOutputs) : 0);
 }
 
-// Create a sawtooth wave table
-void MainComponent::createSawtoothTable(AudioSampleBuffer& waveTable) {
-    waveTable.setSize(1, tableSize + 1);
-    waveTable.clear();
-    auto* samples = waveTable.getWritePointer(0);
-    auto phase = 0.0;
-    auto phaseDelta = MathConstants<double>::twoPi / (double)(tableSize - 1);
-
-    double numHarmonics = 15;
-
-    for (auto i = 0; i < tableSize; ++i) {
-        for (auto h = 1; h < numHarmonics; h++) {
-            samples[i] += std::sin(phase * h) / numHarmonics / h;
-        }
-        phase += phaseDelta;
-    }
-    samples[tableSize] = samples[0];
+const AudioSampleBuffer& MainComponent::getWaveTable(WaveformId id) {
+  return waveTables.getTable((WaveTables::Shape)(id - WT_START));
 }
 
-// Create a triangle wave table
-void MainComponent::createTriangleTable(AudioSampleBuffer& waveTable) {
-    waveTable.setSize(1, tableSize + 1);
-    waveTable.clear();
-    auto* samples = waveTable.getWritePointer(0);
-    auto phase = 0.0;
-    auto phaseDelta = MathConstants<double>::twoPi / (double)(tableSize - 1);
-
-    double numHarmonics = 15;
-
-    for (auto i = 0; i < tableSize; ++i) {
-        for (auto h = 1; h < numHarmonics; h++) {
-            if (h % 2 == 1) {
-                samples[i] += std::sin(phase * h) / numHarmonics / (h * h);
-            }
-        }
-        phase += phaseDelta;
-    }
-    samples[tableSize] = samples[0];
+const uint16* MainComponent::getCompactTable(WaveformId id) {
+  if (!isWaveTable(id) || activeTableFormat == WaveTables::Float32) {
+    return nullptr;
+  }
+  return compactTables.getTable((WaveTables::Shape)(id - WT_START), (WaveTables::Format) activeTableFormat);
 }
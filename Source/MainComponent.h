@@ -5,7 +5,26 @@
 
 #pragma once
 
-#include "WavetableOscillator.h"
+#include "GeneratorSwitcher.h"
+#include "SubBlockScheduler.h"
+#include "DiskRecorder.h"
+#include "HarmonicEditor.h"
+#include "CompactTables.h"
+#include "GranularPanel.h"
+#include "MeasurementPanel.h"
+#include "StringPanel.h"
+#include "PartialPanel.h"
+#include "ExpressionPanel.h"
+#include "SamplePanel.h"
+#include "SpectralPanel.h"
+#include "ConvolutionPanel.h"
+#include "LimiterPanel.h"
+#include "RenderRatePanel.h"
+#include "OutputCapture.h"
+#include "ChannelMatrixView.h"
+#include "LevelMeterView.h"
+#include "Tracing.h"
+#include "SilenceTracker.h"
 
 /// MainComponent provides the app's user controls and content. NOTE: this
 /// must inherit from three listener classes to respond to user interactions
@@ -28,6 +47,19 @@ public Slider::Listener, public Button::Listener, public ComboBox::Listener, pub
   /// and starts with BL_ImpulseWave.
   /// - The fifth section contains "WT Sine", "WT Impulse", "WT Square", "WT Saw", "WT Triangle"
   ///  and starts with WT_SineWave.
+  /// - The sixth section contains just the string "Granular" with the id Granular.
+  /// - The seventh section contains "Exp Sweep", "Lin Sweep", "MLS", "Multitone"
+  ///  and starts with ExpSweepWave.
+  /// - The eighth section contains "Plucked" and "Resonator" and starts with
+  ///  PluckedWave.
+  /// - The ninth section contains just the string "Resynthesis" with the id
+  ///  ResynthesisWave.
+  /// - The tenth section contains just the string "Expression" with the id
+  ///  ExpressionWave.
+  /// - The eleventh section contains just the string "Sample" with the id
+  ///  SampleWave.
+  /// - The twelfth section contains "FFT Impulse", "FFT Square", "FFT Saw",
+  ///  "FFT Triangle" and starts with FFT_ImpulseWave.
   /// *  Add the level slider to MainComponent with proper text box style
   /// and range (0.0-1.0).
   /// * Both slider textboxes should be initilized to Slider::TextBoxLeft with a width of
@@ -61,6 +93,11 @@ public Slider::Listener, public Button::Listener, public ComboBox::Listener, pub
   /// * Unless otherwise stated the height of all components is 24 pixels.
   /// * All subcomponents except the CPU display line are inset from
   ///   MainComponent's top, left and right by 8 pixels
+  /// * The harmonic editor is 80 pixels high and sits 8 pixels below the
+  ///   buttons and menu. The granular, measurement, string and resynthesis
+  ///   panels share its place.
+  /// * The convolution controls sit 8 pixels below the harmonic editor, and
+  ///   the limiter controls 8 pixels below them.
   /// * The visualizer is inset from the bottom by 24 pixels.
   /// * The width of the Audio Settings button and the Waveforms menu is 118 pixels.
   /// * There is an 8 pixel offset between the buttons and the transport button.
@@ -71,6 +108,8 @@ public Slider::Listener, public Button::Listener, public ComboBox::Listener, pub
   /// * The width of the cpu usage display is 66 pixels, its Y is 24 pixels from the bottom
   ///   and it is idented from the right by 8 pixels.
   /// * The cpu label is 36 pixels width and abuts the left side of the usage display.
+  /// * The level meter takes the rest of the cpu display line, left of the
+  ///   DSP memory display.
   /// Look at Wave Lab.app image in the documentation to check your layout:
   /// http://cmp.music.illinois.edu/courses/taube/mus205/Projects/Wave%20Lab/WaveLabOutlines.png
 
@@ -80,7 +119,9 @@ public Slider::Listener, public Button::Listener, public ComboBox::Listener, pub
   // Listener overrides
 
   /// MainComponent's button callback. If the button is the settingsButton the
-  /// then openAudioSettings() should be called. Otherwise the playButton was
+  /// then openAudioSettings() should be called. If it is the recordButton
+  /// then toggleRecording() should be called, and if it is the matrixButton
+  /// openChannelMatrix() should be called. Otherwise the playButton was
   /// pressed and the following action should be taken:
   /// * If the mainComponent is playing then playback should stop by
   /// setting the source to nullptr and the playButton should be redrawn showing
@@ -92,16 +133,21 @@ public Slider::Listener, public Button::Listener, public ComboBox::Listener, pub
 
   /// MainComponent's slider callback. If slider is levelSlider the function
   /// should update the 'level' variable with the current slider
-  /// value.  If slider is freqSlider it should update the 'freq' and
-  /// 'phaseDelta' variables.
+  /// value.  If slider is freqSlider it should update 'freq' and the
+  /// generator state's frequency.
   void sliderValueChanged (Slider *slider) override;
 
   /// MainComponent's comboBoxChanged callback. The function should set
-  /// the waveformId member with the selected waveform id. If the id
+  /// the waveformId member with the selected waveform id and request that
+  /// the audio thread crossfade to it (see requestedWaveform). If the id
   /// is Empty then the playButton should be disabled otherwise the
   /// playButton should be enabled. If the id is WhiteNoise or BrownNoise
   /// then the frequency label and slider should be disabled otherwise
-  /// they should be enabled.
+  /// they should be enabled. The harmonic editor is enabled and shows the
+  /// selected table's spectrum only for WT_* waveforms. For the Granular
+  /// waveform the granular panel replaces the harmonic editor, for the
+  /// measurement waveforms the measurement panel does and for the Plucked
+  /// and Resonator waveforms the string panel does.
   void comboBoxChanged (ComboBox *menu) override;
   
   //==============================================================================
@@ -109,7 +155,23 @@ public Slider::Listener, public Button::Listener, public ComboBox::Listener, pub
   /// The timer callback shuld get the AudioDeviceManager's cpu usage, convert
   /// it to percentage, and set the cpuUsage label to that value rounded
   /// to two digits (see String(int)) with the string " %" appended to it.
+  /// While recording it shows the recorded time and any dropped samples on
+  /// the recordButton.
+  /// It also shows the DSP arena size in the memoryUsage label, updates the
+  /// level meter and reports any real-time violations the audio thread made
+  /// (see RealtimeChecks.h).
+  /// Each callback is traced (see Tracing.h).
+  /// Finished output captures are passed on to the wavetable bank, and the
+  /// granular and measurement panels' status is updated.
+  /// Finally it switches idle mode on or off (see updateIdle()).
   void timerCallback() override;
+
+  /// Enters idle mode when audio is stopped, or when the output has been
+  /// silent long enough for the visualizer to show a flat line and nothing
+  /// is being recorded. While idle the timer runs at idleTimerInterval and
+  /// the visualizer doesn't repaint. Leaves idle mode as soon as neither is
+  /// true.
+  void updateIdle();
   
   //==============================================================================
   // AudioSource overrides
@@ -117,20 +179,32 @@ public Slider::Listener, public Button::Listener, public ComboBox::Listener, pub
   /// This function will be called (on the audio thread, not the GUI
   /// thread) when the audio device is started, or when its settings
   /// (i.e. sample rate, block size, etc) are changed.
-  /// It should set the srate to the current sampling rate. set phase to 0, and
-  /// set phaseDelta to the phase increment for the current frequency
-  /// and srate. The visualizer's buffer size should be set to samplesPerBlockExpected
+  /// It should set the srate to the render rate, the device's sampling rate
+  /// or the fixed rate chosen in the render rate panel, size the DSP arena
+  /// and create the generator state in it, bind the current wavetables and
+  /// start building the multitone for the render rate. A fixed render rate
+  /// is converted to the device rate by the rate converter, and everything
+  /// but the converter, the limiter, the meter and the recorder is prepared
+  /// at the fixed rate, so the rendered sound doesn't depend on the device
+  /// rate. Those render stages are then kept across a device change, and
+  /// only the device stages are prepared again for the new device.
+  /// The visualizer's buffer size should be set to samplesPerBlockExpected
   /// and it should take 8 samples per block.
   void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override ;
   
   /// Your audio-processing code goes in this function.  This function
-  /// will simply call one of the private inline waveform functions
-  /// (e.g whiteNoise(), sineWave(), etc.)  according to what
-  /// WaveFormId the user has selected.
+  /// fills the buffer from the sub-block scheduler, which calls
+  /// renderSubBlock() every SubBlockScheduler::subBlockSize samples, and
+  /// meters the result. At a fixed render rate the rate converter pulls
+  /// from the scheduler instead, and outputScheduler feeds the converted
+  /// output to the limiter in sub-blocks at the device rate. Each callback
+  /// is traced, into the ring prepareToPlay() reserved for the audio thread.
   void getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill) override ;
   
   /// This will be called when the audio device stops, or when it is
-  /// being restarted due to a setting change.
+  /// being restarted due to a setting change. It frees the device stages
+  /// and their arena. At the device rate it also frees the render stages,
+  /// which at a fixed render rate stay prepared until playback stops.
   void releaseResources() override ;
   
   //==============================================================================
@@ -151,7 +225,12 @@ public Slider::Listener, public Button::Listener, public ComboBox::Listener, pub
   ///    - its background color is black,
   /// * use launchOptions.content.setOwned() to assign the component
   /// * call launchOptions.launchAsync() to open the dialog.
+  /// The selector offers up to ChannelMatrix::maxChannels outputs.
   void openAudioSettings();
+
+  /// Opens the channel matrix, where each output channel gets its own
+  /// waveform, frequency and level in multichannel mode.
+  void openChannelMatrix();
   
   /// Draws the play button. Since the image will be scaled by the button use
   /// percentage coordinates (0-100) for x and y. If drawPlay is true the button
@@ -163,10 +242,13 @@ public Slider::Listener, public Button::Listener, public ComboBox::Listener, pub
   /// draw first bar at x=0  and second bar at 100-width.
   void drawPlayButton(juce::DrawableButton& b, bool drawPlay) ;
 
-  /// Called at startup to create the wavetables.
-  void createWaveTables();
+  /// Stops a recording in progress, or asks for a .wav, .w64 or .flac file
+  /// and starts recording the output stream to it.
+  void toggleRecording();
 
 private:
+  /// Drives the controls headless (see SoakTest.h).
+  friend class SoakTest;
 
   /// Enumeration identifying all the different waveforms the app
   /// generates. The Empty value indicate that no waveform has
@@ -178,7 +260,15 @@ private:
     BL_ImpulseWave, BL_SquareWave, BL_SawtoothWave, BL_TriangeWave,
     WT_SineWave,
     WT_ImpulseWave, WT_SquareWave, WT_SawtoothWave, WT_TriangleWave,
-    WT_START = WT_SineWave
+    Granular,
+    ExpSweepWave, LinSweepWave, MlsWave, MultitoneWave,
+    PluckedWave, ResonatorWave,
+    ResynthesisWave,
+    ExpressionWave,
+    SampleWave,
+    FFT_ImpulseWave, FFT_SquareWave, FFT_SawtoothWave, FFT_TriangleWave,
+    WT_START = WT_SineWave,
+    MEASUREMENT_START = ExpSweepWave
   };
 
   std::unique_ptr<AudioDeviceSelectorComponent> adsComp;
@@ -186,7 +276,7 @@ private:
 
   /// A variable holding the currently selected waveform to generate
   /// (see the WaveformId enum).  Its initial value should be Empty.
-  WaveformId waveformId;
+  WaveformId waveformId {Empty};
 
   /// A Random object for generating random numbers.
   Random random;
@@ -200,8 +290,17 @@ private:
   /// must be passed to the player using player.addSource().
   AudioSourcePlayer audioSourcePlayer;
 
-  /// A specialized JUCE component that displays a wave form.
-  AudioVisualiserComponent audioVisualizer;
+  /// A specialized JUCE component that displays a wave form. Its repaints
+  /// are traced (see Tracing.h).
+  struct TracedVisualizer : public AudioVisualiserComponent
+  {
+    using AudioVisualiserComponent::AudioVisualiserComponent;
+    void paint (Graphics& g) override {
+      Tracing::Scope trace ("AudioVisualiserComponent::paint");
+      AudioVisualiserComponent::paint (g);
+    }
+  };
+  TracedVisualizer audioVisualizer;
   
   /// A button that opens the audio preferences window. Initialize
   /// the button to show "Audio Settings...".
@@ -214,6 +313,18 @@ private:
   /// which is two vertical stripes.
   DrawableButton playButton {"", juce::DrawableButton::ImageOnButtonBackground};
 
+  /// A button that starts and stops recording the output to disk.
+  TextButton recordButton {"Record..."};
+
+  /// A button that opens the channel matrix.
+  TextButton matrixButton {"Matrix..."};
+
+  /// Writes the output stream to disk while recording.
+  DiskRecorder recorder;
+
+  /// The file dialog opened by toggleRecording().
+  std::unique_ptr<FileChooser> fileChooser;
+
   /// A label that displays the text "Level:"
   Label levelLabel {"", "Level:"};
 
@@ -245,100 +356,313 @@ private:
   /// A label that is updated by a timer to show the current cpu usage.
   Label cpuUsage {"", ""};
 
-  /// The current audio sample rate. Its initial value 0.0
-  /// must be updated by prepareToPlay().
+  /// A label that is updated by a timer to show the DSP arena size.
+  Label memoryUsage {"", ""};
+
+  /// Measures the peak, true peak, RMS and loudness of the output.
+  LevelMeter meter;
+
+  /// Draws the output levels next to the cpu usage.
+  LevelMeterView meterView {meter};
+
+  /// The rate everything up to the rate converter renders at. Its initial
+  /// value 0.0 must be updated by prepareToPlay().
   double srate { 0.0 };
 
+  /// The device's sample rate, set by prepareToPlay(). The meter, recorder
+  /// and visualizer run at this rate.
+  double deviceRate { 0.0 };
+
   /// The current audio amplitude level. Its initial value 0.0
-  /// must updated by the levelSlider.
-  double level{ 0.0 };
+  /// must updated by the levelSlider. The audio thread reads it once per
+  /// sub-block.
+  std::atomic<float> level{ 0.0f };
+
+  /// The level the last sub-block ended at. Each sub-block ramps from it to
+  /// the current level. Only accessed on the audio thread.
+  float currentLevel{ 0.0f };
 
   /// The current audio frequency. Its initial value 0.0 must be updated
   /// by the freqSlider.
   double freq{ 0.0 };
 
-  /// The current phase position of the waveform. Its initial value
-  /// 0.0 must be updated by the freqSlider.
-  double phase{ 0.0 };
+  /// The waveform the audio thread should switch to. comboBoxChanged()
+  /// stores the menu selection here and getNextAudioBlock() picks it up.
+  std::atomic<int> requestedWaveform {Empty};
+
+  /// The waveform the audio thread is rendering (or fading to). Only
+  /// accessed on the audio thread.
+  WaveformId activeWaveform {Empty};
+
+  /// Renders the active generator and crossfades waveform changes.
+  GeneratorSwitcher switcher;
+
+  /// Number of samples a waveform change is crossfaded over.
+  int fadeLength {512};
+
+  /// Slices each callback into fixed size sub-blocks.
+  SubBlockScheduler scheduler;
+
+  /// False until the first callback after prepareToPlay() has adopted the
+  /// trace ring reserved for it (see Tracing::adoptThread()). Reset by
+  /// prepareToPlay() while the device is stopped.
+  bool audioThreadTraced {false};
+
+  /// Renders one sub-block with a channel per output. Waveform, frequency
+  /// and level changes are applied here, at sub-block boundaries. The
+  /// generators are followed by the convolution, the level ramp and, at
+  /// the device rate, the limiter. Each generator and stage is traced.
+  /// Returns true if the sub-block is silent. A stage is skipped once its
+  /// input has been silent for longer than its tail.
+  bool renderSubBlock(AudioSampleBuffer& subBlock);
+
+  /// Runs the limiter over a sub-block at the device rate, or skips it once
+  /// its input has been silent for longer than its tail. Takes and returns
+  /// whether the sub-block is silent.
+  bool limitSubBlock(AudioSampleBuffer& subBlock, bool silent);
+
+  /// Renders the sub-block from the switcher, fanned out to every channel.
+  /// When muted, or when the Empty waveform is playing, the generator is
+  /// paused and the sub-block cleared. Returns false if it was.
+  bool renderGenerator(AudioSampleBuffer& subBlock, bool muted);
+
+  /// Renders each sub-block channel from its own channel matrix switcher.
+  /// Channels that are muted, or play the Empty waveform, are paused and
+  /// cleared. Returns false if every channel was.
+  bool renderMatrix(AudioSampleBuffer& subBlock, bool muted);
+
+  /// How long the input of the convolution and of the limiter has been
+  /// silent. Only accessed on the audio thread.
+  SilenceTracker convolutionSilence;
+  SilenceTracker limiterSilence;
+
+  /// How long the output has been silent. The visualizer isn't fed more
+  /// zeros once its whole history, visualizerHistory samples, is zeros.
+  SilenceTracker visualizerSilence;
+  int visualizerHistory {0};
+
+  /// The number of samples the output has been silent for, published to
+  /// the GUI for updateIdle().
+  std::atomic<int64> outputSilentSamples {0};
+
+  /// True while the GUI is in idle mode. Only accessed on the message
+  /// thread.
+  bool idle {false};
+
+  /// The timer interval in milliseconds and the visualizer repaint rate
+  /// in Hz outside idle mode, and the timer interval inside it.
+  static constexpr int activeTimerInterval = 100;
+  static constexpr int activeRepaintRate = 60;
+  static constexpr int idleTimerInterval = 500;
+
+  /// The per-channel generators of multichannel mode.
+  ChannelMatrix matrix;
+
+  /// The number of output channels, set by prepareToPlay().
+  int numOutputs {1};
+
+  /// Returns the waveform menu without the items the channel matrix can't
+  /// play (see WaveformInfo::matrix).
+  PopupMenu getMatrixWaveforms();
+
+  /// Returns true for the waveforms the channel matrix can play.
+  static bool isMatrixWaveform(WaveformId id) { return getWaveformInfo(id).matrix; }
+
+  /// Holds the generator slots and scratch buffers in one
+  /// contiguous, cache aligned region. It is sized by
+  /// prepareRenderStages() and freed by releaseRenderStages(), nothing is
+  /// allocated in between.
+  DspArena arena;
+  /// Holds the state of the device rate stages: the limiter, the rate
+  /// converter and the output scheduler. It is sized by prepareToPlay()
+  /// and freed by releaseResources().
+  DspArena deviceArena;
+
+  /// The size of both arenas in bytes, published to the GUI by
+  /// prepareToPlay().
+  std::atomic<size_t> dspMemory {0};
+
+  /// Returns the arena size needed by the render stages.
+  size_t getArenaBytes();
+  /// Returns the arena size needed by the device stages.
+  size_t getDeviceArenaBytes();
+
+  /// Prepares everything that renders at srate, in the arena, and binds
+  /// the current wavetables.
+  void prepareRenderStages();
+  /// Frees the render stages and the arena, if prepared, and detaches the
+  /// audio thread from the wavetables. Called by releaseResources() at the
+  /// device rate, and after playback stops.
+  void releaseRenderStages();
+  /// True between prepareRenderStages() and releaseRenderStages().
+  bool renderPrepared {false};
+
+  /// The panel that edits a waveform, shown under the waveform menu.
+  enum class WaveformPanel { Harmonics, Granular, Measurement, Strings, Partials, Expression, Sample, Spectral };
+  /// The engine a waveform's generator renders from (see GeneratorEngines).
+  enum class WaveformEngine { None, Grains, Signals, Strings, Partials, Expression, Samples, Spectral };
+
+  /// Describes a waveform id: its block renderer, the name it is traced
+  /// under (the menu's name), the panel that edits it, the engine it
+  /// renders from and whether the channel matrix can play it. The matrix
+  /// can't play a waveform whose engine has a single set of voices or
+  /// buffers, as its channels would share them.
+  struct WaveformInfo
+  {
+    GeneratorFunction generator;
+    const char* traceName;
+    WaveformPanel panel;
+    WaveformEngine engine;
+    bool matrix;
+  };
 
-  /// The phase increment per sample, e.g (freq/srate). The phase must be
-  /// reset whenever the frequency or srate changes.
-  double phaseDelta;
+  /// Returns the description of a waveform id.
+  static const WaveformInfo& getWaveformInfo(WaveformId id);
+  /// Returns the block renderer for a waveform id. The WT_* waveforms get
+  /// the compact kernel of a 16 bit table format.
+  static GeneratorFunction getGenerator(WaveformId id, WaveTables::Format format = WaveTables::Float32);
+  /// Returns the name a waveform id's generator is traced under.
+  static const char* getTraceName(WaveformId id) { return getWaveformInfo(id).traceName; }
+  /// Returns the engine context for a waveform id's generator: the engine
+  /// its description names, and no other.
+  GeneratorEngines getEngines(WaveformId id);
+
+  //==============================================================================
+  // Wavetable support
+
+  /// Returns true for the WT_* waveform ids.
+  static bool isWaveTable(WaveformId id) { return id >= WT_START && id <= WT_TriangleWave; }
+  /// Returns the wavetable the audio thread reads for a WT_* waveform id.
+  const AudioSampleBuffer& getWaveTable(WaveformId id);
+  /// The WT_* tables and their editable spectra. Edited tables are rebuilt
+  /// in the background and adopted by renderSubBlock().
+  WaveTableBank waveTables;
+  /// Edits the spectrum of the selected WT_* waveform.
+  HarmonicEditor harmonicEditor {waveTables};
+  /// Returns the compact copy of the table of a WT_* waveform id in the
+  /// active table format, or nullptr for float tables and other ids.
+  const uint16* getCompactTable(WaveformId id);
+  /// The WT_* tables in the 16 bit formats. They live in the DSP arena and
+  /// are re-encoded into spare copies by renderSubBlock() when a table is
+  /// rebuilt.
+  CompactTables compactTables;
+  /// The format the WT_* generators read their tables in, chosen by the
+  /// tableFormatMenu, and the format the audio thread last switched them
+  /// to. A new format crossfades every WT_* generator over to it.
+  std::atomic<int> tableFormat {WaveTables::Float32};
+  int activeTableFormat {WaveTables::Float32};
+  /// Chooses the table format, next to the harmonic editor.
+  ComboBox tableFormatMenu;
+  /// Shows the size of the tables the oscillators read in the chosen
+  /// format and the saving over float tables, and the size of every table
+  /// resident: the float masters and the compact copies.
+  Label tableMemory {"", ""};
+  /// Updates tableMemory for the chosen format.
+  void showTableMemory();
 
-  /// 2pi as a double value.
-  const double TwoPi {double_Pi * 2.0};
-  
   //==============================================================================
-  // Waveforms
+  // Granular support
+
+  /// The grain pool and parameters of the Granular waveform. Its pool lives
+  /// in the DSP arena.
+  GrainCloud grains;
+  /// The controls of the Granular waveform.
+  GranularPanel granularPanel {grains};
+  /// Captures the output for the granular generator's "Captured" source,
+  /// at the render rate. At a fixed render rate that is ahead of the
+  /// limiter.
+  OutputCapture capture;
+  /// Length of an output capture.
+  double captureSeconds {2.0};
 
-  /// A periodic function ranging 0.0 to 1.0. It returns the current phase
-  /// value and post-increments phase by phaseDelta. See: std::fmod().
-  double inline phasor();
+  //==============================================================================
+  // Measurement support
 
-  /// Generates samples in a uniform random distribution.
-  void inline whiteNoise(const AudioSourceChannelInfo& bufferToFill) ;
+  /// The settings of the measurement waveforms and their multitone.
+  MeasurementSignals signals;
+  /// The controls of the measurement waveforms.
+  MeasurementPanel measurementPanel {signals};
 
-  /// Generates random uniform samples with a probability of freq/srate
-  /// across all channels.
-  void inline dust(const AudioSourceChannelInfo& bufferToFill) ;
+  //==============================================================================
+  // String support
 
-  /// Generates samples in a 'brown' distribution (-6dB per octave).
-  void inline brownNoise(const AudioSourceChannelInfo& bufferToFill) ;
-  void inline brownNoiseFilt(const AudioSourceChannelInfo& bufferToFill) ;
+  /// The strings of the Plucked and Resonator waveforms. Their delay lines
+  /// live in the DSP arena.
+  StringBank strings;
+  /// The controls of the string waveforms.
+  StringPanel stringPanel {strings};
 
-  /// Generates a sine wave at a specified frequency and amplitude.
-  void inline sineWave(const AudioSourceChannelInfo& bufferToFill) ;
+  //==============================================================================
+  // Resynthesis support
 
-  // Generators an inexpensive low frequency waves.
-  void inline LF_impulseWave(const AudioSourceChannelInfo& bufferToFill);
-  void inline LF_squareWave(const AudioSourceChannelInfo& bufferToFill);
-  void inline LF_sawtoothWave(const AudioSourceChannelInfo& bufferToFill);
-  void inline LF_triangleWave(const AudioSourceChannelInfo& bufferToFill);
+  /// The oscillator bank of the Resynthesis waveform. Its oscillators live
+  /// in the DSP arena.
+  PartialSynth partials;
+  /// Loads partial tracks and sets the resynthesis parameters.
+  PartialPanel partialPanel {partials};
 
-  // Generators for band limited waves.
-  void inline BL_impulseWave(const AudioSourceChannelInfo& bufferToFill);
-  void inline BL_squareWave(const AudioSourceChannelInfo& bufferToFill);
-  void inline BL_sawtoothWave(const AudioSourceChannelInfo& bufferToFill);
-  void inline BL_triangleWave(const AudioSourceChannelInfo& bufferToFill);
-  /// Generates samples using a wavetable oscillator.
-  void inline WT_wave(const AudioSourceChannelInfo& bufferToFill);
+  //==============================================================================
+  // Expression support
 
-  /// Returns a random value [-1.0, 1.0]
-  float inline ranSamp();
+  /// The program of the Expression waveform, shared by every slot and
+  /// matrix channel playing it. Its registers live in the DSP arena.
+  ExpressionSynth expression;
+  /// Edits the expression and sets its parameters.
+  ExpressionPanel expressionPanel {expression};
 
-  /// Returns a random value [-amp, amp]
-  float inline ranSamp(const float amp) ;
+  //==============================================================================
+  // Sample support
 
-  /// The change from one filter output to the next is proportional to the
-  /// difference between the previous output and the next input.
-  /// prevout + (alpha * (value - prevout)
-  /// e.g. for i from 1 to n y[i] := y[i-1] + α * (x[i] - y[i-1])
-  float lowPass(const float value, const float prevout, const float alpha) ;
+  /// Streams the file of the Sample waveform from disk.
+  SampleStreamer samples;
+  /// Opens the file and sets the voices.
+  SamplePanel samplePanel {samples};
 
   //==============================================================================
-  // Wavetable support
+  // FFT support
 
-  void createSineTable(AudioSampleBuffer& waveTable);
-  void createSquareTable(AudioSampleBuffer& waveTable);
-  void createImpulseTable(AudioSampleBuffer& waveTable);
-  void createSawtoothTable(AudioSampleBuffer& waveTable);
-  void createTriangleTable(AudioSampleBuffer& waveTable);
-  void wavetablePrepareToPlay(int wttype);
-  void wavetableSetFreq(float amp);
-  /// Wavetable for sine waves.
-  AudioSampleBuffer sineTable;
-  /// Wavetable for square waves.
-  AudioSampleBuffer squareTable;
-  /// Wavetable for impulse waves.
-  AudioSampleBuffer impulseTable;
-  /// Wavetable for sawtooth ewaves.
-  AudioSampleBuffer sawtoothTable;
-  /// Wavetable for triangle waves.
-  AudioSampleBuffer triangleTable;
-  /// Size of wavetables
-  int tableSize = 512;
-  /// Array of wavetable oscillators
-  std::vector<std::unique_ptr<WavetableOscillator>> oscillators;
+  /// The inverse FFT engine of the FFT_* waveforms. Its overlap-add buffers
+  /// live in the DSP arena.
+  SpectralSynth spectral;
+  /// Sets the FFT size.
+  SpectralPanel spectralPanel {spectral};
+
+  //==============================================================================
+  // Convolution support
+
+  /// Convolves the output of every waveform with an impulse response.
+  ConvolutionStage convolution;
+  /// Loads the impulse response and sets the wet/dry mix.
+  ConvolutionPanel convolutionPanel {convolution};
+
+  //==============================================================================
+  // Output limiter
+
+  /// Keeps the output below its true-peak ceiling. It runs at the device
+  /// rate, after the rate converter, so nothing may follow it that could
+  /// overshoot. Its delay lines live in the device arena.
+  OutputLimiter limiter;
+  /// Sets the ceiling and soft clipper and shows the latency.
+  LimiterPanel limiterPanel {limiter};
+
+  //==============================================================================
+  // Render rate support
+
+  /// The fixed render rate chosen in the render rate panel, or 0.0 to
+  /// render at the device rate. Read by prepareToPlay() and
+  /// releaseResources().
+  std::atomic<double> fixedRate {0.0};
+  /// Converts a fixed render rate to the device rate. Its filters and
+  /// history live in the device arena.
+  RateConverter converter;
+  /// Slices the converted output into sub-blocks for the limiter. Only
+  /// prepared while converting.
+  SubBlockScheduler outputScheduler;
+  /// True if the render rate differs from the device rate, set by
+  /// prepareToPlay().
+  bool converting {false};
+  /// Chooses the render rate and the converter's quality.
+  RenderRatePanel ratePanel {converter};
   //==============================================================================
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
 };
@@ -0,0 +1,76 @@
+//==============================================================================
+// MeasurementPanel.cpp
+// The controls of the measurement signals.
+//==============================================================================
+
+#include "MeasurementPanel.h"
+
+MeasurementPanel::MeasurementPanel (MeasurementSignals& s)
+: signals (s) {
+  addAndMakeVisible (status);
+
+  addSlider (startSlider, 1.0, 24000.0, signals.getSweepStart(), " Hz start");
+  startSlider.setSkewFactorFromMidPoint (1000.0);
+  addSlider (endSlider, 1.0, 24000.0, signals.getSweepEnd(), " Hz end");
+  endSlider.setSkewFactorFromMidPoint (1000.0);
+  addSlider (lengthSlider, 0.1, 60.0, signals.getSweepLength(), " s sweep");
+  lengthSlider.setSkewFactorFromMidPoint (5.0);
+  addSlider (silenceSlider, 0.0, 10.0, signals.getSweepSilence(), " s silence");
+  addSlider (orderSlider, 8.0, 24.0, signals.getMlsOrder(), " bit MLS");
+  orderSlider.setRange (8.0, 24.0, 1.0);
+}
+
+void MeasurementPanel::addSlider (Slider& slider, double minimum, double maximum, double value, const String& suffix) {
+  addAndMakeVisible (slider);
+  slider.setSliderStyle (Slider::LinearHorizontal);
+  slider.setTextBoxStyle (Slider::TextBoxLeft, false, 90, 22);
+  slider.setRange (minimum, maximum);
+  slider.setTextValueSuffix (suffix);
+  slider.setValue (value, dontSendNotification);
+  slider.addListener (this);
+}
+
+void MeasurementPanel::updateStatus (double sampleRate) {
+  if (sampleRate <= 0.0) {
+    status.setText ({}, dontSendNotification);
+    return;
+  }
+  auto sweep = signals.getPeriod (MeasurementSignals::ExponentialSweep, sampleRate) / sampleRate;
+  auto mls = signals.getPeriod (MeasurementSignals::Mls, sampleRate);
+  auto crest = signals.getMultitoneCrestFactor();
+  auto text = "Sweep period " + String (sweep, 2) + " s, MLS period " + String (mls) + " samples";
+  if (crest > 0.0f)
+    text += ", multitone crest " + String (Decibels::gainToDecibels (crest), 1) + " dB";
+  status.setText (text, dontSendNotification);
+}
+
+void MeasurementPanel::resized() {
+  auto bounds = getLocalBounds();
+  status.setBounds (bounds.removeFromTop (24));
+
+  bounds.removeFromTop (4);
+  auto row = bounds.removeFromTop (24);
+  auto third = row.getWidth() / 3;
+  startSlider.setBounds (row.removeFromLeft (third));
+  endSlider.setBounds (row.removeFromLeft (third));
+  lengthSlider.setBounds (row);
+
+  bounds.removeFromTop (4);
+  row = bounds.removeFromTop (24);
+  silenceSlider.setBounds (row.removeFromLeft (row.getWidth() / 2));
+  orderSlider.setBounds (row);
+}
+
+void MeasurementPanel::sliderValueChanged (Slider* slider) {
+  auto value = slider->getValue();
+  if (slider == &startSlider)
+    signals.setSweepStart (value);
+  else if (slider == &endSlider)
+    signals.setSweepEnd (value);
+  else if (slider == &lengthSlider)
+    signals.setSweepLength (value);
+  else if (slider == &silenceSlider)
+    signals.setSweepSilence (value);
+  else if (slider == &orderSlider)
+    signals.setMlsOrder (roundToInt (value));
+}
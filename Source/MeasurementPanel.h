@@ -0,0 +1,38 @@
+//==============================================================================
+// MeasurementPanel.h
+// The controls of the measurement signals.
+//==============================================================================
+
+#pragma once
+
+#include "MeasurementSignals.h"
+
+/// MeasurementPanel sets the sweep start and end frequencies, the sweep
+/// length and the silence after it, and the MLS order of a
+/// MeasurementSignals. updateStatus() shows the period of each signal and
+/// the multitone's crest factor.
+class MeasurementPanel : public Component, public Slider::Listener
+{
+public:
+  explicit MeasurementPanel (MeasurementSignals& signals);
+
+  /// Shows the signal periods at sampleRate. Call from a timer.
+  void updateStatus (double sampleRate);
+
+  void resized() override;
+  void sliderValueChanged (Slider* slider) override;
+
+private:
+  /// Sets up a slider with the app's text box style.
+  void addSlider (Slider& slider, double minimum, double maximum, double value, const String& suffix);
+
+  MeasurementSignals& signals;
+  Label status;
+  Slider startSlider;
+  Slider endSlider;
+  Slider lengthSlider;
+  Slider silenceSlider;
+  Slider orderSlider;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeasurementPanel)
+};
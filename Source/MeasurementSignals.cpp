@@ -0,0 +1,285 @@
+//==============================================================================
+// MeasurementSignals.cpp
+// Sine sweeps, maximum length sequences and multitones for measurements.
+//==============================================================================
+
+#include "MeasurementSignals.h"
+#include "SubBlockScheduler.h"
+
+namespace
+{
+  /// Galois feedback masks of maximal length LFSRs, indexed by order.
+  const uint32 mlsTaps[] = {
+    0, 0, 0x3, 0x6, 0xC, 0x14, 0x30, 0x60, 0xB8, 0x110, 0x240, 0x500, 0x829,
+    0x100D, 0x2015, 0x6000, 0xD008, 0x12000, 0x20400, 0x40023, 0x90000,
+    0x140000, 0x300000, 0x420000, 0xE10000
+  };
+
+  /// Rounds of phase refinement used to lower the multitone's crest factor.
+  const int crestIterations = 200;
+
+  /// Returns the bins of numTones log spaced tones between lowest and
+  /// highest, moving tones up where rounding would put two on one bin.
+  Array<int> getToneBins (int size, double sampleRate)
+  {
+    auto binHz = sampleRate / size;
+    auto lowest = jmax (1, roundToInt (MeasurementSignals::lowestTone / binHz));
+    auto highest = jmin (size / 2 - 1, roundToInt (jmin (MeasurementSignals::highestTone, 0.45 * sampleRate) / binHz));
+    Array<int> bins;
+    for (auto tone = 0; tone < MeasurementSignals::numTones; ++tone) {
+      auto ratio = (double) tone / (MeasurementSignals::numTones - 1);
+      auto bin = roundToInt (lowest * std::pow ((double) highest / lowest, ratio));
+      if (! bins.isEmpty())
+        bin = jmax (bin, bins.getLast() + 1);
+      if (bin <= highest)
+        bins.add (bin);
+    }
+    return bins;
+  }
+
+  /// Writes unit amplitude tones with the given phases into an interleaved
+  /// real FFT spectrum and transforms it into one period in the first size
+  /// values of data.
+  void synthesize (const dsp::FFT& fft, const Array<int>& bins, const std::vector<double>& phases,
+                   std::vector<float>& data)
+  {
+    std::fill (data.begin(), data.end(), 0.0f);
+    for (auto i = 0; i < bins.size(); ++i) {
+      data[(size_t) (2 * bins[i])] = (float) std::cos (phases[(size_t) i]);
+      data[(size_t) (2 * bins[i] + 1)] = (float) std::sin (phases[(size_t) i]);
+    }
+    fft.performRealOnlyInverseTransform (data.data());
+  }
+
+  float getPeak (const float* data, int size)
+  {
+    auto range = FloatVectorOperations::findMinAndMax (data, size);
+    return jmax (std::abs (range.getStart()), std::abs (range.getEnd()));
+  }
+
+  double getRms (const float* data, int size)
+  {
+    auto power = 0.0;
+    for (auto i = 0; i < size; ++i)
+      power += (double) data[i] * data[i];
+    return std::sqrt (power / size);
+  }
+}
+
+MeasurementSignals::MeasurementSignals()
+: Thread ("Multitone Builder") {
+  startThread (Thread::Priority::low);
+}
+
+MeasurementSignals::~MeasurementSignals() {
+  stopThread (10000);
+  delete multitone.exchange (nullptr);
+}
+
+void MeasurementSignals::prepare (double sampleRate) {
+  if (sampleRate <= 0.0)
+    return;
+  const ScopedLock sl (lock);
+  if (sampleRate == requestedRate)
+    return;
+  requestedRate = sampleRate;
+  crestFactor.store (0.0f);
+  // the audio thread is stopped, so the multitone for the old rate can go
+  delete multitone.exchange (nullptr);
+  notify();
+}
+
+void MeasurementSignals::run() {
+  while (! threadShouldExit()) {
+    double rate;
+    {
+      const ScopedLock sl (lock);
+      rate = (multitone.load() == nullptr) ? requestedRate : 0.0;
+    }
+    if (rate <= 0.0) {
+      wait (-1);
+      continue;
+    }
+    auto crest = 0.0f;
+    auto built = buildMultitone (rate, crest);
+    if (built == nullptr)
+      continue;
+    const ScopedLock sl (lock);
+    // prepare() may have asked for another rate meanwhile
+    if (rate == requestedRate && multitone.load() == nullptr) {
+      crestFactor.store (crest);
+      multitone.store (built.release(), std::memory_order_release);
+      multitoneBuilt.signal();
+    }
+  }
+}
+
+std::unique_ptr<MeasurementSignals::MultitonePeriod> MeasurementSignals::buildMultitone (double sampleRate, float& crest) {
+  // An eighth of a second or more per period, so the tones sit on a grid
+  // of about 6 Hz. A finer grid lets the tones come close to lining up
+  // somewhere in the longer period, whatever their phases.
+  auto order = jlimit (10, 20, (int) std::ceil (std::log2 (sampleRate)) - 3);
+  auto size = 1 << order;
+  auto bins = getToneBins (size, sampleRate);
+  auto numBins = bins.size();
+
+  // Start from Schroeder's phases and lower the crest factor by gradient
+  // descent on the 16-norm of the period, which tracks the peak but, unlike
+  // it, depends smoothly on every phase. The gradient for each tone is the
+  // imaginary part of exp (j phase) * conj (Y) at its bin, where Y is the
+  // spectrum of x^15. Steps that raise the norm are retried at half size.
+  std::vector<double> phases ((size_t) numBins), accepted, gradient ((size_t) numBins);
+  for (auto i = 0; i < numBins; ++i)
+    phases[(size_t) i] = -MathConstants<double>::pi * i * (i + 1) / numBins;
+  dsp::FFT fft (order);
+  std::vector<float> data ((size_t) size * 2);
+  std::vector<float> best ((size_t) size);
+  auto bestCrest = std::numeric_limits<float>::max();
+  auto acceptedNorm = std::numeric_limits<double>::max();
+  auto step = 0.05;
+  for (auto iteration = 0; iteration < crestIterations; ++iteration) {
+    if (threadShouldExit())
+      return nullptr;
+    synthesize (fft, bins, phases, data);
+    auto rms = getRms (data.data(), size);
+    auto crest = (rms > 0.0) ? (float) (getPeak (data.data(), size) / rms) : 0.0f;
+    if (crest < bestCrest) {
+      bestCrest = crest;
+      std::copy (data.begin(), data.begin() + size, best.begin());
+    }
+    auto norm = 0.0;
+    for (auto i = 0; i < size; ++i) {
+      auto x = data[(size_t) i] / rms;
+      auto x2 = x * x, x4 = x2 * x2, x8 = x4 * x4;
+      norm += x8 * x8;
+      data[(size_t) i] = (float) (x8 * x4 * x2 * x);
+    }
+    if (norm > acceptedNorm) {
+      step *= 0.5;
+      for (auto i = 0; i < numBins; ++i)
+        phases[(size_t) i] = accepted[(size_t) i] + step * gradient[(size_t) i];
+      continue;
+    }
+    acceptedNorm = norm;
+    accepted = phases;
+    step *= 1.1;
+    std::fill (data.begin() + size, data.end(), 0.0f);
+    fft.performRealOnlyForwardTransform (data.data());
+    auto largest = 0.0;
+    for (auto i = 0; i < numBins; ++i) {
+      auto phase = phases[(size_t) i];
+      auto bin = (size_t) bins[i];
+      gradient[(size_t) i] = std::sin (phase) * data[2 * bin] - std::cos (phase) * data[2 * bin + 1];
+      largest = jmax (largest, std::abs (gradient[(size_t) i]));
+    }
+    for (auto i = 0; i < numBins; ++i) {
+      gradient[(size_t) i] = (largest > 0.0) ? gradient[(size_t) i] / largest : 0.0;
+      phases[(size_t) i] += step * gradient[(size_t) i];
+    }
+  }
+
+  auto result = std::make_unique<MultitonePeriod>();
+  result->period.setSize (1, size);
+  result->sampleRate = sampleRate;
+  auto peak = getPeak (best.data(), size);
+  FloatVectorOperations::copyWithMultiply (result->period.getWritePointer (0), best.data(),
+                                           (peak > 0.0f) ? 1.0f / peak : 0.0f, size);
+  crest = bestCrest;
+  return result;
+}
+
+GeneratorFunction MeasurementSignals::getGenerator (Signal signal) {
+  switch (signal) {
+    case ExponentialSweep: return &Generators::render<Sweep<true>>;
+    case LinearSweep:      return &Generators::render<Sweep<false>>;
+    case Mls:              return &Generators::render<MlsKernel>;
+    case Multitone:        return &Generators::render<MultitoneKernel>;
+    default:               return nullptr;
+  }
+}
+
+const char* MeasurementSignals::getName (Signal signal) {
+  switch (signal) {
+    case ExponentialSweep: return "exp-sweep";
+    case LinearSweep:      return "lin-sweep";
+    case Mls:              return "mls";
+    case Multitone:        return "multitone";
+    default:               return "";
+  }
+}
+
+int64 MeasurementSignals::getPeriod (Signal signal, double sampleRate) const {
+  switch (signal) {
+    case ExponentialSweep:
+    case LinearSweep: {
+      GeneratorState state;
+      state.srate = sampleRate;
+      startSweep (state, signal == ExponentialSweep);
+      return state.period;
+    }
+    case Mls:       return ((int64) 1 << mlsOrder.load()) - 1;
+    case Multitone: {
+      auto* tone = multitone.load();
+      return (tone != nullptr && tone->sampleRate == sampleRate) ? tone->period.getNumSamples() : 0;
+    }
+    default:        return 0;
+  }
+}
+
+void MeasurementSignals::startSweep (GeneratorState& state, bool exponential) const noexcept {
+  if (state.srate <= 0.0) {
+    state.sweepLength = 0;
+    state.period = 1;
+    return;
+  }
+  auto nyquist = state.srate / 2.0;
+  auto start = jmin (sweepStart.load(), nyquist) / state.srate;
+  auto end = jmin (sweepEnd.load(), nyquist) / state.srate;
+  state.sweepLength = jmax ((int64) 1, (int64) std::llround (sweepLength.load() * state.srate));
+  state.period = state.sweepLength + (int64) std::llround (sweepSilence.load() * state.srate);
+  state.sweepStart = start;
+  state.sweepRate = exponential ? std::log (end / start) / (double) state.sweepLength
+                                : (end - start) / (double) state.sweepLength;
+}
+
+void MeasurementSignals::startMls (GeneratorState& state) const noexcept {
+  auto order = mlsOrder.load();
+  state.mlsTaps = mlsTaps[order];
+  state.period = ((int64) 1 << order) - 1;
+  state.lfsr = 1;
+}
+
+String MeasurementSignals::render (Signal signal, double sampleRate, const File& file) {
+  prepare (sampleRate);
+  if (signal == Multitone && sampleRate > 0.0)
+    while (multitone.load() == nullptr)
+      multitoneBuilt.wait (-1);
+  auto period = getPeriod (signal, sampleRate);
+  if (period <= 0 || period > std::numeric_limits<int>::max())
+    return "Can't render " + String (getName (signal)) + " at " + String (sampleRate) + " Hz.";
+
+  auto numSamples = (int) period;
+  AudioSampleBuffer buffer (1, numSamples);
+  GeneratorState state;
+  state.setFrequency (0.0, sampleRate);
+  state.engines.signals = this;
+  state.reset();
+  auto generator = getGenerator (signal);
+  for (auto start = 0; start < numSamples; start += SubBlockScheduler::subBlockSize) {
+    auto num = jmin (SubBlockScheduler::subBlockSize, numSamples - start);
+    generator (state, AudioSourceChannelInfo (&buffer, start, num), 1.0f);
+  }
+
+  file.deleteFile();
+  auto stream = file.createOutputStream();
+  if (stream == nullptr)
+    return "Can't open " + file.getFullPathName() + " for writing.";
+  WavAudioFormat format;
+  std::unique_ptr<AudioFormatWriter> writer (format.createWriterFor (stream.get(), sampleRate, 1, 32, {}, 0));
+  if (writer == nullptr)
+    return "Can't write a .wav file at " + String (sampleRate) + " Hz.";
+  stream.release(); // now owned by the writer
+  if (! writer->writeFromAudioSampleBuffer (buffer, 0, numSamples))
+    return "Can't write " + file.getFullPathName() + ".";
+  return {};
+}
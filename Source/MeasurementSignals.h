@@ -0,0 +1,215 @@
+//==============================================================================
+// MeasurementSignals.h
+// Sine sweeps, maximum length sequences and multitones for measurements.
+//==============================================================================
+
+#pragma once
+
+#include "Generators.h"
+
+/// MeasurementSignals holds the settings of the measurement generators and
+/// the multitone they play. Every signal is periodic and computed from the
+/// number of samples since its period started, so it is sample exact and
+/// renders the same samples in real time, offline and in any block size:
+/// * The sweeps compute each sample's phase in closed form from its index,
+///   exponentially (Farina) or linearly from the start to the end
+///   frequency, followed by a stretch of silence for the decay. Nothing
+///   accumulates from sample to sample, so there is no phase drift.
+/// * The MLS steps a Galois LFSR of the chosen order once per sample with a
+///   branchless shift and masked xor, giving a +-1 sequence that repeats
+///   every 2^order - 1 samples.
+/// * The multitone is precomputed into a buffer of a power of two samples
+///   with every tone on an exact FFT bin, so it loops without a seam. The
+///   tones are log spaced and their phases start from Schroeder's formula
+///   and are refined to lower the crest factor to about 8.5 dB. Playing it
+///   costs a vector copy. The refinement takes a moment, so a builder
+///   thread does it and hands the buffer to the audio thread through an
+///   atomic pointer, as ConvolutionStage does its engines. The multitone
+///   is silent until then.
+/// Settings are latched at the start of each period and are safe to set
+/// from any thread.
+class MeasurementSignals : private Thread
+{
+public:
+  enum Signal { ExponentialSweep, LinearSweep, Mls, Multitone, NumSignals };
+
+  /// Number of multitone tones and their frequency range. Tones above
+  /// 0.45 of the sample rate are moved down.
+  static constexpr int numTones = 32;
+  static constexpr double lowestTone = 20.0;
+  static constexpr double highestTone = 20000.0;
+
+  MeasurementSignals();
+
+  /// Stops the builder. The audio thread must have stopped.
+  ~MeasurementSignals() override;
+
+  /// Starts building the multitone for sampleRate in the background,
+  /// unless it was built or is being built for it. A multitone for another
+  /// rate is deleted, so call it from prepareToPlay(), while the audio
+  /// thread is stopped.
+  void prepare (double sampleRate);
+
+  /// Returns the renderer of a signal. The generator state's signals
+  /// member must point at this object.
+  static GeneratorFunction getGenerator (Signal signal);
+
+  /// Returns a signal's name, as used on the command line.
+  static const char* getName (Signal signal);
+
+  /// Returns the length in samples of one period of a signal at the current
+  /// settings, 0 for the multitone until it is built for sampleRate.
+  int64 getPeriod (Signal signal, double sampleRate) const;
+
+  /// Renders one period of a signal at sampleRate into a mono 32 bit .wav
+  /// file, one sub-block at a time exactly as the audio thread does. Returns
+  /// an error message, or an empty string on success. Run it with
+  /// `WaveLab --measure <signal> [file] [--rate <hz>]`.
+  String render (Signal signal, double sampleRate, const File& file);
+
+  //==============================================================================
+  // Parameters, safe to set from any thread. New values apply from the next
+  // period.
+
+  /// Sweep start and end frequencies, 1 to 96000 Hz. They are limited to the
+  /// nyquist frequency when a sweep starts.
+  void setSweepStart (double hz) { sweepStart.store (jlimit (1.0, 96000.0, hz)); }
+  void setSweepEnd (double hz) { sweepEnd.store (jlimit (1.0, 96000.0, hz)); }
+  /// Length of the sweep, 0.1 to 60 seconds.
+  void setSweepLength (double seconds) { sweepLength.store (jlimit (0.1, 60.0, seconds)); }
+  /// Silence after each sweep, 0 to 10 seconds.
+  void setSweepSilence (double seconds) { sweepSilence.store (jlimit (0.0, 10.0, seconds)); }
+  /// MLS register length in bits, 8 to 24.
+  void setMlsOrder (int order) { mlsOrder.store (jlimit (8, 24, order)); }
+
+  double getSweepStart() const noexcept { return sweepStart.load(); }
+  double getSweepEnd() const noexcept { return sweepEnd.load(); }
+  double getSweepLength() const noexcept { return sweepLength.load(); }
+  double getSweepSilence() const noexcept { return sweepSilence.load(); }
+  int getMlsOrder() const noexcept { return mlsOrder.load(); }
+
+  /// Returns the multitone's peak to RMS ratio, 0 until it is built.
+  float getMultitoneCrestFactor() const noexcept { return crestFactor.load(); }
+
+  //==============================================================================
+  // Kernels
+
+  /// The sweep kernel. Each sample's phase in cycles is start * n for a
+  /// constant frequency, n * (start + rate * n / 2) for a linear sweep and
+  /// start / rate * (exp (rate * n) - 1) for an exponential one.
+  template <bool Exponential>
+  struct Sweep
+  {
+    static void render (GeneratorState& s, float* dest, int numSamples, float gain) noexcept
+    {
+      if (s.engines.signals == nullptr) {
+        FloatVectorOperations::clear (dest, numSamples);
+        return;
+      }
+      for (auto done = 0; done < numSamples;) {
+        if (s.position == 0)
+          s.engines.signals->startSweep (s, Exponential);
+        auto num = (int) jmin ((int64) (numSamples - done), s.period - s.position);
+        auto sweeping = (int) jlimit ((int64) 0, (int64) num, s.sweepLength - s.position);
+        for (auto i = 0; i < sweeping; ++i) {
+          auto n = (double) (s.position + i);
+          auto cycles = (Exponential && s.sweepRate != 0.0)
+            ? s.sweepStart / s.sweepRate * std::expm1 (s.sweepRate * n)
+            : n * (s.sweepStart + 0.5 * s.sweepRate * n);
+          dest[done + i] = gain * (float) std::sin ((cycles - std::floor (cycles)) * Generators::TwoPi);
+        }
+        FloatVectorOperations::clear (dest + done + sweeping, num - sweeping);
+        if ((s.position += num) >= s.period)
+          s.position = 0;
+        done += num;
+      }
+    }
+  };
+
+  /// The MLS kernel, one Galois LFSR step per sample.
+  struct MlsKernel
+  {
+    static void render (GeneratorState& s, float* dest, int numSamples, float gain) noexcept
+    {
+      if (s.engines.signals == nullptr) {
+        FloatVectorOperations::clear (dest, numSamples);
+        return;
+      }
+      for (auto done = 0; done < numSamples;) {
+        if (s.position == 0)
+          s.engines.signals->startMls (s);
+        auto num = (int) jmin ((int64) (numSamples - done), s.period - s.position);
+        auto lfsr = s.lfsr;
+        for (auto i = 0; i < num; ++i) {
+          auto bit = lfsr & 1u;
+          lfsr = (lfsr >> 1) ^ ((0u - bit) & s.mlsTaps);
+          dest[done + i] = gain * (float) ((int) (bit << 1) - 1);
+        }
+        s.lfsr = lfsr;
+        if ((s.position += num) >= s.period)
+          s.position = 0;
+        done += num;
+      }
+    }
+  };
+
+  /// The multitone kernel, a looped copy of the precomputed period.
+  struct MultitoneKernel
+  {
+    static void render (GeneratorState& s, float* dest, int numSamples, float gain) noexcept
+    {
+      auto* tone = (s.engines.signals != nullptr) ? s.engines.signals->multitone.load (std::memory_order_acquire) : nullptr;
+      if (tone == nullptr) {
+        FloatVectorOperations::clear (dest, numSamples);
+        return;
+      }
+      auto size = tone->period.getNumSamples();
+      auto* source = tone->period.getReadPointer (0);
+      for (auto done = 0; done < numSamples;) {
+        if (s.position >= size)
+          s.position = 0;
+        auto num = (int) jmin ((int64) (numSamples - done), size - s.position);
+        FloatVectorOperations::copyWithMultiply (dest + done, source + s.position, gain, num);
+        s.position += num;
+        done += num;
+      }
+    }
+  };
+
+private:
+  /// One period of the multitone and the sample rate it was built for.
+  struct MultitonePeriod
+  {
+    AudioSampleBuffer period;
+    double sampleRate;
+  };
+
+  /// The builder thread: builds the multitone for the rate requested.
+  void run() override;
+
+  /// Returns the multitone for sampleRate, or nullptr if the builder was
+  /// asked to stop. Sets crest to its crest factor.
+  std::unique_ptr<MultitonePeriod> buildMultitone (double sampleRate, float& crest);
+
+  /// Latch the settings of a new period into a generator state.
+  void startSweep (GeneratorState& state, bool exponential) const noexcept;
+  void startMls (GeneratorState& state) const noexcept;
+
+  std::atomic<double> sweepStart {20.0};
+  std::atomic<double> sweepEnd {20000.0};
+  std::atomic<double> sweepLength {10.0};
+  std::atomic<double> sweepSilence {1.0};
+  std::atomic<int> mlsOrder {16};
+
+  /// The multitone built, read by the audio thread. It only changes from
+  /// nullptr to the multitone for requestedRate, or back in prepare().
+  std::atomic<MultitonePeriod*> multitone {nullptr};
+  std::atomic<float> crestFactor {0.0f};
+  /// The rate prepare() asked for, guarded by lock.
+  double requestedRate {0.0};
+  CriticalSection lock;
+  /// Signalled when a multitone is handed over, for render().
+  WaitableEvent multitoneBuilt;
+
+  JUCE_DECLARE_NON_COPYABLE (MeasurementSignals)
+};
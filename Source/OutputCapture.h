@@ -0,0 +1,84 @@
+//==============================================================================
+// OutputCapture.h
+// Captures a few seconds of the output for the granular generator.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/// OutputCapture hands a buffer from the message thread to the audio thread,
+/// which fills it with the next few seconds of output and hands it back.
+/// Both hand-offs are single atomic pointer exchanges, so the audio thread
+/// never allocates, frees or blocks. The finished buffer holds mono audio
+/// plus a guard sample equal to the first, ready for WaveTableBank.
+class OutputCapture
+{
+public:
+  ~OutputCapture()
+  {
+    reset();
+    delete completed.exchange (nullptr);
+  }
+
+  /// Starts capturing numSamples. Ignored while a capture is already in
+  /// progress. Call on the message thread.
+  void request (int numSamples)
+  {
+    if (isCapturing() || numSamples <= 0)
+      return;
+    delete pending.exchange (new AudioSampleBuffer (1, numSamples + 1));
+  }
+
+  /// Returns true from request() until the capture is complete.
+  bool isCapturing() const noexcept { return pending.load() != nullptr || busy.load(); }
+
+  /// Returns the finished capture, or nullptr. Call on the message thread.
+  std::unique_ptr<AudioSampleBuffer> takeCompleted()
+  {
+    return std::unique_ptr<AudioSampleBuffer> (completed.exchange (nullptr));
+  }
+
+  /// Copies the first channel of a block into the capture in progress, if
+  /// any. Called on the audio thread.
+  void push (const AudioSampleBuffer& block) noexcept
+  {
+    if (capture == nullptr) {
+      if (pending.load() == nullptr)
+        return;
+      capture = pending.exchange (nullptr);
+      position = 0;
+    }
+    auto length = capture->getNumSamples() - 1;
+    auto num = jmin (block.getNumSamples(), length - position);
+    capture->copyFrom (0, position, block, 0, 0, num);
+    position += num;
+    if (position == length) {
+      capture->setSample (0, length, capture->getSample (0, 0));
+      // hand it over, unless the last capture has not been collected yet
+      AudioSampleBuffer* expected = nullptr;
+      if (completed.compare_exchange_strong (expected, capture))
+        capture = nullptr;
+    }
+    busy.store (capture != nullptr);
+  }
+
+  /// Drops a capture in progress. Call from releaseResources(), when the
+  /// audio thread no longer calls push().
+  void reset()
+  {
+    delete pending.exchange (nullptr);
+    delete capture;
+    capture = nullptr;
+    busy = false;
+  }
+
+private:
+  std::atomic<AudioSampleBuffer*> pending {nullptr};
+  std::atomic<AudioSampleBuffer*> completed {nullptr};
+  /// The buffer being filled. Only accessed by the audio thread.
+  AudioSampleBuffer* capture {nullptr};
+  int position {0};
+  /// True while the audio thread is filling a buffer.
+  std::atomic<bool> busy {false};
+};
@@ -0,0 +1,294 @@
+//==============================================================================
+// OutputLimiter.cpp
+// Keeps the output below a true-peak ceiling with a lookahead limiter.
+//==============================================================================
+
+#include "OutputLimiter.h"
+#include "RealtimeChecks.h"
+
+namespace
+{
+  /// Fills taps with a Blackman-Harris windowed sinc low pass at the Nyquist
+  /// frequency of a quarter of the rate it runs at.
+  void designQuarterBandLowPass (float* taps, int numTaps)
+  {
+    for (auto n = 0; n < numTaps; ++n) {
+      auto x = (n - (numTaps - 1) / 2.0) / 4.0;
+      auto sinc = (x == 0.0) ? 1.0 : std::sin (MathConstants<double>::pi * x) / (MathConstants<double>::pi * x);
+      auto w = 2.0 * MathConstants<double>::pi * (n + 0.5) / numTaps;
+      auto window = 0.35875 - 0.48829 * std::cos (w) + 0.14128 * std::cos (2.0 * w) - 0.01168 * std::cos (3.0 * w);
+      taps[n] = (float) (sinc * window);
+    }
+  }
+
+  /// Returns x unchanged up to half the threshold t, and above it bent
+  /// towards t along t - t^2 / 4|x|, which never reaches t and joins the
+  /// straight line with the same slope.
+  forcedinline float saturate (float x, float threshold) noexcept
+  {
+    auto a = std::abs (x);
+    auto bent = threshold - 0.25f * threshold * threshold / jmax (a, 1.0e-30f);
+    return std::copysign (a > 0.5f * threshold ? bent : a, x);
+  }
+}
+
+OutputLimiter::OutputLimiter() {
+  // the interpolator's taps split into four phases that each have unity
+  // gain at DC
+  float taps[4 * tapsPerPhase];
+  designQuarterBandLowPass (taps, 4 * tapsPerPhase);
+  for (auto phase = 0; phase < 4; ++phase) {
+    auto sum = 0.0f;
+    for (auto tap = 0; tap < tapsPerPhase; ++tap)
+      sum += taps[tap * 4 + phase];
+    auto absolute = 0.0f;
+    for (auto tap = 0; tap < tapsPerPhase; ++tap) {
+      phases[phase][tap] = taps[tap * 4 + phase] / sum;
+      absolute += std::abs (phases[phase][tap]);
+    }
+    interpolatorGain = jmax (interpolatorGain, absolute);
+  }
+  designQuarterBandLowPass (decimator, decimatorTaps);
+  auto sum = std::accumulate (decimator, decimator + decimatorTaps, 0.0f);
+  for (auto& tap : decimator)
+    tap /= sum;
+}
+
+int OutputLimiter::getLookahead (double sampleRate) {
+  return jmax (1, roundToInt (lookaheadSeconds * sampleRate));
+}
+
+int OutputLimiter::getChannelStride (double sampleRate) {
+  auto delayLineSize = getLookahead (sampleRate) + detectorDelay + blockSize;
+  auto floats = delayLineSize + tapsPerPhase - 1 + clipDelay + 4 * decimatorHistory;
+  // a cache line per channel
+  return (floats + 15) & ~15;
+}
+
+size_t OutputLimiter::getArenaBytes (int numChannels, double sampleRate) {
+  auto lookahead = (size_t) getLookahead (sampleRate);
+  return DspArena::bytesFor<float> ((size_t) jmin (numChannels, maxChannels) * getChannelStride (sampleRate))
+    + DspArena::bytesFor<int64> (lookahead + 2)
+    + DspArena::bytesFor<float> (lookahead + 2)
+    + DspArena::bytesFor<float> (lookahead)
+    + 2 * DspArena::bytesFor<float> (blockSize)
+    + DspArena::bytesFor<float> (clipDelay + blockSize)
+    + DspArena::bytesFor<float> (4 * blockSize)
+    + DspArena::bytesFor<float> (4 * (decimatorHistory + blockSize));
+}
+
+void OutputLimiter::prepare (DspArena& arena, int channels, double sampleRate) {
+  numChannels = jlimit (1, maxChannels, channels);
+  lookahead = getLookahead (sampleRate);
+  channelStride = (size_t) getChannelStride (sampleRate);
+  queueSize = lookahead + 2;
+  state = arena.allocate<float> ((size_t) numChannels * channelStride);
+  queueIndex = arena.allocate<int64> ((size_t) queueSize);
+  queueGain = arena.allocate<float> ((size_t) queueSize);
+  minima = arena.allocate<float> ((size_t) lookahead);
+  peaks = arena.allocate<float> (blockSize);
+  gains = arena.allocate<float> (blockSize);
+  run = arena.allocate<float> (clipDelay + blockSize);
+  phaseOutput = arena.allocate<float> (4 * blockSize);
+  upsampled = arena.allocate<float> (4 * (decimatorHistory + blockSize));
+  if (upsampled == nullptr) {
+    release();
+    return;
+  }
+  FloatVectorOperations::clear (state, (int) (numChannels * channelStride));
+  delay = lookahead + detectorDelay;
+  delayLineSize = delay + blockSize;
+  writeIndex = 0;
+  queueFront = queueCount = 0;
+  sampleIndex = 0;
+  FloatVectorOperations::fill (minima, 1.0f, lookahead);
+  minimaIndex = 0;
+  minimaSum = lookahead;
+  gain = 1.0f;
+  releaseCoefficient = (float) (1.0 - std::exp (-1.0 / (releaseSeconds * sampleRate)));
+  clipping = softClip.load();
+  latency.store (delay + clipDelay);
+}
+
+void OutputLimiter::release() {
+  state = nullptr;
+  queueIndex = nullptr;
+  queueGain = nullptr;
+  minima = nullptr;
+  peaks = gains = run = phaseOutput = upsampled = nullptr;
+}
+
+float OutputLimiter::takeGainReductionDb() {
+  return Decibels::gainToDecibels (lowestGain.exchange (1.0f), -100.0f);
+}
+
+void OutputLimiter::process (AudioSampleBuffer& subBlock) noexcept {
+  if (upsampled == nullptr || subBlock.getNumSamples() != blockSize)
+    return;
+  resting = false;
+  auto channels = jmin (numChannels, subBlock.getNumChannels());
+  auto threshold = ceiling.load();
+  auto on = softClip.load();
+  if (on && ! clipping) {
+    // the upsampled history is from the last time the clipper ran
+    for (auto chan = 0; chan < channels; ++chan)
+      FloatVectorOperations::clear (getUpsampledHistory (chan), 4 * decimatorHistory);
+  }
+  clipping = on;
+  for (auto chan = 0; chan < channels; ++chan)
+    clip (chan, subBlock.getWritePointer (chan), threshold, on);
+
+  computeGains (detect (subBlock, channels, threshold), threshold);
+
+  for (auto chan = 0; chan < channels; ++chan) {
+    auto* samples = subBlock.getWritePointer (chan);
+    auto* line = getDelayLine (chan);
+    auto write = writeIndex;
+    auto read = writeIndex - delay;
+    if (read < 0)
+      read += delayLineSize;
+    for (auto i = 0; i < blockSize; ++i) {
+      auto input = samples[i];
+      samples[i] = line[read] * gains[i];
+      line[write] = input;
+      if (++read == delayLineSize)
+        read = 0;
+      if (++write == delayLineSize)
+        write = 0;
+    }
+  }
+  writeIndex = (writeIndex + blockSize) % delayLineSize;
+  RealtimeChecks::checkDenormal (gain);
+}
+
+void OutputLimiter::skip() noexcept {
+  if (minima == nullptr)
+    return;
+  // the sliding minimum only holds unity gains, which any new gain
+  // replaces, and the moving average is exactly unity. Its ring keeps
+  // moving, as the running sum is recounted when it wraps.
+  queueFront = queueCount = 0;
+  sampleIndex += blockSize;
+  minimaIndex = (minimaIndex + blockSize) % lookahead;
+  if (resting)
+    return;
+  // the release towards a target of 1.0, as computeGains() runs it, until
+  // rounding leaves the gain where it is
+  for (auto i = 0; i < blockSize; ++i) {
+    auto next = gain + (1.0f - gain) * releaseCoefficient;
+    if (next == gain) {
+      resting = true;
+      return;
+    }
+    gain = next;
+  }
+}
+
+void OutputLimiter::clip (int chan, float* samples, float threshold, bool on) noexcept {
+  auto* history = getClipHistory (chan);
+  std::copy (history, history + clipDelay, run);
+  FloatVectorOperations::copy (run + clipDelay, samples, blockSize);
+  std::copy (run + blockSize, run + blockSize + clipDelay, history);
+  if (! on) {
+    FloatVectorOperations::copy (samples, run, blockSize);
+    return;
+  }
+  // the 4x signal is kept split into its phases, each after its history.
+  // Each phase of the interpolator is one vector multiply-add per tap
+  // across the sub-block.
+  auto* upsampledHistory = getUpsampledHistory (chan);
+  const auto phaseStride = decimatorHistory + blockSize;
+  for (auto phase = 0; phase < 4; ++phase) {
+    auto* phaseRun = upsampled + phase * phaseStride;
+    auto* phaseHistory = upsampledHistory + phase * decimatorHistory;
+    std::copy (phaseHistory, phaseHistory + decimatorHistory, phaseRun);
+    auto* output = phaseRun + decimatorHistory;
+    FloatVectorOperations::copyWithMultiply (output, run + clipDelay, phases[phase][0], blockSize);
+    for (auto tap = 1; tap < tapsPerPhase; ++tap)
+      FloatVectorOperations::addWithMultiply (output, run + clipDelay - tap, phases[phase][tap], blockSize);
+    for (auto i = 0; i < blockSize; ++i)
+      output[i] = saturate (output[i], threshold);
+    std::copy (phaseRun + blockSize, phaseRun + phaseStride, phaseHistory);
+  }
+  // decimating on the first phase of each sample puts the delay of both
+  // filters together on a whole number of samples. A tap reaches back to
+  // phase (4 - tap) % 4, so each tap is again one vector multiply-add.
+  FloatVectorOperations::clear (samples, blockSize);
+  for (auto tap = 0; tap < decimatorTaps; ++tap) {
+    auto phase = (4 - tap % 4) % 4;
+    auto lag = tap / 4 + (phase != 0 ? 1 : 0);
+    FloatVectorOperations::addWithMultiply (samples, upsampled + phase * phaseStride + decimatorHistory - lag,
+                                            decimator[tap], blockSize);
+  }
+}
+
+bool OutputLimiter::detect (const AudioSampleBuffer& subBlock, int channels, float threshold) noexcept {
+  const auto historySize = tapsPerPhase - 1;
+  auto anyOver = false;
+  for (auto chan = 0; chan < channels; ++chan) {
+    auto* history = getDetectorHistory (chan);
+    std::copy (history, history + historySize, run);
+    FloatVectorOperations::copy (run + historySize, subBlock.getReadPointer (chan), blockSize);
+    std::copy (run + blockSize, run + blockSize + historySize, history);
+    // no interpolated sample can exceed the run's peak times the
+    // interpolator's gain, so most sub-blocks stop here
+    auto range = FloatVectorOperations::findMinAndMax (run, historySize + blockSize);
+    if (jmax (-range.getStart(), range.getEnd()) * interpolatorGain <= threshold)
+      continue;
+    if (! anyOver)
+      FloatVectorOperations::clear (peaks, blockSize);
+    anyOver = true;
+    for (auto phase = 0; phase < 4; ++phase) {
+      auto* output = phaseOutput + phase * blockSize;
+      FloatVectorOperations::copyWithMultiply (output, run + historySize, phases[phase][0], blockSize);
+      for (auto tap = 1; tap < tapsPerPhase; ++tap)
+        FloatVectorOperations::addWithMultiply (output, run + historySize - tap, phases[phase][tap], blockSize);
+    }
+    // the interpolated peaks lie between the samples detectorDelay + 1 and
+    // detectorDelay before, which count too
+    const auto* older = run + historySize - detectorDelay - 1;
+    for (auto i = 0; i < blockSize; ++i) {
+      auto peak = jmax (std::abs (older[i]), std::abs (older[i + 1]));
+      for (auto phase = 0; phase < 4; ++phase)
+        peak = jmax (peak, std::abs (phaseOutput[phase * blockSize + i]));
+      peaks[i] = jmax (peaks[i], peak);
+    }
+  }
+  return anyOver;
+}
+
+void OutputLimiter::computeGains (bool anyOver, float threshold) noexcept {
+  auto lowest = gain;
+  for (auto i = 0; i < blockSize; ++i, ++sampleIndex) {
+    auto needed = (anyOver && peaks[i] > threshold) ? threshold / peaks[i] : 1.0f;
+    // the sliding minimum over the last lookahead + 1 samples: gains at
+    // least as large as the new one can never be the minimum again
+    while (queueCount > 0 && queueGain[(queueFront + queueCount - 1) % queueSize] >= needed)
+      --queueCount;
+    auto back = (queueFront + queueCount) % queueSize;
+    queueIndex[back] = sampleIndex;
+    queueGain[back] = needed;
+    ++queueCount;
+    if (queueIndex[queueFront] <= sampleIndex - lookahead - 1) {
+      queueFront = (queueFront + 1) % queueSize;
+      --queueCount;
+    }
+    auto minimum = queueGain[queueFront];
+    // averaging lookahead minima that each cover a peak reaches its gain
+    // exactly when the peak leaves the delay line
+    minimaSum += minimum - minima[minimaIndex];
+    minima[minimaIndex] = minimum;
+    if (++minimaIndex == lookahead)
+      minimaIndex = 0;
+    auto target = (float) (minimaSum / lookahead);
+    gain = (target < gain) ? target : gain + (target - gain) * releaseCoefficient;
+    gains[i] = gain;
+    lowest = jmin (lowest, gain);
+  }
+  // the running sum drifts with rounding, so it restarts from the ring
+  // whenever the ring wraps
+  if (minimaIndex < blockSize)
+    minimaSum = std::accumulate (minima, minima + lookahead, 0.0);
+  auto previous = lowestGain.load();
+  while (lowest < previous && ! lowestGain.compare_exchange_weak (previous, lowest)) {}
+}
@@ -0,0 +1,180 @@
+//==============================================================================
+// OutputLimiter.h
+// Keeps the output below a true-peak ceiling with a lookahead limiter.
+//==============================================================================
+
+#pragma once
+
+#include "DspArena.h"
+#include "SubBlockScheduler.h"
+
+/// OutputLimiter is the last stage of the output bus. Nothing the
+/// generators, the convolution or the level slider do can send a sample
+/// above its ceiling to the device, and peaks between samples are held to
+/// it as closely as a 4x true-peak meter measures them. That's within a
+/// fraction of a dB, except for strong content close to Nyquist, which
+/// any such meter reads low.
+///
+/// An optional soft clipper comes first. It rounds peaks off towards the
+/// ceiling at 4x the sample rate, so the harmonics it adds above the
+/// original Nyquist are filtered out rather than aliased. When it's off,
+/// the signal is delayed by the same amount instead, so the latency
+/// doesn't change when it's switched.
+///
+/// The limiter then estimates the true peak of every sample with a 4x
+/// polyphase interpolator, as LevelMeter does. Runs whose sample peak
+/// can't reach the ceiling skip the interpolator. The gain each peak
+/// needs is held over the lookahead window by a sliding minimum, which a
+/// monotonic queue keeps at O(1) amortized cost per sample. A moving
+/// average over the same window then ramps the gain down smoothly, and it
+/// is down in time for the peak, which the signal's delay line holds back.
+/// The gain recovers with an exponential release. One gain is applied to
+/// every channel, so the stereo image doesn't move.
+///
+/// All state lives in the DSP arena. getLatencySamples() reports the total
+/// delay, which is constant for a sample rate.
+class OutputLimiter
+{
+public:
+  /// Most channels limited. Further channels are left alone.
+  static constexpr int maxChannels = 64;
+  /// How far the limiter looks ahead, and its attack time.
+  static constexpr double lookaheadSeconds = 0.001;
+  /// Time for the gain to recover by 63% after a peak.
+  static constexpr double releaseSeconds = 0.05;
+
+  OutputLimiter();
+
+  /// Returns the arena space prepare() needs.
+  static size_t getArenaBytes (int numChannels, double sampleRate);
+
+  /// Places the delay lines in the arena and clears them. Call from
+  /// prepareToPlay().
+  void prepare (DspArena& arena, int numChannels, double sampleRate);
+
+  /// Forgets the arena memory handed out by prepare(). Call from
+  /// releaseResources() before the arena is released.
+  void release();
+
+  /// Returns the delay through the stage, in samples.
+  int getLatencySamples() const noexcept { return latency.load(); }
+
+  //==============================================================================
+  // Parameters, safe to set from any thread.
+
+  /// The highest true peak let through, -12 to 0 dBTP.
+  void setCeilingDb (float db) { ceiling.store (Decibels::decibelsToGain (jlimit (-12.0f, 0.0f, db))); }
+  /// Switches the soft clipper.
+  void setSoftClip (bool on) { softClip.store (on); }
+
+  /// Returns the largest gain reduction in dB since the last call, as a
+  /// negative number.
+  float takeGainReductionDb();
+
+  //==============================================================================
+  // Audio thread
+
+  /// Limits a sub-block in place.
+  void process (AudioSampleBuffer& subBlock) noexcept;
+
+  /// Returns how long the output can go on after the input goes silent,
+  /// and the sliding minimum and moving average take to hold only unity
+  /// gain and have their sum recounted, in samples.
+  int getTailSamples() const noexcept
+  {
+    return delayLineSize + clipDelay + tapsPerPhase + 2 * (lookahead + 1) + blockSize;
+  }
+
+  /// Stands in for process() on a silent sub-block once the input has
+  /// been silent for getTailSamples(). The delay lines and histories hold
+  /// only silence by then, and the gain only follows its release, so this
+  /// runs the release as process() would, until the gain stops changing.
+  /// Processing resumes from the same state either way.
+  void skip() noexcept;
+
+private:
+  static constexpr int blockSize = SubBlockScheduler::subBlockSize;
+  /// Taps per phase of the 4x interpolators. 96 taps keep them flat to
+  /// 20 kHz at 48 kHz.
+  static constexpr int tapsPerPhase = 24;
+  /// Taps of the clipper's decimation filter at 4x. With the interpolator's
+  /// 96 this puts the clipper's delay on a whole number of samples.
+  static constexpr int decimatorTaps = 98;
+  static constexpr int clipDelay = (4 * tapsPerPhase - 1 + decimatorTaps - 1) / 8;
+  /// Samples of each phase of the 4x signal the decimator reaches back.
+  static constexpr int decimatorHistory = (decimatorTaps + 3) / 4;
+  /// The interpolated peaks of a sample lie between the samples this many
+  /// and one more before it.
+  static constexpr int detectorDelay = tapsPerPhase / 2 - 1;
+
+  /// Rounds peaks of one channel off at 4x and decimates back, or delays
+  /// the channel by as much when the clipper is off.
+  void clip (int chan, float* samples, float threshold, bool on) noexcept;
+
+  /// Writes the true peak of each sample of the sub-block, the largest over
+  /// all channels, to peaks. Returns false if none can reach threshold.
+  bool detect (const AudioSampleBuffer& subBlock, int numChannels, float threshold) noexcept;
+
+  /// Turns the peaks into the gain of each sample.
+  void computeGains (bool anyOver, float threshold) noexcept;
+
+  /// Returns the fields of a channel.
+  float* getDelayLine (int chan) const noexcept { return state + (size_t) chan * channelStride; }
+  float* getDetectorHistory (int chan) const noexcept { return getDelayLine (chan) + delayLineSize; }
+  float* getClipHistory (int chan) const noexcept { return getDetectorHistory (chan) + tapsPerPhase - 1; }
+  float* getUpsampledHistory (int chan) const noexcept { return getClipHistory (chan) + clipDelay; }
+
+  static int getLookahead (double sampleRate);
+  static int getChannelStride (double sampleRate);
+
+  /// The interpolators' coefficients by phase and tap, the largest sum of
+  /// absolute coefficients of a phase, and the decimator's coefficients.
+  float phases[4][tapsPerPhase];
+  float interpolatorGain {0.0f};
+  float decimator[decimatorTaps];
+
+  /// Per channel: the delay line, then the histories of the detector, the
+  /// clipper's input and the phases of its upsampled signal.
+  float* state {nullptr};
+  size_t channelStride {0};
+  int numChannels {0};
+  int delayLineSize {0};
+  int delay {0};
+  int writeIndex {0};
+
+  /// The sliding minimum: a ring of the sample indices and gains that can
+  /// still become the minimum, in increasing order of both.
+  int64* queueIndex {nullptr};
+  float* queueGain {nullptr};
+  int queueSize {0};
+  int queueFront {0};
+  int queueCount {0};
+  int64 sampleIndex {0};
+
+  /// The moving average: a ring of the last lookahead minima and their sum.
+  float* minima {nullptr};
+  int lookahead {0};
+  int minimaIndex {0};
+  double minimaSum {0.0};
+
+  float gain {1.0f};
+  float releaseCoefficient {0.0f};
+  bool clipping {false};
+  /// True once skip() has found the gain fully recovered, until process()
+  /// runs again.
+  bool resting {false};
+
+  /// Scratch space for one sub-block.
+  float* peaks {nullptr};
+  float* gains {nullptr};
+  float* run {nullptr};
+  float* phaseOutput {nullptr};
+  float* upsampled {nullptr};
+
+  std::atomic<float> ceiling {Decibels::decibelsToGain (-1.0f)};
+  std::atomic<bool> softClip {false};
+  std::atomic<float> lowestGain {1.0f};
+  std::atomic<int> latency {0};
+
+  JUCE_DECLARE_NON_COPYABLE (OutputLimiter)
+};
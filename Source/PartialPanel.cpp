@@ -0,0 +1,135 @@
+//==============================================================================
+// PartialPanel.cpp
+// The controls of the additive resynthesis generator.
+//==============================================================================
+
+#include "PartialPanel.h"
+
+PartialPanel::PartialPanel (PartialSynth& s)
+: Thread ("Partial Loader"), synth (s) {
+  addAndMakeVisible (loadButton);
+  loadButton.onClick = [this] {
+    fileChooser = std::make_unique<FileChooser> ("Resynthesize...", File(),
+                                                 "*.wav;*.aif;*.aiff;*.flac;*" + String (PartialTracks::fileExtension));
+    auto flags = FileChooser::openMode | FileChooser::canSelectFiles;
+    fileChooser->launchAsync (flags, [this] (const FileChooser& chooser) {
+      auto file = chooser.getResult();
+      if (file.existsAsFile())
+        load (file);
+    });
+  };
+
+  addAndMakeVisible (status);
+  status.setJustificationType (Justification::centredRight);
+  status.setText (description, dontSendNotification);
+
+  addSlider (speedSlider, 0.1, 4.0, 1.0, " x speed");
+  speedSlider.setSkewFactorFromMidPoint (1.0);
+  addSlider (transposeSlider, -24.0, 24.0, 0.0, " st");
+  addSlider (limitSlider, 1.0, PartialSynth::maxPartials, PartialSynth::maxPartials, " partials");
+  limitSlider.setRange (1.0, PartialSynth::maxPartials, 1.0);
+  limitSlider.setSkewFactorFromMidPoint (64.0);
+}
+
+PartialPanel::~PartialPanel() {
+  stopThread (10000);
+}
+
+void PartialPanel::addSlider (Slider& slider, double minimum, double maximum, double value, const String& suffix) {
+  addAndMakeVisible (slider);
+  slider.setSliderStyle (Slider::LinearHorizontal);
+  slider.setTextBoxStyle (Slider::TextBoxLeft, false, 90, 22);
+  slider.setRange (minimum, maximum);
+  slider.setTextValueSuffix (suffix);
+  slider.setValue (value, dontSendNotification);
+  slider.addListener (this);
+}
+
+void PartialPanel::load (const File& file) {
+  // the analysis polls threadShouldExit() every frame, so this is quick
+  stopThread (10000);
+  {
+    const ScopedLock lock (loadLock);
+    pendingFile = file;
+    finished = false;
+    loaded.reset();
+  }
+  auto verb = file.hasFileExtension (PartialTracks::fileExtension) ? "Reading " : "Analyzing ";
+  status.setText (verb + file.getFileName() + "...", dontSendNotification);
+  startThread (Thread::Priority::low);
+}
+
+void PartialPanel::run() {
+  File file;
+  {
+    const ScopedLock lock (loadLock);
+    file = pendingFile;
+  }
+  String error;
+  std::unique_ptr<PartialTracks> tracks;
+  if (file.hasFileExtension (PartialTracks::fileExtension))
+    tracks = PartialTracks::load (file, error);
+  else
+    tracks = PartialTracks::analyze (file, error, [this] { return threadShouldExit(); });
+  if (threadShouldExit())
+    return;
+  auto text = error;
+  if (tracks != nullptr)
+    text = file.getFileName() + ": " + String (tracks->getNumTracks()) + " tracks, "
+           + String (tracks->getLengthInSeconds(), 1) + " s";
+  const ScopedLock lock (loadLock);
+  loaded = std::move (tracks);
+  loadedText = text;
+  finished = true;
+}
+
+void PartialPanel::updateStatus() {
+  std::unique_ptr<PartialTracks> tracks;
+  auto done = false;
+  {
+    const ScopedLock lock (loadLock);
+    if (finished) {
+      tracks = std::move (loaded);
+      description = loadedText;
+      finished = false;
+      done = true;
+    }
+  }
+  if (tracks != nullptr) {
+    synth.setTracks (std::move (tracks));
+    hasTracks = true;
+  }
+  synth.reclaim();
+  if (! done && isThreadRunning())
+    return;
+  auto text = description;
+  if (hasTracks)
+    text += ", " + String (synth.getNumPlaying()) + " playing";
+  status.setText (text, dontSendNotification);
+}
+
+void PartialPanel::resized() {
+  auto bounds = getLocalBounds();
+  auto row = bounds.removeFromTop (24);
+  loadButton.setBounds (row.removeFromLeft (118));
+  status.setBounds (row);
+
+  bounds.removeFromTop (4);
+  row = bounds.removeFromTop (24);
+  speedSlider.setBounds (row.removeFromLeft (row.getWidth() / 2));
+  transposeSlider.setBounds (row);
+
+  bounds.removeFromTop (4);
+  row = bounds.removeFromTop (24);
+  limitSlider.setBounds (row.removeFromLeft (row.getWidth() / 2));
+}
+
+void PartialPanel::sliderValueChanged (Slider* slider) {
+  auto value = (float) slider->getValue();
+  if (slider == &speedSlider)
+    synth.setSpeed (value);
+  else if (slider == &transposeSlider)
+    synth.setTranspose (value);
+  else if (slider == &limitSlider)
+    synth.setPartialLimit (roundToInt (value));
+}
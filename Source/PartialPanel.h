@@ -0,0 +1,63 @@
+//==============================================================================
+// PartialPanel.h
+// The controls of the additive resynthesis generator.
+//==============================================================================
+
+#pragma once
+
+#include "PartialSynth.h"
+
+/// PartialPanel loads partial tracks into a PartialSynth and sets its
+/// speed, transposition and partial limit. Its Load button opens an audio
+/// file, which is analyzed, or a .partials file written by
+/// `WaveLab --analyze`. Files are analyzed or read on a background thread;
+/// updateStatus() hands finished tracks to the synth and shows what is
+/// loaded and how many partials are playing.
+class PartialPanel : public Component, public Slider::Listener, private Thread
+{
+public:
+  explicit PartialPanel (PartialSynth& synth);
+
+  /// Stops any analysis in progress.
+  ~PartialPanel() override;
+
+  /// Starts analyzing an audio file, or reading a .partials file, in the
+  /// background. Replaces any load in progress.
+  void load (const File& file);
+
+  /// Hands finished tracks to the synth, deletes the tracks it has
+  /// replaced and shows the status. Call from a timer.
+  void updateStatus();
+
+  void resized() override;
+  void sliderValueChanged (Slider* slider) override;
+
+private:
+  /// The loader thread: analyzes or reads pendingFile.
+  void run() override;
+
+  /// Sets up a slider with the app's text box style.
+  void addSlider (Slider& slider, double minimum, double maximum, double value, const String& suffix);
+
+  PartialSynth& synth;
+  TextButton loadButton {"Load..."};
+  Label status;
+  Slider speedSlider;
+  Slider transposeSlider;
+  Slider limitSlider;
+  std::unique_ptr<FileChooser> fileChooser;
+
+  /// The file being loaded, and the tracks and description of the last
+  /// finished load, guarded by loadLock.
+  File pendingFile;
+  std::unique_ptr<PartialTracks> loaded;
+  String loadedText;
+  bool finished {false};
+  CriticalSection loadLock;
+
+  /// What the synth has been given, shown with the partials playing.
+  String description {"No partials loaded"};
+  bool hasTracks {false};
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PartialPanel)
+};
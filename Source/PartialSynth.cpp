@@ -0,0 +1,198 @@
+//==============================================================================
+// PartialSynth.cpp
+// Resynthesizes partial tracks with a bank of recursive oscillators.
+//==============================================================================
+
+#include "PartialSynth.h"
+
+namespace
+{
+  /// Returns sin (x) and cos (x) for |x| up to pi / 2 from their Taylor
+  /// series, accurate to about 1e-7. Plain arithmetic, so loops of it
+  /// vectorize where loops of std::sin() don't.
+  forcedinline void getSinCos (float x, float& sine, float& cosine) noexcept
+  {
+    auto x2 = x * x;
+    sine = x * (1.0f - x2 / 6.0f * (1.0f - x2 / 20.0f * (1.0f - x2 / 42.0f * (1.0f - x2 / 72.0f * (1.0f - x2 / 110.0f)))));
+    cosine = 1.0f - x2 / 2.0f * (1.0f - x2 / 12.0f * (1.0f - x2 / 30.0f * (1.0f - x2 / 56.0f * (1.0f - x2 / 90.0f * (1.0f - x2 / 132.0f)))));
+  }
+}
+
+PartialSynth::~PartialSynth() {
+  delete incoming.exchange (nullptr);
+  delete retired.exchange (nullptr);
+  delete playing;
+}
+
+size_t PartialSynth::getArenaBytes() {
+  return DspArena::bytesFor<int> (maxPartials) + DspArena::bytesFor<float> ((size_t) NumFields * maxPartials);
+}
+
+void PartialSynth::prepare (DspArena& arena, double sampleRate) {
+  oscillators = arena.allocate<float> ((size_t) NumFields * maxPartials);
+  track = arena.allocate<int> (maxPartials);
+  if (track == nullptr) {
+    release();
+    return;
+  }
+  srate = sampleRate;
+  numOscillators = 0;
+  position = 0.0;
+  nextTrack = 0;
+}
+
+void PartialSynth::release() {
+  oscillators = nullptr;
+  track = nullptr;
+  numOscillators = 0;
+  numPlaying.store (0);
+}
+
+void PartialSynth::setTracks (std::unique_ptr<PartialTracks> newTracks) {
+  reclaim();
+  // tracks still waiting were never played
+  delete incoming.exchange (newTracks.release());
+}
+
+void PartialSynth::reclaim() {
+  delete retired.exchange (nullptr);
+}
+
+void PartialSynth::update() noexcept {
+  if (retired.load() != nullptr)
+    return;
+  if (auto* next = incoming.exchange (nullptr)) {
+    retired.store (playing);
+    playing = next;
+    numOscillators = 0;
+    position = 0.0;
+    nextTrack = 0;
+  }
+}
+
+void PartialSynth::render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain) {
+  auto* synth = state.engines.partials;
+  auto& buffer = *bufferToFill.buffer;
+  if (synth == nullptr || synth->track == nullptr) {
+    bufferToFill.clearActiveBufferRegion();
+    return;
+  }
+  synth->update();
+  if (synth->playing == nullptr || synth->playing->getNumTracks() == 0) {
+    synth->numPlaying.store (0);
+    bufferToFill.clearActiveBufferRegion();
+    return;
+  }
+  if (buffer.getNumChannels() == 0 || bufferToFill.numSamples <= 0)
+    return;
+  auto* first = buffer.getWritePointer (0, bufferToFill.startSample);
+  for (auto done = 0; done < bufferToFill.numSamples; done += controlPeriod) {
+    auto num = jmin (controlPeriod, bufferToFill.numSamples - done);
+    synth->control (state.random, num);
+    synth->process (first + done, num, gain);
+  }
+  synth->numPlaying.store (synth->numOscillators);
+  for (auto chan = 1; chan < buffer.getNumChannels(); ++chan)
+    FloatVectorOperations::copy (buffer.getWritePointer (chan, bufferToFill.startSample), first, bufferToFill.numSamples);
+}
+
+void PartialSynth::control (Random& random, int numSamples) noexcept {
+  auto& tracks = *playing;
+  // an oscillator whose track has faded out is free
+  for (auto k = numOscillators; --k >= 0;) {
+    auto& t = tracks.getTrack (track[k]);
+    if (position >= t.firstFrame + t.numFrames)
+      remove (k);
+  }
+  // every track has faded out one frame after the last, so the loop starts
+  // over from silence
+  auto loopLength = tracks.getNumFrames() + 1.0;
+  if (position >= loopLength) {
+    position = std::fmod (position, loopLength);
+    nextTrack = 0;
+  }
+
+  auto framesPerSample = speed.load() * tracks.getSampleRate() / (tracks.getHopSize() * srate);
+  auto end = position + numSamples * framesPerSample;
+  auto middle = 0.5 * (position + end);
+  auto limit = partialLimit.load();
+  // tracks fade in over the frame before their first
+  for (; nextTrack < tracks.getNumTracks() && tracks.getTrack (nextTrack).firstFrame - 1 < end; ++nextTrack) {
+    auto& t = tracks.getTrack (nextTrack);
+    if (numOscillators >= limit || position >= t.firstFrame + t.numFrames)
+      continue;
+    // random starting phases keep the crest factor of harmonic sounds low
+    auto k = numOscillators++;
+    auto phase = random.nextFloat() * MathConstants<float>::twoPi;
+    track[k] = nextTrack;
+    field (Real)[k] = std::cos (phase);
+    field (Imag)[k] = std::sin (phase);
+    field (Amplitude)[k] = 0.0f;
+  }
+
+  auto ratio = std::pow (2.0f, transpose.load() / 12.0f);
+  auto highest = (float) (0.45 * srate);
+  auto* const re = field (Real);
+  auto* const im = field (Imag);
+  auto* const cr = field (RotationReal);
+  auto* const ci = field (RotationImag);
+  auto* const amp = field (Amplitude);
+  auto* const step = field (AmplitudeStep);
+  // the track values first, into the fields they end up setting
+  for (auto k = 0; k < numOscillators; ++k) {
+    auto& t = tracks.getTrack (track[k]);
+    auto frequency = tracks.getPoint (t, middle).frequency * ratio;
+    auto target = tracks.getPoint (t, end).amplitude;
+    if (! (frequency > 0.0f && frequency < highest && target > 0.0f))
+      frequency = target = 0.0f;
+    ci[k] = frequency;
+    step[k] = target;
+  }
+  // then the rotations and ramps of every oscillator in a loop that
+  // vectorizes. Every rotation is at most 0.9 pi per sample, so it's
+  // computed from its half, which the series covers.
+  auto halfRadiansPerHz = (float) (MathConstants<double>::pi / srate);
+  auto periodScale = 1.0f / (float) numSamples;
+  for (auto k = 0; k < numOscillators; ++k) {
+    float sine, cosine;
+    getSinCos (ci[k] * halfRadiansPerHz, sine, cosine);
+    cr[k] = cosine * cosine - sine * sine;
+    ci[k] = 2.0f * sine * cosine;
+    step[k] = (step[k] - amp[k]) * periodScale;
+    // one Newton step towards 1 / |phasor| removes the rounding of a period
+    auto g = 1.5f - 0.5f * (re[k] * re[k] + im[k] * im[k]);
+    re[k] *= g;
+    im[k] *= g;
+  }
+  position = end;
+}
+
+void PartialSynth::process (float* output, int numSamples, float gain) noexcept {
+  const auto count = numOscillators;
+  auto* const re = field (Real);
+  auto* const im = field (Imag);
+  const auto* const cr = field (RotationReal);
+  const auto* const ci = field (RotationImag);
+  auto* const amp = field (Amplitude);
+  const auto* const step = field (AmplitudeStep);
+  auto* const tap = field (Tap);
+  for (auto i = 0; i < numSamples; ++i) {
+    // every oscillator, with no dependency between oscillators
+    for (auto k = 0; k < count; ++k) {
+      auto x = re[k];
+      auto y = im[k];
+      re[k] = x * cr[k] - y * ci[k];
+      im[k] = x * ci[k] + y * cr[k];
+      amp[k] += step[k];
+      tap[k] = amp[k] * im[k];
+    }
+    output[i] = gain * Generators::getSum (tap, count);
+  }
+}
+
+void PartialSynth::remove (int k) noexcept {
+  auto last = --numOscillators;
+  track[k] = track[last];
+  for (auto f : {Real, Imag, Amplitude})
+    field (f)[k] = field (f)[last];
+}
@@ -0,0 +1,148 @@
+//==============================================================================
+// PartialSynth.h
+// Resynthesizes partial tracks with a bank of recursive oscillators.
+//==============================================================================
+
+#pragma once
+
+#include "Generators.h"
+#include "DspArena.h"
+#include "PartialTracks.h"
+
+/// PartialSynth loops a set of PartialTracks through a bank of up to
+/// maxPartials sine oscillators, at an adjustable speed and transposition.
+/// It generalizes the BL_* additive kernels, which sum fixed harmonics of one
+/// frequency, to any number of partials whose frequencies and amplitudes all
+/// change over time.
+///
+/// Each oscillator is a phasor rotated by a complex multiply every sample,
+/// so a partial costs a handful of multiplies and adds per sample and no
+/// sin(). Every controlPeriod samples the bank reads each playing track at
+/// the current position: its amplitude ramps linearly to the value at the
+/// end of the period and its rotation is set from the frequency in the
+/// middle. The phasors carry the phase across periods, so frequency changes
+/// are glitch free, and they are renormalized each period so rounding never
+/// builds up. The oscillator state is stored as one array per field in the
+/// DSP arena, and the per sample loop runs across all oscillators in a loop
+/// the compiler vectorizes, as in StringBank.
+///
+/// Tracks are started in order as the position reaches them, fade in and
+/// out over one analysis frame and free their oscillator when they end. A
+/// track that starts while the partial limit is reached isn't played.
+/// Partials transposed above 0.45 of the sample rate are silenced.
+///
+/// New tracks are handed over from the message thread through a pair of
+/// atomic pointers: the audio thread adopts them at the start of a block
+/// and passes the set they replace back, to be deleted by the next
+/// setTracks() or reclaim().
+class PartialSynth
+{
+public:
+  /// Size of the oscillator bank.
+  static constexpr int maxPartials = 512;
+
+  /// Samples between updates of the oscillators' frequencies and amplitude
+  /// ramps.
+  static constexpr int controlPeriod = 32;
+
+  PartialSynth() = default;
+
+  /// Deletes every set of tracks. The audio thread must have stopped.
+  ~PartialSynth();
+
+  /// Returns the arena space prepare() needs.
+  static size_t getArenaBytes();
+
+  /// Places the oscillators in the arena and silences them. Call from
+  /// prepareToPlay().
+  void prepare (DspArena& arena, double sampleRate);
+
+  /// Forgets the arena memory handed out by prepare(). Call from
+  /// releaseResources() before the arena is released.
+  void release();
+
+  //==============================================================================
+  // Message thread
+
+  /// Hands new tracks to the audio thread, which plays them from the start
+  /// from its next block. Also deletes tracks the audio thread is done with.
+  void setTracks (std::unique_ptr<PartialTracks> newTracks);
+
+  /// Deletes the tracks the audio thread has passed back. Call regularly,
+  /// e.g. from a timer.
+  void reclaim();
+
+  /// Returns the number of oscillators playing, as of the last block.
+  int getNumPlaying() const noexcept { return numPlaying.load(); }
+
+  //==============================================================================
+  // Parameters, safe to set from any thread. New values apply from the next
+  // control period.
+
+  /// Playback speed, 0.1 to 4 times the analyzed speed. The pitch doesn't
+  /// change with it.
+  void setSpeed (float ratio) { speed.store (jlimit (0.1f, 4.0f, ratio)); }
+  /// Transposition of every partial, -24 to 24 semitones.
+  void setTranspose (float semitones) { transpose.store (jlimit (-24.0f, 24.0f, semitones)); }
+  /// The most partials played at once, 1 to maxPartials. Lowering it stops
+  /// new tracks starting until fewer are playing.
+  void setPartialLimit (int count) { partialLimit.store (jlimit (1, maxPartials, count)); }
+
+  //==============================================================================
+  // Audio thread
+
+  /// The generator function. Renders the synth that
+  /// state.engines.partials points to.
+  static void render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain);
+
+private:
+  /// Adopts tracks handed over by setTracks(), if any.
+  void update() noexcept;
+
+  /// Renders numSamples, at most controlPeriod, into output.
+  void process (float* output, int numSamples, float gain) noexcept;
+
+  /// Frees the oscillators of ended tracks, starts oscillators for the
+  /// tracks that begin in the next numSamples, sets every oscillator's
+  /// rotation and amplitude ramp for them and advances the position.
+  void control (Random& random, int numSamples) noexcept;
+
+  /// Frees oscillator k, moving the last one into its place.
+  void remove (int k) noexcept;
+
+  /// The fields of an oscillator: its phasor, whose imaginary part is the
+  /// output, the rotation applied each sample, its amplitude and the step
+  /// of its amplitude ramp, and its output for the current sample.
+  enum Field { Real, Imag, RotationReal, RotationImag, Amplitude, AmplitudeStep, Tap, NumFields };
+
+  /// Returns the array of a field, with one entry per oscillator.
+  float* field (Field f) const noexcept { return oscillators + (size_t) f * maxPartials; }
+
+  /// The fields, maxPartials apart in one block, so the compiler can tell
+  /// the arrays apart and needn't check them for overlap before
+  /// vectorizing.
+  float* oscillators {nullptr};
+  /// The index of the track each oscillator plays.
+  int* track {nullptr};
+  int numOscillators {0};
+
+  double srate {0.0};
+  /// The tracks being played, the position in their frames and the next
+  /// track to start.
+  PartialTracks* playing {nullptr};
+  double position {0.0};
+  int nextTrack {0};
+
+  /// The tracks handed over by setTracks(), and the ones the audio thread
+  /// has replaced. The audio thread only adopts new tracks while nothing
+  /// waits in retired, so it never has more than one to pass back.
+  std::atomic<PartialTracks*> incoming {nullptr};
+  std::atomic<PartialTracks*> retired {nullptr};
+
+  std::atomic<float> speed {1.0f};
+  std::atomic<float> transpose {0.0f};
+  std::atomic<int> partialLimit {maxPartials};
+  std::atomic<int> numPlaying {0};
+
+  JUCE_DECLARE_NON_COPYABLE (PartialSynth)
+};
@@ -0,0 +1,315 @@
+//==============================================================================
+// PartialTracks.cpp
+// Sinusoidal partial tracks analyzed from audio files.
+//==============================================================================
+
+#include "PartialTracks.h"
+
+namespace
+{
+  using Point = PartialTracks::Point;
+
+  /// Peaks below -90 dBFS are ignored.
+  constexpr float absoluteFloor = 3.16e-5f;
+  /// Peaks more than 80 dB below the loudest peak of their frame are ignored.
+  constexpr float relativeFloor = 1.0e-4f;
+  /// Partials below this frequency are ignored.
+  constexpr double lowestFrequency = 20.0;
+  /// The largest relative frequency change of a track from one frame to the
+  /// next, but never less than one bin of the unpadded frame.
+  constexpr double maxDeviation = 0.03;
+
+  constexpr char magic[8] = {'W', 'L', 'P', 'A', 'R', 'T', 'S', '1'};
+  constexpr int formatVersion = 1;
+
+  /// Fills window with a 4 term Blackman-Harris window.
+  void fillWindow (std::vector<float>& window)
+  {
+    auto size = (double) window.size();
+    for (size_t i = 0; i < window.size(); ++i) {
+      auto x = MathConstants<double>::twoPi * (i + 0.5) / size;
+      window[i] = (float) (0.35875 - 0.48829 * std::cos (x) + 0.14128 * std::cos (2.0 * x)
+                           - 0.01168 * std::cos (3.0 * x));
+    }
+  }
+
+  /// Settings and buffers shared by the frames of an analysis.
+  struct Analysis
+  {
+    const float* audio;
+    int numSamples;
+    int frameSize;
+    int hopSize;
+    int fftOrder;
+    double sampleRate;
+    std::vector<float> window;
+    /// Turns a spectrum magnitude into a sinusoid's peak amplitude.
+    float amplitudeScale;
+    /// The peaks of each frame, loudest first.
+    std::vector<std::vector<Point>> peaks;
+  };
+
+  /// Finds the peaks of one frame, centred on sample frame * hopSize.
+  /// spectrum holds twice the FFT size.
+  void findPeaks (Analysis& analysis, int frame, dsp::FFT& fft, std::vector<float>& spectrum)
+  {
+    auto fftSize = 1 << analysis.fftOrder;
+    std::fill (spectrum.begin(), spectrum.end(), 0.0f);
+    auto start = frame * analysis.hopSize - analysis.frameSize / 2;
+    auto first = jmax (0, -start);
+    auto last = jmin (analysis.frameSize, analysis.numSamples - start);
+    for (auto i = first; i < last; ++i)
+      spectrum[(size_t) i] = analysis.audio[start + i] * analysis.window[(size_t) i];
+    fft.performFrequencyOnlyForwardTransform (spectrum.data());
+
+    auto binWidth = analysis.sampleRate / fftSize;
+    auto loudest = 0.0f;
+    for (auto bin = 1; bin < fftSize / 2; ++bin)
+      loudest = jmax (loudest, spectrum[(size_t) bin]);
+    auto floor = jmax (absoluteFloor / analysis.amplitudeScale, loudest * relativeFloor);
+    auto& peaks = analysis.peaks[(size_t) frame];
+    for (auto bin = jmax (2, (int) (lowestFrequency / binWidth)); bin < fftSize / 2 - 1; ++bin) {
+      auto m = spectrum[(size_t) bin];
+      if (m <= floor || m <= spectrum[(size_t) bin - 1] || m < spectrum[(size_t) bin + 1])
+        continue;
+      // a parabola through the log magnitudes finds the top of the main lobe
+      auto a = std::log (spectrum[(size_t) bin - 1] + 1.0e-20f);
+      auto b = std::log (m);
+      auto c = std::log (spectrum[(size_t) bin + 1] + 1.0e-20f);
+      auto offset = 0.5f * (a - c) / (a - 2.0f * b + c);
+      auto top = b - 0.25f * (a - c) * offset;
+      peaks.push_back ({(float) ((bin + offset) * binWidth), std::exp (top) * analysis.amplitudeScale});
+    }
+    std::sort (peaks.begin(), peaks.end(), [] (const Point& x, const Point& y) { return x.amplitude > y.amplitude; });
+    if (peaks.size() > (size_t) PartialTracks::maxPeaks)
+      peaks.resize ((size_t) PartialTracks::maxPeaks);
+  }
+}
+
+int PartialTracks::getFrameSize (double sampleRate) {
+  return jmax (256, nextPowerOfTwo ((int) std::ceil (sampleRate * 0.04)));
+}
+
+std::unique_ptr<PartialTracks> PartialTracks::analyze (const File& file, String& error,
+                                                       const std::function<bool()>& shouldStop) {
+  AudioFormatManager formats;
+  formats.registerBasicFormats();
+  std::unique_ptr<AudioFormatReader> reader (formats.createReaderFor (file));
+  if (reader == nullptr) {
+    error = "Can't read " + file.getFullPathName() + ".";
+    return nullptr;
+  }
+  if (reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0 || reader->numChannels == 0) {
+    error = file.getFileName() + " holds no audio.";
+    return nullptr;
+  }
+  if (reader->lengthInSamples > maxSeconds * reader->sampleRate) {
+    error = file.getFileName() + " is longer than " + String ((int) maxSeconds) + " seconds.";
+    return nullptr;
+  }
+  auto numSamples = (int) reader->lengthInSamples;
+  auto numChannels = (int) reader->numChannels;
+  AudioSampleBuffer audio (numChannels, numSamples);
+  if (! reader->read (&audio, 0, numSamples, 0, true, true)) {
+    error = "Can't read " + file.getFullPathName() + ".";
+    return nullptr;
+  }
+  for (auto chan = 1; chan < numChannels; ++chan)
+    audio.addFrom (0, 0, audio, chan, 0, numSamples);
+  audio.applyGain (0, 0, numSamples, 1.0f / (float) numChannels);
+
+  auto tracks = analyze (audio, reader->sampleRate, shouldStop);
+  if (tracks == nullptr)
+    error = "Analysis stopped.";
+  return tracks;
+}
+
+std::unique_ptr<PartialTracks> PartialTracks::analyze (const AudioSampleBuffer& audio, double sampleRate,
+                                                       const std::function<bool()>& shouldStop) {
+  Analysis analysis;
+  analysis.audio = audio.getReadPointer (0);
+  analysis.numSamples = audio.getNumSamples();
+  analysis.frameSize = getFrameSize (sampleRate);
+  analysis.hopSize = analysis.frameSize / 4;
+  // zero padded to twice the frame, for a finer spectrum to interpolate
+  analysis.fftOrder = roundToInt (std::log2 (analysis.frameSize)) + 1;
+  analysis.sampleRate = sampleRate;
+  analysis.window.resize ((size_t) analysis.frameSize);
+  fillWindow (analysis.window);
+  auto windowSum = std::accumulate (analysis.window.begin(), analysis.window.end(), 0.0);
+  analysis.amplitudeScale = (float) (2.0 / windowSum);
+  auto numFrames = (analysis.numSamples + analysis.hopSize - 1) / analysis.hopSize + 1;
+  analysis.peaks.resize ((size_t) numFrames);
+
+  // Every thread, this one included, takes the next frame until none are
+  // left. Each has its own FFT and spectrum.
+  std::atomic<int> nextFrame {0};
+  std::atomic<bool> stopped {false};
+  auto work = [&] {
+    dsp::FFT fft (analysis.fftOrder);
+    std::vector<float> spectrum ((size_t) 2 << analysis.fftOrder);
+    for (;;) {
+      auto frame = nextFrame++;
+      if (frame >= numFrames || stopped.load())
+        return;
+      if (shouldStop && shouldStop()) {
+        stopped.store (true);
+        return;
+      }
+      findPeaks (analysis, frame, fft, spectrum);
+    }
+  };
+  auto numHelpers = jlimit (0, 15, SystemStats::getNumCpus() - 1);
+  {
+    ThreadPool pool (jmax (1, numHelpers));
+    WaitableEvent finished;
+    std::atomic<int> running {numHelpers};
+    for (auto i = 0; i < numHelpers; ++i)
+      pool.addJob ([&] {
+        work();
+        if (--running == 0)
+          finished.signal();
+      });
+    work();
+    if (numHelpers > 0)
+      finished.wait();
+  }
+  if (stopped.load())
+    return nullptr;
+
+  // Tracking. open holds every track started so far, active those that
+  // reached the previous frame, sorted by their last frequency.
+  struct OpenTrack
+  {
+    int firstFrame;
+    std::vector<Point> points;
+  };
+  std::vector<OpenTrack> open;
+  std::vector<int> active, next;
+  std::vector<float> activeFrequency;
+  std::vector<bool> claimed;
+  auto binWidth = sampleRate / analysis.frameSize;
+  for (auto frame = 0; frame < numFrames; ++frame) {
+    activeFrequency.clear();
+    for (auto index : active)
+      activeFrequency.push_back (open[(size_t) index].points.back().frequency);
+    claimed.assign (active.size(), false);
+    next.clear();
+    for (auto& peak : analysis.peaks[(size_t) frame]) {
+      auto tolerance = (float) jmax (binWidth, maxDeviation * peak.frequency);
+      auto nearest = -1;
+      auto nearestDistance = tolerance;
+      auto j = std::lower_bound (activeFrequency.begin(), activeFrequency.end(), peak.frequency - tolerance)
+               - activeFrequency.begin();
+      for (; j < (int) activeFrequency.size() && activeFrequency[(size_t) j] <= peak.frequency + tolerance; ++j) {
+        auto distance = std::abs (activeFrequency[(size_t) j] - peak.frequency);
+        if (! claimed[(size_t) j] && distance <= nearestDistance) {
+          nearest = (int) j;
+          nearestDistance = distance;
+        }
+      }
+      if (nearest >= 0) {
+        claimed[(size_t) nearest] = true;
+        auto index = active[(size_t) nearest];
+        open[(size_t) index].points.push_back (peak);
+        next.push_back (index);
+      } else {
+        open.push_back ({frame, {peak}});
+        next.push_back ((int) open.size() - 1);
+      }
+    }
+    std::sort (next.begin(), next.end(), [&] (int x, int y) {
+      return open[(size_t) x].points.back().frequency < open[(size_t) y].points.back().frequency;
+    });
+    std::swap (active, next);
+    // the peaks are no longer needed
+    std::vector<Point>().swap (analysis.peaks[(size_t) frame]);
+  }
+
+  // open is in order of first frame already
+  auto result = std::make_unique<PartialTracks>();
+  result->sampleRate = sampleRate;
+  result->hopSize = analysis.hopSize;
+  result->numFrames = numFrames;
+  for (auto& track : open) {
+    if ((int) track.points.size() < minFrames)
+      continue;
+    result->tracks.push_back ({track.firstFrame, (int) track.points.size(), (int) result->points.size()});
+    result->points.insert (result->points.end(), track.points.begin(), track.points.end());
+  }
+  return result;
+}
+
+String PartialTracks::save (const File& file) const {
+  // write a private file first, so a failed save leaves the old file
+  auto temp = file.withFileExtension ("tmp").getNonexistentSibling();
+  {
+    FileOutputStream out (temp);
+    if (! out.openedOk())
+      return "Can't open " + temp.getFullPathName() + " for writing.";
+    auto ok = out.write (magic, sizeof (magic)) && out.writeInt (formatVersion)
+              && out.writeDouble (sampleRate) && out.writeInt (hopSize) && out.writeInt (numFrames)
+              && out.writeInt (getNumTracks()) && out.writeInt (getNumPoints());
+    for (auto& track : tracks)
+      ok = ok && out.writeInt (track.firstFrame) && out.writeInt (track.numFrames);
+    for (auto& point : points)
+      ok = ok && out.writeFloat (point.frequency) && out.writeFloat (point.amplitude);
+    out.flush();
+    if (! ok || out.getStatus().failed()) {
+      temp.deleteFile();
+      return "Can't write " + temp.getFullPathName() + ".";
+    }
+  }
+  if (! temp.moveFileTo (file)) {
+    temp.deleteFile();
+    return "Can't replace " + file.getFullPathName() + ".";
+  }
+  return {};
+}
+
+std::unique_ptr<PartialTracks> PartialTracks::load (const File& file, String& error) {
+  FileInputStream in (file);
+  if (in.failedToOpen()) {
+    error = "Can't open " + file.getFullPathName() + ".";
+    return nullptr;
+  }
+  error = file.getFileName() + " is not a partials file.";
+  char header[sizeof (magic)] {};
+  if (in.read (header, (int) sizeof (header)) != (int) sizeof (header)
+      || std::memcmp (header, magic, sizeof (magic)) != 0 || in.readInt() != formatVersion)
+    return nullptr;
+  auto result = std::make_unique<PartialTracks>();
+  result->sampleRate = in.readDouble();
+  result->hopSize = in.readInt();
+  result->numFrames = in.readInt();
+  auto numTracks = in.readInt();
+  auto numPoints = in.readInt();
+  const int64 headerBytes = (int64) sizeof (magic) + 4 + 8 + 4 * 4;
+  if (! (result->sampleRate > 0.0) || result->hopSize <= 0 || result->numFrames < 0
+      || numTracks < 0 || numPoints < 0
+      || in.getTotalLength() != headerBytes + 8 * (int64) numTracks + 8 * (int64) numPoints)
+    return nullptr;
+
+  result->tracks.resize ((size_t) numTracks);
+  auto total = (int64) 0;
+  auto previousFirst = 0;
+  for (auto& track : result->tracks) {
+    track.firstFrame = in.readInt();
+    track.numFrames = in.readInt();
+    track.firstPoint = (int) total;
+    if (track.firstFrame < previousFirst || track.numFrames <= 0
+        || (int64) track.firstFrame + track.numFrames > result->numFrames)
+      return nullptr;
+    previousFirst = track.firstFrame;
+    total += track.numFrames;
+  }
+  if (total != numPoints)
+    return nullptr;
+  result->points.resize ((size_t) numPoints);
+  for (auto& point : result->points) {
+    point.frequency = in.readFloat();
+    point.amplitude = in.readFloat();
+  }
+  error.clear();
+  return result;
+}
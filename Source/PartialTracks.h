@@ -0,0 +1,128 @@
+//==============================================================================
+// PartialTracks.h
+// Sinusoidal partial tracks analyzed from audio files.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/// PartialTracks holds the sinusoidal partials of a sound as breakpoint
+/// tracks. The breakpoints of every track lie on one grid of analysis
+/// frames, hopSize samples of the analyzed audio apart, so a breakpoint is
+/// just a frequency and an amplitude (8 bytes) and a track is its first
+/// frame and its run of breakpoints. Tracks are sorted by first frame, so a
+/// player starts them in order. A track fades in from silence over the frame
+/// before its first breakpoint and out over the frame after its last.
+///
+/// analyze() builds the tracks from audio:
+/// * Each frame is windowed with a 4 term Blackman-Harris window, whose
+///   side lobes are below -92 dB and so never picked as partials, zero
+///   padded to twice its length and transformed. The frames are independent
+///   and are spread over a thread pool.
+/// * The local maxima of each magnitude spectrum above an absolute and a
+///   relative floor are its peaks. Their frequency and amplitude come from
+///   a parabola through the log magnitudes of the peak bin and its
+///   neighbours. Only the loudest maxPeaks of a frame are kept.
+/// * Tracking then runs through the frames in order. Each peak, loudest
+///   first, continues the unclaimed track of the previous frame nearest to
+///   it in frequency, if one is close enough, or starts a new track. Tracks
+///   that find no peak end, and tracks shorter than minFrames are dropped.
+///
+/// save() and load() store the tracks in a little endian binary file.
+class PartialTracks
+{
+public:
+  /// A breakpoint: frequency in Hz and peak amplitude.
+  struct Point
+  {
+    float frequency;
+    float amplitude;
+  };
+
+  /// A track: numFrames breakpoints from firstFrame on, stored from
+  /// points[firstPoint].
+  struct Track
+  {
+    int firstFrame;
+    int numFrames;
+    int firstPoint;
+  };
+
+  /// The most peaks kept from one analysis frame.
+  static constexpr int maxPeaks = 256;
+  /// The fewest frames a track may last.
+  static constexpr int minFrames = 4;
+  /// The longest audio analyzed, in seconds.
+  static constexpr double maxSeconds = 600.0;
+  /// Extension of the files save() writes.
+  static constexpr const char* fileExtension = ".partials";
+
+  /// Analyzes the channels of an audio file in any format JUCE reads, mixed
+  /// down to mono. Returns null and sets error if the file can't be read or
+  /// the analysis is stopped. Slow, so call it off the audio and message
+  /// threads. shouldStop, if set, is polled between frames on every
+  /// analysis thread.
+  static std::unique_ptr<PartialTracks> analyze (const File& file, String& error,
+                                                 const std::function<bool()>& shouldStop = {});
+
+  /// Analyzes channel 0 of audio at sampleRate. Returns null if shouldStop
+  /// returned true.
+  static std::unique_ptr<PartialTracks> analyze (const AudioSampleBuffer& audio, double sampleRate,
+                                                 const std::function<bool()>& shouldStop = {});
+
+  /// Reads tracks written by save(). Returns null and sets error if the
+  /// file can't be read or isn't a partials file.
+  static std::unique_ptr<PartialTracks> load (const File& file, String& error);
+
+  /// Writes the tracks to file, replacing it. Returns an error message, or
+  /// an empty string on success.
+  String save (const File& file) const;
+
+  /// Returns the analysis frame length used at sampleRate: the shortest
+  /// power of two of at least 40 ms. Frames overlap by three quarters.
+  static int getFrameSize (double sampleRate);
+
+  double getSampleRate() const noexcept { return sampleRate; }
+  int getHopSize() const noexcept { return hopSize; }
+  int getNumFrames() const noexcept { return numFrames; }
+  int getNumTracks() const noexcept { return (int) tracks.size(); }
+  int getNumPoints() const noexcept { return (int) points.size(); }
+  double getLengthInSeconds() const noexcept { return numFrames * (double) hopSize / sampleRate; }
+  const Track& getTrack (int index) const noexcept { return tracks[(size_t) index]; }
+
+  /// Returns the frequency and amplitude of a track at a position in
+  /// frames, interpolating linearly between breakpoints. Before and after
+  /// the track the amplitude ramps to zero over one frame at the frequency
+  /// of its nearest breakpoint.
+  Point getPoint (const Track& track, double frame) const noexcept
+  {
+    auto local = jlimit (-1.0, (double) track.numFrames, frame - track.firstFrame);
+    auto index = (int) std::floor (local);
+    auto fraction = (float) (local - index);
+    auto a = getBreakpoint (track, index);
+    auto b = getBreakpoint (track, index + 1);
+    return {a.frequency + fraction * (b.frequency - a.frequency),
+            a.amplitude + fraction * (b.amplitude - a.amplitude)};
+  }
+
+private:
+  /// Returns breakpoint index of a track, or a silent one at the nearest
+  /// frequency outside it.
+  Point getBreakpoint (const Track& track, int index) const noexcept
+  {
+    if (index < 0)
+      return {points[(size_t) track.firstPoint].frequency, 0.0f};
+    if (index >= track.numFrames)
+      return {points[(size_t) (track.firstPoint + track.numFrames - 1)].frequency, 0.0f};
+    return points[(size_t) (track.firstPoint + index)];
+  }
+
+  double sampleRate {44100.0};
+  int hopSize {1};
+  int numFrames {0};
+  std::vector<Track> tracks;
+  std::vector<Point> points;
+
+  JUCE_LEAK_DETECTOR (PartialTracks)
+};
@@ -0,0 +1,142 @@
+//==============================================================================
+// RateConverter.cpp
+// Converts the output from a fixed internal render rate to the device rate.
+//==============================================================================
+
+#include "RateConverter.h"
+
+namespace
+{
+  /// A quality's zero crossings either side of the centre at equal rates,
+  /// Kaiser window shape, and cutoff as a fraction of the lower rate. The
+  /// cutoff leaves the transition band ending just above half the lower
+  /// rate, so only the top of the transition band aliases.
+  struct Design
+  {
+    int zeroCrossings;
+    double beta;
+    double cutoff;
+  };
+
+  const Design designs[] {{8, 6.0, 0.40}, {16, 8.0, 0.44}, {32, 10.0, 0.46}};
+
+  /// Returns the zeroth order modified Bessel function of the first kind,
+  /// from its power series.
+  double getBessel (double x)
+  {
+    auto sum = 1.0, term = 1.0;
+    for (auto k = 1; k < 50 && term > 1e-12 * sum; ++k) {
+      term *= (x / (2.0 * k)) * (x / (2.0 * k));
+      sum += term;
+    }
+    return sum;
+  }
+}
+
+int RateConverter::getTaps (Quality quality, double inputRate, double outputRate) {
+  // a filter below the input's band has to be longer by the same ratio
+  auto ratio = jmin (1.0, outputRate / inputRate);
+  auto taps = (int) std::ceil (2.0 * designs[quality].zeroCrossings / ratio);
+  return (taps + 7) & ~7;
+}
+
+size_t RateConverter::getArenaBytes (int numChannels, double inputRate, double outputRate) {
+  if (inputRate <= 0.0 || outputRate <= 0.0)
+    return 0;
+  size_t bytes = 0;
+  for (auto q = 0; q < NumQualities; ++q)
+    bytes += DspArena::bytesFor<float> ((size_t) (numPhases + 1) * getTaps ((Quality) q, inputRate, outputRate));
+  auto longest = getTaps (Best, inputRate, outputRate);
+  return bytes + (size_t) jlimit (1, maxChannels, numChannels) * DspArena::bytesFor<float> ((size_t) (longest + inputBlockSize));
+}
+
+void RateConverter::prepare (DspArena& arena, int numChannels, double inputRate, double outputRate) {
+  jassert (numChannels > 0 && numChannels <= maxChannels);
+  numChannels = jlimit (1, maxChannels, numChannels);
+  release();
+  if (inputRate <= 0.0 || outputRate <= 0.0)
+    return;
+  auto ratio = jmin (1.0, outputRate / inputRate);
+  for (auto q = 0; q < NumQualities; ++q) {
+    auto& filter = filters[q];
+    filter.taps = getTaps ((Quality) q, inputRate, outputRate);
+    filter.coefficients = arena.allocate<float> ((size_t) (numPhases + 1) * filter.taps);
+    if (filter.coefficients == nullptr) {
+      release();
+      return;
+    }
+    const auto& design = designs[q];
+    auto cutoff = design.cutoff * ratio;
+    auto half = filter.taps / 2;
+    auto window = getBessel (design.beta);
+    for (auto phase = 0; phase <= numPhases; ++phase) {
+      auto* row = filter.coefficients + (size_t) phase * filter.taps;
+      auto sum = 0.0;
+      for (auto k = 0; k < filter.taps; ++k) {
+        // tap k is k - half + 1 samples from the start of the phase's
+        // fractional sample
+        auto distance = k - half + 1 - (double) phase / numPhases;
+        auto x = distance / half;
+        auto value = (x <= -1.0 || x >= 1.0) ? 0.0
+                   : 2.0 * cutoff * (distance == 0.0 ? 1.0 : std::sin (MathConstants<double>::twoPi * cutoff * distance)
+                                                              / (MathConstants<double>::twoPi * cutoff * distance))
+                     * getBessel (design.beta * std::sqrt (1.0 - x * x)) / window;
+        row[k] = (float) value;
+        sum += value;
+      }
+      // unity gain at DC for every phase
+      for (auto k = 0; k < filter.taps; ++k)
+        row[k] = (float) (row[k] / sum);
+    }
+  }
+  maxTaps = filters[Best].taps;
+  for (auto chan = 0; chan < numChannels; ++chan) {
+    history[chan] = arena.allocate<float> ((size_t) (maxTaps + inputBlockSize));
+    if (history[chan] == nullptr) {
+      release();
+      return;
+    }
+    std::fill (history[chan], history[chan] + maxTaps + inputBlockSize, 0.0f);
+    inputChannels[chan] = history[chan] + maxTaps;
+  }
+  input.setDataToReferTo (inputChannels, numChannels, inputBlockSize);
+  end = maxTaps;
+  position = maxTaps;
+  step = inputRate / outputRate;
+  // the history starts out silent
+  silence = SilenceTracker();
+  silence.push (true, maxTaps, 0);
+  silent = true;
+}
+
+void RateConverter::release() {
+  for (auto& filter : filters)
+    filter = Filter();
+  input = AudioSampleBuffer();
+  maxTaps = 0;
+}
+
+void RateConverter::shift() noexcept {
+  auto offset = end - maxTaps;
+  for (auto chan = 0; chan < input.getNumChannels(); ++chan)
+    std::copy (history[chan] + offset, history[chan] + end, history[chan]);
+  position -= offset;
+  end = maxTaps + inputBlockSize;
+}
+
+float RateConverter::filterSample (const float* samples, const float* row0, const float* row1, int taps, float frac) noexcept {
+  // eight partial sums of each row, in SIMD registers
+  float sum0[8] {}, sum1[8] {};
+  for (auto i = 0; i < taps; i += 8) {
+    for (auto lane = 0; lane < 8; ++lane) {
+      sum0[lane] += samples[i + lane] * row0[i + lane];
+      sum1[lane] += samples[i + lane] * row1[i + lane];
+    }
+  }
+  auto y0 = 0.0f, y1 = 0.0f;
+  for (auto lane = 0; lane < 8; ++lane) {
+    y0 += sum0[lane];
+    y1 += sum1[lane];
+  }
+  return y0 + frac * (y1 - y0);
+}
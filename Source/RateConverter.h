@@ -0,0 +1,161 @@
+//==============================================================================
+// RateConverter.h
+// Converts the output from a fixed internal render rate to the device rate.
+//==============================================================================
+
+#pragma once
+
+#include "DspArena.h"
+#include "SilenceTracker.h"
+
+/// RateConverter lets the app render at one fixed rate whatever rate the
+/// device runs at. It pulls blocks of inputBlockSize samples at the render
+/// rate from a render callback and resamples them to the device rate with a
+/// polyphase windowed sinc filter.
+///
+/// The filter is a Kaiser windowed sinc with its cutoff below half the
+/// lower of the two rates. It is tabulated at numPhases fractional delays,
+/// and each output sample interpolates linearly between the two phases
+/// around its position, so any pair of rates converts without drift. The
+/// filter is stretched when the device rate is the lower one, so the
+/// transition band is the same fraction of the device's band either way.
+/// The taps of a phase are contiguous, and the dot products are summed in
+/// eight lanes the compiler keeps in SIMD registers.
+///
+/// Each quality has its own table, and the history is laid out for the
+/// longest filter, so a new quality takes effect at the next block without
+/// a click. The tables and history live in the DSP arena and are built by
+/// prepare(), so the audio thread never allocates. While the input has
+/// been silent for longer than the filter the output is cleared without
+/// filtering.
+class RateConverter
+{
+public:
+  /// The filter lengths, from 16 taps with 60 dB of stopband rejection to
+  /// 64 taps with 100 dB, at equal rates.
+  enum Quality { Fast, Standard, Best, NumQualities };
+
+  /// Number of fractional delays the filter is tabulated at.
+  static constexpr int numPhases = 256;
+  /// Number of samples pulled from the render callback at a time.
+  static constexpr int inputBlockSize = 128;
+
+  /// Returns the arena space prepare() needs for numChannels channels.
+  static size_t getArenaBytes (int numChannels, double inputRate, double outputRate);
+
+  /// Builds the filters from inputRate to outputRate and places them and a
+  /// history of numChannels channels in the arena. Call from
+  /// prepareToPlay().
+  void prepare (DspArena& arena, int numChannels, double inputRate, double outputRate);
+
+  /// Forgets the arena memory handed out by prepare(). Call from
+  /// releaseResources() before the arena is released.
+  void release();
+
+  /// Sets the quality. Safe to call from any thread, the audio thread
+  /// applies it at the start of the next block.
+  void setQuality (Quality newQuality) { quality.store (jlimit (0, NumQualities - 1, (int) newQuality)); }
+  Quality getQuality() const noexcept { return (Quality) quality.load(); }
+
+  /// Returns how many input samples the render callback runs ahead of the
+  /// output, at most.
+  int getLatencySamples() const noexcept { return maxTaps / 2 + inputBlockSize; }
+
+  /// Returns the most input samples the render callback can be asked for
+  /// while numOutputSamples samples are filled.
+  int getMaxInputSamples (int numOutputSamples) const noexcept
+  {
+    return (int) std::ceil (numOutputSamples * step) + inputBlockSize;
+  }
+
+  /// Fills bufferToFill at the output rate. Each time more input is needed
+  /// renderInput (const AudioSourceChannelInfo&) is called to render the
+  /// next inputBlockSize samples at the input rate. It returns true if they
+  /// are silent. Output channels beyond the history's are copies of its
+  /// last channel. Returns true if every sample of bufferToFill is silent.
+  template <typename Renderer>
+  bool process (const AudioSourceChannelInfo& bufferToFill, Renderer&& renderInput)
+  {
+    if (input.getNumChannels() == 0) {
+      bufferToFill.clearActiveBufferRegion();
+      return true;
+    }
+    auto& buffer = *bufferToFill.buffer;
+    const auto& filter = filters[quality.load()];
+    auto numChannels = jmin (buffer.getNumChannels(), input.getNumChannels());
+    float* outputs[maxChannels];
+    for (auto chan = 0; chan < numChannels; ++chan)
+      outputs[chan] = buffer.getWritePointer (chan, bufferToFill.startSample);
+    auto allSilent = true;
+    for (auto i = 0; i < bufferToFill.numSamples; ++i) {
+      auto index = (int) position;
+      while (index + maxTaps / 2 >= end) {
+        shift();
+        silent = silence.push (renderInput (AudioSourceChannelInfo (input)), inputBlockSize, maxTaps);
+        index = (int) position;
+      }
+      if (silent) {
+        for (auto chan = 0; chan < numChannels; ++chan)
+          outputs[chan][i] = 0.0f;
+      }
+      else {
+        auto offset = (position - index) * numPhases;
+        auto phase = (int) offset;
+        auto frac = (float) (offset - phase);
+        const auto* row0 = filter.coefficients + (size_t) phase * filter.taps;
+        const auto* row1 = row0 + filter.taps;
+        auto first = index - filter.taps / 2 + 1;
+        for (auto chan = 0; chan < numChannels; ++chan)
+          outputs[chan][i] = filterSample (history[chan] + first, row0, row1, filter.taps, frac);
+        allSilent = false;
+      }
+      position += step;
+    }
+    for (auto chan = numChannels; chan < buffer.getNumChannels(); ++chan)
+      buffer.copyFrom (chan, bufferToFill.startSample, buffer, numChannels - 1, bufferToFill.startSample, bufferToFill.numSamples);
+    return allSilent;
+  }
+
+private:
+  static constexpr int maxChannels = 64;
+
+  /// One quality's filter: its taps per phase and numPhases + 1 rows of
+  /// coefficients, the last one the first delayed by a whole sample.
+  struct Filter
+  {
+    int taps {0};
+    float* coefficients {nullptr};
+  };
+
+  /// Returns the taps of quality at the ratio of the two rates, a
+  /// multiple of eight.
+  static int getTaps (Quality quality, double inputRate, double outputRate);
+
+  /// Returns the dot product of the samples from input with the two rows,
+  /// interpolated by frac.
+  static float filterSample (const float* input, const float* row0, const float* row1, int taps, float frac) noexcept;
+
+  /// Moves the last maxTaps samples of the history to its start, where
+  /// the next block of input follows them.
+  void shift() noexcept;
+
+  Filter filters[NumQualities];
+  /// Each channel's history of maxTaps + inputBlockSize samples, and a
+  /// view of the last inputBlockSize of them the input is rendered into.
+  float* history[maxChannels] {};
+  float* inputChannels[maxChannels] {};
+  AudioSampleBuffer input;
+  /// The length of the longest filter.
+  int maxTaps {0};
+  /// One past the last valid history sample.
+  int end {0};
+  /// The input position of the next output sample in the history, and the
+  /// input samples per output sample.
+  double position {0.0};
+  double step {1.0};
+  /// Whether the history's last maxTaps + inputBlockSize samples are
+  /// silent.
+  SilenceTracker silence;
+  bool silent {true};
+  std::atomic<int> quality {Standard};
+};
@@ -0,0 +1,343 @@
+//==============================================================================
+// RealtimeChecks.cpp
+// Audio thread tagging, violation recording and the interposed system calls.
+//==============================================================================
+
+#include "RealtimeChecks.h"
+
+#if WAVELAB_REALTIME_CHECKS
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <execinfo.h>
+#endif
+
+#if JUCE_LINUX
+ #include <dlfcn.h>
+ #include <pthread.h>
+ #include <unistd.h>
+ #include <fcntl.h>
+ #include <cerrno>
+ #include <cstdarg>
+ #include <cstdio>
+ #include <ctime>
+#endif
+
+namespace RealtimeChecks
+{
+  namespace
+  {
+    /// True on the thread inside a ScopedAudioThread.
+    thread_local bool onAudioThread = false;
+
+    /// True while violation() is recording, so the calls it makes itself
+    /// are not reported.
+    thread_local bool recording = false;
+
+    const int maxFrames = 32;
+
+    /// A violation and the stack that made it.
+    struct Record
+    {
+      Violation kind;
+      int numFrames;
+      void* frames[maxFrames];
+    };
+
+    /// Violations are written by the audio thread and read by the message
+    /// thread through a fixed ring, so recording one never allocates.
+    const int maxRecords = 64;
+    Record records[maxRecords];
+    std::atomic<int> writeIndex {0};
+    std::atomic<int> readIndex {0};
+    std::atomic<int> droppedRecords {0};
+
+    std::atomic<int64> denormalCount {0};
+    int64 reportedDenormals = 0;
+
+    /// Writes the calling thread's stack to frames and returns its depth.
+    /// Without execinfo violations are reported without a stack.
+    int captureStack (void** frames, int size) noexcept
+    {
+     #if JUCE_LINUX || JUCE_MAC
+      return backtrace (frames, size);
+     #else
+      ignoreUnused (frames, size);
+      return 0;
+     #endif
+    }
+
+    /// backtrace() loads its unwinder (and allocates) on the first call, so
+    /// make that call at startup rather than on the audio thread.
+    const int backtraceWarmup = [] {
+      void* frame[1];
+      return captureStack (frame, 1);
+    }();
+
+    const char* getName (Violation kind)
+    {
+      switch (kind) {
+        case Violation::allocation:   return "memory allocation";
+        case Violation::deallocation: return "memory deallocation";
+        case Violation::mutexLock:    return "mutex lock";
+        case Violation::blockingCall: return "blocking system call";
+      }
+      return "";
+    }
+  }
+
+  ScopedAudioThread::ScopedAudioThread() noexcept
+  : wasAudioThread (onAudioThread) {
+    onAudioThread = true;
+  }
+
+  ScopedAudioThread::~ScopedAudioThread() noexcept {
+    onAudioThread = wasAudioThread;
+  }
+
+  void violation (Violation kind) noexcept {
+    if (! onAudioThread || recording)
+      return;
+    recording = true;
+    auto write = writeIndex.load (std::memory_order_relaxed);
+    if (write - readIndex.load (std::memory_order_acquire) < maxRecords) {
+      auto& record = records[write % maxRecords];
+      record.kind = kind;
+      record.numFrames = captureStack (record.frames, maxFrames);
+      writeIndex.store (write + 1, std::memory_order_release);
+    }
+    else {
+      droppedRecords.fetch_add (1, std::memory_order_relaxed);
+    }
+    recording = false;
+  }
+
+  void checkDenormal (float value) noexcept {
+    // a zero exponent with a mantissa: a comparison would see zero under DAZ
+    uint32 bits;
+    std::memcpy (&bits, &value, sizeof (bits));
+    if ((bits & 0x7f800000u) == 0 && (bits & 0x007fffffu) != 0)
+      denormalCount.fetch_add (1, std::memory_order_relaxed);
+  }
+
+  void reportViolations() {
+    auto write = writeIndex.load (std::memory_order_acquire);
+    for (auto read = readIndex.load (std::memory_order_relaxed); read != write; ++read) {
+      auto& record = records[read % maxRecords];
+      String message ("Real-time violation on the audio thread: ");
+      message += getName (record.kind);
+     #if JUCE_LINUX || JUCE_MAC
+      if (auto* symbols = backtrace_symbols (record.frames, record.numFrames)) {
+        for (auto i = 0; i < record.numFrames; ++i)
+          message += String ("\n  ") + symbols[i];
+        ::free (symbols);
+      }
+     #endif
+      Logger::writeToLog (message);
+      readIndex.store (read + 1, std::memory_order_release);
+    }
+    if (auto dropped = droppedRecords.exchange (0))
+      Logger::writeToLog ("Real-time violations dropped: " + String (dropped));
+    auto denormals = denormalCount.load();
+    if (denormals != reportedDenormals) {
+      Logger::writeToLog ("Denormal filter states on the audio thread: " + String (denormals));
+      reportedDenormals = denormals;
+    }
+  }
+}
+
+//==============================================================================
+// Interposed functions
+//==============================================================================
+
+using RealtimeChecks::Violation;
+
+#if JUCE_LINUX
+
+// glibc exports its allocator under these names so it can be wrapped.
+extern "C" void* __libc_malloc (size_t);
+extern "C" void* __libc_calloc (size_t, size_t);
+extern "C" void* __libc_realloc (void*, size_t);
+extern "C" void* __libc_memalign (size_t, size_t);
+extern "C" void* __libc_valloc (size_t);
+extern "C" void* __libc_pvalloc (size_t);
+extern "C" void  __libc_free (void*);
+
+namespace
+{
+  /// Returns the next definition of a symbol after ours. The result is
+  /// cached without a function-local static because its guard would lock
+  /// a mutex, which is one of the calls being interposed.
+  template <typename Function>
+  Function getNext (std::atomic<void*>& cache, const char* name) noexcept
+  {
+    auto* function = cache.load (std::memory_order_relaxed);
+    if (function == nullptr) {
+      function = dlsym (RTLD_NEXT, name);
+      cache.store (function, std::memory_order_relaxed);
+    }
+    return reinterpret_cast<Function> (function);
+  }
+
+  std::atomic<void*> nextMutexLock {nullptr};
+  std::atomic<void*> nextWrite {nullptr};
+  std::atomic<void*> nextRead {nullptr};
+  std::atomic<void*> nextOpen {nullptr};
+  std::atomic<void*> nextFsync {nullptr};
+  std::atomic<void*> nextNanosleep {nullptr};
+  std::atomic<void*> nextFopen {nullptr};
+  std::atomic<void*> nextFwrite {nullptr};
+  std::atomic<void*> nextFflush {nullptr};
+  std::atomic<void*> nextFputs {nullptr};
+}
+
+extern "C"
+{
+  void* malloc (size_t size) noexcept {
+    RealtimeChecks::violation (Violation::allocation);
+    return __libc_malloc (size);
+  }
+
+  void* calloc (size_t count, size_t size) noexcept {
+    RealtimeChecks::violation (Violation::allocation);
+    return __libc_calloc (count, size);
+  }
+
+  void* realloc (void* pointer, size_t size) noexcept {
+    RealtimeChecks::violation (Violation::allocation);
+    return __libc_realloc (pointer, size);
+  }
+
+  void* memalign (size_t alignment, size_t size) noexcept {
+    RealtimeChecks::violation (Violation::allocation);
+    return __libc_memalign (alignment, size);
+  }
+
+  int posix_memalign (void** pointer, size_t alignment, size_t size) noexcept {
+    RealtimeChecks::violation (Violation::allocation);
+    if (alignment < sizeof (void*) || (alignment & (alignment - 1)) != 0)
+      return EINVAL;
+    auto* result = __libc_memalign (alignment, size);
+    if (result == nullptr)
+      return ENOMEM;
+    *pointer = result;
+    return 0;
+  }
+
+  void* aligned_alloc (size_t alignment, size_t size) noexcept {
+    RealtimeChecks::violation (Violation::allocation);
+    return __libc_memalign (alignment, size);
+  }
+
+  void* valloc (size_t size) noexcept {
+    RealtimeChecks::violation (Violation::allocation);
+    return __libc_valloc (size);
+  }
+
+  void* pvalloc (size_t size) noexcept {
+    RealtimeChecks::violation (Violation::allocation);
+    return __libc_pvalloc (size);
+  }
+
+  void free (void* pointer) noexcept {
+    if (pointer != nullptr)
+      RealtimeChecks::violation (Violation::deallocation);
+    __libc_free (pointer);
+  }
+
+  int pthread_mutex_lock (pthread_mutex_t* mutex) noexcept {
+    RealtimeChecks::violation (Violation::mutexLock);
+    return getNext<int (*) (pthread_mutex_t*)> (nextMutexLock, "pthread_mutex_lock") (mutex);
+  }
+
+  ssize_t write (int fd, const void* data, size_t size) {
+    RealtimeChecks::violation (Violation::blockingCall);
+    return getNext<ssize_t (*) (int, const void*, size_t)> (nextWrite, "write") (fd, data, size);
+  }
+
+  ssize_t read (int fd, void* data, size_t size) {
+    RealtimeChecks::violation (Violation::blockingCall);
+    return getNext<ssize_t (*) (int, void*, size_t)> (nextRead, "read") (fd, data, size);
+  }
+
+  int open (const char* path, int flags, ...) {
+    RealtimeChecks::violation (Violation::blockingCall);
+    mode_t mode = 0;
+    if ((flags & O_CREAT) != 0) {
+      va_list args;
+      va_start (args, flags);
+      mode = (mode_t) va_arg (args, int);
+      va_end (args);
+    }
+    return getNext<int (*) (const char*, int, ...)> (nextOpen, "open") (path, flags, mode);
+  }
+
+  int fsync (int fd) {
+    RealtimeChecks::violation (Violation::blockingCall);
+    return getNext<int (*) (int)> (nextFsync, "fsync") (fd);
+  }
+
+  int nanosleep (const struct timespec* duration, struct timespec* remaining) {
+    RealtimeChecks::violation (Violation::blockingCall);
+    return getNext<int (*) (const struct timespec*, struct timespec*)> (nextNanosleep, "nanosleep") (duration, remaining);
+  }
+
+  // stdio calls write() and open() through glibc's internal aliases, so
+  // console and file output has to be caught at this level too.
+
+  FILE* fopen (const char* path, const char* mode) {
+    RealtimeChecks::violation (Violation::blockingCall);
+    return getNext<FILE* (*) (const char*, const char*)> (nextFopen, "fopen") (path, mode);
+  }
+
+  size_t fwrite (const void* data, size_t size, size_t count, FILE* stream) {
+    RealtimeChecks::violation (Violation::blockingCall);
+    return getNext<size_t (*) (const void*, size_t, size_t, FILE*)> (nextFwrite, "fwrite") (data, size, count, stream);
+  }
+
+  int fflush (FILE* stream) {
+    RealtimeChecks::violation (Violation::blockingCall);
+    return getNext<int (*) (FILE*)> (nextFflush, "fflush") (stream);
+  }
+
+  int fputs (const char* text, FILE* stream) {
+    RealtimeChecks::violation (Violation::blockingCall);
+    return getNext<int (*) (const char*, FILE*)> (nextFputs, "fputs") (text, stream);
+  }
+}
+
+#else
+
+// Without symbol interposition only C++ allocations can be caught.
+
+void* operator new (size_t size) {
+  RealtimeChecks::violation (Violation::allocation);
+  if (auto* pointer = std::malloc (size == 0 ? 1 : size))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void* operator new[] (size_t size) {
+  return operator new (size);
+}
+
+void operator delete (void* pointer) noexcept {
+  if (pointer != nullptr)
+    RealtimeChecks::violation (Violation::deallocation);
+  std::free (pointer);
+}
+
+void operator delete[] (void* pointer) noexcept {
+  operator delete (pointer);
+}
+
+void operator delete (void* pointer, size_t) noexcept {
+  operator delete (pointer);
+}
+
+void operator delete[] (void* pointer, size_t) noexcept {
+  operator delete (pointer);
+}
+
+#endif
+
+#endif
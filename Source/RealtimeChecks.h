@@ -0,0 +1,91 @@
+//==============================================================================
+// RealtimeChecks.h
+// Debug/CI mode that catches real-time safety violations on the audio thread.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/// Build with WAVELAB_REALTIME_CHECKS=1 (e.g. in the Debug or CI configuration)
+/// to enable the checks. Release builds leave it at 0, which compiles every
+/// function below to nothing.
+#ifndef WAVELAB_REALTIME_CHECKS
+ #define WAVELAB_REALTIME_CHECKS 0
+#endif
+
+/// With WAVELAB_REALTIME_CHECKS enabled, the thread inside a ScopedAudioThread
+/// is tagged as the audio thread. Memory allocation, mutex locking and
+/// blocking I/O or sleeps made on it are recorded with a stack trace, and
+/// reportViolations() writes them to the log from the message thread.
+/// checkDenormal() counts filter states that end up denormal.
+///
+/// The audio thread runs with flush-to-zero and denormals-are-zero inside a
+/// ScopedDenormalGuard, in check builds as in release, so they run the same
+/// arithmetic. checkDenormal() reads the bit pattern of a state, as DAZ
+/// makes a denormal compare equal to zero, and counts the ones that reach
+/// memory anyway, e.g. through a path that escapes the guard.
+///
+/// malloc, free, posix_memalign and the other allocators,
+/// pthread_mutex_lock and the I/O calls are interposed on Linux. Other platforms only check C++ operator new and delete. Stack
+/// traces come from execinfo on Linux and macOS. Elsewhere violations are
+/// reported without one.
+namespace RealtimeChecks
+{
+  /// The kinds of calls that are not allowed on the audio thread.
+  enum class Violation { allocation, deallocation, mutexLock, blockingCall };
+
+#if WAVELAB_REALTIME_CHECKS
+  /// Tags the calling thread as the audio thread for the lifetime of the
+  /// object.
+  class ScopedAudioThread
+  {
+  public:
+    ScopedAudioThread() noexcept;
+    ~ScopedAudioThread() noexcept;
+  private:
+    bool wasAudioThread;
+  };
+
+  /// Turns on the FTZ/DAZ denormal guards for the lifetime of the object.
+  class ScopedDenormalGuard
+  {
+  public:
+    ScopedDenormalGuard() noexcept {}
+  private:
+    ScopedNoDenormals noDenormals;
+  };
+
+  /// Records a violation (and its stack trace) if the calling thread is the
+  /// audio thread. Called by the interposed functions.
+  void violation (Violation kind) noexcept;
+
+  /// Counts value if its bits are those of a denormal. Use on filter memory
+  /// once per block.
+  void checkDenormal (float value) noexcept;
+
+  /// Logs every violation recorded since the last call together with its
+  /// stack trace, and the running denormal count if it changed. Call from
+  /// the message thread.
+  void reportViolations();
+#else
+  class ScopedAudioThread
+  {
+  public:
+    ScopedAudioThread() noexcept {}
+  };
+
+  /// Turns on the FTZ/DAZ denormal guards for the lifetime of the object.
+  class ScopedDenormalGuard
+  {
+  public:
+    ScopedDenormalGuard() noexcept {}
+  private:
+    ScopedNoDenormals noDenormals;
+  };
+
+  inline void violation (Violation) noexcept {}
+  inline void checkDenormal (float) noexcept {}
+  inline void reportViolations() {}
+#endif
+}
@@ -0,0 +1,60 @@
+//==============================================================================
+// RealtimeWakeup.cpp
+// The semaphore behind RealtimeWakeup on each platform.
+//==============================================================================
+
+#include "RealtimeWakeup.h"
+
+#if JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <semaphore.h>
+ #include <cerrno>
+#endif
+
+struct RealtimeWakeup::Semaphore
+{
+ #if JUCE_MAC || JUCE_IOS
+  Semaphore() : handle (dispatch_semaphore_create (0)) {}
+  ~Semaphore() { dispatch_release (handle); }
+  void post() noexcept { dispatch_semaphore_signal (handle); }
+  void wait() noexcept { dispatch_semaphore_wait (handle, DISPATCH_TIME_FOREVER); }
+  dispatch_semaphore_t handle;
+ #elif JUCE_WINDOWS
+  Semaphore() : handle (CreateSemaphoreW (nullptr, 0, 1, nullptr)) {}
+  ~Semaphore() { CloseHandle (handle); }
+  void post() noexcept { ReleaseSemaphore (handle, 1, nullptr); }
+  void wait() noexcept { WaitForSingleObject (handle, INFINITE); }
+  HANDLE handle;
+ #else
+  Semaphore() { sem_init (&handle, 0, 0); }
+  ~Semaphore() { sem_destroy (&handle); }
+  void post() noexcept { sem_post (&handle); }
+  void wait() noexcept
+  {
+    // a signal handler can interrupt the wait
+    while (sem_wait (&handle) != 0 && errno == EINTR) {}
+  }
+  sem_t handle;
+ #endif
+};
+
+RealtimeWakeup::RealtimeWakeup()
+: semaphore (std::make_unique<Semaphore>()) {
+}
+
+RealtimeWakeup::~RealtimeWakeup() = default;
+
+void RealtimeWakeup::signal() noexcept {
+  if (! pending.exchange (true))
+    semaphore->post();
+}
+
+void RealtimeWakeup::wait() noexcept {
+  semaphore->wait();
+  // a signal() from here on posts again, and one before was for work the
+  // caller is about to look for
+  pending.store (false);
+}
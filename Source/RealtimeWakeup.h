@@ -0,0 +1,42 @@
+//==============================================================================
+// RealtimeWakeup.h
+// Wakes a waiting thread from the audio thread without locking.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/// RealtimeWakeup lets the audio thread wake a background thread that has
+/// run out of work. Thread::notify() signals a WaitableEvent, which locks a
+/// mutex, so the audio thread can't use it. signal() sets an atomic flag
+/// and, if it wasn't set, posts a semaphore: sem_post on Linux,
+/// dispatch_semaphore_signal on macOS and ReleaseSemaphore on Windows,
+/// none of which lock or allocate. The flag is cleared by wait(), so at
+/// most one post is outstanding and repeated signals cost an atomic
+/// exchange.
+///
+/// Only one thread may wait. It is woken by nothing else, so a thread that
+/// waits here must be woken with signal() after signalThreadShouldExit()
+/// before it is stopped.
+class RealtimeWakeup
+{
+public:
+  RealtimeWakeup();
+  ~RealtimeWakeup();
+
+  /// Wakes the thread in wait(), or makes its next wait() return at once.
+  /// Safe on the audio thread.
+  void signal() noexcept;
+
+  /// Waits for signal(). Returns at once if there was one since the last
+  /// wait.
+  void wait() noexcept;
+
+private:
+  struct Semaphore;
+  std::unique_ptr<Semaphore> semaphore;
+  std::atomic<bool> pending {false};
+
+  JUCE_DECLARE_NON_COPYABLE (RealtimeWakeup)
+};
@@ -0,0 +1,65 @@
+//==============================================================================
+// RenderRatePanel.cpp
+// The controls of the internal render rate and its rate converter.
+//==============================================================================
+
+#include "RenderRatePanel.h"
+
+namespace
+{
+  /// The render rates of the rate menu's items after the first, which
+  /// renders at the device rate.
+  const double renderRates[] {44100.0, 48000.0, 88200.0, 96000.0};
+}
+
+RenderRatePanel::RenderRatePanel (RateConverter& c)
+: converter (c) {
+  addAndMakeVisible (rateMenu);
+  rateMenu.addItem ("Device rate", 1);
+  for (auto i = 0; i < (int) std::size (renderRates); ++i)
+    rateMenu.addItem ("Render " + String (renderRates[i] / 1000.0, 1) + " kHz", i + 2);
+  rateMenu.setSelectedId (1, dontSendNotification);
+  rateMenu.addListener (this);
+
+  addAndMakeVisible (qualityMenu);
+  qualityMenu.addItemList ({"Fast SRC", "Standard SRC", "Best SRC"}, 1);
+  qualityMenu.setSelectedId (converter.getQuality() + 1, dontSendNotification);
+  qualityMenu.addListener (this);
+
+  addAndMakeVisible (status);
+  status.setJustificationType (Justification::centredRight);
+}
+
+void RenderRatePanel::updateStatus (double renderRate, double deviceRate) {
+  qualityMenu.setEnabled (rateMenu.getSelectedId() > 1);
+  if (renderRate <= 0.0 || deviceRate <= 0.0) {
+    status.setText ({}, dontSendNotification);
+    return;
+  }
+  if (renderRate == deviceRate) {
+    status.setText ("Rendering at " + String (deviceRate / 1000.0, 1) + " kHz", dontSendNotification);
+    return;
+  }
+  auto latency = 1000.0 * converter.getLatencySamples() / renderRate;
+  status.setText (String (renderRate / 1000.0, 1) + " to " + String (deviceRate / 1000.0, 1) + " kHz, latency "
+                  + String (latency, 1) + " ms", dontSendNotification);
+}
+
+void RenderRatePanel::resized() {
+  auto row = getLocalBounds();
+  rateMenu.setBounds (row.removeFromLeft (118));
+  row.removeFromLeft (8 + 56 + 8);
+  qualityMenu.setBounds (row.removeFromLeft (118));
+  status.setBounds (row);
+}
+
+void RenderRatePanel::comboBoxChanged (ComboBox* menu) {
+  if (menu == &rateMenu) {
+    auto index = rateMenu.getSelectedId() - 2;
+    if (onRateChange != nullptr)
+      onRateChange (index >= 0 ? renderRates[index] : 0.0);
+  }
+  else if (menu == &qualityMenu) {
+    converter.setQuality ((RateConverter::Quality) (qualityMenu.getSelectedId() - 1));
+  }
+}
@@ -0,0 +1,35 @@
+//==============================================================================
+// RenderRatePanel.h
+// The controls of the internal render rate and its rate converter.
+//==============================================================================
+
+#pragma once
+
+#include "RateConverter.h"
+
+/// RenderRatePanel chooses the rate the app renders at, the device's or a
+/// fixed one, and the quality of the RateConverter that takes a fixed rate
+/// to the device's. updateStatus() shows the rates and the latency the
+/// converter adds.
+class RenderRatePanel : public Component, public ComboBox::Listener
+{
+public:
+  explicit RenderRatePanel (RateConverter& converter);
+
+  /// Called with the chosen render rate, or 0.0 for the device rate.
+  std::function<void (double)> onRateChange;
+
+  /// Shows the rates and the converter's latency. Call from a timer.
+  void updateStatus (double renderRate, double deviceRate);
+
+  void resized() override;
+  void comboBoxChanged (ComboBox* menu) override;
+
+private:
+  RateConverter& converter;
+  ComboBox rateMenu;
+  ComboBox qualityMenu;
+  Label status;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderRatePanel)
+};
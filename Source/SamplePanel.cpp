@@ -0,0 +1,76 @@
+//==============================================================================
+// SamplePanel.cpp
+// The controls of the sample streaming generator.
+//==============================================================================
+
+#include "SamplePanel.h"
+
+SamplePanel::SamplePanel (SampleStreamer& s)
+: streamer (s) {
+  addAndMakeVisible (loadButton);
+  loadButton.onClick = [this] {
+    fileChooser = std::make_unique<FileChooser> ("Sample...", File(), "*.wav;*.w64;*.aif;*.aiff;*.flac");
+    auto flags = FileChooser::openMode | FileChooser::canSelectFiles;
+    fileChooser->launchAsync (flags, [this] (const FileChooser& chooser) {
+      auto file = chooser.getResult();
+      if (file.existsAsFile())
+        streamer.load (file);
+    });
+  };
+  addAndMakeVisible (loopButton);
+  loopButton.setToggleState (true, dontSendNotification);
+  loopButton.onClick = [this] { streamer.setLooping (loopButton.getToggleState()); };
+
+  addAndMakeVisible (status);
+  status.setJustificationType (Justification::centredRight);
+
+  addSlider (rootSlider, 20.0, 5000.0, 440.0, " Hz root");
+  rootSlider.setSkewFactorFromMidPoint (500.0);
+  addSlider (voicesSlider, 1.0, SampleStreamer::maxVoices, 1.0, " voices");
+  voicesSlider.setRange (1.0, SampleStreamer::maxVoices, 1.0);
+  addSlider (detuneSlider, 0.0, 50.0, 10.0, " cents");
+  updateStatus();
+}
+
+void SamplePanel::addSlider (Slider& slider, double minimum, double maximum, double value, const String& suffix) {
+  addAndMakeVisible (slider);
+  slider.setSliderStyle (Slider::LinearHorizontal);
+  slider.setTextBoxStyle (Slider::TextBoxLeft, false, 90, 22);
+  slider.setRange (minimum, maximum);
+  slider.setTextValueSuffix (suffix);
+  slider.setValue (value, dontSendNotification);
+  slider.addListener (this);
+}
+
+void SamplePanel::updateStatus() {
+  auto text = streamer.getStatus();
+  if (auto late = streamer.getUnderruns())
+    text += ", " + String (late) + " underruns";
+  status.setText (text, dontSendNotification);
+}
+
+void SamplePanel::resized() {
+  auto bounds = getLocalBounds();
+  auto row = bounds.removeFromTop (24);
+  loadButton.setBounds (row.removeFromLeft (118));
+  row.removeFromLeft (8);
+  loopButton.setBounds (row.removeFromLeft (64));
+  status.setBounds (row);
+
+  bounds.removeFromTop (4);
+  rootSlider.setBounds (bounds.removeFromTop (24));
+
+  bounds.removeFromTop (4);
+  row = bounds.removeFromTop (24);
+  voicesSlider.setBounds (row.removeFromLeft (row.getWidth() / 2));
+  detuneSlider.setBounds (row);
+}
+
+void SamplePanel::sliderValueChanged (Slider* slider) {
+  if (slider == &rootSlider)
+    streamer.setRootFrequency (slider->getValue());
+  else if (slider == &voicesSlider)
+    streamer.setNumVoices (roundToInt (slider->getValue()));
+  else if (slider == &detuneSlider)
+    streamer.setDetune ((float) slider->getValue());
+}
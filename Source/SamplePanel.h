@@ -0,0 +1,38 @@
+//==============================================================================
+// SamplePanel.h
+// The controls of the sample streaming generator.
+//==============================================================================
+
+#pragma once
+
+#include "SampleStreamer.h"
+
+/// SamplePanel opens an audio file for a SampleStreamer and sets its root
+/// frequency, voices, detuning and looping. updateStatus() shows the file
+/// playing and how often a voice ran out of data.
+class SamplePanel : public Component, public Slider::Listener
+{
+public:
+  explicit SamplePanel (SampleStreamer& streamer);
+
+  /// Shows the streamer's status. Call from a timer.
+  void updateStatus();
+
+  void resized() override;
+  void sliderValueChanged (Slider* slider) override;
+
+private:
+  /// Sets up a slider with the app's text box style.
+  void addSlider (Slider& slider, double minimum, double maximum, double value, const String& suffix);
+
+  SampleStreamer& streamer;
+  TextButton loadButton {"Sample..."};
+  ToggleButton loopButton {"Loop"};
+  Label status;
+  Slider rootSlider;
+  Slider voicesSlider;
+  Slider detuneSlider;
+  std::unique_ptr<FileChooser> fileChooser;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SamplePanel)
+};
@@ -0,0 +1,286 @@
+//==============================================================================
+// SampleStreamer.cpp
+// Plays audio files of any length, streamed from disk by a prefetch thread.
+//==============================================================================
+
+#include "SampleStreamer.h"
+
+namespace
+{
+  /// The low half of a voice's published word: the chunks published.
+  const uint64 chunkMask = 0xffffffff;
+
+  /// Returns the four point, third order Hermite interpolation between x0
+  /// and x1 at t.
+  forcedinline float hermite (float xm1, float x0, float x1, float x2, float t) noexcept
+  {
+    auto c1 = 0.5f * (x1 - xm1);
+    auto c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+    auto c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+    return ((c3 * t + c2) * t + c1) * t + x0;
+  }
+}
+
+SampleStreamer::SampleStreamer()
+: Thread ("Sample Prefetch") {
+  startThread (Thread::Priority::high);
+}
+
+SampleStreamer::~SampleStreamer() {
+  signalThreadShouldExit();
+  wakeup.signal();
+  stopThread (10000);
+  delete incoming.exchange (nullptr);
+  delete retired.exchange (nullptr);
+  delete playing;
+}
+
+void SampleStreamer::load (const File& file) {
+  {
+    const ScopedLock sl (lock);
+    pendingFile = file;
+    status = "Opening " + file.getFileName() + "...";
+  }
+  wakeup.signal();
+}
+
+String SampleStreamer::getStatus() const {
+  const ScopedLock sl (lock);
+  return status;
+}
+
+//==============================================================================
+// Prefetch thread
+
+void SampleStreamer::run() {
+  while (! threadShouldExit()) {
+    File file;
+    {
+      const ScopedLock sl (lock);
+      file = std::exchange (pendingFile, File());
+    }
+    if (file != File()) {
+      auto error = open (file);
+      if (error.isNotEmpty()) {
+        const ScopedLock sl (lock);
+        status = error;
+      }
+    }
+    // once a file is passed back no voice refers to it
+    delete retired.exchange (nullptr);
+    auto busy = false;
+    for (auto index = 0; index < maxVoices; ++index)
+      busy = prefetch (index) || busy;
+    if (busy)
+      continue;
+    // either the audio thread sees the flag and wakes the thread, or the
+    // thread sees the voice the audio thread moved on before it
+    parked.store (true);
+    auto wanted = false;
+    for (auto& voice : voices)
+      wanted = wanted || needsChunk (voice);
+    if (! wanted)
+      wakeup.wait();
+    parked.store (false);
+  }
+}
+
+String SampleStreamer::open (const File& file) {
+  AudioFormatManager formats;
+  formats.registerBasicFormats();
+  std::unique_ptr<AudioFormatReader> reader (formats.createReaderFor (file));
+  if (reader == nullptr)
+    return "Can't read " + file.getFullPathName() + ".";
+  if (reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0 || reader->numChannels == 0)
+    return file.getFileName() + " holds no audio.";
+  if (rings == nullptr) {
+    rings.allocate ((size_t) maxVoices * ringFrames, true);
+    chunk.setSize (2, chunkFrames);
+  }
+  auto seconds = (double) reader->lengthInSamples / reader->sampleRate;
+  auto text = file.getFileName() + ": "
+              + (seconds < 60.0 ? String (seconds, 1) + " s " : String (seconds / 60.0, 1) + " min ")
+              + (reader->numChannels > 1 ? "stereo, " : "mono, ") + String (reader->sampleRate / 1000.0, 1) + " kHz";
+  auto* source = new Source;
+  source->length = reader->lengthInSamples;
+  source->sampleRate = reader->sampleRate;
+  source->reader = std::move (reader);
+  underruns.store (0);
+  {
+    const ScopedLock sl (lock);
+    status = text;
+  }
+  // a file the audio thread hasn't taken yet was never played
+  delete incoming.exchange (source);
+  return {};
+}
+
+bool SampleStreamer::needsChunk (const Voice& voice) noexcept {
+  auto published = voice.published.load();
+  if (voice.source.load() == nullptr)
+    return false;
+  auto next = voice.origin.load() + (int64) (published & chunkMask) * chunkFrames;
+  // the chunk replaces the one a double buffer earlier, which the playhead
+  // must have left
+  return next + chunkFrames <= voice.oldest.load() + ringFrames;
+}
+
+bool SampleStreamer::prefetch (int index) {
+  auto& voice = voices[index];
+  auto published = voice.published.load();
+  auto* source = voice.source.load();
+  if (source == nullptr)
+    return false;
+  auto next = voice.origin.load() + (int64) (published & chunkMask) * chunkFrames;
+  if (next + chunkFrames > voice.oldest.load() + ringFrames)
+    return false;
+
+  // read the stream frames, which run on through every loop, from the file
+  auto& reader = *source->reader;
+  auto channels = jmin (2, (int) reader.numChannels);
+  AudioSampleBuffer scratch (chunk.getArrayOfWritePointers(), channels, chunkFrames);
+  auto loop = looping.load();
+  for (auto done = 0; done < chunkFrames;) {
+    auto frame = next + done;
+    auto num = chunkFrames - done;
+    if (frame < 0 || (! loop && frame >= source->length)) {
+      if (frame < 0)
+        num = (int) jmin ((int64) num, -frame);
+      scratch.clear (done, num);
+    }
+    else {
+      auto position = frame % source->length;
+      num = (int) jmin ((int64) num, source->length - position);
+      if (! reader.read (&scratch, done, num, position, true, true))
+        scratch.clear (done, num);
+    }
+    done += num;
+  }
+  if (channels > 1) {
+    scratch.addFrom (0, 0, scratch, 1, 0, chunkFrames);
+    scratch.applyGain (0, 0, chunkFrames, 0.5f);
+  }
+
+  // the chunk may wrap around the end of the double buffer
+  auto* ring = rings.get() + (size_t) index * ringFrames;
+  auto* mono = scratch.getReadPointer (0);
+  auto offset = (int) (next & (ringFrames - 1));
+  auto first = jmin (chunkFrames, ringFrames - offset);
+  std::copy (mono, mono + first, ring + offset);
+  std::copy (mono + first, mono + chunkFrames, ring);
+  // fails if the voice was restarted while the chunk was read
+  voice.published.compare_exchange_strong (published, published + 1, std::memory_order_release);
+  return true;
+}
+
+//==============================================================================
+// Audio thread
+
+void SampleStreamer::update() noexcept {
+  if (retired.load() != nullptr)
+    return;
+  if (auto* next = incoming.exchange (nullptr)) {
+    // every voice lets go of the old file before it is passed back
+    for (auto index = 0; index < maxVoices; ++index)
+      stop (index);
+    retired.store (playing);
+    playing = next;
+  }
+}
+
+void SampleStreamer::start (int index, int64 frame) noexcept {
+  auto& voice = voices[index];
+  voice.playhead = (double) frame;
+  voice.state = Voice::Playing;
+  voice.primed = false;
+  // the interpolator reads a frame behind the playhead
+  voice.source.store (playing);
+  voice.origin.store (frame - 1);
+  voice.oldest.store (frame - 1);
+  voice.published.store ((uint64) ++voice.epoch << 32);
+}
+
+void SampleStreamer::stop (int index) noexcept {
+  auto& voice = voices[index];
+  voice.state = Voice::Idle;
+  voice.source.store (nullptr);
+  voice.published.store ((uint64) ++voice.epoch << 32, std::memory_order_release);
+}
+
+void SampleStreamer::render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain) {
+  bufferToFill.clearActiveBufferRegion();
+  auto* streamer = state.engines.samples;
+  auto& buffer = *bufferToFill.buffer;
+  if (streamer == nullptr || buffer.getNumChannels() == 0 || bufferToFill.numSamples <= 0)
+    return;
+  auto& s = *streamer;
+  s.update();
+  auto* source = s.playing;
+  if (source == nullptr || state.srate <= 0.0)
+    return;
+  // a slot switching to the streamer starts every voice afresh
+  if (state.position == 0)
+    for (auto index = 0; index < maxVoices; ++index)
+      s.stop (index);
+
+  auto count = s.numVoices.load();
+  auto loop = s.looping.load();
+  auto spread = s.detune.load();
+  auto base = state.freq / s.root.load() * source->sampleRate / state.srate;
+  auto level = gain / std::sqrt ((float) count);
+  auto* output = buffer.getWritePointer (0, bufferToFill.startSample);
+  auto wanted = false;
+  for (auto index = 0; index < maxVoices; ++index) {
+    auto& voice = s.voices[index];
+    if (index >= count) {
+      if (voice.state != Voice::Idle)
+        s.stop (index);
+      continue;
+    }
+    // voices start spread evenly through the file, and start over at its
+    // beginning when looping is switched on after they finished
+    if (voice.state == Voice::Idle)
+      s.start (index, source->length * index / count);
+    else if (voice.state == Voice::Finished && loop)
+      s.start (index, 0);
+    if (voice.state != Voice::Playing)
+      continue;
+    auto cents = (count > 1) ? spread * (2.0f * (float) index / (float) (count - 1) - 1.0f) : 0.0f;
+    auto step = jlimit (0.0, maxStep, base * std::exp2 (cents / 1200.0));
+    auto* ring = s.rings.get() + (size_t) index * ringFrames;
+    // a voice waiting for its first chunk isn't late
+    if (! s.play (voice, ring, output, bufferToFill.numSamples, step, level) && voice.primed)
+      s.underruns.fetch_add (1);
+    if (! loop && voice.playhead >= (double) source->length)
+      voice.state = Voice::Finished;
+    wanted = wanted || needsChunk (voice);
+  }
+  if (wanted && s.parked.load())
+    s.wakeup.signal();
+  for (auto chan = 1; chan < buffer.getNumChannels(); ++chan)
+    FloatVectorOperations::copy (buffer.getWritePointer (chan, bufferToFill.startSample), output, bufferToFill.numSamples);
+  state.position += bufferToFill.numSamples;
+}
+
+bool SampleStreamer::play (Voice& voice, const float* ring, float* output, int numSamples, double step, float gain) noexcept {
+  const auto mask = (int64) ringFrames - 1;
+  // the epoch is ours, only the chunk count can have moved on
+  auto chunks = (int64) (voice.published.load (std::memory_order_acquire) & chunkMask);
+  auto end = voice.origin.load() + chunks * chunkFrames;
+  auto position = voice.playhead;
+  auto i = 0;
+  for (; i < numSamples; ++i) {
+    auto frame = (int64) position;
+    if (frame + 2 >= end)
+      break;
+    auto t = (float) (position - (double) frame);
+    output[i] += gain * hermite (ring[(frame - 1) & mask], ring[frame & mask],
+                                 ring[(frame + 1) & mask], ring[(frame + 2) & mask], t);
+    position += step;
+  }
+  if (i > 0)
+    voice.primed = true;
+  voice.playhead = position;
+  voice.oldest.store ((int64) position - 1);
+  return i == numSamples;
+}
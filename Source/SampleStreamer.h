@@ -0,0 +1,187 @@
+//==============================================================================
+// SampleStreamer.h
+// Plays audio files of any length, streamed from disk by a prefetch thread.
+//==============================================================================
+
+#pragma once
+
+#include "Generators.h"
+#include "RealtimeWakeup.h"
+
+/// SampleStreamer plays an audio file as a generator, pitched by the
+/// generator frequency: the root frequency plays the file at its own
+/// speed. Files are never loaded whole, so they can be many gigabytes.
+/// Up to maxVoices voices play the file at once, each from its own
+/// position, spread evenly through the file and detuned across the detune
+/// setting. A voice plays to the end of the file and stops, or loops.
+///
+/// Each voice streams the file, mixed to mono, into a double buffer of two
+/// chunks of chunkFrames samples. A prefetch thread refills a chunk as soon
+/// as the voice's playhead has left it, so it has a whole chunk's worth of
+/// playback to read the next one. The audio thread only reads samples the
+/// prefetch thread has written and published, so it never touches the disk
+/// or a page that isn't resident, and a voice whose data is late plays
+/// silence and counts an underrun instead of waiting. Memory use is
+/// maxVoices double buffers, whatever the length of the file.
+///
+/// Positions are counted in stream frames that run on through every loop,
+/// and the prefetch thread maps them to file frames. A voice is (re)started
+/// by bumping an epoch packed into the same atomic as the number of chunks
+/// published, so chunks read for its previous position are never
+/// published for the new one. The audio thread never allocates or locks.
+/// The prefetch thread sleeps while no voice needs a chunk, and the audio
+/// thread wakes it when a playhead leaves a chunk or a voice starts,
+/// through a RealtimeWakeup as ConvolutionStage wakes a parked worker.
+///
+/// Files are opened on the prefetch thread and handed to the audio thread
+/// through a pair of atomic pointers, as in ConvolutionStage. Adopting a
+/// file restarts every voice.
+class SampleStreamer : private Thread
+{
+public:
+  /// Number of voices.
+  static constexpr int maxVoices = 8;
+  /// Samples in each half of a voice's double buffer.
+  static constexpr int chunkFrames = 1 << 16;
+  /// The most file frames a voice may advance per output sample. With the
+  /// prefetch thread woken as soon as the playhead leaves a chunk, the
+  /// other chunk lasts long enough to read the next one at every playback
+  /// speed.
+  static constexpr double maxStep = 8.0;
+
+  SampleStreamer();
+
+  /// Stops the prefetch thread and closes the file. The audio thread must
+  /// have stopped.
+  ~SampleStreamer() override;
+
+  //==============================================================================
+  // Message thread
+
+  /// Starts opening an audio file in the background. The voices go on
+  /// playing the previous file until it is open.
+  void load (const File& file);
+
+  /// Returns the state of the last load: the file's name, length and
+  /// format, or an error.
+  String getStatus() const;
+
+  /// Returns the number of blocks in which a voice ran out of data, since
+  /// the last file was opened.
+  int64 getUnderruns() const noexcept { return underruns.load(); }
+
+  //==============================================================================
+  // Parameters, safe to set from any thread. New values apply from the next
+  // block.
+
+  /// The generator frequency that plays the file at its own speed, 20 to
+  /// 5000 Hz.
+  void setRootFrequency (double hz) { root.store (jlimit (20.0, 5000.0, hz)); }
+  /// Voices playing, 1 to maxVoices.
+  void setNumVoices (int count) { numVoices.store (jlimit (1, maxVoices, count)); }
+  /// The detuning of the outermost voices, 0 to 50 cents either way.
+  void setDetune (float cents) { detune.store (jlimit (0.0f, 50.0f, cents)); }
+  /// Loops the whole file, or stops each voice at its end.
+  void setLooping (bool on) { looping.store (on); }
+
+  //==============================================================================
+  // Audio thread
+
+  /// The generator function. Renders the voices of the streamer that
+  /// state.engines.samples points to.
+  static void render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain);
+
+private:
+  /// An open file. Its reader is only used by the prefetch thread, the
+  /// rest is read by the audio thread.
+  struct Source
+  {
+    std::unique_ptr<AudioFormatReader> reader;
+    int64 length {0};
+    double sampleRate {0.0};
+  };
+
+  /// A voice's double buffer and playhead.
+  struct Voice
+  {
+    enum State { Idle, Playing, Finished };
+
+    /// Audio thread only: the playhead in stream frames, the voice's
+    /// state, whether it has played since its last start, and its epoch.
+    double playhead {0.0};
+    State state {Idle};
+    bool primed {false};
+    uint32 epoch {0};
+
+    /// Set by the audio thread when it starts the voice: the file, and the
+    /// stream frame at the start of the double buffer.
+    std::atomic<Source*> source {nullptr};
+    std::atomic<int64> origin {0};
+    /// The epoch in the high half and the number of chunks published since
+    /// the start in the low half. Bumped by the audio thread, advanced by
+    /// the prefetch thread.
+    std::atomic<uint64> published {0};
+    /// The oldest stream frame the audio thread may still read.
+    std::atomic<int64> oldest {0};
+  };
+
+  /// Samples in a voice's double buffer.
+  static constexpr int ringFrames = 2 * chunkFrames;
+
+  /// The prefetch thread: opens files and refills the voices.
+  void run() override;
+
+  /// Opens file and hands it to the audio thread, or returns an error.
+  String open (const File& file);
+
+  /// Reads the next chunk of a voice if its playhead has left the chunk
+  /// it would replace. Returns true if it read one.
+  bool prefetch (int index);
+
+  /// Returns true if prefetch() would read a chunk for a voice.
+  static bool needsChunk (const Voice& voice) noexcept;
+
+  /// Adopts a file handed over by open(), if any.
+  void update() noexcept;
+
+  /// Starts voice index at a stream frame.
+  void start (int index, int64 frame) noexcept;
+
+  /// Stops voice index and lets go of its file.
+  void stop (int index) noexcept;
+
+  /// Adds numSamples of a voice, advancing step frames per sample, into
+  /// output. Returns false if it ran out of data.
+  bool play (Voice& voice, const float* ring, float* output, int numSamples, double step, float gain) noexcept;
+
+  Voice voices[maxVoices];
+  /// The double buffers, ringFrames per voice. Allocated by the prefetch
+  /// thread before it hands over the first file, and first written by it.
+  HeapBlock<float> rings;
+  /// The prefetch thread's scratch for a chunk of up to two channels.
+  AudioSampleBuffer chunk;
+
+  /// The file playing, on the audio thread, and the files handed over and
+  /// passed back. The audio thread only adopts a new file while nothing
+  /// waits in retired.
+  Source* playing {nullptr};
+  std::atomic<Source*> incoming {nullptr};
+  std::atomic<Source*> retired {nullptr};
+
+  std::atomic<double> root {440.0};
+  std::atomic<int> numVoices {1};
+  std::atomic<float> detune {10.0f};
+  std::atomic<bool> looping {true};
+  std::atomic<int64> underruns {0};
+  /// Set while the prefetch thread waits for the audio thread to wake it,
+  /// and how it is woken, by load() too.
+  std::atomic<bool> parked {false};
+  RealtimeWakeup wakeup;
+
+  /// The prefetch thread's work and results, guarded by lock.
+  File pendingFile;
+  String status {"No sample"};
+  CriticalSection lock;
+
+  JUCE_DECLARE_NON_COPYABLE (SampleStreamer)
+};
@@ -0,0 +1,43 @@
+//==============================================================================
+// SilenceTracker.h
+// Tells when a stage of the output chain can be skipped because it is silent.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/// SilenceTracker follows the input of a stage whose output can ring on
+/// for a tail of samples after its input goes silent, as a convolution or
+/// a delay line does. Told whether each block of input is silent, it tells
+/// when the stage's output is certain to be silent too, so the stage can
+/// be skipped until its input isn't.
+class SilenceTracker
+{
+public:
+  /// Returns true if every sample of buffer is exactly zero.
+  static bool isSilent (const AudioSampleBuffer& buffer) noexcept
+  {
+    for (auto chan = 0; chan < buffer.getNumChannels(); ++chan) {
+      auto range = FloatVectorOperations::findMinAndMax (buffer.getReadPointer (chan), buffer.getNumSamples());
+      if (range.getStart() != 0.0f || range.getEnd() != 0.0f)
+        return false;
+    }
+    return true;
+  }
+
+  /// Counts a block of numSamples of input and returns true if the stage's
+  /// output for it is silent: its input has been silent for the whole
+  /// block and for tailSamples before it.
+  bool push (bool inputSilent, int numSamples, int tailSamples) noexcept
+  {
+    silentSamples = inputSilent ? silentSamples + numSamples : 0;
+    return inputSilent && silentSamples >= (int64) tailSamples + numSamples;
+  }
+
+  /// Returns the number of samples the input has been silent for.
+  int64 getSilentSamples() const noexcept { return silentSamples; }
+
+private:
+  int64 silentSamples {0};
+};
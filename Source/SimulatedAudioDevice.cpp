@@ -0,0 +1,213 @@
+//==============================================================================
+// SimulatedAudioDevice.cpp
+// The simulated device's callback thread, timing and background load.
+//==============================================================================
+
+#include "SimulatedAudioDevice.h"
+
+//==============================================================================
+/// Keeps a core busy for a fraction of every few milliseconds.
+class SimulatedAudioDevice::LoadThread : public Thread
+{
+public:
+  explicit LoadThread (double busyFraction)
+  : Thread ("Simulated Load"), busy (jlimit (0.0, 1.0, busyFraction)) {
+  }
+
+  ~LoadThread() override {
+    stopThread (1000);
+  }
+
+private:
+  void run() override {
+    const auto sliceMs = 10.0;
+    while (! threadShouldExit()) {
+      auto end = Time::getMillisecondCounterHiRes() + busy * sliceMs;
+      while (Time::getMillisecondCounterHiRes() < end)
+        sink = sink * 0.999 + 1.0;
+      if (busy < 1.0)
+        wait (roundToInt ((1.0 - busy) * sliceMs));
+    }
+  }
+
+  const double busy;
+  volatile double sink {0.0};
+};
+
+//==============================================================================
+SimulatedAudioDevice::SimulatedAudioDevice (const String& name, const Options& o)
+: AudioIODevice (name, SimulatedAudioDeviceType::typeName), Thread ("Simulated Audio Device"), options (o) {
+}
+
+SimulatedAudioDevice::~SimulatedAudioDevice() {
+  close();
+}
+
+SimulatedAudioDevice::Stats SimulatedAudioDevice::getStats() const {
+  Stats stats;
+  stats.callbacks = callbacks.load();
+  stats.deadlineMisses = deadlineMisses.load();
+  stats.worstLoad = worstLoad.load();
+  stats.meanLoad = (stats.callbacks > 0) ? totalLoad.load() / (double) stats.callbacks : 0.0;
+  stats.elapsedSeconds = elapsedSeconds.load();
+  return stats;
+}
+
+StringArray SimulatedAudioDevice::getOutputChannelNames() {
+  StringArray names;
+  for (auto i = 0; i < options.numChannels; ++i)
+    names.add ("Output " + String (i + 1));
+  return names;
+}
+
+StringArray SimulatedAudioDevice::getInputChannelNames() {
+  StringArray names;
+  for (auto i = 0; i < options.numChannels; ++i)
+    names.add ("Input " + String (i + 1));
+  return names;
+}
+
+Array<double> SimulatedAudioDevice::getAvailableSampleRates() {
+  Array<double> rates {44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0};
+  rates.addIfNotAlreadyThere (options.sampleRate);
+  rates.sort();
+  return rates;
+}
+
+Array<int> SimulatedAudioDevice::getAvailableBufferSizes() {
+  Array<int> sizes;
+  for (auto size = 16; size <= 4096; size *= 2)
+    sizes.add (size);
+  sizes.addIfNotAlreadyThere (options.blockSize);
+  sizes.sort();
+  return sizes;
+}
+
+String SimulatedAudioDevice::open (const BigInteger& inputChannels, const BigInteger& outputChannels,
+                                   double newSampleRate, int bufferSize) {
+  close();
+  sampleRate = (newSampleRate > 0.0) ? newSampleRate : options.sampleRate;
+  blockSize = (bufferSize > 0) ? bufferSize : options.blockSize;
+
+  // the callback sees the active channels only, in order
+  auto setUp = [this] (const BigInteger& requested, BigInteger& active, AudioSampleBuffer& buffer) {
+    active = requested;
+    active.setRange (options.numChannels, jmax (0, active.getHighestBit() + 1 - options.numChannels), false);
+    buffer.setSize (jmax (1, active.countNumberOfSetBits()), blockSize);
+    buffer.clear();
+  };
+  setUp (outputChannels, activeOutputs, outputs);
+  setUp (inputChannels, activeInputs, inputs);
+  outputPointers.clear();
+  for (auto i = 0; i < activeOutputs.countNumberOfSetBits(); ++i)
+    outputPointers.push_back (outputs.getWritePointer (i));
+  inputPointers.clear();
+  for (auto i = 0; i < activeInputs.countNumberOfSetBits(); ++i)
+    inputPointers.push_back (inputs.getReadPointer (i));
+  opened = true;
+  return {};
+}
+
+void SimulatedAudioDevice::close() {
+  stop();
+  opened = false;
+}
+
+void SimulatedAudioDevice::start (AudioIODeviceCallback* newCallback) {
+  if (! opened || newCallback == nullptr)
+    return;
+  stop();
+  newCallback->audioDeviceAboutToStart (this);
+  callbacks.store (0);
+  deadlineMisses.store (0);
+  worstLoad.store (0.0);
+  totalLoad.store (0.0);
+  elapsedSeconds.store (0.0);
+  callback = newCallback;
+  if (options.contention > 0.0) {
+    for (auto i = 0; i < SystemStats::getNumCpus(); ++i) {
+      loadThreads.push_back (std::make_unique<LoadThread> (options.contention));
+      loadThreads.back()->startThread (Thread::Priority::normal);
+    }
+  }
+  startThread (Thread::Priority::highest);
+}
+
+void SimulatedAudioDevice::stop() {
+  if (callback == nullptr)
+    return;
+  stopThread (10000);
+  loadThreads.clear();
+  std::exchange (callback, nullptr)->audioDeviceStopped();
+}
+
+void SimulatedAudioDevice::run() {
+  Random random (options.seed);
+  AudioIODeviceCallbackContext context;
+  auto ticksPerSecond = (double) Time::getHighResolutionTicksPerSecond();
+  auto periodTicks = (double) blockSize / sampleRate * ticksPerSecond;
+  auto start = Time::getHighResolutionTicks();
+  // the period the next callback fills, counted from the start
+  int64 period = 0;
+  while (! threadShouldExit()) {
+    auto due = start + (int64) ((double) period * periodTicks);
+    if (! options.maxSpeed) {
+      waitUntil (due + (int64) (random.nextDouble() * options.jitter * periodTicks));
+      if (threadShouldExit())
+        break;
+    }
+    auto begin = Time::getHighResolutionTicks();
+    callback->audioDeviceIOCallbackWithContext (inputPointers.data(), (int) inputPointers.size(),
+                                                outputPointers.data(), (int) outputPointers.size(),
+                                                blockSize, context);
+    auto end = Time::getHighResolutionTicks();
+
+    auto load = (double) (end - begin) / periodTicks;
+    auto missed = options.maxSpeed ? (load > 1.0) : ((double) (end - due) > periodTicks);
+    if (missed)
+      deadlineMisses.store (deadlineMisses.load (std::memory_order_relaxed) + 1);
+    if (load > worstLoad.load (std::memory_order_relaxed))
+      worstLoad.store (load);
+    totalLoad.store (totalLoad.load (std::memory_order_relaxed) + load);
+    elapsedSeconds.store ((double) (end - start) / ticksPerSecond);
+    callbacks.store (callbacks.load (std::memory_order_relaxed) + 1);
+
+    // after a miss the hardware has played a gap, and the next callback is
+    // due at the next whole period
+    ++period;
+    if (! options.maxSpeed)
+      period = jmax (period, (int64) std::ceil ((double) (end - start) / periodTicks));
+  }
+}
+
+void SimulatedAudioDevice::waitUntil (int64 ticks) {
+  for (;;) {
+    auto remaining = Time::highResolutionTicksToSeconds (ticks - Time::getHighResolutionTicks());
+    if (remaining <= 0.0 || threadShouldExit())
+      return;
+    // sleep while that can't overshoot, then spin for the rest
+    if (remaining > 0.002)
+      wait ((int) (remaining * 1000.0) - 1);
+    else
+      Thread::yield();
+  }
+}
+
+//==============================================================================
+SimulatedAudioDeviceType::SimulatedAudioDeviceType (const SimulatedAudioDevice::Options& o)
+: AudioIODeviceType (typeName), options (o) {
+}
+
+StringArray SimulatedAudioDeviceType::getDeviceNames (bool wantInputNames) const {
+  return StringArray (deviceName);
+}
+
+int SimulatedAudioDeviceType::getIndexOfDevice (AudioIODevice* device, bool asInput) const {
+  return (dynamic_cast<SimulatedAudioDevice*> (device) != nullptr) ? 0 : -1;
+}
+
+AudioIODevice* SimulatedAudioDeviceType::createDevice (const String& outputDeviceName, const String& inputDeviceName) {
+  if (outputDeviceName != deviceName && inputDeviceName != deviceName)
+    return nullptr;
+  return new SimulatedAudioDevice (deviceName, options);
+}
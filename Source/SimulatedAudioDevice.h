@@ -0,0 +1,152 @@
+//==============================================================================
+// SimulatedAudioDevice.h
+// A virtual audio device that runs the callbacks without sound hardware.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/// SimulatedAudioDevice drives an AudioIODeviceCallback from its own thread
+/// the way a sound card would, so the whole callback stack runs on machines
+/// without one. Its outputs are discarded and its inputs are silent.
+///
+/// In real time, a callback is due every block at the device's rate. Each
+/// one can start late by a random part of the period, like a scheduler's
+/// wakeup latency, and background threads can keep every core partly busy
+/// to compete with the callback. A callback that ends after its period is
+/// over has missed its deadline. The hardware would have played a gap
+/// there, so the next callback is due at the next whole period. At max
+/// speed, the callbacks run back to back and the ones that take longer than
+/// a period are counted as misses instead.
+///
+/// The jitter comes from a seeded generator, so a run is repeatable.
+class SimulatedAudioDevice : public AudioIODevice, private Thread
+{
+public:
+  /// The device's defaults and the stress it applies.
+  struct Options
+  {
+    double sampleRate {48000.0};
+    int blockSize {256};
+    /// Outputs, and silent inputs.
+    int numChannels {2};
+    /// Each callback starts late by up to this fraction of the period.
+    double jitter {0.0};
+    /// Fraction of every core kept busy by background threads, 0 to 1.
+    double contention {0.0};
+    /// Runs the callbacks back to back instead of in real time.
+    bool maxSpeed {false};
+    /// Seeds the jitter.
+    int64 seed {1};
+  };
+
+  /// What the device measured since it started.
+  struct Stats
+  {
+    int64 callbacks {0};
+    int64 deadlineMisses {0};
+    /// Time spent in the callback as a fraction of the period.
+    double worstLoad {0.0};
+    double meanLoad {0.0};
+    double elapsedSeconds {0.0};
+  };
+
+  SimulatedAudioDevice (const String& name, const Options& options);
+
+  /// Stops the callbacks and closes the device.
+  ~SimulatedAudioDevice() override;
+
+  /// Returns the measurements since the last start(). Safe from any thread.
+  Stats getStats() const;
+
+  //==============================================================================
+  // AudioIODevice overrides
+
+  StringArray getOutputChannelNames() override;
+  StringArray getInputChannelNames() override;
+  Array<double> getAvailableSampleRates() override;
+  Array<int> getAvailableBufferSizes() override;
+  int getDefaultBufferSize() override { return options.blockSize; }
+
+  String open (const BigInteger& inputChannels, const BigInteger& outputChannels,
+               double sampleRate, int bufferSize) override;
+  void close() override;
+  bool isOpen() override { return opened; }
+
+  void start (AudioIODeviceCallback* callback) override;
+  void stop() override;
+  bool isPlaying() override { return callback != nullptr; }
+
+  String getLastError() override { return {}; }
+  int getCurrentBufferSizeSamples() override { return blockSize; }
+  double getCurrentSampleRate() override { return sampleRate; }
+  int getCurrentBitDepth() override { return 32; }
+  BigInteger getActiveOutputChannels() const override { return activeOutputs; }
+  BigInteger getActiveInputChannels() const override { return activeInputs; }
+  int getOutputLatencyInSamples() override { return blockSize; }
+  int getInputLatencyInSamples() override { return blockSize; }
+  /// Returns the number of deadline misses.
+  int getXRunCount() const noexcept override { return (int) deadlineMisses.load(); }
+
+private:
+  class LoadThread;
+
+  /// The device thread: runs the callbacks and measures them.
+  void run() override;
+
+  /// Waits until the high resolution clock reaches ticks, or the thread
+  /// is asked to exit.
+  void waitUntil (int64 ticks);
+
+  const Options options;
+
+  bool opened {false};
+  double sampleRate {0.0};
+  int blockSize {0};
+  BigInteger activeOutputs;
+  BigInteger activeInputs;
+
+  /// The channels passed to the callback, one per active channel.
+  AudioSampleBuffer outputs;
+  AudioSampleBuffer inputs;
+  std::vector<float*> outputPointers;
+  std::vector<const float*> inputPointers;
+
+  /// Set by start() before the thread runs and cleared by stop() after it
+  /// has stopped.
+  AudioIODeviceCallback* callback {nullptr};
+  std::vector<std::unique_ptr<LoadThread>> loadThreads;
+
+  /// Written by the device thread.
+  std::atomic<int64> callbacks {0};
+  std::atomic<int64> deadlineMisses {0};
+  std::atomic<double> worstLoad {0.0};
+  std::atomic<double> totalLoad {0.0};
+  std::atomic<double> elapsedSeconds {0.0};
+
+  JUCE_DECLARE_NON_COPYABLE (SimulatedAudioDevice)
+};
+
+//==============================================================================
+/// The "Simulated" device type, with one device. Add it to the
+/// AudioDeviceManager to offer it next to the real devices, or on its own
+/// so nothing touches the hardware.
+class SimulatedAudioDeviceType : public AudioIODeviceType
+{
+public:
+  static constexpr const char* typeName = "Simulated";
+  static constexpr const char* deviceName = "Simulated Device";
+
+  explicit SimulatedAudioDeviceType (const SimulatedAudioDevice::Options& options = {});
+
+  void scanForDevices() override {}
+  StringArray getDeviceNames (bool wantInputNames = false) const override;
+  int getDefaultDeviceIndex (bool forInput) const override { return 0; }
+  int getIndexOfDevice (AudioIODevice* device, bool asInput) const override;
+  bool hasSeparateInputsAndOutputs() const override { return false; }
+  AudioIODevice* createDevice (const String& outputDeviceName, const String& inputDeviceName) override;
+
+private:
+  const SimulatedAudioDevice::Options options;
+};
@@ -0,0 +1,77 @@
+//==============================================================================
+// SoakTest.cpp
+// The soak test's control changes and report.
+//==============================================================================
+
+#include "SoakTest.h"
+#include "MainApplication.h"
+#include "SimulatedAudioDevice.h"
+
+namespace
+{
+  const int tickMs = 20;
+  /// Ticks between waveform changes.
+  const int ticksPerWaveform = 25;
+}
+
+SoakTest::SoakTest (double seconds, int64 seed)
+: component (std::make_unique<MainComponent>()), random (seed),
+  endTime (Time::getMillisecondCounterHiRes() + seconds * 1000.0) {
+  component->setSize (600, 400);
+  component->waveformMenu.setSelectedId (MainComponent::SineWave, sendNotificationSync);
+  component->levelSlider.setValue (0.5, sendNotificationSync);
+  component->freqSlider.setValue (440.0, sendNotificationSync);
+  component->buttonClicked (&component->playButton);
+  startTimer (tickMs);
+}
+
+SoakTest::~SoakTest() {
+  stopTimer();
+  component = nullptr;
+}
+
+void SoakTest::timerCallback() {
+  if (Time::getMillisecondCounterHiRes() >= endTime) {
+    finish();
+    return;
+  }
+  ++ticks;
+  if (ticks % ticksPerWaveform == 0) {
+    auto id = 1 + random.nextInt (component->waveformMenu.getNumItems());
+    component->waveformMenu.setSelectedId (id, sendNotificationSync);
+  }
+  component->freqSlider.setValue (20.0 + random.nextDouble() * 4980.0, sendNotificationSync);
+  component->levelSlider.setValue (random.nextDouble(), sendNotificationSync);
+  // paints every visible child, as a repaint of the window would
+  component->createComponentSnapshot (component->getLocalBounds());
+}
+
+void SoakTest::finish() {
+  stopTimer();
+  if (component->isPlaying())
+    component->buttonClicked (&component->playButton);
+  auto& app = MainApplication::getApp();
+  auto* device = app.audioDeviceManager.getCurrentAudioDevice();
+  auto misses = 0;
+  if (auto* simulated = dynamic_cast<SimulatedAudioDevice*> (device)) {
+    auto stats = simulated->getStats();
+    misses = (int) stats.deadlineMisses;
+    Logger::writeToLog ("Soak test: " + String (stats.callbacks) + " callbacks of "
+                        + String (device->getCurrentBufferSizeSamples()) + " samples at "
+                        + String (device->getCurrentSampleRate()) + " Hz in "
+                        + String (stats.elapsedSeconds, 1) + " s, "
+                        + String (stats.deadlineMisses) + " deadline misses, load "
+                        + String (stats.meanLoad * 100.0, 1) + " % mean, "
+                        + String (stats.worstLoad * 100.0, 1) + " % worst");
+  }
+  else if (device != nullptr) {
+    misses = device->getXRunCount();
+    Logger::writeToLog ("Soak test on " + device->getName() + ": " + String (misses) + " xruns");
+  }
+  else {
+    Logger::writeToLog ("Soak test: no audio device");
+    misses = 1;
+  }
+  app.setApplicationReturnValue (misses > 0 ? 1 : 0);
+  app.quit();
+}
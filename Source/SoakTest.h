@@ -0,0 +1,40 @@
+//==============================================================================
+// SoakTest.h
+// Plays the app headless on the simulated device while changing its settings.
+//==============================================================================
+
+#pragma once
+
+#include "MainComponent.h"
+
+/// SoakTest runs the main component without a window for a given time,
+/// against whichever device the AudioDeviceManager has open, normally a
+/// SimulatedAudioDevice. It drives the controls through the message thread
+/// as a user would: the frequency and level sliders every tick and the
+/// waveform menu every half second. It renders the component into an image
+/// every tick, so the visualizer and meters repaint as they do on screen.
+///
+/// When the time is up it logs the device's measurements and quits. The
+/// app returns 1 if the device missed a deadline, so CI can fail on it.
+class SoakTest : private Timer
+{
+public:
+  /// Starts playing. seed picks the sequence of settings.
+  SoakTest (double seconds, int64 seed);
+
+  /// Stops playing.
+  ~SoakTest() override;
+
+private:
+  void timerCallback() override;
+
+  /// Stops playing, logs the results and quits.
+  void finish();
+
+  std::unique_ptr<MainComponent> component;
+  Random random;
+  double endTime;
+  int ticks {0};
+
+  JUCE_DECLARE_NON_COPYABLE (SoakTest)
+};
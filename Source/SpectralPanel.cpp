@@ -0,0 +1,41 @@
+//==============================================================================
+// SpectralPanel.cpp
+// The controls of the inverse FFT additive generators.
+//==============================================================================
+
+#include "SpectralPanel.h"
+
+SpectralPanel::SpectralPanel (SpectralSynth& s)
+: synth (s) {
+  addAndMakeVisible (sizeMenu);
+  // the item ids are the FFT orders
+  for (auto order = SpectralSynth::minOrder; order <= SpectralSynth::maxOrder; ++order)
+    sizeMenu.addItem ("FFT " + String (1 << order), order);
+  sizeMenu.setSelectedId (synth.getFftOrder(), dontSendNotification);
+  sizeMenu.addListener (this);
+
+  addAndMakeVisible (status);
+  status.setJustificationType (Justification::centredRight);
+}
+
+void SpectralPanel::updateStatus (double sampleRate) {
+  auto hop = 1 << (synth.getFftOrder() - 2);
+  auto text = String (synth.getNumPartials()) + " partials, hop " + String (hop);
+  // a partial's frequency is heard from the frame after it changes
+  if (sampleRate > 0.0)
+    text += ", " + String (1000.0 * hop / sampleRate, 1) + " ms latency";
+  status.setText (text, dontSendNotification);
+}
+
+void SpectralPanel::resized() {
+  auto bounds = getLocalBounds();
+  auto row = bounds.removeFromTop (24);
+  sizeMenu.setBounds (row.removeFromLeft (118));
+  row.removeFromLeft (8);
+  status.setBounds (row);
+}
+
+void SpectralPanel::comboBoxChanged (ComboBox* menu) {
+  if (menu == &sizeMenu)
+    synth.setFftOrder (sizeMenu.getSelectedId());
+}
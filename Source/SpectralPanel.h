@@ -0,0 +1,29 @@
+//==============================================================================
+// SpectralPanel.h
+// The controls of the inverse FFT additive generators.
+//==============================================================================
+
+#pragma once
+
+#include "SpectralSynth.h"
+
+/// SpectralPanel sets the FFT size of a SpectralSynth. updateStatus() shows
+/// the partials in each frame, the hop and the latency the size adds.
+class SpectralPanel : public Component, public ComboBox::Listener
+{
+public:
+  explicit SpectralPanel (SpectralSynth& synth);
+
+  /// Shows the engine's status at sampleRate. Call from a timer.
+  void updateStatus (double sampleRate);
+
+  void resized() override;
+  void comboBoxChanged (ComboBox* menu) override;
+
+private:
+  SpectralSynth& synth;
+  ComboBox sizeMenu;
+  Label status;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectralPanel)
+};
@@ -0,0 +1,145 @@
+//==============================================================================
+// SpectralSynth.cpp
+// Additive synthesis by inverse FFT and overlap-add, for thousands of partials.
+//==============================================================================
+
+#include "SpectralSynth.h"
+
+namespace
+{
+  /// The coefficients of the four term Blackman-Harris window, whose
+  /// sidelobes are 92 dB down.
+  const double blackmanHarris[] {0.35875, 0.48829, 0.14128, 0.01168};
+
+  /// Returns the sum of cos (2 pi x n / size) over the n of a frame centred
+  /// on n = 0, from -size / 2 to size / 2 - 1: the spectrum of a rectangular
+  /// window x bins from its centre.
+  double getRectangleSpectrum (double x, int size)
+  {
+    auto pi = MathConstants<double>::pi;
+    auto denominator = std::sin (pi * x / size);
+    auto symmetric = (std::abs (denominator) < 1e-12) ? (double) (size - 1)
+                                                       : std::sin (pi * x * (size - 1) / size) / denominator;
+    // the first sample of the frame has no partner
+    return symmetric + std::cos (pi * x);
+  }
+
+  /// Returns the value of the centred Blackman-Harris window n samples from
+  /// the centre of a frame of size samples.
+  double getWindow (int n, int size)
+  {
+    auto x = MathConstants<double>::twoPi * n / size;
+    return blackmanHarris[0] + blackmanHarris[1] * std::cos (x) + blackmanHarris[2] * std::cos (2.0 * x)
+           + blackmanHarris[3] * std::cos (3.0 * x);
+  }
+
+  /// Returns the spectrum of the window x bins from its centre. Each
+  /// cosine term of the window shifts the rectangle's spectrum by its
+  /// number of bins either way.
+  double getWindowSpectrum (double x, int size)
+  {
+    auto sum = blackmanHarris[0] * getRectangleSpectrum (x, size);
+    for (auto m = 1; m < 4; ++m)
+      sum += 0.5 * blackmanHarris[m] * (getRectangleSpectrum (x - m, size) + getRectangleSpectrum (x + m, size));
+    return sum;
+  }
+}
+
+SpectralSynth::SpectralSynth() {
+  for (auto order = minOrder; order <= maxOrder; ++order) {
+    auto& s = sizes[order - minOrder];
+    auto size = 1 << order;
+    auto hop = size / 4;
+    s.fft = std::make_unique<dsp::FFT> (order);
+    s.lobe.resize ((size_t) 2 * lobeBins * lobeResolution + 2);
+    for (size_t i = 0; i < s.lobe.size(); ++i)
+      s.lobe[i] = (float) (0.5 * getWindowSpectrum ((double) i / lobeResolution - lobeBins, size));
+    s.synthesis.resize ((size_t) 2 * hop);
+    for (auto n = -hop; n < hop; ++n)
+      s.synthesis[(size_t) (n + hop)] = (float) ((1.0 - std::abs (n) / (double) hop) / getWindow (n, size));
+  }
+}
+
+size_t SpectralSynth::getArenaBytes() {
+  return (size_t) 2 * numSlots * DspArena::bytesFor<float> ((size_t) 1 << (maxOrder - 2))
+         + DspArena::bytesFor<float> ((size_t) 2 << maxOrder);
+}
+
+void SpectralSynth::prepare (DspArena& arena) {
+  for (auto& slot : slots) {
+    slot.tail = arena.allocate<float> ((size_t) 1 << (maxOrder - 2));
+    slot.ready = arena.allocate<float> ((size_t) 1 << (maxOrder - 2));
+  }
+  frame = arena.allocate<float> ((size_t) 2 << maxOrder);
+  if (frame == nullptr) {
+    release();
+    return;
+  }
+  for (auto& slot : slots) {
+    slot.readyPosition = 0;
+    slot.order = 0;
+  }
+}
+
+void SpectralSynth::release() {
+  for (auto& slot : slots) {
+    slot.tail = nullptr;
+    slot.ready = nullptr;
+  }
+  frame = nullptr;
+  for (auto& count : numPartials)
+    count.store (0);
+}
+
+void SpectralSynth::beginFrame() noexcept {
+  std::fill (frame, frame + (1 << order) + 2, 0.0f);
+}
+
+void SpectralSynth::addPartial (double bin, float amplitude, float cosine, float sine) noexcept {
+  const auto& lobe = sizes[order - minOrder].lobe;
+  auto half = 1 << (order - 1);
+  auto re = amplitude * cosine;
+  auto im = amplitude * sine;
+  auto first = (int) std::ceil (bin - lobeBins);
+  auto last = (int) std::floor (bin + lobeBins);
+  for (auto j = first; j <= last; ++j) {
+    auto position = (j - bin + lobeBins) * lobeResolution;
+    auto index = jlimit (0, (int) lobe.size() - 2, (int) position);
+    auto frac = (float) (position - index);
+    auto weight = lobe[(size_t) index] + frac * (lobe[(size_t) index + 1] - lobe[(size_t) index]);
+    // the lobe's bins below zero and above nyquist are the mirror images
+    // of the negative frequency lobe, so they fold back conjugated
+    if (j == 0 || j == half) {
+      frame[2 * j] += 2.0f * weight * re;
+    }
+    else if (j < 0 && j > -half) {
+      frame[-2 * j] += weight * re;
+      frame[-2 * j + 1] -= weight * im;
+    }
+    else if (j > half && j < 2 * half) {
+      frame[2 * (2 * half - j)] += weight * re;
+      frame[2 * (2 * half - j) + 1] -= weight * im;
+    }
+    else if (j > 0 && j < half) {
+      frame[2 * j] += weight * re;
+      frame[2 * j + 1] += weight * im;
+    }
+  }
+}
+
+void SpectralSynth::endFrame (int index) noexcept {
+  auto& slot = slots[index];
+  const auto& s = sizes[order - minOrder];
+  auto size = 1 << order;
+  auto hop = size / 4;
+  s.fft->performRealOnlyInverseTransform (frame);
+  // the frame is centred on its first sample, so its first half is at the
+  // end of the transform
+  const auto* synthesis = s.synthesis.data();
+  const auto* before = frame + size - hop;
+  for (auto i = 0; i < hop; ++i)
+    slot.ready[i] = slot.tail[i] + before[i] * synthesis[i];
+  for (auto i = 0; i < hop; ++i)
+    slot.tail[i] = frame[i] * synthesis[hop + i];
+  slot.readyPosition = 0;
+}
@@ -0,0 +1,244 @@
+//==============================================================================
+// SpectralSynth.h
+// Additive synthesis by inverse FFT and overlap-add, for thousands of partials.
+//==============================================================================
+
+#pragma once
+
+#include "Generators.h"
+#include "DspArena.h"
+
+/// SpectralSynth renders the band limited waveforms of the BL_* kernels in
+/// the frequency domain. The BL_* kernels call sin() for every harmonic of
+/// every sample, which at a 20 Hz fundamental and 192 kHz is thousands of
+/// calls per sample. Here every hop of fftSize / 4 samples builds one
+/// frame: each partial adds the spectrum of a Blackman-Harris windowed
+/// sinusoid, its main lobe of 2 * lobeBins bins read from a table, to the
+/// frame's bins. One inverse FFT turns the frame into the windowed sum of
+/// the partials. Dividing by the window and applying a triangle two hops
+/// long lets consecutive frames overlap-add to the sum itself. A partial
+/// costs about ten complex multiply-adds per hop rather than one sin() per
+/// sample, so the cost follows the number of frames rather than the number
+/// of partials.
+///
+/// The FFT size trades time resolution for cost. Each frame holds one
+/// frequency per partial, and a frequency change is heard from the next
+/// frame, up to a hop later, and is crossfaded over a hop. The Blackman-
+/// Harris sidelobes leave the difference from the BL_* kernels 95 dB or
+/// more below their output at every size, as GeneratorBenchmark measures
+/// it. A new size takes effect at the next frame, where the overlap-add
+/// starts over from the phase of the next sample.
+///
+/// Partials are added through addPartial() between beginFrame() and
+/// endFrame(), so the frames can hold any spectrum. The generators below
+/// add the harmonics of the generator frequency with the BL_* amplitude
+/// laws and phases, locked to the fundamental's phase. Each of the
+/// switcher's two slots has its own overlap-add buffers, chosen by
+/// GeneratorState::slot, so two spectral waveforms can crossfade. The
+/// buffers live in the DSP arena, the FFTs and tables are built by the
+/// constructor, and nothing is allocated on the audio thread.
+class SpectralSynth
+{
+public:
+  /// The smallest and largest FFT size, as powers of two.
+  static constexpr int minOrder = 9;
+  static constexpr int maxOrder = 13;
+  /// Half width in bins of the window's main lobe, the part of each
+  /// partial's spectrum that is added.
+  static constexpr int lobeBins = 4;
+  /// Number of overlap-add streams, one per switcher slot.
+  static constexpr int numSlots = 2;
+
+  /// Builds the FFTs and the lobe and window tables of every size.
+  SpectralSynth();
+
+  /// Returns the arena space prepare() needs.
+  static size_t getArenaBytes();
+
+  /// Places the overlap-add buffers and the frame in the arena. Call from
+  /// prepareToPlay().
+  void prepare (DspArena& arena);
+
+  /// Forgets the arena memory handed out by prepare(). Call from
+  /// releaseResources() before the arena is released.
+  void release();
+
+  //==============================================================================
+  // Parameters, safe to set from any thread.
+
+  /// Sets the FFT size to 2^order, minOrder to maxOrder.
+  void setFftOrder (int order) { fftOrder.store (jlimit (minOrder, maxOrder, order)); }
+  int getFftOrder() const noexcept { return fftOrder.load(); }
+
+  /// Returns the number of partials in the last frame of the slot a
+  /// waveform last switched to, so the count holds still while the slot
+  /// switched from fades out.
+  int getNumPartials() const noexcept { return numPartials[latestSlot.load()].load(); }
+
+  //==============================================================================
+  // Audio thread
+
+  /// The generator functions. Render the harmonics of the generator
+  /// frequency up to Nyquist with the amplitude laws of BL_Additive: every
+  /// harmonic (Step 1) or the odd ones (Step 2), at equal amplitude
+  /// (Rolloff 0), 1/h (1) or 1/h**2 (2).
+  template <int Step, int Rolloff>
+  static void render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain);
+
+  /// Clears the frame of the current size.
+  void beginFrame() noexcept;
+
+  /// Adds a partial at a frequency in bins of the current size, whose
+  /// value at the centre of the frame is amplitude * cos (phase), given as
+  /// cos (phase) and sin (phase).
+  void addPartial (double bin, float amplitude, float cosine, float sine) noexcept;
+
+  /// Transforms the frame into the time domain and overlap-adds it into
+  /// the buffers of a slot, whose next hop is then ready to play.
+  void endFrame (int slot) noexcept;
+
+private:
+  /// Samples of the table per bin of the lobe.
+  static constexpr int lobeResolution = 64;
+
+  /// A size's FFT, the lobe of the window's spectrum from -lobeBins to
+  /// lobeBins, scaled by 1/2 for the positive frequency half, and the
+  /// synthesis window: a triangle two hops long divided by the window.
+  struct Size
+  {
+    std::unique_ptr<dsp::FFT> fft;
+    std::vector<float> lobe;
+    std::vector<float> synthesis;
+  };
+
+  /// A slot's overlap-add state: the second half of the last frame, the
+  /// hop of output ready to play and the next sample of it to play, the
+  /// size the buffers were filled at, and the fundamental's phase at the
+  /// centre of the next frame.
+  struct Slot
+  {
+    float* tail {nullptr};
+    float* ready {nullptr};
+    int readyPosition {0};
+    int order {0};
+    double centrePhase {0.0};
+  };
+
+  /// Renders numSamples of a slot's harmonics into output.
+  template <int Step, int Rolloff>
+  void process (GeneratorState& state, float* output, int numSamples, float gain) noexcept;
+
+  /// Synthesizes the frame of a slot's harmonics centred at its centre
+  /// phase and overlap-adds it.
+  template <int Step, int Rolloff>
+  void addHarmonics (GeneratorState& state, int slot) noexcept;
+
+  /// Restarts a slot's overlap-add at the current size from phase.
+  template <int Step, int Rolloff>
+  void restart (GeneratorState& state, int slot, double phase) noexcept;
+
+  Size sizes[maxOrder - minOrder + 1];
+  Slot slots[numSlots];
+  /// The frame being built, as the interleaved bins of a real inverse FFT
+  /// of the largest size.
+  float* frame {nullptr};
+  /// The size of the frame being built.
+  int order {minOrder};
+
+  std::atomic<int> fftOrder {11};
+  /// The number of partials in each slot's last frame, and the slot that
+  /// last started playing.
+  std::atomic<int> numPartials[numSlots] {};
+  std::atomic<int> latestSlot {0};
+
+  JUCE_DECLARE_NON_COPYABLE (SpectralSynth)
+};
+
+//==============================================================================
+
+template <int Step, int Rolloff>
+void SpectralSynth::render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain) {
+  auto* synth = state.engines.spectral;
+  auto& buffer = *bufferToFill.buffer;
+  if (synth == nullptr || synth->frame == nullptr || state.slot < 0 || state.slot >= numSlots) {
+    bufferToFill.clearActiveBufferRegion();
+    return;
+  }
+  if (buffer.getNumChannels() == 0 || bufferToFill.numSamples <= 0)
+    return;
+  auto* first = buffer.getWritePointer (0, bufferToFill.startSample);
+  synth->process<Step, Rolloff> (state, first, bufferToFill.numSamples, gain);
+  for (auto chan = 1; chan < buffer.getNumChannels(); ++chan)
+    FloatVectorOperations::copy (buffer.getWritePointer (chan, bufferToFill.startSample), first, bufferToFill.numSamples);
+}
+
+template <int Step, int Rolloff>
+void SpectralSynth::process (GeneratorState& state, float* output, int numSamples, float gain) noexcept {
+  auto& slot = slots[state.slot];
+  // a slot switching to the synth starts from the fundamental's phase
+  if (state.position == 0 || slot.order == 0) {
+    latestSlot.store (state.slot);
+    restart<Step, Rolloff> (state, state.slot, state.phase);
+  }
+  for (auto done = 0; done < numSamples;) {
+    auto hop = 1 << (slot.order - 2);
+    if (slot.readyPosition == hop) {
+      // a new size starts over from the phase of the next sample
+      if (fftOrder.load() != slot.order) {
+        auto phase = state.phase + done * state.phaseDelta;
+        restart<Step, Rolloff> (state, state.slot, phase - std::floor (phase));
+      }
+      else
+        addHarmonics<Step, Rolloff> (state, state.slot);
+      hop = 1 << (slot.order - 2);
+    }
+    auto num = jmin (numSamples - done, hop - slot.readyPosition);
+    FloatVectorOperations::copyWithMultiply (output + done, slot.ready + slot.readyPosition, gain, num);
+    slot.readyPosition += num;
+    done += num;
+  }
+  auto next = state.phase + numSamples * state.phaseDelta;
+  state.phase = next - std::floor (next);
+  state.position += numSamples;
+}
+
+template <int Step, int Rolloff>
+void SpectralSynth::restart (GeneratorState& state, int index, double phase) noexcept {
+  auto& slot = slots[index];
+  slot.order = fftOrder.load();
+  auto hop = 1 << (slot.order - 2);
+  // the frame centred on the first sample only leaves its second half,
+  // the next frame completes the first hop
+  std::fill (slot.tail, slot.tail + hop, 0.0f);
+  slot.centrePhase = phase;
+  addHarmonics<Step, Rolloff> (state, index);
+  addHarmonics<Step, Rolloff> (state, index);
+}
+
+template <int Step, int Rolloff>
+void SpectralSynth::addHarmonics (GeneratorState& state, int index) noexcept {
+  auto& slot = slots[index];
+  order = slot.order;
+  beginFrame();
+  auto size = 1 << order;
+  auto binsPerHarmonic = state.phaseDelta * size;
+  auto count = 0;
+  if (binsPerHarmonic > 0.0) {
+    // the phasor of harmonic h is the fundamental's raised to the h, minus
+    // a quarter turn as sin (x) = cos (x - pi / 2)
+    auto angle = MathConstants<double>::twoPi * slot.centrePhase;
+    std::complex<double> phasor (std::sin (angle), -std::cos (angle));
+    auto rotation = std::polar (1.0, angle * Step);
+    auto scale = (Rolloff == 0 && state.numHarmonics > 0) ? 1.0f / (float) state.numHarmonics : 1.0f;
+    for (auto h = 1; h <= state.numHarmonics; h += Step) {
+      auto amp = (Rolloff == 0) ? 1.0f : (Rolloff == 1) ? 1.0f / (float) h : 1.0f / (float) (h * h);
+      addPartial (h * binsPerHarmonic, scale * amp, (float) phasor.real(), (float) phasor.imag());
+      phasor *= rotation;
+      ++count;
+    }
+  }
+  endFrame (index);
+  numPartials[index].store (count);
+  auto next = slot.centrePhase + state.phaseDelta * (size / 4);
+  slot.centrePhase = next - std::floor (next);
+}
@@ -0,0 +1,242 @@
+//==============================================================================
+// StringBank.cpp
+// A bank of plucked and noise driven waveguide strings.
+//==============================================================================
+
+#include "StringBank.h"
+
+namespace
+{
+  /// Returns the delay line length for sampleRate: a power of two that
+  /// holds the period of the lowest string.
+  int getLineLength (double sampleRate)
+  {
+    return nextPowerOfTwo ((int) std::ceil (sampleRate / StringBank::lowestFrequency) + 1);
+  }
+
+  /// Returns the distance between the starts of successive delay lines. A
+  /// cache line of padding keeps lines that are accessed at the same index
+  /// from mapping to the same cache sets.
+  int getLineStride (double sampleRate)
+  {
+    return getLineLength (sampleRate) + 16;
+  }
+}
+
+size_t StringBank::getArenaBytes (double sampleRate) {
+  return DspArena::bytesFor<float> ((size_t) maxStrings * getLineStride (sampleRate))
+    + DspArena::bytesFor<int> (maxStrings)
+    + DspArena::bytesFor<float> ((size_t) (NumFields + maxRun) * maxStrings)
+    + DspArena::bytesFor<float> (scratchSize + maxRun);
+}
+
+void StringBank::prepare (DspArena& arena, double sampleRate) {
+  lineLength = getLineLength (sampleRate);
+  lineStride = getLineStride (sampleRate);
+  lines = arena.allocate<float> ((size_t) maxStrings * lineStride);
+  delay = arena.allocate<int> (maxStrings);
+  strings = arena.allocate<float> ((size_t) (NumFields + maxRun) * maxStrings);
+  inputScratch = arena.allocate<float> (scratchSize + maxRun);
+  if (inputScratch == nullptr) {
+    release();
+    return;
+  }
+  FloatVectorOperations::clear (lines, maxStrings * lineStride);
+  for (auto f : {LowPass1, LowPass2, AllpassIn, AllpassOut})
+    FloatVectorOperations::clear (field (f), maxStrings);
+  // a fixed seed, so the bank is detuned the same way every time
+  Random random (0x5742);
+  for (auto s = 0; s < maxStrings; ++s)
+    field (DetuneOffset)[s] = random.nextFloat() * 2.0f - 1.0f;
+  srate = sampleRate;
+  writeIndex = 0;
+  samplesToNextPluck = 0.0;
+  dcInput = dcOutput = 0.0f;
+  dcPole = (float) (1.0 - MathConstants<double>::twoPi * 20.0 / sampleRate);
+  // every line was just cleared, so tune() needn't clear any
+  tunedFrequency = -1.0;
+  tunedStrings = maxStrings;
+}
+
+void StringBank::release() {
+  lines = nullptr;
+  lineLength = lineStride = 0;
+  delay = nullptr;
+  strings = inputScratch = nullptr;
+}
+
+template <bool Plucked>
+void StringBank::render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain) {
+  auto* bank = state.engines.strings;
+  auto& buffer = *bufferToFill.buffer;
+  if (bank == nullptr || bank->inputScratch == nullptr) {
+    bufferToFill.clearActiveBufferRegion();
+    return;
+  }
+  if (buffer.getNumChannels() == 0 || bufferToFill.numSamples <= 0)
+    return;
+  // decaying strings would otherwise spend their tails in denormals
+  RealtimeChecks::ScopedDenormalGuard denormalGuard;
+  auto* first = buffer.getWritePointer (0, bufferToFill.startSample);
+  for (auto done = 0; done < bufferToFill.numSamples; done += scratchSize)
+    bank->process (state, first + done, jmin (scratchSize, bufferToFill.numSamples - done), gain, Plucked);
+  RealtimeChecks::checkDenormal (bank->field (AllpassOut)[0]);
+  for (auto chan = 1; chan < buffer.getNumChannels(); ++chan)
+    FloatVectorOperations::copy (buffer.getWritePointer (chan, bufferToFill.startSample), first, bufferToFill.numSamples);
+}
+
+template void StringBank::render<true> (GeneratorState&, const AudioSourceChannelInfo&, float);
+template void StringBank::render<false> (GeneratorState&, const AudioSourceChannelInfo&, float);
+
+void StringBank::process (GeneratorState& state, float* output, int numSamples, float gain, bool plucked) noexcept {
+  auto count = numStrings.load();
+  if (state.freq != tunedFrequency || count != tunedStrings
+      || decay.load() != tunedDecay || detune.load() != tunedDetune)
+    tune (state.freq, count);
+  auto centre = 0.5f + 0.5f * brightness.load();
+  lowPassCentre = centre;
+  lowPassSide = 0.5f * (1.0f - centre);
+
+  if (! plucked) {
+    // every string resonates at DC, where they would all add up in phase,
+    // so the noise goes through a DC blocker first
+    excite (state, inputScratch, numSamples, 1.0f);
+    auto x1 = dcInput, y1 = dcOutput;
+    for (auto i = 0; i < numSamples; ++i) {
+      auto x = inputScratch[i];
+      y1 = x - x1 + dcPole * y1;
+      x1 = x;
+      inputScratch[i] = y1;
+    }
+    dcInput = x1;
+    dcOutput = y1;
+    // driven strings add in power, each at about the level of the noise
+    resonate (output, inputScratch, numSamples, gain / std::sqrt ((float) count));
+    return;
+  }
+  auto interval = srate / pluckRate.load();
+  samplesToNextPluck = jmin (samplesToNextPluck, interval);
+  for (auto done = 0; done < numSamples;) {
+    while (samplesToNextPluck < 1.0) {
+      pluck (state);
+      samplesToNextPluck += interval;
+    }
+    // the pluck lands on the sample its onset falls in
+    auto num = jmin (numSamples - done, (int) samplesToNextPluck);
+    resonate (output + done, nullptr, num, gain);
+    samplesToNextPluck -= num;
+    done += num;
+  }
+}
+
+void StringBank::tune (double frequency, int count) noexcept {
+  // new strings start from silence
+  for (auto s = tunedStrings; s < count; ++s) {
+    FloatVectorOperations::clear (lines + (size_t) s * lineStride, lineLength);
+    for (auto f : {LowPass1, LowPass2, AllpassIn, AllpassOut})
+      field (f)[s] = 0.0f;
+  }
+  auto seconds = decay.load();
+  auto cents = detune.load();
+  auto highest = jmin (highestFrequency, 0.45 * srate);
+  auto base = jlimit (lowestFrequency, highest, frequency);
+  shortestDelay = maxRun;
+  auto* const detuneOffset = field (DetuneOffset);
+  for (auto s = 0; s < count; ++s) {
+    auto f = base * (s + 1);
+    while (f > highest)
+      f *= 0.5;
+    f = jlimit (lowestFrequency, highest, f * std::pow (2.0, cents * detuneOffset[s] / 1200.0));
+    // the loop is the delay line, one sample of low pass and the allpass,
+    // which takes the remaining 0.1 to 1.1 samples
+    auto period = srate / f;
+    auto whole = (int) (period - 1.1);
+    auto fraction = period - 1.0 - whole;
+    delay[s] = whole;
+    shortestDelay = jmin (shortestDelay, whole);
+    field (Coefficient)[s] = (float) ((1.0 - fraction) / (1.0 + fraction));
+    auto gainPerPeriod = std::pow (10.0, -3.0 / (seconds * f));
+    field (Loss)[s] = (float) gainPerPeriod;
+    // keeps a string driven by white noise at about the noise's level
+    field (Drive)[s] = (float) std::sqrt (1.0 - gainPerPeriod * gainPerPeriod);
+  }
+  tunedFrequency = frequency;
+  tunedStrings = count;
+  tunedDecay = seconds;
+  tunedDetune = cents;
+}
+
+void StringBank::pluck (GeneratorState& state) noexcept {
+  auto s = state.random.nextInt (tunedStrings);
+  // overlapping plucks add in power. A string's energy lasts about
+  // decay / 13.8 seconds (60 dB is a factor of 1e6 in power).
+  auto overlap = jmin ((double) tunedStrings, pluckRate.load() * tunedDecay / 13.8);
+  auto amplitude = (float) (1.0 / std::sqrt (jmax (1.0, overlap)));
+  // the next delay[s] samples read from the string are its whole loop
+  auto* line = lines + (size_t) s * lineStride;
+  auto start = (writeIndex - delay[s]) & (lineLength - 1);
+  auto first = jmin (delay[s], lineLength - start);
+  excite (state, line + start, first, amplitude);
+  excite (state, line, delay[s] - first, amplitude);
+}
+
+void StringBank::excite (GeneratorState& state, float* dest, int numSamples, float gain) noexcept {
+  if (excitation.load() == Brown)
+    Generators::BrownNoise::render (state, dest, numSamples, gain);
+  else
+    Generators::WhiteNoise::render (state, dest, numSamples, gain);
+}
+
+void StringBank::resonate (float* output, const float* input, int numSamples, float gain) noexcept {
+  const auto count = tunedStrings;
+  const auto mask = lineLength - 1;
+  const auto stride = (size_t) lineStride;
+  const auto centre = lowPassCentre;
+  const auto side = lowPassSide;
+  auto* const x1 = field (LowPass1);
+  auto* const x2 = field (LowPass2);
+  auto* const apIn = field (AllpassIn);
+  auto* const apOut = field (AllpassOut);
+  const auto* const c = field (Coefficient);
+  const auto* const g = field (Loss);
+  const auto* const drive = field (Drive);
+  auto* const taps = getTaps();
+  auto* const in = inputScratch + scratchSize;
+  auto w = writeIndex;
+  for (auto done = 0; done < numSamples;) {
+    // a string reads nothing written during a run no longer than its loop,
+    // so the run's delay outputs are gathered first and its loop outputs
+    // written back last, each string's in one sequential pass
+    auto run = jmin (numSamples - done, shortestDelay);
+    for (auto s = 0; s < count; ++s) {
+      auto* line = lines + s * stride;
+      auto read = w - delay[s];
+      for (auto i = 0; i < run; ++i)
+        taps[i * maxStrings + s] = line[(read + i) & mask];
+    }
+    for (auto i = 0; i < run; ++i) {
+      auto* tap = taps + i * maxStrings;
+      // the loop filters of every string, with no dependency between strings
+      for (auto s = 0; s < count; ++s) {
+        auto x = tap[s];
+        auto low = side * (x + x2[s]) + centre * x1[s];
+        x2[s] = x1[s];
+        x1[s] = x;
+        auto y = c[s] * (low - apOut[s]) + apIn[s];
+        apIn[s] = low;
+        apOut[s] = y;
+        tap[s] = y * g[s];
+      }
+      output[done + i] = gain * Generators::getSum (tap, count);
+      in[i] = (input != nullptr) ? input[done + i] : 0.0f;
+    }
+    for (auto s = 0; s < count; ++s) {
+      auto* line = lines + s * stride;
+      for (auto i = 0; i < run; ++i)
+        line[(w + i) & mask] = taps[i * maxStrings + s] + drive[s] * in[i];
+    }
+    w = (w + run) & mask;
+    done += run;
+  }
+  writeIndex = w;
+}
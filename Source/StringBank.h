@@ -0,0 +1,163 @@
+//==============================================================================
+// StringBank.h
+// A bank of plucked and noise driven waveguide strings.
+//==============================================================================
+
+#pragma once
+
+#include "Generators.h"
+#include "DspArena.h"
+
+/// StringBank is a bank of up to maxStrings Karplus-Strong waveguide
+/// strings, tuned to the harmonics of the generator frequency. A harmonic
+/// above highestFrequency is folded down by octaves, and each string is
+/// detuned by a fixed random fraction of the detune setting. It plays as two
+/// generators:
+/// * Plucked fills the delay line of a random string with a burst of noise
+///   at the pluck rate, so plucks ring out and overlap.
+/// * Resonator feeds a continuous, DC blocked noise signal into every
+///   string, making the bank a set of tuned resonators.
+/// Both excite the strings with the White or Brown noise kernels.
+///
+/// Each string loops its delay line through a three tap linear phase low
+/// pass (the brightness), a first order allpass for the fraction of a
+/// sample left of its period, and a loss gain that decays it by 60 dB in
+/// the decay time. The delay lines are power of two rings back to back in
+/// the DSP arena, and the filter state is stored as one array per field.
+/// The bank works in runs no longer than its shortest loop (at most maxRun
+/// samples), in which no string reads back what it writes. It gathers the
+/// run's delay outputs of every string into a block of one row per
+/// sample, runs the filters of all strings across each row in a loop the
+/// compiler vectorizes, and writes the block back to the lines. Each line
+/// is read and written sequentially once per run. The cost grows with the
+/// number of strings but not with their length, and nothing is allocated.
+class StringBank
+{
+public:
+  /// The noise the strings are excited with.
+  enum Excitation { White, Brown, NumExcitations };
+
+  /// Size of the bank.
+  static constexpr int maxStrings = 256;
+
+  /// The lowest string frequency, which sets the delay line length. The
+  /// generator frequency is raised to it.
+  static constexpr double lowestFrequency = 27.5;
+
+  /// The highest string frequency. It keeps every loop at least 8 samples
+  /// long at 48 kHz, so runs are long.
+  static constexpr double highestFrequency = 5000.0;
+
+  /// Returns the arena space prepare() needs at sampleRate.
+  static size_t getArenaBytes (double sampleRate);
+
+  /// Places the delay lines and string state in the arena and clears them.
+  /// Call from prepareToPlay().
+  void prepare (DspArena& arena, double sampleRate);
+
+  /// Forgets the arena memory handed out by prepare(). Call from
+  /// releaseResources() before the arena is released.
+  void release();
+
+  //==============================================================================
+  // Parameters, safe to set from any thread. New values apply from the next
+  // block.
+
+  /// Strings sounding, 1 to maxStrings.
+  void setNumStrings (int count) { numStrings.store (jlimit (1, maxStrings, count)); }
+  /// Plucks per second of the Plucked generator, 0.1 to 1000.
+  void setPluckRate (float plucksPerSecond) { pluckRate.store (jlimit (0.1f, 1000.0f, plucksPerSecond)); }
+  /// Time a string takes to decay by 60 dB, 0.05 to 30 seconds.
+  void setDecay (float seconds) { decay.store (jlimit (0.05f, 30.0f, seconds)); }
+  /// Loop filter brightness, from 0 (dull) to 1 (no low pass).
+  void setBrightness (float amount) { brightness.store (jlimit (0.0f, 1.0f, amount)); }
+  /// The largest random detuning of a string, 0 to 50 cents.
+  void setDetune (float cents) { detune.store (jlimit (0.0f, 50.0f, cents)); }
+  void setExcitation (Excitation noise) { excitation.store (jlimit (0, (int) NumExcitations - 1, (int) noise)); }
+
+  //==============================================================================
+  // Audio thread
+
+  /// The generator functions. Render the bank that state.engines.strings
+  /// points to, plucked or driven by noise.
+  template <bool Plucked>
+  static void render (GeneratorState& state, const AudioSourceChannelInfo& bufferToFill, float gain);
+
+private:
+  /// Samples rendered per pass.
+  static constexpr int scratchSize = 64;
+
+  /// The longest run of samples the strings are processed in.
+  static constexpr int maxRun = 16;
+
+  /// Renders numSamples (at most scratchSize) into output.
+  void process (GeneratorState& state, float* output, int numSamples, float gain, bool plucked) noexcept;
+
+  /// Runs every string for numSamples, adding input times each string's
+  /// drive into the strings if input isn't null.
+  void resonate (float* output, const float* input, int numSamples, float gain) noexcept;
+
+  /// Sets the delay, allpass coefficient, loss and drive of every string
+  /// for the generator frequency and the current parameters.
+  void tune (double frequency, int count) noexcept;
+
+  /// Fills the loop of a random string with a burst of noise.
+  void pluck (GeneratorState& state) noexcept;
+
+  /// Renders numSamples of the excitation noise at the given gain.
+  void excite (GeneratorState& state, float* dest, int numSamples, float gain) noexcept;
+
+  /// The delay lines, maxStrings of lineLength samples lineStride apart.
+  float* lines {nullptr};
+  int lineLength {0};
+  int lineStride {0};
+  /// The index every delay line writes next.
+  int writeIndex {0};
+
+  /// The fields of a string: its allpass coefficient, loss, drive and
+  /// detuning, the last two low pass inputs, and the last allpass input and
+  /// output.
+  enum Field { Coefficient, Loss, Drive, DetuneOffset, LowPass1, LowPass2, AllpassIn, AllpassOut, NumFields };
+
+  /// Returns the array of a field, with one entry per string.
+  float* field (Field f) const noexcept { return strings + (size_t) f * maxStrings; }
+
+  /// Returns each string's delay output, then its loop output, for each
+  /// sample of a run: maxRun rows of maxStrings.
+  float* getTaps() const noexcept { return strings + (size_t) NumFields * maxStrings; }
+
+  /// The fields followed by the taps, in one block, so the compiler can
+  /// tell the arrays apart and needn't check them for overlap before
+  /// vectorizing.
+  float* strings {nullptr};
+  /// The delay of each string in samples.
+  int* delay {nullptr};
+  /// Per pass excitation noise followed by the input of a run, and the
+  /// state and pole of the Resonator's DC blocker.
+  float* inputScratch {nullptr};
+  float dcInput {0.0f};
+  float dcOutput {0.0f};
+  float dcPole {0.0f};
+
+  double srate {0.0};
+  /// Samples from the start of the current pass to the next pluck.
+  double samplesToNextPluck {0.0};
+
+  /// The frequency and parameters the strings are tuned to, and the loop
+  /// filter taps.
+  double tunedFrequency {-1.0};
+  int tunedStrings {0};
+  float tunedDecay {0.0f};
+  float tunedDetune {-1.0f};
+  /// The shortest string delay, capped at maxRun.
+  int shortestDelay {1};
+  float lowPassCentre {1.0f};
+  float lowPassSide {0.0f};
+
+  std::atomic<int> numStrings {32};
+  std::atomic<float> pluckRate {4.0f};
+  std::atomic<float> decay {4.0f};
+  std::atomic<float> brightness {0.5f};
+  std::atomic<float> detune {5.0f};
+  std::atomic<int> excitation {White};
+};
@@ -0,0 +1,71 @@
+//==============================================================================
+// StringPanel.cpp
+// The controls of the string bank generators.
+//==============================================================================
+
+#include "StringPanel.h"
+
+StringPanel::StringPanel (StringBank& b)
+: bank (b) {
+  addAndMakeVisible (excitationMenu);
+  excitationMenu.addItemList ({"White Excitation", "Brown Excitation"}, 1);
+  excitationMenu.setSelectedId (StringBank::White + 1, dontSendNotification);
+  excitationMenu.addListener (this);
+
+  addSlider (stringsSlider, 1.0, StringBank::maxStrings, 32.0, " strings");
+  stringsSlider.setRange (1.0, StringBank::maxStrings, 1.0);
+  stringsSlider.setSkewFactorFromMidPoint (32.0);
+  addSlider (rateSlider, 0.1, 1000.0, 4.0, " plucks/s");
+  rateSlider.setSkewFactorFromMidPoint (10.0);
+  addSlider (decaySlider, 0.05, 30.0, 4.0, " s decay");
+  decaySlider.setSkewFactorFromMidPoint (3.0);
+  addSlider (brightnessSlider, 0.0, 1.0, 0.5, " bright");
+  addSlider (detuneSlider, 0.0, 50.0, 5.0, " cents");
+}
+
+void StringPanel::addSlider (Slider& slider, double minimum, double maximum, double value, const String& suffix) {
+  addAndMakeVisible (slider);
+  slider.setSliderStyle (Slider::LinearHorizontal);
+  slider.setTextBoxStyle (Slider::TextBoxLeft, false, 90, 22);
+  slider.setRange (minimum, maximum);
+  slider.setTextValueSuffix (suffix);
+  slider.setValue (value, dontSendNotification);
+  slider.addListener (this);
+}
+
+void StringPanel::resized() {
+  auto bounds = getLocalBounds();
+  auto row = bounds.removeFromTop (24);
+  excitationMenu.setBounds (row.removeFromLeft (118));
+  row.removeFromLeft (8);
+  stringsSlider.setBounds (row);
+
+  bounds.removeFromTop (4);
+  row = bounds.removeFromTop (24);
+  rateSlider.setBounds (row.removeFromLeft (row.getWidth() / 2));
+  decaySlider.setBounds (row);
+
+  bounds.removeFromTop (4);
+  row = bounds.removeFromTop (24);
+  brightnessSlider.setBounds (row.removeFromLeft (row.getWidth() / 2));
+  detuneSlider.setBounds (row);
+}
+
+void StringPanel::sliderValueChanged (Slider* slider) {
+  auto value = (float) slider->getValue();
+  if (slider == &stringsSlider)
+    bank.setNumStrings (roundToInt (value));
+  else if (slider == &rateSlider)
+    bank.setPluckRate (value);
+  else if (slider == &decaySlider)
+    bank.setDecay (value);
+  else if (slider == &brightnessSlider)
+    bank.setBrightness (value);
+  else if (slider == &detuneSlider)
+    bank.setDetune (value);
+}
+
+void StringPanel::comboBoxChanged (ComboBox* menu) {
+  if (menu == &excitationMenu)
+    bank.setExcitation ((StringBank::Excitation) (excitationMenu.getSelectedId() - 1));
+}
@@ -0,0 +1,35 @@
+//==============================================================================
+// StringPanel.h
+// The controls of the string bank generators.
+//==============================================================================
+
+#pragma once
+
+#include "StringBank.h"
+
+/// StringPanel sets the parameters of a StringBank: the excitation noise,
+/// the number of strings, the pluck rate, decay time, brightness and
+/// detuning.
+class StringPanel : public Component, public Slider::Listener, public ComboBox::Listener
+{
+public:
+  explicit StringPanel (StringBank& bank);
+
+  void resized() override;
+  void sliderValueChanged (Slider* slider) override;
+  void comboBoxChanged (ComboBox* menu) override;
+
+private:
+  /// Sets up a slider with the app's text box style.
+  void addSlider (Slider& slider, double minimum, double maximum, double value, const String& suffix);
+
+  StringBank& bank;
+  ComboBox excitationMenu;
+  Slider stringsSlider;
+  Slider rateSlider;
+  Slider decaySlider;
+  Slider brightnessSlider;
+  Slider detuneSlider;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StringPanel)
+};
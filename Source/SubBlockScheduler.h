@@ -0,0 +1,106 @@
+//==============================================================================
+// SubBlockScheduler.h
+// Renders in fixed size sub-blocks independent of the device block size.
+//==============================================================================
+
+#pragma once
+
+#include "DspArena.h"
+
+/// SubBlockScheduler slices every audio callback into sub-blocks of
+/// subBlockSize samples on a grid that runs continuously across callbacks.
+/// Each sub-block is rendered whole into an aligned buffer in the DSP arena,
+/// so generators always see the same trip count and never a ragged tail.
+/// When a callback ends part way through a sub-block, the rest of it is
+/// copied out at the start of the next callback. Parameters applied by the
+/// render callback therefore change every subBlockSize samples at every
+/// device buffer size.
+///
+/// The render callback also says whether the sub-block is silent, so
+/// silent sub-blocks are cleared into the output rather than copied, and
+/// process() tells whether the whole callback was.
+class SubBlockScheduler
+{
+public:
+  /// Number of samples per sub-block.
+  static constexpr int subBlockSize = 32;
+
+  /// Returns the arena space prepare() needs for numChannels channels.
+  static size_t getArenaBytes (int numChannels)
+  {
+    return (size_t) numChannels * DspArena::bytesFor<float> (subBlockSize);
+  }
+
+  /// Places a sub-block buffer of numChannels channels in the arena. Output
+  /// channels beyond numChannels receive the last sub-block channel, so a
+  /// mono sub-block is fanned out to every output. Call from prepareToPlay().
+  void prepare (DspArena& arena, int numChannels)
+  {
+    jassert (numChannels > 0 && numChannels <= maxChannels);
+    numChannels = jlimit (1, maxChannels, numChannels);
+    for (auto chan = 0; chan < numChannels; ++chan) {
+      channels[chan] = arena.allocate<float> (subBlockSize);
+      if (channels[chan] == nullptr) {
+        release();
+        return;
+      }
+    }
+    subBlock.setDataToReferTo (channels, numChannels, subBlockSize);
+    subBlock.clear();
+    position = subBlockSize;
+    silent = true;
+  }
+
+  /// Forgets the arena memory handed out by prepare(). Call from
+  /// releaseResources() before the arena is released.
+  void release()
+  {
+    subBlock = AudioSampleBuffer();
+    position = subBlockSize;
+  }
+
+  /// Fills bufferToFill from the sub-block buffer. Each time a new
+  /// sub-block is needed renderSubBlock (AudioSampleBuffer&) is called to
+  /// apply parameter changes and overwrite the whole sub-block buffer. It
+  /// returns true if the sub-block it rendered is silent. Returns true if
+  /// every sample of bufferToFill is.
+  template <typename Renderer>
+  bool process (const AudioSourceChannelInfo& bufferToFill, Renderer&& renderSubBlock)
+  {
+    if (subBlock.getNumChannels() == 0) {
+      bufferToFill.clearActiveBufferRegion();
+      return true;
+    }
+    auto& buffer = *bufferToFill.buffer;
+    auto lastChannel = subBlock.getNumChannels() - 1;
+    auto allSilent = true;
+    int done = 0;
+    while (done < bufferToFill.numSamples) {
+      if (position == subBlockSize) {
+        silent = renderSubBlock (subBlock);
+        position = 0;
+      }
+      auto num = jmin (bufferToFill.numSamples - done, subBlockSize - position);
+      for (auto chan = 0; chan < buffer.getNumChannels(); ++chan) {
+        if (silent)
+          buffer.clear (chan, bufferToFill.startSample + done, num);
+        else
+          buffer.copyFrom (chan, bufferToFill.startSample + done, subBlock, jmin (chan, lastChannel), position, num);
+      }
+      allSilent = allSilent && silent;
+      position += num;
+      done += num;
+    }
+    return allSilent;
+  }
+
+private:
+  static constexpr int maxChannels = 64;
+  float* channels[maxChannels] {};
+  AudioSampleBuffer subBlock;
+  /// Index of the next sample to copy out of subBlock. subBlockSize means
+  /// the next sub-block has to be rendered.
+  int position {subBlockSize};
+  /// True if the sub-block in subBlock is silent.
+  bool silent {true};
+};
@@ -0,0 +1,384 @@
+//==============================================================================
+// Tracing.cpp
+// The per-thread event rings and the trace file writer.
+//==============================================================================
+
+#include "Tracing.h"
+
+#if WAVELAB_TRACING
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+#include <cstdio>
+
+namespace Tracing
+{
+  namespace
+  {
+    const int maxThreads = 16;
+    /// Events per thread, a power of two. Enough for 50 ms of a 64 channel
+    /// matrix rendered in sub-blocks.
+    const uint32 eventsPerThread = 16384;
+    const int flushIntervalMs = 50;
+
+    /// Reads the CPU's cycle counter, or the high resolution clock where
+    /// there is none. The trace writer converts it to time.
+    inline uint64 now() noexcept
+    {
+     #if JUCE_INTEL
+      return __rdtsc();
+     #elif JUCE_ARM && JUCE_64BIT && ! JUCE_MSVC
+      uint64 ticks;
+      asm volatile ("mrs %0, cntvct_el0" : "=r" (ticks));
+      return ticks;
+     #else
+      return (uint64) Time::getHighResolutionTicks();
+     #endif
+    }
+
+    struct Event
+    {
+      const char* name;
+      uint64 begin;
+      uint64 end;
+    };
+
+    /// The ring of one thread. The thread writes events and the trace
+    /// writer reads them; state says who owns the rest.
+    struct ThreadBuffer
+    {
+      enum State { available, claiming, reserved, claimed, exited };
+      std::atomic<int> state {available};
+
+      /// Set while claiming, before state becomes reserved or claimed. The
+      /// serial number tells a thread apart from the ones that used the
+      /// buffer before it.
+      uint32 serial {0};
+      char name[64] {};
+      std::atomic<const char*> label {nullptr};
+
+      std::atomic<uint32> writeIndex {0};
+      std::atomic<uint32> readIndex {0};
+      /// The writer's last known readIndex, so the thread only reads the
+      /// shared one when the ring looks full.
+      uint32 cachedReadIndex {0};
+      std::atomic<uint32> dropped {0};
+
+      Event events[eventsPerThread];
+    };
+
+    /// Allocated by the first start() and kept until exit, as threads hold
+    /// pointers into it.
+    std::atomic<ThreadBuffer*> buffers {nullptr};
+    std::atomic<bool> recording {false};
+    std::atomic<uint32> nextSerial {1};
+    /// Events of threads that found every buffer taken.
+    std::atomic<uint32> unbufferedEvents {0};
+
+    /// The name given to reserveThread(), the buffer it set aside and the
+    /// buffer the adopting thread took from it.
+    std::atomic<const char*> reservedLabel {nullptr};
+    std::atomic<ThreadBuffer*> reservedBuffer {nullptr};
+    std::atomic<ThreadBuffer*> adoptedBuffer {nullptr};
+
+    /// Gives the thread's buffer back when the thread exits.
+    struct ThreadExit
+    {
+      ThreadBuffer* buffer {nullptr};
+      ~ThreadExit()
+      {
+        if (buffer != nullptr)
+          buffer->state.store (ThreadBuffer::exited, std::memory_order_release);
+      }
+    };
+
+    /// The calling thread's buffer. Kept apart from ThreadExit so recording
+    /// an event doesn't go through its initialization check.
+    thread_local ThreadBuffer* threadBuffer = nullptr;
+    thread_local bool noBufferLeft = false;
+    /// Set by adoptThread().
+    thread_local bool adopting = false;
+
+    /// Empties a buffer being claimed.
+    void reset (ThreadBuffer& buffer) noexcept
+    {
+      buffer.serial = nextSerial.fetch_add (1);
+      buffer.label.store (nullptr);
+      buffer.writeIndex.store (0);
+      buffer.readIndex.store (0);
+      buffer.cachedReadIndex = 0;
+      buffer.dropped.store (0);
+    }
+
+    /// Sets a free buffer aside for the adopting thread, unless one is
+    /// already. Called on the message thread.
+    void reserve()
+    {
+      auto* all = buffers.load (std::memory_order_acquire);
+      auto* label = reservedLabel.load();
+      if (all == nullptr || label == nullptr)
+        return;
+      if (auto* buffer = reservedBuffer.load()) {
+        buffer->label.store (label, std::memory_order_relaxed);
+        return;
+      }
+      for (auto i = 0; i < maxThreads; ++i) {
+        auto& buffer = all[i];
+        auto expected = (int) ThreadBuffer::available;
+        if (! buffer.state.compare_exchange_strong (expected, ThreadBuffer::claiming, std::memory_order_acquire))
+          continue;
+        reset (buffer);
+        std::snprintf (buffer.name, sizeof (buffer.name), "%s", label);
+        buffer.label.store (label);
+        buffer.state.store (ThreadBuffer::reserved, std::memory_order_release);
+        reservedBuffer.store (&buffer);
+        return;
+      }
+    }
+
+    /// Takes the reserved buffer for the adopting thread, or returns nullptr.
+    ThreadBuffer* adopt() noexcept
+    {
+      auto* buffer = reservedBuffer.exchange (nullptr);
+      if (buffer == nullptr)
+        return nullptr;
+      buffer->state.store (ThreadBuffer::claimed, std::memory_order_release);
+      adoptedBuffer.store (buffer);
+      threadBuffer = buffer;
+      return buffer;
+    }
+
+    /// Takes a free buffer for the calling thread, or returns nullptr.
+    ThreadBuffer* claim() noexcept
+    {
+      if (adopting)
+        return adopt();
+      auto* all = buffers.load (std::memory_order_acquire);
+      if (all == nullptr || noBufferLeft)
+        return nullptr;
+      for (auto i = 0; i < maxThreads; ++i) {
+        auto& buffer = all[i];
+        auto expected = (int) ThreadBuffer::available;
+        if (! buffer.state.compare_exchange_strong (expected, ThreadBuffer::claiming, std::memory_order_acquire))
+          continue;
+        reset (buffer);
+        String threadName;
+        if (auto* thread = Thread::getCurrentThread())
+          threadName = thread->getThreadName();
+        if (MessageManager::existsAndIsCurrentThread())
+          std::snprintf (buffer.name, sizeof (buffer.name), "Message Thread");
+        else if (threadName.isNotEmpty())
+          threadName.copyToUTF8 (buffer.name, sizeof (buffer.name));
+        else
+          std::snprintf (buffer.name, sizeof (buffer.name), "Thread %u", (unsigned) buffer.serial);
+        buffer.state.store (ThreadBuffer::claimed, std::memory_order_release);
+        static thread_local ThreadExit threadExit;
+        threadExit.buffer = &buffer;
+        threadBuffer = &buffer;
+        return &buffer;
+      }
+      noBufferLeft = true;
+      return nullptr;
+    }
+
+    void record (const char* name, uint64 begin, uint64 end) noexcept
+    {
+      auto* buffer = threadBuffer;
+      if (buffer == nullptr && (buffer = claim()) == nullptr) {
+        unbufferedEvents.fetch_add (1, std::memory_order_relaxed);
+        return;
+      }
+      auto write = buffer->writeIndex.load (std::memory_order_relaxed);
+      if (write - buffer->cachedReadIndex >= eventsPerThread) {
+        buffer->cachedReadIndex = buffer->readIndex.load (std::memory_order_acquire);
+        if (write - buffer->cachedReadIndex >= eventsPerThread) {
+          buffer->dropped.fetch_add (1, std::memory_order_relaxed);
+          return;
+        }
+      }
+      buffer->events[write & (eventsPerThread - 1)] = {name, begin, end};
+      buffer->writeIndex.store (write + 1, std::memory_order_release);
+    }
+
+    //==============================================================================
+    /// Drains the rings into the trace file.
+    class Writer : public Thread
+    {
+    public:
+      Writer (std::unique_ptr<FileOutputStream> s, ThreadBuffer* b)
+      : Thread ("Trace Writer"), stream (std::move (s)), all (b) {
+        ticksOrigin = Time::getHighResolutionTicks();
+        counterOrigin = now();
+        write ("{\"traceEvents\":[\n");
+        writeEvent ("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"%s\"}}",
+                    ProjectInfo::projectName);
+      }
+
+      /// Writes the rest and closes the file. Returns the number of events
+      /// dropped.
+      uint32 finish() {
+        stopThread (10000);
+        flush();
+        write ("\n]}\n");
+        stream->flush();
+        return dropped + unbufferedEvents.exchange (0);
+      }
+
+    private:
+      void run() override {
+        while (! threadShouldExit()) {
+          wait (flushIntervalMs);
+          flush();
+        }
+      }
+
+      void flush() {
+        calibrate();
+        for (auto i = 0; i < maxThreads; ++i) {
+          auto& buffer = all[i];
+          auto state = buffer.state.load (std::memory_order_acquire);
+          if (state != ThreadBuffer::claimed && state != ThreadBuffer::exited)
+            continue;
+          auto* label = buffer.label.load (std::memory_order_relaxed);
+          if (buffer.serial != namedSerial[i] || label != namedLabel[i]) {
+            writeEvent ("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                        (unsigned) buffer.serial, label != nullptr ? label : buffer.name);
+            namedSerial[i] = buffer.serial;
+            namedLabel[i] = label;
+          }
+          auto write = buffer.writeIndex.load (std::memory_order_acquire);
+          for (auto read = buffer.readIndex.load (std::memory_order_relaxed); read != write; ++read) {
+            auto& event = buffer.events[read & (eventsPerThread - 1)];
+            writeEvent ("{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                        event.name, (unsigned) buffer.serial, toMicroseconds (event.begin - counterOrigin),
+                        toMicroseconds (event.end - event.begin));
+          }
+          buffer.readIndex.store (write, std::memory_order_release);
+          dropped += buffer.dropped.exchange (0);
+          if (state == ThreadBuffer::exited)
+            buffer.state.store (ThreadBuffer::available, std::memory_order_release);
+        }
+        stream->flush();
+      }
+
+      /// Measures the counter's rate against the high resolution clock. The
+      /// rate is kept once enough time has passed since the start to measure
+      /// it precisely, so every event is converted at the same rate.
+      void calibrate() {
+        if (calibrated)
+          return;
+        auto counts = now() - counterOrigin;
+        auto seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - ticksOrigin);
+        if (counts > 0 && seconds > 0.0)
+          microsecondsPerCount = seconds * 1.0e6 / (double) counts;
+        calibrated = (seconds >= 0.04);
+      }
+
+      double toMicroseconds (uint64 counts) const {
+        return (double) (int64) counts * microsecondsPerCount;
+      }
+
+      void write (const char* text) {
+        stream->write (text, std::strlen (text));
+      }
+
+      template <typename... Args>
+      void writeEvent (const char* format, Args... args) {
+        char line[512];
+        auto length = std::snprintf (line, sizeof (line), format, args...);
+        if (length <= 0)
+          return;
+        if (eventsWritten++ > 0)
+          write (",\n");
+        stream->write (line, (size_t) jmin (length, (int) sizeof (line) - 1));
+      }
+
+      std::unique_ptr<FileOutputStream> stream;
+      ThreadBuffer* all;
+      int64 ticksOrigin;
+      uint64 counterOrigin;
+      double microsecondsPerCount {0.0};
+      bool calibrated {false};
+      uint32 namedSerial[maxThreads] {};
+      const char* namedLabel[maxThreads] {};
+      uint32 dropped {0};
+      int64 eventsWritten {0};
+    };
+
+    /// Touched on the message thread only.
+    std::unique_ptr<Writer> writer;
+  }
+
+  Scope::Scope (const char* n) noexcept
+  : name (n), begin (recording.load (std::memory_order_relaxed) ? now() : 0) {
+  }
+
+  Scope::~Scope() noexcept {
+    if (begin != 0)
+      record (name, begin, now());
+  }
+
+  void reserveThread (const char* name) {
+    reservedLabel.store (name);
+    if (auto* previous = adoptedBuffer.exchange (nullptr))
+      previous->state.store (ThreadBuffer::exited, std::memory_order_release);
+    reserve();
+  }
+
+  void adoptThread() noexcept {
+    adopting = true;
+    threadBuffer = nullptr;
+  }
+
+  String start (const File& file) {
+    if (writer != nullptr)
+      return "Already tracing";
+    auto* all = buffers.load();
+    if (all == nullptr) {
+      all = new ThreadBuffer[maxThreads];
+      buffers.store (all, std::memory_order_release);
+    }
+    // forget what was recorded after the last stop()
+    for (auto i = 0; i < maxThreads; ++i) {
+      auto& buffer = all[i];
+      auto state = buffer.state.load (std::memory_order_acquire);
+      if (state == ThreadBuffer::claimed)
+        buffer.readIndex.store (buffer.writeIndex.load (std::memory_order_acquire), std::memory_order_release);
+      else if (state == ThreadBuffer::exited)
+        buffer.state.store (ThreadBuffer::available, std::memory_order_release);
+      buffer.dropped.store (0);
+    }
+    unbufferedEvents.store (0);
+    reserve();
+    file.deleteFile();
+    auto stream = std::make_unique<FileOutputStream> (file);
+    if (stream->failedToOpen())
+      return "Can't write " + file.getFullPathName();
+    writer = std::make_unique<Writer> (std::move (stream), all);
+    writer->startThread (Thread::Priority::low);
+    recording.store (true);
+    return {};
+  }
+
+  void stop() {
+    if (writer == nullptr)
+      return;
+    recording.store (false);
+    auto dropped = writer->finish();
+    writer.reset();
+    if (dropped > 0)
+      Logger::writeToLog ("Trace events dropped: " + String (dropped));
+  }
+
+  bool isRecording() noexcept {
+    return recording.load();
+  }
+}
+
+#endif
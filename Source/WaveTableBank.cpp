@@ -0,0 +1,144 @@
+//==============================================================================
+// WaveTableBank.cpp
+// Rebuilds edited wavetables off the audio thread and swaps them in.
+//==============================================================================
+
+#include "WaveTableBank.h"
+#include "Tracing.h"
+
+WaveTableBank::WaveTableBank()
+: Thread ("Wavetable Builder") {
+  WaveTableCache cache;
+  for (auto shape = 0; shape < WaveTables::NumShapes; ++shape) {
+    spectra[shape] = WaveTables::getDefaultSpectrum ((Shape) shape);
+    auto* table = new AudioSampleBuffer (1, WaveTables::tableSize + 1);
+    if (cache.isValid()) {
+      // copy the mapped table, so the audio thread never reads the mapping
+      table->copyFrom (0, 0, cache.getTable ((Shape) shape), WaveTables::tableSize + 1);
+    } else {
+      // no cache yet: start silent and have the builder fill in the tables
+      table->clear();
+      dirty.fetch_or (1u << shape);
+    }
+    current[shape] = table;
+    bound[shape] = table;
+  }
+  writeCache = ! cache.isValid();
+  // nothing captured yet: a silent buffer
+  auto* silence = new AudioSampleBuffer (1, WaveTables::tableSize + 1);
+  silence->clear();
+  current[captureSource] = silence;
+  bound[captureSource] = silence;
+  startThread (Thread::Priority::low);
+}
+
+WaveTableBank::~WaveTableBank() {
+  stopThread (10000);
+  for (auto& table : current)
+    delete table.load();
+  for (auto& r : retired)
+    delete r.table;
+}
+
+WaveTables::Spectrum WaveTableBank::getSpectrum (Shape shape) const {
+  const ScopedLock lock (spectrumLock);
+  return spectra[shape];
+}
+
+void WaveTableBank::setHarmonic (Shape shape, int harmonic, float amplitude, float phase) {
+  jassert (harmonic >= 1 && harmonic <= WaveTables::maxHarmonics);
+  if (harmonic < 1 || harmonic > WaveTables::maxHarmonics)
+    return;
+  {
+    const ScopedLock lock (spectrumLock);
+    spectra[shape].amplitude[harmonic - 1] = amplitude;
+    spectra[shape].phase[harmonic - 1] = phase;
+  }
+  dirty.fetch_or (1u << shape);
+  notify();
+}
+
+void WaveTableBank::setSpectrum (Shape shape, const Spectrum& spectrum) {
+  {
+    const ScopedLock lock (spectrumLock);
+    spectra[shape] = spectrum;
+  }
+  dirty.fetch_or (1u << shape);
+  notify();
+}
+
+void WaveTableBank::setCapture (std::unique_ptr<AudioSampleBuffer> capture) {
+  {
+    const ScopedLock lock (spectrumLock);
+    pendingCapture = std::move (capture);
+  }
+  dirty.fetch_or (1u << captureSource);
+  notify();
+}
+
+void WaveTableBank::attachReader() noexcept {
+  // Announce the reader before reading the tables. A table the builder
+  // replaces after this point is kept until update() acknowledges it.
+  readerAttached.store (true);
+  auto sequence = published.load();
+  for (auto source = 0; source < numSources; ++source)
+    bound[source] = current[source].load();
+  acknowledged.store (sequence);
+}
+
+void WaveTableBank::detachReader() noexcept {
+  readerAttached.store (false);
+  notify();
+}
+
+void WaveTableBank::publish (int source, AudioSampleBuffer* table) {
+  auto* old = current[source].exchange (table);
+  auto sequence = ++published;
+  retired.push_back ({old, sequence});
+}
+
+void WaveTableBank::reclaim() {
+  auto attached = readerAttached.load();
+  auto safe = acknowledged.load (std::memory_order_acquire);
+  auto end = std::remove_if (retired.begin(), retired.end(), [=] (const Retired& r) {
+    if (attached && r.sequence > safe)
+      return false;
+    delete r.table;
+    return true;
+  });
+  retired.erase (end, retired.end());
+}
+
+void WaveTableBank::run() {
+  while (! threadShouldExit()) {
+    auto sources = dirty.exchange (0);
+    for (auto shape = 0; shape < WaveTables::NumShapes; ++shape) {
+      if ((sources & (1u << shape)) == 0)
+        continue;
+      Tracing::Scope trace ("rebuild wavetable");
+      auto spectrum = getSpectrum ((Shape) shape);
+      auto table = std::make_unique<AudioSampleBuffer>();
+      WaveTables::createTable (spectrum, *table);
+      publish (shape, table.release());
+    }
+    if ((sources & (1u << captureSource)) != 0) {
+      std::unique_ptr<AudioSampleBuffer> capture;
+      {
+        const ScopedLock lock (spectrumLock);
+        capture = std::move (pendingCapture);
+      }
+      if (capture != nullptr)
+        publish (captureSource, capture.release());
+    }
+    // the tables are playing by now, so saving them for the next start
+    // doesn't hold anything up
+    if (writeCache) {
+      writeCache = false;
+      Tracing::Scope trace ("write wavetable cache");
+      WaveTableCache::write();
+    }
+    reclaim();
+    // poll while tables wait for the audio thread to move off them
+    wait (retired.empty() ? -1 : 50);
+  }
+}
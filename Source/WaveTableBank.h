@@ -0,0 +1,145 @@
+//==============================================================================
+// WaveTableBank.h
+// Rebuilds edited wavetables off the audio thread and swaps them in.
+//==============================================================================
+
+#pragma once
+
+#include "WaveTableCache.h"
+
+/// WaveTableBank holds the current table and editable spectrum of every
+/// WT_* shape, plus a buffer of audio captured from the output for the
+/// granular generator. Spectrum edits made on the message thread wake a low
+/// priority builder thread that renders the new table by inverse FFT and
+/// publishes it with an atomic pointer swap. Captures are published the
+/// same way. The audio thread adopts published tables in update(), which
+/// never blocks or allocates.
+///
+/// The default tables are copied out of a WaveTableCache, which is then
+/// unmapped. The audio thread only reads tables the bank owns, so it never
+/// takes a page fault on a mapped page the kernel has dropped. When the
+/// cache is missing or stale the tables start
+/// silent, and the builder generates them and then writes the cache for the
+/// next start. Edits are never cached.
+///
+/// Replaced tables are reclaimed read-copy-update style. Each is retired
+/// with the sequence number of the swap that replaced it and deleted by the
+/// builder once the audio thread has acknowledged that sequence, i.e. once
+/// no generator can still be reading it. While no reader is attached (see
+/// attachReader()) retired tables are deleted straight away.
+class WaveTableBank : private Thread
+{
+public:
+  using Shape = WaveTables::Shape;
+  using Spectrum = WaveTables::Spectrum;
+
+  /// Source index of the captured audio. Indexes below it are the WT_*
+  /// tables.
+  static constexpr int captureSource = WaveTables::NumShapes;
+  static constexpr int numSources = WaveTables::NumShapes + 1;
+
+  /// Copies every table from the cache, or schedules it to be built from
+  /// its default spectrum, and starts the builder.
+  WaveTableBank();
+
+  /// Stops the builder and deletes every table.
+  ~WaveTableBank() override;
+
+  //==============================================================================
+  // Message thread
+
+  /// Returns a copy of the spectrum of a shape.
+  Spectrum getSpectrum (Shape shape) const;
+
+  /// Sets the amplitude and phase of harmonic (1 to maxHarmonics) of a
+  /// shape and schedules the shape's table for rebuilding. Edits that
+  /// arrive faster than the builder are coalesced.
+  void setHarmonic (Shape shape, int harmonic, float amplitude, float phase);
+
+  /// Replaces the whole spectrum of a shape and schedules a rebuild.
+  void setSpectrum (Shape shape, const Spectrum& spectrum);
+
+  /// Schedules captured audio to replace the capture source. The buffer
+  /// holds mono audio plus a guard sample equal to the first.
+  void setCapture (std::unique_ptr<AudioSampleBuffer> capture);
+
+  //==============================================================================
+  // Audio thread
+
+  /// Binds the current tables for a reader. Call from prepareToPlay(),
+  /// before the first update().
+  void attachReader() noexcept;
+
+  /// Declares that the audio thread will not read any table until the next
+  /// attachReader(). Call from releaseResources().
+  void detachReader() noexcept;
+
+  /// Returns the buffer of a source the audio thread is currently bound to.
+  const AudioSampleBuffer& getTable (int source) const noexcept { return *bound[source]; }
+
+  /// Adopts any tables published since the last call. For each one
+  /// rebind (const AudioSampleBuffer& oldTable, const AudioSampleBuffer&
+  /// newTable) is called so the caller can move its generators over, after
+  /// which the old table may be deleted at any time. Call once per block.
+  template <typename Rebind>
+  void update (Rebind&& rebind) noexcept
+  {
+    auto sequence = published.load (std::memory_order_acquire);
+    if (sequence == acknowledged.load (std::memory_order_relaxed))
+      return;
+    for (auto source = 0; source < numSources; ++source) {
+      auto* table = current[source].load (std::memory_order_acquire);
+      if (table != bound[source]) {
+        rebind (*bound[source], *table);
+        bound[source] = table;
+      }
+    }
+    acknowledged.store (sequence, std::memory_order_release);
+  }
+
+private:
+  /// The builder thread: rebuilds edited shapes and reclaims old tables.
+  void run() override;
+
+  /// Publishes a new table for a source and retires the one it replaces.
+  void publish (int source, AudioSampleBuffer* table);
+
+  /// Deletes the retired tables the audio thread can no longer be reading.
+  void reclaim();
+
+  /// A table replaced by the swap with sequence number 'sequence'.
+  struct Retired
+  {
+    AudioSampleBuffer* table;
+    uint64 sequence;
+  };
+
+  /// The edited spectra and the next capture, guarded by spectrumLock.
+  /// Only the message and builder threads touch them.
+  Spectrum spectra[WaveTables::NumShapes];
+  std::unique_ptr<AudioSampleBuffer> pendingCapture;
+  CriticalSection spectrumLock;
+  /// One bit per source that changed since its table was published.
+  std::atomic<uint32> dirty {0};
+
+  /// The newest table of each source, written by the builder.
+  std::atomic<AudioSampleBuffer*> current[numSources];
+  /// The tables the audio thread's generators read. Only accessed by the
+  /// audio thread, or while no reader is attached.
+  const AudioSampleBuffer* bound[numSources] {};
+  /// The number of swaps published, and the number the audio thread has
+  /// adopted.
+  std::atomic<uint64> published {0};
+  std::atomic<uint64> acknowledged {0};
+  /// True between attachReader() and detachReader().
+  std::atomic<bool> readerAttached {false};
+
+  /// Whether the builder should write the default tables to the cache
+  /// once it has built them.
+  bool writeCache {false};
+
+  /// Tables waiting to be deleted. Only the builder touches this.
+  std::vector<Retired> retired;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveTableBank)
+};
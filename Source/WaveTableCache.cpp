@@ -0,0 +1,105 @@
+//==============================================================================
+// WaveTableCache.cpp
+// A memory-mapped file of the default wavetables, for fast startup.
+//==============================================================================
+
+#include "WaveTableCache.h"
+
+namespace
+{
+  /// Adds size bytes to a 64 bit FNV-1a hash.
+  void hash (uint64& key, const void* data, size_t size)
+  {
+    auto* bytes = static_cast<const uint8*> (data);
+    for (size_t i = 0; i < size; ++i)
+      key = (key ^ bytes[i]) * 0x100000001b3ull;
+  }
+
+  /// Returns a key covering everything the default tables depend on.
+  uint64 getKey()
+  {
+    auto key = 0xcbf29ce484222325ull;
+    const int parameters[] = {(int) WaveTableCache::formatVersion, WaveTables::tableSize,
+                              WaveTables::maxHarmonics, WaveTables::NumShapes};
+    hash (key, parameters, sizeof (parameters));
+    for (auto shape = 0; shape < WaveTables::NumShapes; ++shape) {
+      auto spectrum = WaveTables::getDefaultSpectrum ((WaveTables::Shape) shape);
+      hash (key, &spectrum, sizeof (spectrum));
+    }
+    return key;
+  }
+}
+
+WaveTableCache::WaveTableCache() {
+  auto cacheFile = getFile();
+  if (! cacheFile.existsAsFile())
+    return;
+  file = std::make_unique<MemoryMappedFile> (cacheFile, MemoryMappedFile::readOnly);
+  auto expected = getHeader();
+  auto size = headerSize + sizeof (float) * (size_t) stride * WaveTables::NumShapes;
+  auto* data = static_cast<const char*> (file->getData());
+  if (data == nullptr || file->getSize() != size) {
+    file.reset();
+    return;
+  }
+  Header found;
+  std::memcpy (&found, data, sizeof (Header));
+  if (! found.matches (expected)) {
+    file.reset();
+    return;
+  }
+  tables = reinterpret_cast<const float*> (data + headerSize);
+}
+
+WaveTableCache::Header WaveTableCache::getHeader() {
+  Header header;
+  zerostruct (header);
+  std::memcpy (header.magic, "WLTABLES", sizeof (header.magic));
+  header.version = formatVersion;
+  header.byteOrder = 0x01020304;
+  header.key = getKey();
+  header.numTables = WaveTables::NumShapes;
+  header.tableSize = WaveTables::tableSize;
+  header.stride = stride;
+  return header;
+}
+
+File WaveTableCache::getFile() {
+  return File::getSpecialLocation (File::userApplicationDataDirectory)
+    .getChildFile ("WaveLab")
+    .getChildFile ("wavetables-" + String::toHexString ((int64) getKey()) + ".bin");
+}
+
+bool WaveTableCache::write() {
+  auto target = getFile();
+  if (! target.getParentDirectory().createDirectory())
+    return false;
+  // write a private file first, so nothing maps it half written
+  auto temp = target.withFileExtension ("tmp").getNonexistentSibling();
+  {
+    FileOutputStream out (temp);
+    if (! out.openedOk())
+      return false;
+    char header[headerSize] {};
+    auto expected = getHeader();
+    std::memcpy (header, &expected, sizeof (Header));
+    auto ok = out.write (header, headerSize);
+    std::vector<float> padded ((size_t) stride, 0.0f);
+    AudioSampleBuffer table;
+    for (auto shape = 0; ok && shape < WaveTables::NumShapes; ++shape) {
+      WaveTables::createTable (WaveTables::getDefaultSpectrum ((WaveTables::Shape) shape), table);
+      FloatVectorOperations::copy (padded.data(), table.getReadPointer (0), WaveTables::tableSize + 1);
+      ok = out.write (padded.data(), sizeof (float) * padded.size());
+    }
+    out.flush();
+    if (! ok || out.getStatus().failed()) {
+      temp.deleteFile();
+      return false;
+    }
+  }
+  if (! temp.moveFileTo (target)) {
+    temp.deleteFile();
+    return false;
+  }
+  return true;
+}
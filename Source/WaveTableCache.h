@@ -0,0 +1,90 @@
+//==============================================================================
+// WaveTableCache.h
+// A memory-mapped file of the default wavetables, for fast startup.
+//==============================================================================
+
+#pragma once
+
+#include "WaveTables.h"
+
+/// WaveTableCache maps a binary file holding the table of every shape built
+/// from its default spectrum. Opening the cache costs a map and a header
+/// check whatever the number and size of the tables, rather than an FFT
+/// per table. The mapping is read-only and shared, so every running
+/// instance reads the same pages of the page cache. It is only a load
+/// path: the tables are copied out of it before the audio thread plays
+/// them, as reading a page the kernel has dropped is a page fault.
+///
+/// The file name carries a key hashed from the format version and every
+/// parameter the tables are generated from (table size, harmonics, shapes
+/// and default spectra), so a build that generates different tables never
+/// finds a stale file. Files are written to a temporary sibling and moved
+/// into place, so a reader never maps a partial file.
+class WaveTableCache
+{
+public:
+  /// Bump when the file layout or the table generation changes.
+  static constexpr uint32 formatVersion = 1;
+
+  /// Samples between the starts of successive tables: tableSize + 1 rounded
+  /// up to a multiple of 16, so every table is 64 byte aligned.
+  static constexpr int stride = (WaveTables::tableSize + 1 + 15) & ~15;
+
+  /// Maps the cache file, if it exists and matches this build. Check
+  /// isValid() before reading tables.
+  WaveTableCache();
+
+  /// Returns true if the file was mapped and its header matches.
+  bool isValid() const noexcept { return tables != nullptr; }
+
+  /// Returns the tableSize + 1 samples of a shape's default table. Only
+  /// call when isValid(). The memory is read-only.
+  const float* getTable (WaveTables::Shape shape) const noexcept { return tables + (size_t) shape * stride; }
+
+  /// Builds every default table and writes the cache file. Returns false if
+  /// the file can't be written. Slow, so call it off the audio and message
+  /// threads.
+  static bool write();
+
+  /// Returns the cache file for this build.
+  static File getFile();
+
+private:
+  /// The start of the file, followed by padding up to headerSize bytes and
+  /// then the tables.
+  struct Header
+  {
+    char magic[8];
+    uint32 version;
+    /// Written as 0x01020304, rejects files from a machine of the other
+    /// byte order.
+    uint32 byteOrder;
+    uint64 key;
+    uint32 numTables;
+    uint32 tableSize;
+    uint32 stride;
+
+    /// Compares field by field, as the padding between them is undefined.
+    bool matches (const Header& other) const noexcept
+    {
+      return std::memcmp (magic, other.magic, sizeof (magic)) == 0
+          && version == other.version
+          && byteOrder == other.byteOrder
+          && key == other.key
+          && numTables == other.numTables
+          && tableSize == other.tableSize
+          && stride == other.stride;
+    }
+  };
+
+  static constexpr size_t headerSize = 64;
+  static_assert (sizeof (Header) <= headerSize, "header overruns the tables");
+
+  /// Returns the header this build expects.
+  static Header getHeader();
+
+  std::unique_ptr<MemoryMappedFile> file;
+  const float* tables {nullptr};
+
+  JUCE_DECLARE_NON_COPYABLE (WaveTableCache)
+};
@@ -0,0 +1,67 @@
+//==============================================================================
+// WaveTables.cpp
+// Builds the single cycle tables played by the WT_* waveforms.
+//==============================================================================
+
+#include "WaveTables.h"
+
+WaveTables::Spectrum WaveTables::getDefaultSpectrum(Shape shape) {
+    Spectrum spectrum;
+    if (shape == Sine) {
+        spectrum.amplitude[0] = 1.0f;
+        return spectrum;
+    }
+    double numHarmonics = 15;
+    for (auto h = 1; h < numHarmonics; h++) {
+        auto odd = (h % 2 == 1);
+        double amplitude = 0.0;
+        switch (shape) {
+            case Impulse:  amplitude = 1.0; break;
+            case Square:   amplitude = odd ? 1.0 / h : 0.0; break;
+            case Sawtooth: amplitude = 1.0 / h; break;
+            case Triangle: amplitude = odd ? 1.0 / (h * h) : 0.0; break;
+            default:       break;
+        }
+        spectrum.amplitude[h - 1] = (float) (amplitude / numHarmonics);
+    }
+    return spectrum;
+}
+
+void WaveTables::createTable(const Spectrum& spectrum, AudioSampleBuffer& waveTable) {
+    // Pack the harmonics as the complex bins of a real inverse FFT. A bin of
+    // (size / 2) * a * e^(i theta) becomes a * cos (h * x + theta), and
+    // sin (y) = cos (y - pi / 2).
+    std::vector<float> bins((size_t) tableSize * 2, 0.0f);
+    for (auto h = 1; h <= maxHarmonics && h < tableSize / 2; ++h) {
+        auto magnitude = spectrum.amplitude[h - 1] * (tableSize / 2.0);
+        auto theta = spectrum.phase[h - 1] - MathConstants<double>::halfPi;
+        bins[(size_t) h * 2] = (float) (magnitude * std::cos(theta));
+        bins[(size_t) h * 2 + 1] = (float) (magnitude * std::sin(theta));
+    }
+    dsp::FFT fft(tableOrder);
+    fft.performRealOnlyInverseTransform(bins.data());
+
+    waveTable.setSize(1, tableSize + 1, false, false, true);
+    auto* samples = waveTable.getWritePointer(0);
+    FloatVectorOperations::copy(samples, bins.data(), tableSize);
+    auto peak = FloatVectorOperations::findMaximum(samples, tableSize);
+    peak = jmax(peak, -FloatVectorOperations::findMinimum(samples, tableSize));
+    if (peak > 1.0f) {
+        FloatVectorOperations::multiply(samples, 1.0f / peak, tableSize);
+    }
+    samples[tableSize] = samples[0];
+}
+
+void WaveTables::encode(const float* samples, int numSamples, Format format, uint16* dest) noexcept {
+    jassert(format != Float32);
+    if (format == Int16) {
+        for (auto i = 0; i < numSamples; ++i) {
+            auto value = jlimit(-1.0f, 1.0f, samples[i]);
+            dest[i] = (uint16) (int16) std::lround(value * 32767.0f);
+        }
+        return;
+    }
+    for (auto i = 0; i < numSamples; ++i) {
+        dest[i] = toHalf(samples[i]);
+    }
+}
@@ -0,0 +1,122 @@
+//==============================================================================
+// WaveTables.h
+// Builds the single cycle tables played by the WT_* waveforms.
+//==============================================================================
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#if JUCE_INTEL && defined (__F16C__)
+ #include <immintrin.h>
+#endif
+
+/// Every WT_* table is described by a harmonic spectrum and built from it by
+/// an inverse FFT. Tables hold one period of tableSize samples plus a guard
+/// sample equal to the first, so the oscillator can interpolate across the
+/// wrap.
+namespace WaveTables
+{
+  /// The shapes the default spectra describe, in WT_* menu order.
+  enum Shape { Sine, Impulse, Square, Sawtooth, Triangle, NumShapes };
+
+  /// Samples in one period of a table. Must be a power of two.
+  constexpr int tableOrder = 9;
+  constexpr int tableSize = 1 << tableOrder;
+
+  /// Number of editable harmonics. Harmonics above this are always zero.
+  constexpr int maxHarmonics = 64;
+
+  /// The amplitude and phase of harmonics 1 to maxHarmonics. Harmonic h
+  /// contributes amplitude[h - 1] * sin (h * x + phase[h - 1]) to a period
+  /// x in [0, 2pi).
+  struct Spectrum
+  {
+    float amplitude[maxHarmonics] {};
+    float phase[maxHarmonics] {};
+  };
+
+  /// Returns the spectrum the WT_* waveform of a shape starts out with:
+  /// the first 14 harmonics of its Fourier series, scaled by 1/15.
+  Spectrum getDefaultSpectrum(Shape shape);
+
+  /// Fills waveTable with tableSize + 1 samples of spectrum, resizing it if
+  /// necessary. If the harmonics add up to a peak above 1.0 the table is
+  /// scaled down to 1.0. Allocates, so never call it on the audio thread.
+  void createTable(const Spectrum& spectrum, AudioSampleBuffer& waveTable);
+
+  //==============================================================================
+  // Compact formats
+
+  /// The sample formats the oscillators can read a table in: 32 bit float,
+  /// IEEE 754 half float (11 bit precision, about 66 dB down at full scale)
+  /// and 16 bit integers scaled by 1/32767 (about 96 dB down). The 16 bit
+  /// formats halve the bytes every oscillator reads.
+  enum Format { Float32, Float16, Int16, NumFormats };
+
+  /// Returns the bytes one table takes in a format.
+  constexpr size_t getTableBytes(Format format) {
+    return (size_t) (tableSize + 1) * (format == Float32 ? sizeof (float) : sizeof (uint16));
+  }
+
+  /// Encodes numSamples samples in [-1.0, 1.0] into a 16 bit format,
+  /// rounding to nearest. Doesn't allocate.
+  void encode(const float* samples, int numSamples, Format format, uint16* dest) noexcept;
+
+  /// Returns a float as a half float, rounded to nearest even.
+  inline uint16 toHalf(float value) noexcept {
+    uint32 bits;
+    std::memcpy(&bits, &value, sizeof (bits));
+    auto sign = (bits >> 16) & 0x8000u;
+    auto magnitude = bits & 0x7fffffffu;
+    if (magnitude >= 0x477ff000u) {
+      // too large, infinite or not a number
+      return (uint16) (sign | (magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u));
+    }
+    if (magnitude < 0x38800000u) {
+      // below the smallest normal half, in steps of 2^-24
+      float f;
+      std::memcpy(&f, &magnitude, sizeof (f));
+      return (uint16) (sign | (uint32) std::nearbyint(f * 16777216.0f));
+    }
+    // rebias the exponent and round the 13 dropped bits, carrying into
+    // the exponent when the mantissa overflows
+    return (uint16) (sign | ((magnitude - (112u << 23) + 0xfffu + ((magnitude >> 13) & 1u)) >> 13));
+  }
+
+  /// Returns a half float as a float.
+  inline float fromHalf(uint16 half) noexcept {
+    auto sign = (uint32) (half & 0x8000u) << 16;
+    auto exponent = (half >> 10) & 0x1fu;
+    auto mantissa = (uint32) (half & 0x3ffu);
+    if (exponent == 0) {
+      auto value = (float) mantissa * (1.0f / 16777216.0f);
+      return sign != 0 ? -value : value;
+    }
+    auto bits = sign | (exponent == 0x1fu ? 0x7f800000u : (exponent + 112u) << 23) | (mantissa << 13);
+    float value;
+    std::memcpy(&value, &bits, sizeof (value));
+    return value;
+  }
+
+  /// Decodes eight samples of a 16 bit format. Half floats are converted
+  /// by one F16C instruction where the build targets it.
+  template <Format format>
+  forcedinline void decode8(const uint16* samples, float* dest) noexcept {
+    static_assert(format != Float32, "only the 16 bit formats are encoded");
+    if constexpr (format == Int16) {
+      for (auto i = 0; i < 8; ++i) {
+        dest[i] = (float) (int16) samples[i] * (1.0f / 32767.0f);
+      }
+    }
+    else {
+     #if JUCE_INTEL && defined (__F16C__)
+      _mm256_storeu_ps(dest, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples))));
+     #else
+      for (auto i = 0; i < 8; ++i) {
+        dest[i] = fromHalf(samples[i]);
+      }
+     #endif
+    }
+  }
+}